@@ -22,93 +22,118 @@
 
 #include "cfio.h"
 #include "send.h"
+#include "server.h"
 #include "map.h"
 #include "id.h"
 #include "buffer.h"
 #include "debug.h"
 #include "times.h"
 #include "cfio_error.h"
+#include "define.h"
+#include "trace.h"
+#include "stats.h"
+#include "capture.h"
+#include "transport.h"
+#include "tune.h"
+#include "latency.h"
 
 /* my real rank in mpi_comm_world */
-static int rank;
+static cfio_proc_local int rank;
 /*  the num of the app proc*/
-static int client_num;
-static MPI_Comm inter_comm;
-static MPI_Comm client_comm, server_comm;
+static cfio_proc_local int client_num;
+static cfio_proc_local MPI_Comm inter_comm;
+static cfio_proc_local MPI_Comm client_comm, server_comm;
+/* whether the client is the leader which sends global metadata for its 
+ * server, only used in LEADER_META mode */
+static cfio_proc_local int is_leader;
 
-int cfio_init(int x_proc_num, int y_proc_num, int ratio)
+/**
+ * @brief: check MPI and create server_comm, the servers are proc client_num ~
+ *	size - 1 in MPI_COMM_WORLD
+ *
+ * @param server_proc_num: return amount of server procs
+ * @param best_server_amount: return the best amount of server by ratio
+ *
+ * @return: error code
+ */
+static int _init_comm(int ratio, int *server_proc_num, int *best_server_amount)
 {
-    int rc, i;
-    int size;
-    int root = 0;
-    int error, ret;
-    int server_proc_num;
-    int best_server_amount;
-    MPI_Group group, client_group, server_group;
+    int i, size, ret;
+    MPI_Group group, server_group;
     int *ranks;
 
     //set_debug_mask(DEBUG_CFIO | DEBUG_SERVER);// | DEBUG_MSG | DEBUG_SERVER);
-    rc = MPI_Initialized(&i); 
+    MPI_Initialized(&i); 
     if( !i )
     {
 	error("MPI should be initialized before the cfio\n");
 	return -1;
     }
 
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    size = cfio_transport_size();
+    rank = cfio_transport_rank();
+    /* over the loopback, they are of the process, inited in cfio_loopback_run*/
+    if(!cfio_transport_is_loopback())
+    {
+	cfio_log_init(rank);
+	cfio_trace_init(rank);
+	cfio_stats_init(rank);
+    }
+    if((ret = cfio_tune_init(rank)) < 0)
+    {
+	return ret;
+    }
 
-    //if(rank == 100)
-    //{
-    //    set_debug_mask(DEBUG_MAP);
-    //}
-    
-    client_num = x_proc_num * y_proc_num;
-    server_proc_num = size - client_num;
-    if(server_proc_num < 0)
+    *server_proc_num = size - client_num;
+    if(*server_proc_num < 0)
     {
-	server_proc_num = 0;
+	*server_proc_num = 0;
     }
     
-    best_server_amount = (int)((double)client_num / ratio);
-    if(best_server_amount <= 0)
+    ratio = cfio_tune_ratio(ratio, client_num, *server_proc_num);
+    *best_server_amount = (int)((double)client_num / ratio);
+    if(*best_server_amount <= 0)
+    {
+	*best_server_amount = 1;
+    }
+
+    /* the servers over the loopback are threads, they can't share a comm */
+    if(cfio_transport_is_loopback())
     {
-	best_server_amount = 1;
+	server_comm = MPI_COMM_NULL;
+	return CFIO_ERROR_NONE;
     }
 
     MPI_Comm_group(MPI_COMM_WORLD, &group);
-    
-    //ranks = malloc(client_num * sizeof(int));
-    //for(i = 0; i < client_num; i ++)
-    //{
-    //    ranks[i] = i;
-    //}
-    //MPI_Group_incl(group, client_num, ranks, &client_group);
-    //MPI_Comm_create(MPI_COMM_WORLD, client_group, &client_comm);
-    //free(ranks);
-
-    ranks = malloc(server_proc_num * sizeof(int));
-    for(i = 0; i < server_proc_num; i ++)
+
+    ranks = malloc(*server_proc_num * sizeof(int));
+    for(i = 0; i < *server_proc_num; i ++)
     {
 	ranks[i] = i + client_num;
     }
-    MPI_Group_incl(group, server_proc_num, ranks, &server_group);
+    MPI_Group_incl(group, *server_proc_num, ranks, &server_group);
     MPI_Comm_create(MPI_COMM_WORLD, server_group, &server_comm);
     free(ranks);
 
-    //times_start();
+    return CFIO_ERROR_NONE;
+}
 
-    if((ret = cfio_map_init(
-		    x_proc_num, y_proc_num, server_proc_num, 
-		    best_server_amount, MPI_COMM_WORLD, server_comm)) < 0)
+/**
+ * @brief: start the server or init the client after map is inited
+ *
+ * @return: error code
+ */
+static int _init_proc()
+{
+    int ret;
+
+    if((ret = cfio_latency_init(rank)) < 0)
     {
-	error("Map Init Fail.");
 	return ret;
     }
-
     if(cfio_map_proc_type(rank) == CFIO_MAP_TYPE_SERVER)
     {
-	if((ret = cfio_server_init()) < 0)
+	if((ret = cfio_server_init(rank)) < 0)
 	{
 	    error("");
 	    return ret;
@@ -131,6 +156,12 @@ int cfio_init(int x_proc_num, int y_proc_num, int ratio)
 	    error("");
 	    return ret;
 	}
+	is_leader = (0 == cfio_map_get_client_index_of_server(rank));
+	if((ret = cfio_capture_init(rank)) < 0)
+	{
+	    error("");
+	    return ret;
+	}
 	
     }
 
@@ -138,6 +169,69 @@ int cfio_init(int x_proc_num, int y_proc_num, int ratio)
     return CFIO_ERROR_NONE;
 }
 
+int cfio_init(int x_proc_num, int y_proc_num, int ratio)
+{
+    int ret;
+    int server_proc_num;
+    int best_server_amount;
+
+    client_num = x_proc_num * y_proc_num;
+    if((ret = _init_comm(ratio, &server_proc_num, &best_server_amount)) < 0)
+    {
+	goto RETURN;
+    }
+
+    if((ret = cfio_map_init(
+		    x_proc_num, y_proc_num, server_proc_num, 
+		    best_server_amount, MPI_COMM_WORLD, server_comm)) < 0)
+    {
+	error("Map Init Fail.");
+	goto RETURN;
+    }
+
+    ret = _init_proc();
+
+RETURN:
+    /* the other procs over the loopback would wait for this one forever */
+    cfio_transport_loopback_fail(ret);
+    return ret;
+}
+
+int cfio_init_nd(int _client_num, int ndims, 
+	size_t *start, size_t *count, int ratio)
+{
+    int ret;
+    int server_proc_num;
+    int best_server_amount;
+
+    if(_client_num <= 0 || ndims <= 0)
+    {
+	error("invalid client_num(%d) or ndims(%d).", _client_num, ndims);
+	ret = CFIO_ERROR_INVALID_INIT_ARG;
+	goto RETURN;
+    }
+
+    client_num = _client_num;
+    if((ret = _init_comm(ratio, &server_proc_num, &best_server_amount)) < 0)
+    {
+	goto RETURN;
+    }
+
+    if((ret = cfio_map_init_nd(
+		    client_num, ndims, start, count, server_proc_num, 
+		    best_server_amount, MPI_COMM_WORLD, server_comm)) < 0)
+    {
+	error("Map Init Fail.");
+	goto RETURN;
+    }
+
+    ret = _init_proc();
+
+RETURN:
+    cfio_transport_loopback_fail(ret);
+    return ret;
+}
+
 int cfio_finalize()
 {
     int ret,flag;
@@ -162,10 +256,57 @@ int cfio_finalize()
 	cfio_id_final();
 
 	cfio_send_final();
+	cfio_capture_final();
     }
+    cfio_tune_final(cfio_map_proc_type(rank));
+    cfio_latency_final();
 
     cfio_map_final();
     debug(DEBUG_CFIO, "success return.");
+    if(!cfio_transport_is_loopback())
+    {
+	/* after all threads finish */
+	cfio_stats_final();
+	cfio_trace_final();
+	cfio_log_final();
+    }
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_loopback_run(int proc_num, 
+	void (*func)(int rank, int size, void *arg), void *arg)
+{
+    int ret;
+
+    if(NULL == func)
+    {
+	error("args should not be NULL.");
+	return CFIO_ERROR_ARG_NULL;
+    }
+
+    cfio_log_init(0);
+    cfio_trace_init(0);
+    cfio_stats_init(0);
+
+    ret = cfio_transport_loopback_run(proc_num, func, arg);
+
+    cfio_stats_final();
+    cfio_trace_final();
+    cfio_log_final();
+
+    return ret;
+}
+
+int cfio_get_stats(cfio_stats_t *stats)
+{
+    if(NULL == stats)
+    {
+	error("args should not be NULL.");
+	return CFIO_ERROR_ARG_NULL;
+    }
+
+    cfio_stats_get(stats);
+
     return CFIO_ERROR_NONE;
 }
 
@@ -214,6 +355,95 @@ int cfio_create(
     debug(DEBUG_CFIO, "success return.");
     return CFIO_ERROR_NONE;
 }
+/**
+ * @brief: begin a schema
+ *
+ * @param schemaidp: pointer to location where returned schema ID is to be 
+ *	stored
+ *
+ * @return: 0 if success
+ */
+int cfio_schema_begin(int *schemaidp)
+{
+    if(schemaidp == NULL)
+    {
+	error("args should not be NULL.");
+	return CFIO_ERROR_ARG_NULL;
+    }
+
+    int ret;
+
+    if((ret = cfio_id_assign_schema(schemaidp)) < 0)
+    {
+	error("");
+	return ret;
+    }
+
+    cfio_send_schema_begin(*schemaidp);
+
+    debug(DEBUG_CFIO, "schemaid = %d", *schemaidp);
+
+    debug(DEBUG_CFIO, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: create a file from a schema
+ *
+ * @param path: the file anme of the new netCDF dataset
+ * @param cmode: the creation mode flag
+ * @param schemaid: the schema ID
+ * @param ncidp: pointer to location where returned netCDF ID is to be stored
+ *
+ * @return: 0 if success
+ */
+int cfio_create_from_schema(
+	char *path, int cmode, int schemaid, int *ncidp)
+{
+    if(path == NULL || ncidp == NULL)
+    {
+	error("args should not be NULL.");
+	return CFIO_ERROR_ARG_NULL;
+    }
+
+    int ret;
+
+    if((ret = cfio_id_assign_nc_from(schemaid, ncidp)) < 0)
+    {
+	error("");
+	return ret;
+    }
+
+    cfio_send_create_from_schema(path, cmode, schemaid, *ncidp);
+
+    debug(DEBUG_CFIO, "path = %s, schemaid = %d, ncid = %d", 
+	    path, schemaid, *ncidp);
+
+    debug(DEBUG_CFIO, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: free a schema
+ *
+ * @param schemaid: the schema ID
+ *
+ * @return: 0 if success
+ */
+int cfio_schema_free(int schemaid)
+{
+    int ret;
+
+    if((ret = cfio_id_remove_nc(schemaid)) < 0)
+    {
+	error("");
+	return ret;
+    }
+    cfio_send_schema_free(schemaid);
+
+    debug(DEBUG_CFIO, "success return.");
+    return CFIO_ERROR_NONE;
+}
 /**
  * @brief: def_dim
  *
@@ -240,13 +470,21 @@ int cfio_def_dim(
     
     cfio_msg_t *msg;
 
-    if((ret = cfio_id_assign_dim(ncid, name, idp)) < 0)
+    if((ret = cfio_id_assign_dim(ncid, name, len, idp)) < 0)
     {
 	error("");
 	return ret;
     }
 
-    cfio_send_def_dim(ncid, name, len, *idp);
+#ifdef LEADER_META
+    int is_schema, rec_dim;
+
+    cfio_id_inq_nc(ncid, &is_schema, &rec_dim);
+    if(is_leader || is_schema)
+#endif
+    {
+	cfio_send_def_dim(ncid, name, len, *idp);
+    }
 
     debug(DEBUG_CFIO, "success return.");
     return CFIO_ERROR_NONE;
@@ -274,7 +512,30 @@ int cfio_def_var(
 	error("");
 	return ret;
     }
-    
+    /* put_vara of the var is encoded against start and count */
+    if((ret = cfio_id_set_decomp(ncid, *varidp, 
+		    ndims, start, count, xtype)) < 0)
+    {
+	error("");
+	return ret;
+    }
+
+#ifdef LEADER_META
+    int is_schema, rec_dim;
+
+    /**
+     * defs of schema are always sent by all clients, because a file can be
+     * created from a schema when any client's create msg arrives
+     **/
+    cfio_id_inq_nc(ncid, &is_schema, &rec_dim);
+    if(!is_leader && !is_schema)
+    {
+	cfio_send_def_var_part(ncid, ndims, start, count, 
+		ndims > 0 && dimids[0] == rec_dim, *varidp);
+	debug(DEBUG_CFIO, "success return.");
+	return CFIO_ERROR_NONE;
+    }
+#endif
     cfio_send_def_var(ncid, name, xtype, 
 	    ndims, dimids, start, count, *varidp);
     
@@ -288,11 +549,16 @@ int cfio_put_att(
 {
     cfio_msg_t *msg;
     
-    //if(cfio_map_get_client_index_of_server(rank) == 0)
-    //{
-    cfio_send_put_att(ncid, varid, name,
-	    xtype, len, op);
-    //}
+#ifdef LEADER_META
+    int is_schema, rec_dim;
+
+    cfio_id_inq_nc(ncid, &is_schema, &rec_dim);
+    if(is_leader || is_schema)
+#endif
+    {
+	cfio_send_put_att(ncid, varid, name,
+		xtype, len, op);
+    }
     debug(DEBUG_CFIO, "ncid = %d, var_id = %d, name = %s, len = %lu",
 	    ncid, varid, name, len);
 
@@ -339,6 +605,7 @@ int cfio_put_vara_float(
     }
 
     cfio_msg_t *msg;
+    int ret;
 
     //times_start();
 
@@ -348,8 +615,11 @@ int cfio_put_vara_float(
     //  start, count, CFIO_FLOAT, fp, head_size, dim - 1);
     debug(DEBUG_CFIO, "start :(%lu, %lu), count :(%lu, %lu)", 
 	    start[0], start[1], count[0], count[1]);
-    cfio_send_put_vara(ncid, varid, dim, 
-	    start, count, CFIO_FLOAT, fp);
+    if((ret = cfio_send_put_vara(ncid, varid, dim, 
+		    start, count, CFIO_FLOAT, fp)) < 0)
+    {
+	return ret;
+    }
 
     debug_mark(DEBUG_CFIO);
 
@@ -369,6 +639,7 @@ int cfio_put_vara_double(
     }
 
     cfio_msg_t *msg;
+    int ret;
 
 	//times_start();
     debug(DEBUG_CFIO, "start :(%lu, %lu), count :(%lu, %lu)", 
@@ -378,8 +649,11 @@ int cfio_put_vara_double(
 
     //_put_vara(io_proc_id, ncid, varid, dim,
     //        start, count, CFIO_DOUBLE, fp, head_size, dim - 1);
-    cfio_send_put_vara(ncid, varid, dim, 
-	    start, count, CFIO_DOUBLE, fp);
+    if((ret = cfio_send_put_vara(ncid, varid, dim, 
+		    start, count, CFIO_DOUBLE, fp)) < 0)
+    {
+	return ret;
+    }
 
     debug_mark(DEBUG_CFIO);
 
@@ -399,6 +673,7 @@ int cfio_put_vara_int(
     }
 
     cfio_msg_t *msg;
+    int ret;
 
 	//times_start();
     debug(DEBUG_CFIO, "start :(%lu, %lu), count :(%lu, %lu)", 
@@ -408,8 +683,11 @@ int cfio_put_vara_int(
 
     //_put_vara(io_proc_id, ncid, varid, dim,
     //        start, count, CFIO_DOUBLE, fp, head_size, dim - 1);
-    cfio_send_put_vara(ncid, varid, dim, 
-	    start, count, CFIO_INT, fp);
+    if((ret = cfio_send_put_vara(ncid, varid, dim, 
+		    start, count, CFIO_INT, fp)) < 0)
+    {
+	return ret;
+    }
 
     debug_mark(DEBUG_CFIO);
 
@@ -418,6 +696,49 @@ int cfio_put_vara_int(
     return CFIO_ERROR_NONE;
 }
 
+int cfio_put_vara_multi(
+	int ncid, int n, int *varids,
+	size_t **starts, size_t **counts, cfio_type *types, void **bufs)
+{
+    int i, ret;
+    cfio_id_decomp_t **decomps;
+
+    if(varids == NULL || starts == NULL || counts == NULL || 
+	    types == NULL || bufs == NULL)
+    {
+	error("args should not be NULL.");
+	return CFIO_ERROR_ARG_NULL;
+    }
+    if(n <= 0)
+    {
+	return CFIO_ERROR_NONE;
+    }
+
+    decomps = malloc(n * sizeof(cfio_id_decomp_t *));
+    if(NULL == decomps)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    for(i = 0; i < n; i ++)
+    {
+	if((ret = cfio_id_get_decomp(ncid, varids[i], &decomps[i])) < 0)
+	{
+	    error("var(%d) of nc(%d) is not defined.", varids[i], ncid);
+	    free(decomps);
+	    return ret;
+	}
+    }
+
+    ret = cfio_send_put_vara_multi(ncid, n, varids, decomps, 
+	    starts, counts, types, bufs);
+    free(decomps);
+
+    debug(DEBUG_CFIO, "ncid = %d, n = %d", ncid, n);
+
+    return ret;
+}
+
 int cfio_io_end()
 {
     debug(DEBUG_CFIO, "Start cfio_io_end");
@@ -468,6 +789,31 @@ void cfio_init_c_(int *x_proc_num, int *y_proc_num, int *ratio, int *ierr)
     *ierr = cfio_init(*x_proc_num, *y_proc_num, *ratio);
 }
 
+void cfio_init_nd_c_(int *_client_num, int *ndims, 
+	int *start, int *count, int *ratio, int *ierr)
+{
+    size_t *_start;
+    int i, j;
+
+    _start = malloc(2 * (*ndims) * sizeof(size_t));
+    if(NULL == _start)
+    {
+	debug(DEBUG_CFIO, "malloc fail");
+	*ierr = CFIO_ERROR_MALLOC;
+	return;
+    }
+    for(i = 0, j = (*ndims) - 1; i < (*ndims); i ++, j --)
+    {
+	_start[i] = start[j] - 1;
+	_start[(*ndims) + i] = count[j];
+    }
+
+    *ierr = cfio_init_nd(*_client_num, *ndims, 
+	    _start, _start + (*ndims), *ratio);
+
+    free(_start);
+}
+
 void cfio_finalize_c_(int *ierr)
 {
     *ierr = cfio_finalize();
@@ -489,6 +835,26 @@ void cfio_create_c_(
 
     return;
 }
+void cfio_schema_begin_c_(int *schemaidp, int *ierr)
+{
+    *ierr = cfio_schema_begin(schemaidp);
+}
+
+void cfio_create_from_schema_c_(
+	char *path, int *len, int *cmode, int *schemaid, int *ncidp, int *ierr)
+{
+    path[*len] = 0;
+
+    *ierr = cfio_create_from_schema(path, *cmode, *schemaid, ncidp);
+
+    return;
+}
+
+void cfio_schema_free_c_(int *schemaid, int *ierr)
+{
+    *ierr = cfio_schema_free(*schemaid);
+}
+
 void cfio_def_dim_c_(
 	int *ncid, char *name, int *name_len, int *len, int *idp, int *ierr)
 {
@@ -47,6 +47,24 @@
  * @return: error code
  */
 int cfio_init(int x_proc_num, int y_proc_num, int ratio);
+/**
+ * @brief: init by the block each client writes, for any number of dims and 
+ *	irregular decompositions, e.g. 3-D blocks where the blocks over land
+ *	are eliminated. clients are grouped onto servers by their blocks, and
+ *	the servers write only the regions covered by the blocks. all procs 
+ *	must call it
+ *
+ * @param client_num: client proc number, the clients are rank 0 ~ 
+ *	client_num - 1 in MPI_COMM_WORLD
+ * @param ndims: number of dims of the block
+ * @param start: start of the block of this proc, ignored in server procs
+ * @param count: count of the block of this proc, ignored in server procs
+ * @param ratio: client : server = ratio
+ *
+ * @return: error code
+ */
+int cfio_init_nd(int client_num, int ndims, 
+	size_t *start, size_t *count, int ratio);
 
 /**
  * @brief cfio_Finalize : stop the cfio services, the function 
@@ -72,12 +90,48 @@ int cfio_proc_type();
  */
 int cfio_create(
 	char *path, int cmode, int *ncidp);
+/**
+ * @brief: begin a schema, a schema is a reusable file template. dims, vars and
+ *	atts are defined in the schema by cfio_def_dim, cfio_def_var and 
+ *	cfio_put_att with the schema ID as the netCDF ID, and the files created
+ *	by cfio_create_from_schema have them without sending any define msg.
+ *	cfio_enddef should not be called on a schema
+ *
+ * @param schemaidp: pointer to location where returned schema ID is to be 
+ *	stored
+ *
+ * @return: 0 if success
+ */
+int cfio_schema_begin(int *schemaidp);
+/**
+ * @brief: create a file from a schema, the dim and var IDs of the file are
+ *	the same as the schema, and the file is already in data mode, so 
+ *	cfio_put_vara_* can be called directly
+ *
+ * @param path: the file anme of the new netCDF dataset
+ * @param cmode: the creation mode flag
+ * @param schemaid: the schema ID
+ * @param ncidp: pointer to location where returned netCDF ID is to be stored
+ *
+ * @return: 0 if success
+ */
+int cfio_create_from_schema(
+	char *path, int cmode, int schemaid, int *ncidp);
+/**
+ * @brief: free a schema, the files created from it are not affected
+ *
+ * @param schemaid: the schema ID
+ *
+ * @return: 0 if success
+ */
+int cfio_schema_free(int schemaid);
 /**
  * @brief: cfio_def_dim
  *
  * @param ncid: NetCDF group ID
  * @param name: Dimension name
- * @param len: Length of dimension
+ * @param len: Length of dimension, CFIO_UNLIMITED for the record 
+ *	dimension, which can only be the first dimension of a variable
  * @param idp: pointer to location for returned dimension ID
  *
  * @return: 0 if success
@@ -145,7 +199,8 @@ int cfio_inq_varid(int ncid, char *var_name, int *varid);
  *	each dimension of the block of data values to be written
  * @param fp: pinter to the data value to be written
  *
- * @return: 
+ * @return: error code, CFIO_ERROR_CONVERT if the data can't be converted
+ *	into the type of the variable, i.e. only one of them is CFIO_CHAR
  */
 int cfio_put_vara_float(
 	int ncid, int varid, int dim,
@@ -162,11 +217,31 @@ int cfio_put_vara_float(
  *	each dimension of the block of data values to be written
  * @param fp: pinter to the data value to be written
  *
- * @return: 
+ * @return: error code, CFIO_ERROR_CONVERT if the data can't be converted
+ *	into the type of the variable, i.e. only one of them is CFIO_CHAR
  */
 int cfio_put_vara_double(
 	int ncid, int varid, int dim,
 	size_t *start, size_t *count, double *fp);
+/**
+ * @brief: put parts of many variables of a file in one call, the parts are
+ *	sent in as few msgs as possible, ndims of each variable is the one in 
+ *	its cfio_def_var
+ *
+ * @param ncid: netCDF ID
+ * @param n: amount of variables
+ * @param varids: vector of n variable IDs
+ * @param starts: vector of n start vectors
+ * @param counts: vector of n count vectors
+ * @param types: vector of n types of the data, like CFIO_FLOAT
+ * @param bufs: vector of n pointers to the data values to be written
+ *
+ * @return: error code, CFIO_ERROR_CONVERT if the data of a variable can't be
+ *	converted into its type, none of the parts is put then
+ */
+int cfio_put_vara_multi(
+	int ncid, int n, int *varids,
+	size_t **starts, size_t **counts, cfio_type *types, void **bufs);
 /**
  * @brief: cfio_close
  *
@@ -176,5 +251,41 @@ int cfio_put_vara_double(
  */
 int cfio_close(
 	int ncid);
+/**
+ * @brief: end the output of a step, the data put since the last cfio_io_end
+ *	is sent to the servers
+ *
+ * @return: 0 if success
+ */
+int cfio_io_end();
+/**
+ * @brief: get the runtime statistics of this proc, they are counted since
+ *	cfio_init. set CFIO_STATS to a file prefix in all procs to get a report
+ *	of each proc and the sum of all procs in cfio_finalize
+ *
+ * @param stats: pointer to location where the statistics is to be stored
+ *
+ * @return: error code
+ */
+int cfio_get_stats(cfio_stats_t *stats);
+/**
+ * @brief: run a program of proc_num procs as threads of this process, without
+ *	MPI ranks. thread i calls func(i, proc_num, arg), which works as the 
+ *	main function of rank i of an MPI program, e.g. calls cfio_init, the 
+ *	cfio functions and cfio_finalize. the msgs between clients and servers
+ *	go through memory, the log, trace and stats are of the process. MPI 
+ *	must be initialized by the process, the pnetcdf backend can't be used,
+ *	the null backend is selected if CFIO_BACKEND is not set. if cfio_init
+ *	of a proc fails, the run fails, the other procs don't wait for it, 
+ *	their msgs are dropped and their collectives fail
+ *
+ * @param proc_num: amount of procs, including clients and servers
+ * @param func: the main function of the procs
+ * @param arg: argument of func
+ *
+ * @return: error code, the error of the first failed proc if the run fails
+ */
+int cfio_loopback_run(int proc_num, 
+	void (*func)(int rank, int size, void *arg), void *arg);
 
 #endif
@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 #include "msg.h"
 #include "send.h"
@@ -24,13 +25,20 @@
 #include "map.h"
 #include "pthread.h"
 #include "id.h"
+#include "convert.h"
 #include "cfio_types.h"
 #include "cfio_error.h"
 #include "define.h"
 #include "quicklist.h"
-
-static cfio_msg_t *msg_head, *merge_msg = NULL;
-static cfio_buf_t *buffer;
+#include "trace.h"
+#include "stats.h"
+#include "capture.h"
+#include "transport.h"
+#include "tune.h"
+#include "latency.h"
+
+static cfio_proc_local cfio_msg_t *msg_head, *merge_msg = NULL;
+static cfio_proc_local cfio_buf_t *buffer;
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t empty_cond = PTHREAD_COND_INITIALIZER;
 static pthread_cond_t full_cond = PTHREAD_COND_INITIALIZER;
@@ -41,20 +49,73 @@ static pthread_mutex_t pause_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_t sender;
 
-static int rank;
+static cfio_proc_local int rank;
 
-static double start_time;
+static cfio_proc_local double start_time;
 
-static int max_msg_size;
+static cfio_proc_local int max_msg_size;
+/* msgs are merged and packed up to it, it's max_msg_size or less if tuned */
+static cfio_proc_local int merge_size;
+/* start time of the msg being packed, for trace */
+static cfio_proc_local uint64_t pack_start;
 //static int send_pause = 0;
 double send_time = 0;
 
+/**
+ * @brief: stamp the send time of the put_varas in a msg, which may be merged
+ *	from many msgs
+ */
+static void _stamp_send(cfio_msg_t *msg)
+{
+    char *addr, *vara;
+    cfio_msg_head_t *head;
+    int i, n;
+    uint64_t now = cfio_latency_now();
+
+    for(addr = msg->addr; addr < msg->addr + msg->size; addr += head->size)
+    {
+	head = (cfio_msg_head_t *)addr;
+	if(FUNC_NC_PUT_VARA == head->func_code)
+	{
+	    vara = addr;
+	    n = 1;
+	}else if(FUNC_NC_PUT_VARA_MULTI == head->func_code)
+	{
+	    vara = addr + sizeof(cfio_msg_put_vara_multi_t);
+	    n = ((cfio_msg_put_vara_multi_t *)addr)->n;
+	}else
+	{
+	    continue;
+	}
+	for(i = 0; i < n; i ++)
+	{
+	    if(((cfio_msg_head_t *)vara)->flags & CFIO_MSG_PUT_STAMP)
+	    {
+		((cfio_msg_stamp_t *)(vara + sizeof(cfio_msg_put_vara_t)))->send
+		    = now;
+	    }
+	    vara += ((cfio_msg_head_t *)vara)->size;
+	}
+    }
+}
+
 static inline int _send_msg(
 	cfio_msg_t *msg)
 {
     MPI_Status status;
-    MPI_Ssend(msg->addr, msg->size, MPI_BYTE, msg->dst, msg->src, 
+    cfio_stats_begin(t);
+
+    if(cfio_latency_on)
+    {
+	_stamp_send(msg);
+    }
+    cfio_transport_ssend(msg->addr, msg->size, msg->dst, msg->src, 
 	    msg->comm);
+    cfio_stats_add(send_num, 1);
+    cfio_stats_add(send_bytes, msg->size);
+    cfio_stats_time(send_time, t);
+    cfio_tune_add_send(msg->size, t);
+    cfio_trace_end("send", t, msg->size);
     //if(msg->func_code == FUNC_IO_END)
     //{
     //    printf("proc %d send point : %f\n", rank, times_cur() - start_time);
@@ -84,9 +145,19 @@ static inline void _main_send_msg(cfio_msg_t *msg)
 #elif (defined async_send)
     qlist_add_tail(&(msg->link), &(msg_head->link));
 #else
+    cfio_stats_begin(t);
     //times_start();
-    MPI_Ssend(msg->addr, msg->size, MPI_BYTE, msg->dst, msg->src, 
+    if(cfio_latency_on)
+    {
+	_stamp_send(msg);
+    }
+    cfio_transport_ssend(msg->addr, msg->size, msg->dst, msg->src, 
 	    msg->comm);
+    cfio_stats_add(send_num, 1);
+    cfio_stats_add(send_bytes, msg->size);
+    cfio_stats_time(send_time, t);
+    cfio_tune_add_send(msg->size, t);
+    cfio_trace_end("send", t, msg->size);
     //send_time += times_end();
     buffer->used_addr = msg->addr;
     free_buf(buffer, msg->size);
@@ -110,6 +181,10 @@ static inline void _add_msg(
     debug(DEBUG_SEND, "src=%d; dst=%d; func_code = %d; size = %lu", 
 	    msg->src, msg->dst, msg->func_code, msg->size);
     assert(msg->size <= max_msg_size);
+    if(cfio_capture_on)
+    {
+	cfio_capture_msg(msg);
+    }
 
 //    MPI_Isend(msg->addr, msg->size, MPI_BYTE, 
 //	    msg->dst, tag, msg->comm, &(msg->req));
@@ -157,11 +232,12 @@ static inline void _add_msg(
 	if(merge_msg != NULL)
 	{
 	    if(merge_msg->addr < msg->addr && 
-		    (msg->size + merge_msg->size) <= max_msg_size)
+		    (msg->size + merge_msg->size) <= merge_size)
 	    {
 		assert(msg->addr - merge_msg->addr == merge_msg->size);
 		merge_msg->size += msg->size;
 		free(msg);
+		cfio_stats_add(msg_merged, 1);
 	    }else
 	    {
 		//printf("send msg size : %lu\n", merge_msg->size);
@@ -229,6 +305,7 @@ static void* sender_thread(void *arg)
     cfio_msg_t *msg;
     int sender_finish = 0;
 
+    cfio_trace_thread_name("sender");
     while(sender_finish == 0)
     {
 	msg = _get_first_msg();
@@ -266,9 +343,10 @@ int cfio_send_init()
     }
     INIT_QLIST_HEAD(&(msg_head->link));
 
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    rank = cfio_transport_rank();
 
     max_msg_size = cfio_msg_get_max_size(rank);
+    merge_size = cfio_tune_msg_size(max_msg_size);
     
     buffer = cfio_buf_open(SEND_BUF_SIZE, &error);
 
@@ -334,6 +412,7 @@ static void cfio_send_client_buf_free()
     cfio_msg_t *msg = NULL;
     qlist_head_t *link;
     MPI_Status status;
+    cfio_stats_begin(t);
 
 #ifdef async_isend
     link = qlist_pop(&(msg_head->link));
@@ -350,25 +429,33 @@ static void cfio_send_client_buf_free()
 #ifdef async_send
     pthread_cond_wait(&full_cond, &full_mutex);
 #endif
+    cfio_stats_add(buf_wait_num, 1);
+    cfio_stats_time(buf_wait_time, t);
+    cfio_tune_add_time(t);
+    cfio_trace_end("buf_wait", t, 0);
 
     return;
 }
 
-int cfio_send_create(
-	char *path, int cmode, int ncid)
+/**
+ * @brief: create a msg, reserve its space in the buffer and pack its head
+ *
+ * @param code: function code of the msg
+ * @param size: size of the msg except the head, the total size is padded to
+ *	CFIO_MSG_ALIGN
+ * @param flags: flags of the function
+ *
+ * @return: the msg, the buffer's free_addr points to the end of the head
+ */
+static cfio_msg_t *_msg_begin(uint32_t code, size_t size, uint8_t flags)
 {
-    uint32_t code = FUNC_NC_CREATE;
     cfio_msg_t *msg;
+    cfio_msg_head_t *head;
 
     msg = cfio_msg_create();
     msg->src = rank;
-    msg->func_code = FUNC_NC_CREATE;
-
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    msg->size += cfio_buf_str_size(path);
-    msg->size += cfio_buf_data_size(sizeof(int));
-    msg->size += cfio_buf_data_size(sizeof(int));
+    msg->func_code = code;
+    msg->size = cfio_msg_align(sizeof(cfio_msg_head_t) + size);
 
 #ifdef async_send
     pthread_mutex_lock(&full_mutex);
@@ -377,62 +464,140 @@ int cfio_send_create(
 #ifdef async_send
     pthread_mutex_unlock(&full_mutex);
 #endif
+    pack_start = cfio_trace_on ? cfio_trace_now() : 0;
 
     msg->addr = buffer->free_addr;
 
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code, sizeof(uint32_t) , buffer);
+    head = (cfio_msg_head_t *)msg->addr;
+    head->size = msg->size;
+    head->func_code = code;
+    head->version = CFIO_MSG_VERSION;
+    head->flags = flags;
+    use_buf(buffer, sizeof(cfio_msg_head_t));
+
+    return msg;
+}
+
+/**
+ * @brief: skip the padding of the msg and forward it
+ */
+static void _msg_end(cfio_msg_t *msg)
+{
+    buffer->free_addr = msg->addr;
+    use_buf(buffer, msg->size);
+    cfio_stats_add(msg_num, 1);
+    cfio_stats_add(msg_bytes, msg->size);
+    cfio_trace_end("pack", pack_start, msg->func_code);
+
+    cfio_map_forwarding(msg);
+    _add_msg(msg);
+}
+
+int cfio_send_create(
+	char *path, int cmode, int ncid)
+{
+    cfio_msg_t *msg;
+    size_t size;
+
+    size = cfio_buf_str_size(path);
+    size += cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_data_size(sizeof(int));
+
+    msg = _msg_begin(FUNC_NC_CREATE, size, 0);
+
     cfio_buf_pack_str(path, buffer);
     cfio_buf_pack_data(&cmode, sizeof(int), buffer);
     cfio_buf_pack_data(&ncid, sizeof(int), buffer);
 
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
+    _msg_end(msg);
     
     debug(DEBUG_SEND, "path = %s; cmode = %d, ncid = %d", path, cmode, ncid);
 
     return CFIO_ERROR_NONE;
 }
 
+/**
+ * @brief: pack a msg which only contains a nc id
+ */
+static int _send_nc_msg(uint32_t code, int ncid)
+{
+    cfio_msg_t *msg;
+    cfio_msg_nc_t *nc_msg;
+
+    msg = _msg_begin(code, 
+	    sizeof(cfio_msg_nc_t) - sizeof(cfio_msg_head_t), 0);
+
+    nc_msg = (cfio_msg_nc_t *)msg->addr;
+    nc_msg->ncid = ncid;
+    nc_msg->pad = 0;
+
+    _msg_end(msg);
+    
+    debug(DEBUG_SEND, "code = %u, ncid = %d", code, ncid);
+    
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_send_schema_begin(
+	int schemaid)
+{
+    return _send_nc_msg(FUNC_SCHEMA_BEGIN, schemaid);
+}
+
+int cfio_send_create_from_schema(
+	char *path, int cmode, int schemaid, int ncid)
+{
+    cfio_msg_t *msg;
+    size_t size;
+
+    size = cfio_buf_str_size(path);
+    size += cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_data_size(sizeof(int));
+
+    msg = _msg_begin(FUNC_NC_CREATE_SCHEMA, size, 0);
+
+    cfio_buf_pack_str(path, buffer);
+    cfio_buf_pack_data(&cmode, sizeof(int), buffer);
+    cfio_buf_pack_data(&schemaid, sizeof(int), buffer);
+    cfio_buf_pack_data(&ncid, sizeof(int), buffer);
+
+    _msg_end(msg);
+    
+    debug(DEBUG_SEND, "path = %s; cmode = %d, schemaid = %d, ncid = %d", 
+	    path, cmode, schemaid, ncid);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_send_schema_free(
+	int schemaid)
+{
+    return _send_nc_msg(FUNC_SCHEMA_FREE, schemaid);
+}
+
 /**
  *pack msg function
  **/
 int cfio_send_def_dim(
 	int ncid, char *name, size_t len, int dimid)
 {
-    uint32_t code = FUNC_NC_DEF_DIM;
     cfio_msg_t *msg;
+    size_t size;
 
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = FUNC_NC_DEF_DIM;
-    
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    msg->size += cfio_buf_str_size(name);
-    msg->size += cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
+    size = cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_str_size(name);
+    size += cfio_buf_data_size(sizeof(size_t));
+    size += cfio_buf_data_size(sizeof(int));
 
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
-#endif
-    
-    msg->addr = buffer->free_addr;
+    msg = _msg_begin(FUNC_NC_DEF_DIM, size, 0);
 
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code, sizeof(uint32_t), buffer);
     cfio_buf_pack_data(&ncid, sizeof(int), buffer);
     cfio_buf_pack_str(name, buffer);
     cfio_buf_pack_data(&len, sizeof(size_t), buffer);
     cfio_buf_pack_data(&dimid, sizeof(int), buffer);
 
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
+    _msg_end(msg);
     
     debug(DEBUG_SEND, "ncid = %d, name = %s, len = %lu", ncid, name, len);
 
@@ -444,35 +609,19 @@ int cfio_send_def_var(
 	int ndims, int *dimids, 
 	size_t *start, size_t *count, int varid)
 {
-    uint32_t code = FUNC_NC_DEF_VAR;
     cfio_msg_t *msg;
+    size_t size;
 
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = FUNC_NC_DEF_VAR;
-    
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    msg->size += cfio_buf_str_size(name);
-    msg->size += cfio_buf_data_size(sizeof(cfio_type));
-    msg->size += cfio_buf_data_array_size(ndims, sizeof(int));
-    msg->size += cfio_buf_data_array_size(ndims, sizeof(size_t));
-    msg->size += cfio_buf_data_array_size(ndims, sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
+    size = cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_str_size(name);
+    size += cfio_buf_data_size(sizeof(cfio_type));
+    size += cfio_buf_data_array_size(ndims, sizeof(int));
+    size += cfio_buf_data_array_size(ndims, sizeof(size_t));
+    size += cfio_buf_data_array_size(ndims, sizeof(size_t));
+    size += cfio_buf_data_size(sizeof(int));
 
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
-#endif
-    
-    msg->addr = buffer->free_addr;
+    msg = _msg_begin(FUNC_NC_DEF_VAR, size, 0);
 
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code , sizeof(uint32_t), buffer);
     cfio_buf_pack_data(&ncid, sizeof(int), buffer);
     cfio_buf_pack_str(name, buffer);
     cfio_buf_pack_data(&xtype, sizeof(cfio_type), buffer);
@@ -481,56 +630,65 @@ int cfio_send_def_var(
     cfio_buf_pack_data_array(count, ndims, sizeof(size_t), buffer);
     cfio_buf_pack_data(&varid, sizeof(int), buffer);
 
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
+    _msg_end(msg);
     
     debug(DEBUG_SEND, "ncid = %d, name = %s, ndims = %u", ncid, name, ndims);
 
     return CFIO_ERROR_NONE;
 }
 
+int cfio_send_def_var_part(
+	int ncid, int ndims, size_t *start, size_t *count, 
+	int is_record, int varid)
+{
+    cfio_msg_t *msg;
+    size_t size;
+
+    size = cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_data_array_size(ndims, sizeof(size_t));
+    size += cfio_buf_data_array_size(ndims, sizeof(size_t));
+    size += cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_data_size(sizeof(int));
+
+    msg = _msg_begin(FUNC_NC_DEF_VAR_PART, size, 0);
+
+    cfio_buf_pack_data(&ncid, sizeof(int), buffer);
+    cfio_buf_pack_data_array(start, ndims, sizeof(size_t), buffer);
+    cfio_buf_pack_data_array(count, ndims, sizeof(size_t), buffer);
+    cfio_buf_pack_data(&is_record, sizeof(int), buffer);
+    cfio_buf_pack_data(&varid, sizeof(int), buffer);
+
+    _msg_end(msg);
+    
+    debug(DEBUG_SEND, "ncid = %d, varid = %d, ndims = %u", ncid, varid, ndims);
+
+    return CFIO_ERROR_NONE;
+}
+
 int cfio_send_put_att(
 	int ncid, int varid, char *name, 
 	cfio_type xtype, size_t len, void *op)
 {
-    uint32_t code = FUNC_PUT_ATT;
     cfio_msg_t *msg;
-    size_t att_size;
-
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = FUNC_PUT_ATT;
+    size_t size, att_size;
 
     cfio_types_size(att_size, xtype);
 
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    msg->size += cfio_buf_str_size(name);
-    msg->size += cfio_buf_data_size(sizeof(cfio_type));
-    msg->size += cfio_buf_data_array_size(len, att_size);
+    size = cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_data_size(sizeof(int));
+    size += cfio_buf_str_size(name);
+    size += cfio_buf_data_size(sizeof(cfio_type));
+    size += cfio_buf_data_array_size(len, att_size);
 
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
-#endif
+    msg = _msg_begin(FUNC_PUT_ATT, size, 0);
 
-    msg->addr = buffer->free_addr;
-
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code , sizeof(uint32_t), buffer);
     cfio_buf_pack_data(&ncid, sizeof(int), buffer);
     cfio_buf_pack_data(&varid, sizeof(int), buffer);
     cfio_buf_pack_str(name, buffer);
     cfio_buf_pack_data(&xtype, sizeof(cfio_type), buffer);
     cfio_buf_pack_data_array(op, len, att_size, buffer);
 
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
+    _msg_end(msg);
     
     debug(DEBUG_SEND, "ncid = %d, varid = %d, name = %s, len = %lu", 
 	    ncid, varid, name, len);
@@ -542,37 +700,182 @@ int cfio_send_put_att(
 int cfio_send_enddef(
 	int ncid)
 {
-    uint32_t code = FUNC_NC_ENDDEF;
-    cfio_msg_t *msg;
+    return _send_nc_msg(FUNC_NC_ENDDEF, ncid);
+}
 
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = FUNC_NC_ENDDEF;
-    
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
+/**
+ * @brief: choose how to encode start and count of put_vara against the start
+ *	and count declared in def_var
+ *
+ * @return: flags of put_vara
+ */
+static uint8_t _put_vara_flags(int ndims, size_t *start, size_t *count,
+	cfio_id_decomp_t *decomp)
+{
+    int i, is_decomp = 1;
+    int64_t delta;
+
+    if(NULL == decomp || decomp->ndims != ndims)
+    {
+	return 0;
+    }
+
+    for(i = 0; i < ndims; i ++)
+    {
+	if(count[i] != decomp->count[i] || 
+		(i > 0 && start[i] != decomp->start[i]))
+	{
+	    is_decomp = 0;
+	    break;
+	}
+    }
+    if(is_decomp && (0 == ndims || start[0] <= UINT32_MAX))
+    {
+	return CFIO_MSG_PUT_DECOMP;
+    }
+
+    for(i = 0; i < ndims; i ++)
+    {
+	delta = (int64_t)start[i] - (int64_t)decomp->start[i];
+	if(delta < INT32_MIN || delta > INT32_MAX)
+	{
+	    return 0;
+	}
+	delta = (int64_t)count[i] - (int64_t)decomp->count[i];
+	if(delta < INT32_MIN || delta > INT32_MAX)
+	{
+	    return 0;
+	}
+    }
+    return CFIO_MSG_PUT_DELTA;
+}
+
+/**
+ * @brief: get the type of put_vara data on wire, the type of the var in file
+ *	if CLIENT_CONVERT is defined, else the type of the data
+ */
+static inline int _wire_type(cfio_id_decomp_t *decomp, int fp_type)
+{
+#ifdef CLIENT_CONVERT
+    if(NULL != decomp && cfio_convert_valid(decomp->xtype, fp_type))
+    {
+	return decomp->xtype;
+    }
 #endif
-    
-    msg->addr = buffer->free_addr;
+    return fp_type;
+}
 
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code, sizeof(uint32_t), buffer);
-    cfio_buf_pack_data(&ncid, sizeof(int), buffer);
+/**
+ * @brief: get the size of a put_vara, include the head and padding
+ *
+ * @param decomp: start and count declared in def_var, can be NULL
+ * @param flags: return the flags of the put_vara
+ *
+ * @return: the size
+ */
+static size_t _put_vara_size(cfio_id_decomp_t *decomp,
+	int ndims, size_t *start, size_t *count, int fp_type, uint8_t *flags)
+{
+    int i;
+    size_t data_len, ele_size = 0, start_size, stamp_size = 0;
 
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
-    
-    debug(DEBUG_SEND, "ncid = %d", ncid);
-    
-    return CFIO_ERROR_NONE;
+    data_len = 1;
+    for(i = 0; i < ndims; i ++)
+    {
+	data_len *= count[i]; 
+    }
+    cfio_types_size(ele_size, _wire_type(decomp, fp_type));
+
+    *flags = _put_vara_flags(ndims, start, count, decomp);
+    switch(*flags)
+    {
+	case CFIO_MSG_PUT_DECOMP :
+	    start_size = 0;
+	    break;
+	case CFIO_MSG_PUT_DELTA :
+	    start_size = cfio_msg_align(2 * ndims * sizeof(int32_t));
+	    break;
+	default :
+	    start_size = 2 * ndims * sizeof(uint64_t);
+	    break;
+    }
+    if(cfio_latency_on)
+    {
+	*flags |= CFIO_MSG_PUT_STAMP;
+	stamp_size = sizeof(cfio_msg_stamp_t);
+    }
+
+    return cfio_msg_align(sizeof(cfio_msg_put_vara_t) + stamp_size + 
+	    start_size + data_len * ele_size);
+}
+
+/**
+ * @brief: pack a put_vara at addr, size and flags are got from 
+ *	_put_vara_size
+ *
+ * @param call: time the put_vara is called, stamped if CFIO_MSG_PUT_STAMP is
+ *	set
+ */
+static void _pack_put_vara(char *addr, size_t size, uint8_t flags,
+	cfio_id_decomp_t *decomp, int ncid, int varid, int ndims, 
+	size_t *start, size_t *count, int fp_type, void *fp, uint64_t call)
+{
+    int i, wire_type;
+    cfio_msg_put_vara_t *vara;
+    cfio_msg_stamp_t *stamp;
+    int32_t *delta;
+    uint64_t *full;
+    size_t start_size = 0, data_size;
+
+    wire_type = _wire_type(decomp, fp_type);
+
+    vara = (cfio_msg_put_vara_t *)addr;
+    vara->head.size = size;
+    vara->head.func_code = FUNC_NC_PUT_VARA;
+    vara->head.version = CFIO_MSG_VERSION;
+    vara->head.flags = flags;
+    vara->ncid = ncid;
+    vara->varid = varid;
+    vara->start0 = (flags & CFIO_MSG_PUT_DECOMP) && ndims > 0 ? start[0] : 0;
+    vara->ndims = ndims;
+    vara->fp_type = wire_type;
+    vara->pad = 0;
+
+    addr += sizeof(cfio_msg_put_vara_t);
+    if(flags & CFIO_MSG_PUT_STAMP)
+    {
+	stamp = (cfio_msg_stamp_t *)addr;
+	stamp->call = call;
+	stamp->send = 0;
+	addr += sizeof(cfio_msg_stamp_t);
+    }
+    if(flags & CFIO_MSG_PUT_DELTA)
+    {
+	delta = (int32_t *)addr;
+	for(i = 0; i < ndims; i ++)
+	{
+	    delta[i] = (int64_t)start[i] - (int64_t)decomp->start[i];
+	    delta[ndims + i] = (int64_t)count[i] - (int64_t)decomp->count[i];
+	}
+	start_size = cfio_msg_align(2 * ndims * sizeof(int32_t));
+    }else if(!(flags & CFIO_MSG_PUT_DECOMP))
+    {
+	full = (uint64_t *)addr;
+	for(i = 0; i < ndims; i ++)
+	{
+	    full[i] = start[i];
+	    full[ndims + i] = count[i];
+	}
+	start_size = 2 * ndims * sizeof(uint64_t);
+    }
+    addr += start_size;
+
+    data_size = 1;
+    for(i = 0; i < ndims; i ++)
+    {
+	data_size *= count[i]; 
+    }
+    cfio_convert(wire_type, addr, fp_type, fp, data_size);
 }
 
 int cfio_send_put_vara(
@@ -581,9 +884,11 @@ int cfio_send_put_vara(
 	int fp_type, void *fp)
 {
     int i;
-    size_t data_len;
-    uint32_t code = FUNC_NC_PUT_VARA;
+    size_t size;
+    uint8_t flags;
     cfio_msg_t *msg;
+    cfio_id_decomp_t *decomp;
+    uint64_t call = cfio_latency_on ? cfio_latency_now() : 0;
     
     //times_start();
 
@@ -597,90 +902,95 @@ int cfio_send_put_vara(
 	debug(DEBUG_SEND, "count[%d] = %lu", i, count[i]);
     }
     
-    data_len = 1;
-    for(i = 0; i < ndims; i ++)
+    /* the server can't put the part of a var which it can't convert, so the
+     * put is rejected here, before anything is sent */
+    cfio_id_get_decomp(ncid, varid, &decomp);
+    if(NULL != decomp && !cfio_convert_valid(decomp->xtype, fp_type))
     {
-	data_len *= count[i]; 
+	error("can't put data of type %d into var(%d) of type %d.",
+		fp_type, varid, decomp->xtype);
+	return CFIO_ERROR_CONVERT;
     }
+    size = _put_vara_size(decomp, ndims, start, count, fp_type, &flags);
+
+    msg = _msg_begin(FUNC_NC_PUT_VARA, size - sizeof(cfio_msg_head_t), flags);
+    _pack_put_vara(msg->addr, size, flags, decomp, 
+	    ncid, varid, ndims, start, count, fp_type, fp, call);
+    _msg_end(msg);
     
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = FUNC_NC_PUT_VARA;
-    
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    msg->size += cfio_buf_data_array_size(ndims, sizeof(size_t));
-    msg->size += cfio_buf_data_array_size(ndims, sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    switch(fp_type)
-    {
-	case CFIO_BYTE :
-	    msg->size += cfio_buf_data_array_size(data_len, 1);
-	    break;
-	case CFIO_CHAR :
-	    msg->size += cfio_buf_data_array_size(data_len, sizeof(char));
-	    break;
-	case CFIO_SHORT :
-	    msg->size += cfio_buf_data_array_size(data_len, sizeof(short));
-	    break;
-	case CFIO_INT :
-	    msg->size += cfio_buf_data_array_size(data_len, sizeof(int));
-	    break;
-	case CFIO_FLOAT :
-	    msg->size += cfio_buf_data_array_size(data_len, sizeof(float));
-	    break;
-	case CFIO_DOUBLE :
-	    msg->size += cfio_buf_data_array_size(data_len, sizeof(double));
-	    break;
+    //debug(DEBUG_TIME, "%f ms", times_end());
+    debug(DEBUG_SEND, "ncid = %d, varid = %d, ndims = %d, size = %lu, "
+	    "flags = %d", ncid, varid, ndims, size, flags);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_send_put_vara_multi(
+	int ncid, int n, int *varids, 
+	cfio_id_decomp_t **decomps, size_t **starts, size_t **counts,
+	cfio_type *fp_types, void **fps)
+{
+    int i, j, k;
+    size_t size, *sizes;
+    uint8_t *flags;
+    cfio_msg_t *msg;
+    cfio_msg_put_vara_multi_t *multi;
+    char *addr;
+    uint64_t call = cfio_latency_on ? cfio_latency_now() : 0;
+
+    /* none of the vars is sent if one can't be converted */
+    for(i = 0; i < n; i ++)
+    {
+	if(!cfio_convert_valid(decomps[i]->xtype, fp_types[i]))
+	{
+	    error("can't put data of type %d into var(%d) of type %d.",
+		    fp_types[i], varids[i], decomps[i]->xtype);
+	    return CFIO_ERROR_CONVERT;
+	}
     }
-	    
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
-#endif
 
-    msg->addr = buffer->free_addr;
+    sizes = malloc(n * (sizeof(size_t) + sizeof(uint8_t)));
+    if(NULL == sizes)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    flags = (uint8_t *)(sizes + n);
+    for(i = 0; i < n; i ++)
+    {
+	sizes[i] = _put_vara_size(decomps[i], decomps[i]->ndims, 
+		starts[i], counts[i], fp_types[i], &flags[i]);
+    }
 
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code, sizeof(uint32_t), buffer);
-    cfio_buf_pack_data(&ncid, sizeof(int), buffer);
-    cfio_buf_pack_data(&varid, sizeof(int), buffer);
-    cfio_buf_pack_data_array(start, ndims, sizeof(size_t), buffer);
-    cfio_buf_pack_data_array(count, ndims, sizeof(size_t), buffer);
-    cfio_buf_pack_data(&fp_type, sizeof(int), buffer);
-    switch(fp_type)
+    /* put as many vars as merge_size allows into one msg */
+    for(i = 0; i < n; i = j)
     {
-	case CFIO_BYTE :
-	    cfio_buf_pack_data_array(fp, data_len, 1, buffer);
-	    break;
-	case CFIO_CHAR :
-	    cfio_buf_pack_data_array(fp, data_len, sizeof(char), buffer);
-	    break;
-	case CFIO_SHORT :
-	    cfio_buf_pack_data_array(fp, data_len, sizeof(short), buffer);
-	    break;
-	case CFIO_INT :
-	    cfio_buf_pack_data_array(fp, data_len, sizeof(int), buffer);
-	    break;
-	case CFIO_FLOAT :
-	    cfio_buf_pack_data_array(fp, data_len, sizeof(float), buffer);
-	    break;
-	case CFIO_DOUBLE :
-	    cfio_buf_pack_data_array(fp, data_len, sizeof(double), buffer);
-	    break;
+	size = sizeof(cfio_msg_put_vara_multi_t) + sizes[i];
+	for(j = i + 1; j < n && size + sizes[j] <= merge_size; j ++)
+	{
+	    size += sizes[j];
+	}
+
+	msg = _msg_begin(FUNC_NC_PUT_VARA_MULTI, 
+		size - sizeof(cfio_msg_head_t), 0);
+	multi = (cfio_msg_put_vara_multi_t *)msg->addr;
+	multi->ncid = ncid;
+	multi->n = j - i;
+
+	addr = msg->addr + sizeof(cfio_msg_put_vara_multi_t);
+	for(k = i; k < j; k ++)
+	{
+	    _pack_put_vara(addr, sizes[k], flags[k], decomps[k], 
+		    ncid, varids[k], decomps[k]->ndims, starts[k], counts[k],
+		    fp_types[k], fps[k], call);
+	    addr += sizes[k];
+	}
+	_msg_end(msg);
+
+	debug(DEBUG_SEND, "ncid = %d, n = %d, size = %lu", ncid, j - i, size);
     }
 
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
-    
-    //debug(DEBUG_TIME, "%f ms", times_end());
-    debug(DEBUG_SEND, "ncid = %d, varid = %d, ndims = %d, data_len = %lu", 
-	    ncid, varid, ndims, data_len);
+    free(sizes);
 
     return CFIO_ERROR_NONE;
 }
@@ -688,34 +998,8 @@ int cfio_send_put_vara(
 int cfio_send_close(
 	int ncid)
 {
-    uint32_t code = FUNC_NC_CLOSE;
-    cfio_msg_t *msg;
-    
     //times_start();
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = FUNC_NC_CLOSE;
-    
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    msg->size += cfio_buf_data_size(sizeof(int));
-    
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
-#endif
-
-    msg->addr = buffer->free_addr;
-
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code, sizeof(uint32_t), buffer);
-    cfio_buf_pack_data(&ncid, sizeof(int), buffer);
-
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
+    _send_nc_msg(FUNC_NC_CLOSE, ncid);
     //debug(DEBUG_TIME, "%f", times_end());
 
     return CFIO_ERROR_NONE;
@@ -723,68 +1007,23 @@ int cfio_send_close(
 
 int cfio_send_io_done()
 {
-    uint32_t code = FUNC_FINAL;
-    cfio_msg_t *msg;
-    
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = code;
-    
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
-#endif
-    
-    msg->addr = buffer->free_addr;
-    
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code, sizeof(uint32_t), buffer);
-    
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
+    _msg_end(_msg_begin(FUNC_FINAL, 0, 0));
     
     return CFIO_ERROR_NONE;
 }
 
 int cfio_send_io_end()
 {
-    uint32_t code = FUNC_IO_END;
-    cfio_msg_t *msg;
-    
     debug(DEBUG_SEND, "Start");
 
     /*send IO end*/
-    msg = cfio_msg_create();
-    msg->src = rank;
-    msg->func_code = code;
-    
-    msg->size = cfio_buf_data_size(sizeof(size_t));
-    msg->size += cfio_buf_data_size(sizeof(uint32_t));
-    
-#ifdef async_send
-    pthread_mutex_lock(&full_mutex);
-#endif
-    ensure_free_space(buffer, msg->size, cfio_send_client_buf_free);
-#ifdef async_send
-    pthread_mutex_unlock(&full_mutex);
-#endif
-    
-    msg->addr = buffer->free_addr;
-    
-    cfio_buf_pack_data(&msg->size, sizeof(size_t) , buffer);
-    cfio_buf_pack_data(&code, sizeof(uint32_t), buffer);
-    
-    cfio_map_forwarding(msg);
-    _add_msg(msg);
+    _msg_end(_msg_begin(FUNC_IO_END, 0, 0));
+    if(cfio_tune_on)
+    {
+	merge_size = cfio_tune_epoch();
+    }
 
     debug(DEBUG_SEND, "Success return");
 
     return CFIO_ERROR_NONE;
 }
-
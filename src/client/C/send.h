@@ -17,6 +17,7 @@
 #include <stdlib.h>
 
 #include "cfio_types.h"
+#include "id.h"
 
 #define SEND_BUF_SIZE ((size_t)1024*1024*1024)
 #define SEND_MSG_MIN_SIZE ((size_t)70*1024*1024)
@@ -45,6 +46,37 @@ int cfio_send_final();
  */
 int cfio_send_create(
 	char *path, int cmode, int ncid);
+/**
+ * @brief: pack cfio_schema_begin into msg
+ *
+ * @param schemaid: schema id assigned by client
+ *
+ * @return: error code
+ */
+int cfio_send_schema_begin(
+	int schemaid);
+/**
+ * @brief: pack cfio_create_from_schema into msg
+ *
+ * @param path: the file name of the new netCDF dataset, arg of 
+ *	cfio_create_from_schema
+ * @param cmode: the creation mode flag, arg of cfio_create_from_schema
+ * @param schemaid: the schema id, arg of cfio_create_from_schema
+ * @param ncid: ncid assigned by client
+ *
+ * @return: error code
+ */
+int cfio_send_create_from_schema(
+	char *path, int cmode, int schemaid, int ncid);
+/**
+ * @brief: pack cfio_schema_free into msg
+ *
+ * @param schemaid: the schema id, arg of cfio_schema_free
+ *
+ * @return: error code
+ */
+int cfio_send_schema_free(
+	int schemaid);
 /**
  * @brief: pack cfio_def_dim into msg
  *
@@ -82,6 +114,23 @@ int cfio_send_def_var(
 	int ncid, char *name, cfio_type xtype,
 	int ndims, int *dimids, 
 	size_t *start, size_t *count, int varid);
+/**
+ * @brief: pack the start and count of cfio_def_var into msg, used by the 
+ *	client which is not leader in LEADER_META mode
+ *
+ * @param ncid: netCDF ID, arg of cfio_def_var
+ * @param ndims: number of dimensions for the variable, arg of 
+ *	cfio_def_var
+ * @param start: start of the client, arg of cfio_def_var
+ * @param count: count of the client, arg of cfio_def_var
+ * @param is_record: whether the variable is a record variable
+ * @param varid: var id assigned by client
+ *
+ * @return: error code
+ */
+int cfio_send_def_var_part(
+	int ncid, int ndims, size_t *start, size_t *count, 
+	int is_record, int varid);
 /**
  * @brief: pack cfio_put_att into msg
  *
@@ -123,12 +172,34 @@ int cfio_send_enddef(
  * @param fp : pointer to where data is stored, arg of 
  *	cfio_put_vara_float
  *
- * @return: 
+ * @return: error code, CFIO_ERROR_CONVERT if fp_type can't be converted into
+ *	the type of the var
  */
 int cfio_send_put_vara(
 	int ncid, int varid, int ndims,
 	size_t *start, size_t *count, 
 	int fp_type, void *fp);
+/**
+ * @brief: pack cfio_put_vara_multi into msgs, the vars are packed into as few
+ *	msgs as the max msg size allows
+ *
+ * @param ncid: netCDF ID
+ * @param n: amount of vars
+ * @param varids: variable IDs
+ * @param decomps: start and count declared in def_var of each var, ndims of 
+ *	each var is got from it
+ * @param starts: start of each var
+ * @param counts: count of each var
+ * @param fp_types: type of each var's data
+ * @param fps: data of each var
+ *
+ * @return: error code, CFIO_ERROR_CONVERT if the type of a var's data can't be
+ *	converted into the type of the var, nothing is sent then
+ */
+int cfio_send_put_vara_multi(
+	int ncid, int n, int *varids, 
+	cfio_id_decomp_t **decomps, size_t **starts, size_t **counts,
+	cfio_type *fp_types, void **fps);
 /**
  * @brief: pack cfio_close into msg
  *
@@ -0,0 +1,123 @@
+/****************************************************************************
+ *       Filename:  arena.c
+ *
+ *    Description:  bump allocator
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <string.h>
+#include <assert.h>
+
+#include "arena.h"
+#include "debug.h"
+
+#define _align(size) \
+    (((size) + CFIO_ARENA_ALIGN - 1) & ~((size_t)CFIO_ARENA_ALIGN - 1))
+
+static cfio_arena_chunk_t *_new_chunk(size_t size)
+{
+    cfio_arena_chunk_t *chunk;
+
+    chunk = malloc(sizeof(cfio_arena_chunk_t) + size);
+    if(NULL == chunk)
+    {
+	error("malloc fail.");
+	return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+cfio_arena_t *cfio_arena_create(size_t chunk_size)
+{
+    cfio_arena_t *arena;
+
+    arena = malloc(sizeof(cfio_arena_t));
+    if(NULL == arena)
+    {
+	error("malloc fail.");
+	return NULL;
+    }
+    arena->chunk_size = 0 == chunk_size ? CFIO_ARENA_CHUNK_SIZE : chunk_size;
+    arena->head = NULL;
+
+    return arena;
+}
+
+void *cfio_arena_alloc(cfio_arena_t *arena, size_t size)
+{
+    cfio_arena_chunk_t *chunk;
+    void *addr;
+
+    assert(NULL != arena);
+
+    size = _align(size);
+    chunk = arena->head;
+    if(NULL == chunk || chunk->used + size > chunk->size)
+    {
+	/* big object gets its own chunk, behind the current one, so that the
+	 * free space in the current chunk is still used */
+	if(size > arena->chunk_size / 4 && NULL != chunk)
+	{
+	    if(NULL == (chunk = _new_chunk(size)))
+	    {
+		return NULL;
+	    }
+	    chunk->next = arena->head->next;
+	    arena->head->next = chunk;
+	}else
+	{
+	    if(NULL == (chunk = _new_chunk(
+			    size > arena->chunk_size ? size : arena->chunk_size)))
+	    {
+		return NULL;
+	    }
+	    chunk->next = arena->head;
+	    arena->head = chunk;
+	}
+    }
+
+    addr = chunk->data + chunk->used;
+    chunk->used += size;
+    memset(addr, 0, size);
+
+    return addr;
+}
+
+void *cfio_arena_memdup(cfio_arena_t *arena, const void *src, size_t size)
+{
+    void *dst;
+
+    if(NULL != (dst = cfio_arena_alloc(arena, size)))
+    {
+	memcpy(dst, src, size);
+    }
+
+    return dst;
+}
+
+char *cfio_arena_strdup(cfio_arena_t *arena, const char *str)
+{
+    return cfio_arena_memdup(arena, str, strlen(str) + 1);
+}
+
+void cfio_arena_destroy(cfio_arena_t *arena)
+{
+    cfio_arena_chunk_t *chunk, *next;
+
+    if(NULL == arena)
+    {
+	return;
+    }
+    for(chunk = arena->head; NULL != chunk; chunk = next)
+    {
+	next = chunk->next;
+	free(chunk);
+    }
+    free(arena);
+}
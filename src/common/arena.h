@@ -0,0 +1,70 @@
+/****************************************************************************
+ *       Filename:  arena.h
+ *
+ *    Description:  bump allocator, objects are allocated from big chunks and
+ *		    can only be freed all together by destroying the arena
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stdlib.h>
+
+#define CFIO_ARENA_ALIGN	8
+#define CFIO_ARENA_CHUNK_SIZE	(64 * 1024)
+
+typedef struct cfio_arena_chunk
+{
+    struct cfio_arena_chunk *next;
+    size_t size;	    /* size of data */
+    size_t used;	    /* used size of data */
+    char data[];
+}cfio_arena_chunk_t;
+
+typedef struct
+{
+    cfio_arena_chunk_t *head;	/* the chunk being allocated from */
+    size_t chunk_size;		/* default size of a new chunk */
+}cfio_arena_t;
+
+/**
+ * @brief: create an arena
+ *
+ * @param chunk_size: size of each chunk, CFIO_ARENA_CHUNK_SIZE if 0
+ *
+ * @return: the arena, NULL if malloc fail
+ */
+cfio_arena_t *cfio_arena_create(size_t chunk_size);
+/**
+ * @brief: allocate memory from the arena, the memory is aligned with
+ *	CFIO_ARENA_ALIGN, and zeroed
+ *
+ * @param arena: the arena
+ * @param size: size of the memory
+ *
+ * @return: pointer to the memory, NULL if malloc fail
+ */
+void *cfio_arena_alloc(cfio_arena_t *arena, size_t size);
+/**
+ * @brief: copy the memory into the arena
+ *
+ * @return: pointer to the copy, NULL if malloc fail
+ */
+void *cfio_arena_memdup(cfio_arena_t *arena, const void *src, size_t size);
+/**
+ * @brief: copy the string into the arena
+ *
+ * @return: pointer to the copy, NULL if malloc fail
+ */
+char *cfio_arena_strdup(cfio_arena_t *arena, const char *str);
+/**
+ * @brief: free all memory allocated from the arena, and the arena itself
+ *
+ * @param arena: the arena
+ */
+void cfio_arena_destroy(cfio_arena_t *arena);
+
+#endif
@@ -0,0 +1,68 @@
+/****************************************************************************
+ *       Filename:  bitmap.h
+ *
+ *    Description:  bitmap of the clients of a server, bit i is set when the
+ *		    client with index i has sent an io request
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _BITMAP_H
+#define _BITMAP_H
+
+#include <stdint.h>
+
+/**
+ * @brief: size of a bitmap of num bits, in bytes
+ */
+#define cfio_bitmap_size(num) (((num) >> 3) + 1)
+
+/**
+ * @brief: set bit index in the bitmap
+ */
+static inline void cfio_bitmap_set(uint8_t *bitmap, int index)
+{
+    bitmap[index >> 3] |= (1 << (index & 7));
+}
+
+/**
+ * @brief: get bit index of the bitmap
+ *
+ * @return: 1 if set
+ */
+static inline int cfio_bitmap_get(const uint8_t *bitmap, int index)
+{
+    return (bitmap[index >> 3] >> (index & 7)) & 1;
+}
+
+/**
+ * @brief: judge whether the first num bits of the bitmap are all set
+ *
+ * @return: 1 if full
+ */
+static inline int cfio_bitmap_full(const uint8_t *bitmap, int num)
+{
+    int i;
+    int head, tail;
+
+    head = num >> 3;
+    tail = num & 7;
+
+    for(i = 0; i < head; i ++)
+    {
+	if(bitmap[i] != 255)
+	{
+	    return 0;
+	}
+    }
+
+    if(bitmap[head] != ((1 << tail) - 1))
+    {
+	return 0;
+    }
+
+    return 1;
+}
+
+#endif
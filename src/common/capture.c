@@ -0,0 +1,169 @@
+/****************************************************************************
+ *       Filename:  capture.c
+ *
+ *    Description:  capture of the msgs produced by a client
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "map.h"
+#include "trace.h"
+#include "debug.h"
+#include "define.h"
+#include "cfio_error.h"
+
+cfio_proc_local int cfio_capture_on = 0;
+
+static cfio_proc_local FILE *capture_fp;
+static cfio_proc_local char *capture_buf;
+static cfio_proc_local uint64_t capture_start;
+
+int cfio_capture_init(int rank)
+{
+    char *prefix, path[256];
+    cfio_capture_head_t head;
+    int server_id;
+
+    if(NULL == (prefix = getenv(CFIO_CAPTURE_ENV)))
+    {
+	return CFIO_ERROR_NONE;
+    }
+
+    snprintf(path, sizeof(path), "%s.%d.cap", prefix, rank);
+    if(NULL == (capture_fp = fopen(path, "w")))
+    {
+	error("open capture file %s fail.", path);
+	return CFIO_ERROR_FILE;
+    }
+    /* msgs are written in big blocks, not to slow down the client */
+    if(NULL != (capture_buf = malloc(CFIO_CAPTURE_BUF_SIZE)))
+    {
+	setvbuf(capture_fp, capture_buf, _IOFBF, CFIO_CAPTURE_BUF_SIZE);
+    }
+
+    server_id = cfio_map_get_server_of_client(rank);
+    head.magic = CFIO_CAPTURE_MAGIC;
+    head.version = CFIO_MSG_VERSION;
+    head.client_id = rank;
+    head.client_amount = cfio_map_get_client_amount();
+    head.server_index = cfio_map_get_server_index(server_id);
+    head.server_amount = cfio_map_get_server_amount();
+    head.client_index = cfio_map_get_client_index_of_server(rank);
+    head.client_num = cfio_map_get_client_num_of_server(server_id);
+    if(1 != fwrite(&head, sizeof(head), 1, capture_fp))
+    {
+	error("write capture file %s fail.", path);
+	fclose(capture_fp);
+	free(capture_buf);
+	capture_buf = NULL;
+	return CFIO_ERROR_FILE;
+    }
+
+    capture_start = cfio_trace_now();
+    cfio_capture_on = 1;
+    debug(DEBUG_CFIO, "capture msgs of client %d into %s", rank, path);
+
+    return CFIO_ERROR_NONE;
+}
+
+void cfio_capture_msg(cfio_msg_t *msg)
+{
+    cfio_capture_rec_t rec;
+
+    rec.time = cfio_trace_now() - capture_start;
+    rec.size = msg->size;
+    if(1 != fwrite(&rec, sizeof(rec), 1, capture_fp) ||
+	    1 != fwrite(msg->addr, msg->size, 1, capture_fp))
+    {
+	error("write capture file fail, capture is stopped.");
+	cfio_capture_on = 0;
+    }
+}
+
+int cfio_capture_final()
+{
+    if(NULL == capture_fp)
+    {
+	return CFIO_ERROR_NONE;
+    }
+    cfio_capture_on = 0;
+
+    fclose(capture_fp);
+    capture_fp = NULL;
+    free(capture_buf);
+    capture_buf = NULL;
+
+    return CFIO_ERROR_NONE;
+}
+
+FILE *cfio_capture_open(const char *path, cfio_capture_head_t *head)
+{
+    FILE *fp;
+
+    if(NULL == (fp = fopen(path, "r")))
+    {
+	error("open capture file %s fail.", path);
+	return NULL;
+    }
+    if(1 != fread(head, sizeof(cfio_capture_head_t), 1, fp))
+    {
+	error("read head of capture file %s fail.", path);
+	fclose(fp);
+	return NULL;
+    }
+    if(CFIO_CAPTURE_MAGIC != head->magic)
+    {
+	error("%s is not a capture file.", path);
+	fclose(fp);
+	return NULL;
+    }
+    if(CFIO_MSG_VERSION != head->version)
+    {
+	error("msg version(%u) of capture file %s, expect %d.",
+		head->version, path, CFIO_MSG_VERSION);
+	fclose(fp);
+	return NULL;
+    }
+
+    return fp;
+}
+
+int cfio_capture_next(FILE *fp, cfio_capture_rec_t *rec,
+	char **data, size_t *buf_size)
+{
+    char *buf;
+
+    if(1 != fread(rec, sizeof(cfio_capture_rec_t), 1, fp))
+    {
+	if(feof(fp))
+	{
+	    return 0;
+	}
+	error("read capture file fail.");
+	return CFIO_ERROR_FILE;
+    }
+
+    if(rec->size > *buf_size)
+    {
+	if(NULL == (buf = realloc(*data, rec->size)))
+	{
+	    error("malloc fail for msg of size %llu.",
+		    (unsigned long long)rec->size);
+	    return CFIO_ERROR_MALLOC;
+	}
+	*data = buf;
+	*buf_size = rec->size;
+    }
+    if(1 != fread(*data, rec->size, 1, fp))
+    {
+	error("capture file is truncated.");
+	return CFIO_ERROR_FILE;
+    }
+
+    return 1;
+}
@@ -0,0 +1,102 @@
+/****************************************************************************
+ *       Filename:  capture.h
+ *
+ *    Description:  capture of the msgs produced by a client, so that the
+ *		    server path can be replayed offline by cfio_replay
+ *
+ *		    a capture file is a cfio_capture_head_t followed by the
+ *		    msgs in the order they are produced, each one is a
+ *		    cfio_capture_rec_t followed by the msg itself
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "msg.h"
+#include "define.h"
+
+/* env variable of the capture file prefix, capture is on only if it's set,
+ * e.g. CFIO_CAPTURE=/tmp/cap, then client i writes /tmp/cap.i.cap */
+#define CFIO_CAPTURE_ENV	"CFIO_CAPTURE"
+#define CFIO_CAPTURE_MAGIC	0x50414346  /* "CFAP" */
+#define CFIO_CAPTURE_BUF_SIZE	((size_t)4*1024*1024)
+
+/**
+ * @brief: head of a capture file, with the map of the client, so that the map
+ *	of the whole run can be rebuilt from the heads of all clients
+ **/
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;	    /* CFIO_MSG_VERSION */
+    int32_t client_id;
+    int32_t client_amount;
+    int32_t server_index;   /* index of the server of the client */
+    int32_t server_amount;
+    int32_t client_index;   /* index of the client in its server */
+    int32_t client_num;	    /* client num of the server */
+}cfio_capture_head_t;
+
+/**
+ * @brief: head of a captured msg
+ **/
+typedef struct
+{
+    uint64_t time;	    /* ns since cfio_capture_init */
+    uint64_t size;	    /* size of the msg following the head */
+}cfio_capture_rec_t;
+
+extern cfio_proc_local int cfio_capture_on;
+
+/**
+ * @brief: init the capture of a client, it's on if CFIO_CAPTURE_ENV is set,
+ *	must be called after the map is inited
+ *
+ * @param rank: rank of the client
+ *
+ * @return: error code
+ */
+int cfio_capture_init(int rank);
+/**
+ * @brief: write a msg into the capture file, only called if cfio_capture_on
+ *
+ * @param msg: the msg, its head and args are already packed
+ */
+void cfio_capture_msg(cfio_msg_t *msg);
+/**
+ * @brief: close the capture file
+ *
+ * @return: error code
+ */
+int cfio_capture_final();
+
+/**
+ * @brief: open a capture file and read its head
+ *
+ * @param path: path of the capture file
+ * @param head: where the head is to be stored
+ *
+ * @return: the file, NULL if fail
+ */
+FILE *cfio_capture_open(const char *path, cfio_capture_head_t *head);
+/**
+ * @brief: read the next msg of a capture file
+ *
+ * @param fp: the capture file
+ * @param rec: where the head of the msg is to be stored
+ * @param data: where the msg is to be stored, it's realloced if *buf_size is
+ *	less than the msg
+ * @param buf_size: size of *data
+ *
+ * @return: 1 if a msg is read, 0 at the end of the file, or error code
+ */
+int cfio_capture_next(FILE *fp, cfio_capture_rec_t *rec,
+	char **data, size_t *buf_size);
+
+#endif
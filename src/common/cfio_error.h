@@ -30,6 +30,11 @@
 #define CFIO_ERROR_RANK_INVALID	    -201    
 /* In msg.c */
 #define CFIO_ERROR_MPI_RECV	    -300    /* MPI_Recv error */
+#define CFIO_ERROR_MSG_VERSION	    -301    /* msg from client of another version */
+#define CFIO_ERROR_TRANSPORT	    -302    /* collective of the transport fails, 
+					       e.g. a proc of the loopback fails */
+/* In convert.c */
+#define CFIO_ERROR_CONVERT	    -310    /* types can not be converted */
 /* In id.c */
 #define CFIO_ERROR_EXCEED_BOUND	    -400    /* data index exceeds dimension bound */
 #define CFIO_ERROR_NC_NO_EXIST	    -401    /* nc_id not found in assign_table */
@@ -45,5 +50,9 @@
 #define CFIO_ERROR_NC_NOT_DEFINE    -507    /* nc file is not in DEFINE_MODE, some
 					       IO function only can be called in 
 					       DEFINE_MODE */
+/* In backend*.c */
+#define CFIO_ERROR_INVALID_BACKEND  -600    /* unknown backend name */
+#define CFIO_ERROR_TOO_MANY_FILE    -601    /* exceed CFIO_BACKEND_MAX_FILE */
+#define CFIO_ERROR_FILE		    -602    /* posix file operation error */
 
 #endif
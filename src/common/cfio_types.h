@@ -15,6 +15,7 @@
 #ifndef _CFIO_TYPES_H
 #define _CFIO_TYPES_H
 
+#include <stdint.h>
 #include <pnetcdf.h>
 
 typedef enum
@@ -27,6 +28,10 @@ typedef enum
     CFIO_DOUBLE =	6,
 }cfio_type;
 
+/* length of the unlimited record dimension in cfio_def_dim, same as 
+ * NC_UNLIMITED */
+#define CFIO_UNLIMITED	0L
+
 static inline nc_type cfio_type_to_nc(cfio_type type)
 {
     //return NC_BYTE;
@@ -72,4 +77,33 @@ static inline nc_type cfio_type_to_nc(cfio_type type)
 	    break;		    \
     }} while(0)
 
+/**
+ * @brief: runtime statistics of a proc, got by cfio_get_stats. time is in ns.
+ *	fields of client are 0 in server, and vice versa
+ **/
+typedef struct
+{
+    /* client */
+    uint64_t msg_num;		/* msgs packed */
+    uint64_t msg_bytes;		/* bytes of msgs packed */
+    uint64_t msg_merged;	/* msgs merged into the previous msg by sender */
+    uint64_t send_num;		/* MPI sends */
+    uint64_t send_bytes;	/* bytes sent */
+    uint64_t send_time;		/* time in MPI sends */
+    uint64_t buf_wait_num;	/* stalls because the client buffer is full */
+    uint64_t buf_wait_time;	/* time of the stalls */
+    /* server */
+    uint64_t recv_num;		/* MPI recvs */
+    uint64_t recv_bytes;	/* bytes recved */
+    uint64_t recv_min_size;	/* min size of recved msgs */
+    uint64_t recv_max_size;	/* max size of recved msgs */
+    uint64_t recv_buf_full;	/* recvs delayed because the buffer is full */
+    uint64_t decode_num;	/* msgs decoded */
+    uint64_t decode_time;	/* time of decode, including merge and backend */
+    uint64_t merge_time;	/* time of merging the data of clients */
+    uint64_t backend_num;	/* backend calls, e.g. PnetCDF */
+    uint64_t backend_time;	/* time in backend calls */
+    uint64_t write_bytes;	/* bytes of var data written by backend */
+}cfio_stats_t;
+
 #endif
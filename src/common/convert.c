@@ -0,0 +1,232 @@
+/****************************************************************************
+ *       Filename:  convert.c
+ *
+ *    Description:  convert data between cfio types
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#include "convert.h"
+#include "debug.h"
+#include "cfio_error.h"
+
+/* elements converted at a time before swapped, so that the swap reads dst 
+ * from cache */
+#define _SWAP_CHUNK 1024
+
+/**
+ * the loops are simple enough to be vectorized by the compiler, only the most
+ * common double to float is written with intrinsics
+ **/
+#define _CONVERT_LOOP(dst_t, src_t) \
+    do { \
+	dst_t *restrict _d = dst; \
+	const src_t *restrict _s = src; \
+	for(i = 0; i < n; i ++) \
+	{ \
+	    _d[i] = (dst_t)_s[i]; \
+	} \
+    } while(0)
+
+#define _CONVERT_FROM(dst_t) \
+    do { \
+	switch(src_type) \
+	{ \
+	    case CFIO_BYTE : \
+		_CONVERT_LOOP(dst_t, signed char); \
+		break; \
+	    case CFIO_SHORT : \
+		_CONVERT_LOOP(dst_t, short); \
+		break; \
+	    case CFIO_INT : \
+		_CONVERT_LOOP(dst_t, int); \
+		break; \
+	    case CFIO_FLOAT : \
+		_CONVERT_LOOP(dst_t, float); \
+		break; \
+	    case CFIO_DOUBLE : \
+		_CONVERT_LOOP(dst_t, double); \
+		break; \
+	    default : \
+		return CFIO_ERROR_CONVERT; \
+	} \
+    } while(0)
+
+static void _double_to_float(float *restrict dst,
+	const double *restrict src, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__AVX__)
+    for(; i + 4 <= n; i += 4)
+    {
+	_mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+    }
+#elif defined(__SSE2__)
+    for(; i + 4 <= n; i += 4)
+    {
+	_mm_storeu_ps(dst + i, _mm_movelh_ps(
+		    _mm_cvtpd_ps(_mm_loadu_pd(src + i)),
+		    _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2))));
+    }
+#endif
+    for(; i < n; i ++)
+    {
+	dst[i] = (float)src[i];
+    }
+}
+
+int cfio_convert(cfio_type dst_type, void *dst,
+	cfio_type src_type, const void *src, size_t n)
+{
+    size_t i, size = 0;
+
+    if(dst_type == src_type)
+    {
+	cfio_types_size(size, dst_type);
+	memcpy(dst, src, size * n);
+	return CFIO_ERROR_NONE;
+    }
+    if(!cfio_convert_valid(dst_type, src_type))
+    {
+	error("can't convert type %d into %d.", src_type, dst_type);
+	return CFIO_ERROR_CONVERT;
+    }
+
+    switch(dst_type)
+    {
+	case CFIO_BYTE :
+	    _CONVERT_FROM(signed char);
+	    break;
+	case CFIO_SHORT :
+	    _CONVERT_FROM(short);
+	    break;
+	case CFIO_INT :
+	    _CONVERT_FROM(int);
+	    break;
+	case CFIO_FLOAT :
+	    if(CFIO_DOUBLE == src_type)
+	    {
+		_double_to_float(dst, src, n);
+	    }else
+	    {
+		_CONVERT_FROM(float);
+	    }
+	    break;
+	case CFIO_DOUBLE :
+	    _CONVERT_FROM(double);
+	    break;
+	default :
+	    return CFIO_ERROR_CONVERT;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+/**
+ * @brief: swap the byte order of n elements of size bytes in place
+ */
+static void _swap(char *data, size_t size, size_t n)
+{
+    size_t i = 0;
+    uint16_t *d16;
+    uint32_t *d32;
+    uint64_t *d64;
+
+#if defined(__SSSE3__)
+    __m128i mask;
+    size_t len = size * n;
+
+    switch(size)
+    {
+	case 2 :
+	    mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 
+		    9, 8, 11, 10, 13, 12, 15, 14);
+	    break;
+	case 4 :
+	    mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 
+		    11, 10, 9, 8, 15, 14, 13, 12);
+	    break;
+	case 8 :
+	    mask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 
+		    15, 14, 13, 12, 11, 10, 9, 8);
+	    break;
+	default :
+	    return;
+    }
+    for(; i + 16 <= len; i += 16)
+    {
+	_mm_storeu_si128((__m128i *)(data + i), _mm_shuffle_epi8(
+		    _mm_loadu_si128((__m128i *)(data + i)), mask));
+    }
+    /* i is in bytes above, and in elements below */
+    i /= size;
+#endif
+
+    switch(size)
+    {
+	case 2 :
+	    d16 = (uint16_t *)data;
+	    for(; i < n; i ++)
+	    {
+		d16[i] = __builtin_bswap16(d16[i]);
+	    }
+	    break;
+	case 4 :
+	    d32 = (uint32_t *)data;
+	    for(; i < n; i ++)
+	    {
+		d32[i] = __builtin_bswap32(d32[i]);
+	    }
+	    break;
+	case 8 :
+	    d64 = (uint64_t *)data;
+	    for(; i < n; i ++)
+	    {
+		d64[i] = __builtin_bswap64(d64[i]);
+	    }
+	    break;
+	default :
+	    break;
+    }
+}
+#endif
+
+int cfio_convert_be(cfio_type dst_type, void *dst,
+	cfio_type src_type, const void *src, size_t n)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return cfio_convert(dst_type, dst, src_type, src, n);
+#else
+    int ret;
+    size_t i, m, dst_size = 0, src_size = 0;
+
+    cfio_types_size(dst_size, dst_type);
+    cfio_types_size(src_size, src_type);
+
+    for(i = 0; i < n; i += m)
+    {
+	m = n - i < _SWAP_CHUNK ? n - i : _SWAP_CHUNK;
+	if((ret = cfio_convert(dst_type, (char *)dst + i * dst_size,
+			src_type, (const char *)src + i * src_size, m)) < 0)
+	{
+	    return ret;
+	}
+	if(dst_size > 1)
+	{
+	    _swap((char *)dst + i * dst_size, dst_size, m);
+	}
+    }
+
+    return CFIO_ERROR_NONE;
+#endif
+}
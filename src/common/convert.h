@@ -0,0 +1,51 @@
+/****************************************************************************
+ *       Filename:  convert.h
+ *
+ *    Description:  convert data between cfio types, used by client to pack
+ *		    data in the type on wire, and by server to merge data into
+ *		    the type in file
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _CONVERT_H
+#define _CONVERT_H
+
+#include <stdlib.h>
+
+#include "cfio_types.h"
+
+/**
+ * @brief: whether data of src_type can be converted into dst_type, CFIO_CHAR
+ *	can only be converted into CFIO_CHAR, same as netCDF
+ */
+#define cfio_convert_valid(dst_type, src_type) \
+    (((dst_type) == CFIO_CHAR) == ((src_type) == CFIO_CHAR))
+
+/**
+ * @brief: convert n elements of src into dst, it's a memcpy if the types are
+ *	the same. values out of the range of dst_type are undefined, same as
+ *	a C cast
+ *
+ * @param dst_type: type of dst
+ * @param dst: the dst data, must not overlap with src
+ * @param src_type: type of src
+ * @param src: the src data
+ * @param n: amount of elements
+ *
+ * @return: error code, CFIO_ERROR_CONVERT if the types can't be converted
+ */
+int cfio_convert(cfio_type dst_type, void *dst,
+	cfio_type src_type, const void *src, size_t n);
+/**
+ * @brief: same as cfio_convert, but dst is stored in big-endian, which is the
+ *	byte order of netCDF files, so the data needn't be swapped again before
+ *	written
+ *
+ * @return: error code, CFIO_ERROR_CONVERT if the types can't be converted
+ */
+int cfio_convert_be(cfio_type dst_type, void *dst,
+	cfio_type src_type, const void *src, size_t n);
+
+#endif
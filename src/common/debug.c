@@ -1,19 +1,308 @@
 /****************************************************************************
  *       Filename:  debug.c
  *
- *    Description:  for debug
+ *    Description:  for debug, and the log written by a logger thread
  *
  *        Version:  1.0
  *        Created:  12/29/2011 10:09:26 AM
  *       Revision:  none
  *       Compiler:  gcc
  *
- *         Author:  Wang Wencan 
+ *         Author:  Wang Wencan
  *	    Email:  never.wencan@gmail.com
  *        Company:  HPC Tsinghua
  ***************************************************************************/
 #include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <pthread.h>
 
 #include "debug.h"
+#include "cfio_error.h"
 
 int debug_mask = DEBUG_NONE;
+
+typedef struct cfio_log_buf
+{
+    char *data;
+    size_t used;
+    struct cfio_log_buf *next;
+}cfio_log_buf_t;
+
+/**
+ * @brief: log buffer of a thread, the buffer is only filled by the thread
+ **/
+typedef struct cfio_log_slot
+{
+    cfio_log_buf_t *buf;
+    struct cfio_log_slot *next;
+}cfio_log_slot_t;
+
+static int log_on = 0;
+static int log_done;
+static FILE *log_fp;
+static pthread_t logger;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t full_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t free_cond = PTHREAD_COND_INITIALIZER;
+/* full buffers to be written, in order */
+static cfio_log_buf_t *full_head, *full_tail;
+static cfio_log_buf_t *free_list;
+static int buf_num;
+static cfio_log_slot_t *slots;
+
+static __thread cfio_log_slot_t *slot;
+
+/**
+ * @brief: get a free buffer, wait for the logger if there are too many, need
+ *	log_mutex
+ *
+ * @return: the buffer, NULL if malloc fail
+ */
+static cfio_log_buf_t *_get_free_buf()
+{
+    cfio_log_buf_t *buf;
+
+    while(NULL == free_list && buf_num >= CFIO_LOG_BUF_MAX)
+    {
+	pthread_cond_wait(&free_cond, &log_mutex);
+    }
+    if(NULL != free_list)
+    {
+	buf = free_list;
+	free_list = buf->next;
+    }else
+    {
+	if(NULL == (buf = malloc(sizeof(cfio_log_buf_t))))
+	{
+	    return NULL;
+	}
+	if(NULL == (buf->data = malloc(CFIO_LOG_BUF_SIZE)))
+	{
+	    free(buf);
+	    return NULL;
+	}
+	buf_num ++;
+    }
+    buf->used = 0;
+    buf->next = NULL;
+
+    return buf;
+}
+
+/**
+ * @brief: add a buffer to the tail of the full list, need log_mutex
+ */
+static void _put_full_buf(cfio_log_buf_t *buf)
+{
+    buf->next = NULL;
+    if(NULL == full_tail)
+    {
+	full_head = buf;
+    }else
+    {
+	full_tail->next = buf;
+    }
+    full_tail = buf;
+    pthread_cond_signal(&full_cond);
+}
+
+/**
+ * @brief: get the slot of the calling thread, create it the first time
+ *
+ * @return: the slot, NULL if malloc fail
+ */
+static cfio_log_slot_t *_get_slot()
+{
+    cfio_log_slot_t *new_slot;
+
+    if(NULL != slot)
+    {
+	return slot;
+    }
+
+    if(NULL == (new_slot = malloc(sizeof(cfio_log_slot_t))))
+    {
+	return NULL;
+    }
+    pthread_mutex_lock(&log_mutex);
+    if(NULL == (new_slot->buf = _get_free_buf()))
+    {
+	pthread_mutex_unlock(&log_mutex);
+	free(new_slot);
+	return NULL;
+    }
+    new_slot->next = slots;
+    slots = new_slot;
+    pthread_mutex_unlock(&log_mutex);
+
+    slot = new_slot;
+    return slot;
+}
+
+static void* logger_thread(void *arg)
+{
+    cfio_log_buf_t *buf, *next;
+
+    pthread_mutex_lock(&log_mutex);
+    while(1)
+    {
+	while(NULL == full_head && !log_done)
+	{
+	    pthread_cond_wait(&full_cond, &log_mutex);
+	}
+	if(NULL == full_head)
+	{
+	    break;
+	}
+	buf = full_head;
+	full_head = full_tail = NULL;
+	pthread_mutex_unlock(&log_mutex);
+
+	for(next = buf; NULL != next; next = next->next)
+	{
+	    fwrite(next->data, 1, next->used, log_fp);
+	}
+	fflush(log_fp);
+
+	pthread_mutex_lock(&log_mutex);
+	for(; NULL != buf; buf = next)
+	{
+	    next = buf->next;
+	    buf->next = free_list;
+	    free_list = buf;
+	}
+	pthread_cond_broadcast(&free_cond);
+    }
+    pthread_mutex_unlock(&log_mutex);
+
+    return (void*)0;
+}
+
+void cfio_log(const char *format, ...)
+{
+    va_list ap;
+    cfio_log_slot_t *_slot;
+    cfio_log_buf_t *buf;
+    int len;
+
+    va_start(ap, format);
+    if(!log_on || NULL == (_slot = _get_slot()) || NULL == _slot->buf)
+    {
+	vprintf(format, ap);
+	va_end(ap);
+	return;
+    }
+
+    if(CFIO_LOG_BUF_SIZE - _slot->buf->used < CFIO_LOG_LINE_MAX)
+    {
+	pthread_mutex_lock(&log_mutex);
+	_put_full_buf(_slot->buf);
+	buf = _get_free_buf();
+	pthread_mutex_unlock(&log_mutex);
+	_slot->buf = buf;
+	if(NULL == buf)
+	{
+	    vprintf(format, ap);
+	    va_end(ap);
+	    return;
+	}
+    }
+
+    buf = _slot->buf;
+    len = vsnprintf(buf->data + buf->used, CFIO_LOG_LINE_MAX, format, ap);
+    va_end(ap);
+    if(len >= CFIO_LOG_LINE_MAX)
+    {
+	len = CFIO_LOG_LINE_MAX - 1;
+	buf->data[buf->used + len - 1] = '\n';
+    }
+    if(len > 0)
+    {
+	buf->used += len;
+    }
+}
+
+int cfio_log_init(int rank)
+{
+    char *env, path[256];
+
+    if(NULL != (env = getenv(CFIO_DEBUG_ENV)))
+    {
+	debug_mask = (int)strtoul(env, NULL, 0);
+    }
+    if(DEBUG_NONE == debug_mask)
+    {
+	return CFIO_ERROR_NONE;
+    }
+
+    log_fp = stdout;
+    if(NULL != (env = getenv(CFIO_LOG_ENV)))
+    {
+	snprintf(path, sizeof(path), "%s.%d.log", env, rank);
+	if(NULL == (log_fp = fopen(path, "w")))
+	{
+	    error("open log file %s fail.", path);
+	    return CFIO_ERROR_FILE;
+	}
+    }
+
+    log_done = 0;
+    if(0 != pthread_create(&logger, NULL, logger_thread, NULL))
+    {
+	error("create logger thread fail.");
+	if(stdout != log_fp)
+	{
+	    fclose(log_fp);
+	}
+	return CFIO_ERROR_PTHREAD_CREATE;
+    }
+    log_on = 1;
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_log_final()
+{
+    cfio_log_slot_t *_slot, *next;
+    cfio_log_buf_t *buf;
+
+    if(!log_on)
+    {
+	return CFIO_ERROR_NONE;
+    }
+    log_on = 0;
+
+    pthread_mutex_lock(&log_mutex);
+    for(_slot = slots; NULL != _slot; _slot = next)
+    {
+	next = _slot->next;
+	if(NULL != _slot->buf)
+	{
+	    _put_full_buf(_slot->buf);
+	}
+	free(_slot);
+    }
+    slots = NULL;
+    slot = NULL;
+    log_done = 1;
+    pthread_cond_signal(&full_cond);
+    pthread_mutex_unlock(&log_mutex);
+
+    pthread_join(logger, NULL);
+
+    while(NULL != free_list)
+    {
+	buf = free_list;
+	free_list = buf->next;
+	free(buf->data);
+	free(buf);
+    }
+    buf_num = 0;
+    if(stdout != log_fp)
+    {
+	fclose(log_fp);
+    }
+
+    return CFIO_ERROR_NONE;
+}
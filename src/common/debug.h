@@ -37,15 +37,42 @@
 #define DEBUG_SEND	((uint32_t)1 << 10)
 #define DEBUG_RECV	((uint32_t)1 << 11)
 
+/* masks on the data path, e.g. pack, send and recv of every msg */
+#define DEBUG_HOT	(DEBUG_PACK | DEBUG_MSG | DEBUG_IO | DEBUG_BUF | \
+			 DEBUG_SEND | DEBUG_RECV)
+#define DEBUG_ALL	((uint32_t)0xffffffff)
+/* masks compiled in, debug() of other masks are eliminated by compiler, so 
+ * the data path doesn't even check debug_mask. build with 
+ * -DDEBUG_COMPILE_MASK=DEBUG_ALL to debug the data path */
+#ifndef DEBUG_COMPILE_MASK
+#define DEBUG_COMPILE_MASK (DEBUG_ALL & ~DEBUG_HOT)
+#endif
+
+/* env variable of the debug mask, e.g. CFIO_DEBUG=0x600 */
+#define CFIO_DEBUG_ENV		"CFIO_DEBUG"
+/* env variable of the log file prefix, rank i logs into <prefix>.i.log, the
+ * log is written into stdout if it's not set */
+#define CFIO_LOG_ENV		"CFIO_LOG"
+/* size of a log buffer, each thread fills its own buffer, and the logger 
+ * thread writes full buffers */
+#define CFIO_LOG_BUF_SIZE	(64 * 1024)
+/* max amount of log buffers, a thread waits for the logger if it's reached */
+#define CFIO_LOG_BUF_MAX	64
+/* max length of a log line, longer lines are truncated */
+#define CFIO_LOG_LINE_MAX	1024
+
 extern int debug_mask;
 
 #ifdef ENABLE_DEBUG
 /* try to avoid function call overhead by checking masks in macro */
 #define debug(mask, format, f...)                  \
-    if (debug_mask & mask)                         \
-    {                                                     \
-        printf("[%s, %s, %d]: " format "\n", __FILE__ , __func__, __LINE__ , ##f); \
-    }                                                     
+    do {							\
+	if ((DEBUG_COMPILE_MASK & (mask)) && (debug_mask & (mask)))	\
+	{							\
+	    cfio_log("[%s, %s, %d]: " format "\n", __FILE__ , __func__, \
+		    __LINE__ , ##f);				\
+	}							\
+    } while(0)
 #else
 #define debug(mask, format, f...) \
     do {} while(0)
@@ -59,4 +86,30 @@ extern int debug_mask;
 #define error(format, f...) \
     printf("[%s, %s, %d]: "format "\n", __FILE__, __func__, __LINE__, ##f);
 
+/**
+ * @brief: write a log line, it's buffered in the calling thread and written 
+ *	by the logger thread between cfio_log_init and cfio_log_final, and 
+ *	written into stdout at once otherwise
+ *
+ * @param format: format of the line, same as printf
+ */
+void cfio_log(const char *format, ...) 
+    __attribute__((format(printf, 1, 2)));
+/**
+ * @brief: init the log, set debug_mask by CFIO_DEBUG_ENV, and start the
+ *	logger thread if any mask is set
+ *
+ * @param rank: rank of the proc
+ *
+ * @return: error code
+ */
+int cfio_log_init(int rank);
+/**
+ * @brief: write the buffered log and stop the logger thread, all threads 
+ *	which log must have been finished
+ *
+ * @return: error code
+ */
+int cfio_log_final();
+
 #endif
@@ -16,7 +16,24 @@
 //#define SVR_UNPACK_ONLY
 //#define SVR_NO_IO
 #undef SVR_META_ONLY
+/* only the leader client of each server sends global metadata (def_dim, 
+ * put_att and the name and type of var), the other clients send only their 
+ * start and count of each var */
+//#define LEADER_META
+/* client converts put_vara data into the type of the var in file before
+ * sending, which cuts the traffic when the var is narrower than the data, 
+ * otherwise the server converts it when merging */
+//#define CLIENT_CONVERT
 //#define async_send
+/* state of a client or server proc is kept per thread, so that a process
+ * can host many procs as threads over the loopback transport. the sender 
+ * thread of async_send shares the state of its client, so the state is
+ * global then, and the loopback can't be used */
+#ifdef async_send
+#define cfio_proc_local
+#else
+#define cfio_proc_local __thread
+#endif
 
 //#define async_isend
 
@@ -4,98 +4,579 @@
  *    Description:  manage client's id assign, and server's id map, include
  *		    nc_id, var_id, dim_id
  *
+ *		    nc files are kept in open addressing tables keyed by the
+ *		    client nc id. In client, dim and var names of a file are
+ *		    kept in open addressing name tables; in server, dims and
+ *		    vars are kept in arrays indexed by the client id. All the
+ *		    memory of a file is allocated from its arena, and freed in
+ *		    one shot when the file is closed.
+ *
  *        Version:  1.0
  *        Created:  04/27/2012 02:50:33 PM
  *       Revision:  none
  *       Compiler:  gcc
  *
- *         Author:  Wang Wencan 
+ *         Author:  Wang Wencan
  *	    Email:  never.wencan@gmail.com
  *        Company:  HPC Tsinghua
  ***************************************************************************/
 #include <assert.h>
+#include <string.h>
 
 #include "id.h"
+#include "arena.h"
 #include "cfio_types.h"
 #include "cfio_error.h"
 #include "debug.h"
+#include "define.h"
 #include "times.h"
-#include "quickhash.h"
 #include "map.h"
 
-static int open_nc_a;  /* amount of opened nc file , assigned as new nc id*/
-static struct qhash_table *assign_table; /* used for assign id in client*/
-static struct qhash_table *map_table;	/* used for map id in server */
+/* slot of the open addressing nc table, key 0 means empty, the client nc id
+ * is assigned from 1 */
+typedef struct
+{
+    int key;		    /* client nc id */
+    cfio_id_file_t *file;
+}cfio_id_nc_slot_t;
 
-static int _compare_client_name(struct qhash_head *link, void *key)
+typedef struct
+{
+    int size;		    /* amount of slots, power of 2 */
+    int num;		    /* amount of used slots */
+    cfio_id_nc_slot_t *slots;
+}cfio_id_nc_table_t;
+
+/* amount of opened nc file , assigned as new nc id*/
+static cfio_proc_local int open_nc_a;
+/* used for assign id in client*/
+static cfio_proc_local cfio_id_nc_table_t *assign_table;
+/* used for map id in server */
+static cfio_proc_local cfio_id_nc_table_t *map_table;
+
+static inline int _nc_hash(int key, int size)
 {
-    assert(NULL != key);
-    assert(NULL != link);
+    return (int)(((uint32_t)key * 2654435761u) & (size - 1));
+}
 
-    cfio_id_client_name_t *name = qlist_entry(link, cfio_id_client_name_t, link);
+static inline uint32_t _name_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
 
-    if(strcmp((char *)key, name->name) == 0)
+    while('\0' != *name)
     {
-	return 1;
+	hash ^= (unsigned char)(*name ++);
+	hash *= 16777619u;
     }
 
-    return 0;
+    return hash;
 }
-static int _compare(void *key, struct qhash_head *link)
+
+/**
+ * @brief: free the data in a recv data vector, the vector itself is not freed
+ */
+static void _free_recv_data(cfio_id_data_t *recv_data, int client_num)
 {
-    assert(NULL != key);
-    assert(NULL != link);
+    int i;
+
+    if(NULL == recv_data)
+    {
+	return;
+    }
+    for(i = 0; i < client_num; i ++)
+    {
+	if(NULL != recv_data[i].buf)
+	{
+	    free(recv_data[i].buf);
+	    recv_data[i].buf = NULL;
+	}
+	if(NULL != recv_data[i].start)
+	{
+	    free(recv_data[i].start);
+	    recv_data[i].start = NULL;
+	}
+	if(NULL != recv_data[i].count)
+	{
+	    free(recv_data[i].count);
+	    recv_data[i].count = NULL;
+	}
+    }
+}
 
-    cfio_id_val_t *val = qlist_entry(link, cfio_id_val_t, hash_link);
+static void _free_rec(cfio_id_var_t *var, cfio_id_rec_t *rec)
+{
+    qlist_del(&(rec->link));
+    _free_recv_data(rec->recv_data, var->client_num);
+    free(rec->recv_data);
+    free(rec);
+}
 
-    if(0 == memcmp(key, val, sizeof(cfio_id_key_t)))
+/**
+ * @brief: find the record of a record var
+ *
+ * @param var: the record var
+ * @param rec: index of the record
+ * @param create: whether create the record if it is not found
+ *
+ * @return: the record, NULL if not found or malloc fail
+ */
+static cfio_id_rec_t *_get_rec(cfio_id_var_t *var, size_t rec, int create)
+{
+    cfio_id_rec_t *entry;
+
+    qlist_for_each_entry(entry, var->rec_head, link)
+    {
+	if(entry->rec == rec)
+	{
+	    return entry;
+	}
+    }
+    if(!create)
     {
-        return 1;
+	return NULL;
     }
 
-    return 0;
+    /* records come and go while the file is open, so they are not in arena */
+    entry = malloc(sizeof(cfio_id_rec_t));
+    if(NULL == entry)
+    {
+	error("malloc fail.");
+	return NULL;
+    }
+    entry->rec = rec;
+    entry->recv_data = malloc(sizeof(cfio_id_data_t) * var->client_num);
+    if(NULL == entry->recv_data)
+    {
+	error("malloc fail.");
+	free(entry);
+	return NULL;
+    }
+    memset(entry->recv_data, 0, sizeof(cfio_id_data_t) * var->client_num);
+    qlist_add_tail(&(entry->link), var->rec_head);
+
+    return entry;
 }
 
-static int _hash(void *key, int table_size)
+/**
+ * @brief: init an open addressing name table
+ */
+static int _name_table_init(cfio_id_name_table_t *table, int size)
 {
-    cfio_id_key_t *_key = key;
-    int a, b, c;
+    table->slots = malloc(sizeof(cfio_id_name_t) * size);
+    if(NULL == table->slots)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    memset(table->slots, 0, sizeof(cfio_id_name_t) * size);
+    table->size = size;
+    table->num = 0;
 
-    a = _key->client_nc_id; b = _key->client_dim_id; c = _key->client_var_id;
-    final(a, b, c);
+    return CFIO_ERROR_NONE;
+}
 
-    int h = (int)(c & (table_size - 1));
+/**
+ * @brief: find the slot of the name, if the name is not in the table, return
+ *	the empty slot where it should be put
+ */
+static cfio_id_name_t *_name_table_find(
+	cfio_id_name_table_t *table, const char *name, uint32_t hash)
+{
+    int i, mask = table->size - 1;
+    cfio_id_name_t *slot;
 
-    return h;
+    for(i = hash & mask; ; i = (i + 1) & mask)
+    {
+	slot = &table->slots[i];
+	if(NULL == slot->name ||
+		(slot->hash == hash && 0 == strcmp(slot->name, name)))
+	{
+	    return slot;
+	}
+    }
 }
 
-static void _val_free(cfio_id_val_t *val)
+/**
+ * @brief: put a name which is not in the table into the table, the name is
+ *	copied into the arena
+ */
+static int _name_table_add(cfio_id_name_table_t *table, cfio_arena_t *arena,
+	const char *name, uint32_t hash, int id)
 {
-    if(NULL != val)
+    int i, ret;
+    cfio_id_name_table_t new_table;
+    cfio_id_name_t *slot;
+
+    /* keep load factor under 1/2 */
+    if((table->num + 1) * 2 > table->size)
     {
-	if(NULL != val->var)
+	if((ret = _name_table_init(&new_table, table->size * 2)) < 0)
 	{
-	    if(NULL != val->var->start)
+	    return ret;
+	}
+	for(i = 0; i < table->size; i ++)
+	{
+	    if(NULL != table->slots[i].name)
 	    {
-		free(val->var->start);
-		val->var->start = NULL;
+		slot = _name_table_find(&new_table, table->slots[i].name,
+			table->slots[i].hash);
+		*slot = table->slots[i];
 	    }
-	    if(NULL != val->var->count)
+	}
+	new_table.num = table->num;
+	free(table->slots);
+	*table = new_table;
+    }
+
+    slot = _name_table_find(table, name, hash);
+    assert(NULL == slot->name);
+    if(NULL == (slot->name = cfio_arena_strdup(arena, name)))
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    slot->hash = hash;
+    slot->id = id;
+    table->num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: copy a name table, the names are copied into the arena
+ */
+static int _name_table_copy(cfio_id_name_table_t *dst,
+	cfio_id_name_table_t *src, cfio_arena_t *arena)
+{
+    int i, ret;
+
+    if((ret = _name_table_init(dst, src->size)) < 0)
+    {
+	return ret;
+    }
+    for(i = 0; i < src->size; i ++)
+    {
+	if(NULL != src->slots[i].name)
+	{
+	    dst->slots[i] = src->slots[i];
+	    if(NULL == (dst->slots[i].name = 
+			cfio_arena_strdup(arena, src->slots[i].name)))
 	    {
-		free(val->var->count);
-		val->var->count = NULL;
+		return CFIO_ERROR_MALLOC;
 	    }
-	    if(NULL != val->var->recv_data)
+	}
+    }
+    dst->num = src->num;
+
+    return CFIO_ERROR_NONE;
+}
+
+static cfio_id_file_t *_file_create(int client_nc_id)
+{
+    cfio_id_file_t *file;
+
+    file = malloc(sizeof(cfio_id_file_t));
+    if(NULL == file)
+    {
+	error("malloc fail.");
+	return NULL;
+    }
+    memset(file, 0, sizeof(cfio_id_file_t));
+    file->client_nc_id = client_nc_id;
+    INIT_QLIST_HEAD(&file->att_head);
+    if(NULL == (file->arena = cfio_arena_create(0)))
+    {
+	free(file);
+	return NULL;
+    }
+
+    return file;
+}
+
+static void _file_free(cfio_id_file_t *file)
+{
+    int i;
+    cfio_id_var_t *var;
+    cfio_id_rec_t *rec, *next;
+
+    if(NULL == file)
+    {
+	return;
+    }
+
+    /* recv data is not in the arena */
+    for(i = 0; i < file->var_size; i ++)
+    {
+	if(NULL != (var = file->vars[i]))
+	{
+	    _free_recv_data(var->recv_data, var->client_num);
+	    qlist_for_each_entry_safe(rec, next, var->rec_head, link)
 	    {
-		free(val->var->recv_data);
-		val->var->recv_data = NULL;
+		_free_rec(var, rec);
 	    }
-	    free(val->var);
-	    val->var = NULL;
 	}
-	free(val);
-	val = NULL;
     }
+    if(NULL != file->dims)
+    {
+	free(file->dims);
+    }
+    if(NULL != file->vars)
+    {
+	free(file->vars);
+    }
+    if(NULL != file->decomps)
+    {
+	free(file->decomps);
+    }
+    if(NULL != file->dim_names.slots)
+    {
+	free(file->dim_names.slots);
+    }
+    if(NULL != file->var_names.slots)
+    {
+	free(file->var_names.slots);
+    }
+    cfio_arena_destroy(file->arena);
+    free(file);
+}
+
+static int _copy_atts(cfio_arena_t *arena, 
+	qlist_head_t *dst_head, qlist_head_t *src_head)
+{
+    cfio_id_att_t *att, *src_att;
+    size_t ele_size = 0;
+
+    qlist_for_each_entry(src_att, src_head, link)
+    {
+	cfio_types_size(ele_size, src_att->xtype);
+	att = cfio_arena_memdup(arena, src_att, sizeof(cfio_id_att_t));
+	if(NULL == att ||
+		NULL == (att->name = cfio_arena_strdup(arena, src_att->name)) ||
+		NULL == (att->data = cfio_arena_memdup(arena, src_att->data, 
+			ele_size * src_att->len)))
+	{
+	    return CFIO_ERROR_MALLOC;
+	}
+	qlist_add_tail(&(att->link), dst_head);
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: copy a var which has not been defined into the arena, the recv data
+ *	is not copied
+ */
+static cfio_id_var_t *_copy_var(cfio_arena_t *arena, cfio_id_var_t *src)
+{
+    cfio_id_var_t *var;
+
+    var = cfio_arena_memdup(arena, src, sizeof(cfio_id_var_t));
+    if(NULL == var)
+    {
+	return NULL;
+    }
+    var->name = cfio_arena_strdup(arena, src->name);
+    var->dim_ids = cfio_arena_memdup(arena, src->dim_ids, 
+	    sizeof(int) * src->ndims);
+    var->start = cfio_arena_memdup(arena, src->start, 
+	    sizeof(size_t) * src->ndims);
+    var->count = cfio_arena_memdup(arena, src->count, 
+	    sizeof(size_t) * src->ndims);
+    var->client_start = cfio_arena_memdup(arena, src->client_start, 
+	    sizeof(size_t) * src->ndims * src->client_num);
+    var->client_count = cfio_arena_memdup(arena, src->client_count, 
+	    sizeof(size_t) * src->ndims * src->client_num);
+    var->recv_data = cfio_arena_alloc(arena,
+	    sizeof(cfio_id_data_t) * src->client_num);
+    var->rec_head = cfio_arena_alloc(arena, sizeof(qlist_head_t));
+    var->att_head = cfio_arena_alloc(arena, sizeof(qlist_head_t));
+    if(NULL == var->name || NULL == var->dim_ids || NULL == var->start ||
+	    NULL == var->count || NULL == var->client_start ||
+	    NULL == var->client_count || NULL == var->recv_data ||
+	    NULL == var->rec_head || NULL == var->att_head)
+    {
+	return NULL;
+    }
+    INIT_QLIST_HEAD(var->rec_head);
+    INIT_QLIST_HEAD(var->att_head);
+    if(_copy_atts(arena, var->att_head, src->att_head) < 0)
+    {
+	return NULL;
+    }
+
+    return var;
+}
+
+/**
+ * @brief: make sure that array[id] can be accessed
+ */
+static int _ensure_array(void ***array, int *size, int id)
+{
+    int new_size;
+    void **new_array;
+
+    if(id < *size)
+    {
+	return CFIO_ERROR_NONE;
+    }
+
+    new_size = 0 == *size ? CFIO_ID_ARRAY_INIT_SIZE : *size;
+    while(new_size <= id)
+    {
+	new_size *= 2;
+    }
+    new_array = realloc(*array, sizeof(void *) * new_size);
+    if(NULL == new_array)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    memset(new_array + *size, 0, sizeof(void *) * (new_size - *size));
+    *array = new_array;
+    *size = new_size;
+
+    return CFIO_ERROR_NONE;
+}
+
+static cfio_id_nc_table_t *_nc_table_create(int size)
+{
+    cfio_id_nc_table_t *table;
+
+    table = malloc(sizeof(cfio_id_nc_table_t));
+    if(NULL == table)
+    {
+	error("malloc fail.");
+	return NULL;
+    }
+    table->slots = malloc(sizeof(cfio_id_nc_slot_t) * size);
+    if(NULL == table->slots)
+    {
+	error("malloc fail.");
+	free(table);
+	return NULL;
+    }
+    memset(table->slots, 0, sizeof(cfio_id_nc_slot_t) * size);
+    table->size = size;
+    table->num = 0;
+
+    return table;
+}
+
+static void _nc_table_destroy(cfio_id_nc_table_t *table)
+{
+    int i;
+
+    for(i = 0; i < table->size; i ++)
+    {
+	if(0 != table->slots[i].key)
+	{
+	    _file_free(table->slots[i].file);
+	}
+    }
+    free(table->slots);
+    free(table);
+}
+
+/**
+ * @return: index of the slot of the key, -1 if not found
+ */
+static int _nc_table_find(cfio_id_nc_table_t *table, int key)
+{
+    int i, mask = table->size - 1;
+
+    for(i = _nc_hash(key, table->size); 0 != table->slots[i].key;
+	    i = (i + 1) & mask)
+    {
+	if(key == table->slots[i].key)
+	{
+	    return i;
+	}
+    }
+
+    return -1;
+}
+
+static int _nc_table_add(cfio_id_nc_table_t *table, cfio_id_file_t *file)
+{
+    int i, j, mask, new_size;
+    cfio_id_nc_slot_t *slots, *old_slots;
+
+    assert(0 != file->client_nc_id);
+
+    if((table->num + 1) * 2 > table->size)
+    {
+	new_size = table->size * 2;
+	slots = malloc(sizeof(cfio_id_nc_slot_t) * new_size);
+	if(NULL == slots)
+	{
+	    error("malloc fail.");
+	    return CFIO_ERROR_MALLOC;
+	}
+	memset(slots, 0, sizeof(cfio_id_nc_slot_t) * new_size);
+	old_slots = table->slots;
+	for(i = 0; i < table->size; i ++)
+	{
+	    if(0 != old_slots[i].key)
+	    {
+		for(j = _nc_hash(old_slots[i].key, new_size); 0 != slots[j].key;
+			j = (j + 1) & (new_size - 1));
+		slots[j] = old_slots[i];
+	    }
+	}
+	free(old_slots);
+	table->slots = slots;
+	table->size = new_size;
+    }
+
+    mask = table->size - 1;
+    for(i = _nc_hash(file->client_nc_id, table->size);
+	    0 != table->slots[i].key; i = (i + 1) & mask);
+    table->slots[i].key = file->client_nc_id;
+    table->slots[i].file = file;
+    table->num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: remove the slot i, and shift the following slots back so that no
+ *	tombstone is needed
+ */
+static void _nc_table_del(cfio_id_nc_table_t *table, int i)
+{
+    int j, home, mask = table->size - 1;
+
+    j = i;
+    while(1)
+    {
+	j = (j + 1) & mask;
+	if(0 == table->slots[j].key)
+	{
+	    break;
+	}
+	home = _nc_hash(table->slots[j].key, table->size);
+	/* slot j can be moved to i if its home is not in (i, j] */
+	if((i <= j) ? (home <= i || home > j) : (home <= i && home > j))
+	{
+	    table->slots[i] = table->slots[j];
+	    i = j;
+	}
+    }
+    table->slots[i].key = 0;
+    table->slots[i].file = NULL;
+    table->num --;
+}
+
+static cfio_id_file_t *_get_file(cfio_id_nc_table_t *table, int client_nc_id)
+{
+    int i;
+
+    if(NULL == table || (i = _nc_table_find(table, client_nc_id)) < 0)
+    {
+	return NULL;
+    }
+
+    return table->slots[i].file;
 }
 
 int cfio_id_init(int flag)
@@ -107,7 +588,7 @@ int cfio_id_init(int flag)
     switch(flag)
     {
 	case CFIO_ID_INIT_CLIENT :
-	    assign_table = qhash_init(_compare, _hash, ASSIGN_HASH_TABLE_SIZE);
+	    assign_table = _nc_table_create(CFIO_ID_NC_TABLE_INIT_SIZE);
 	    if(assign_table == NULL)
 	    {
 		error("assign_table init fail.");
@@ -115,7 +596,7 @@ int cfio_id_init(int flag)
 	    }
 	    break;
 	case CFIO_ID_INIT_SERVER :
-	    map_table = qhash_init(_compare,_hash, MAP_HASH_TABLE_SIZE);
+	    map_table = _nc_table_create(CFIO_ID_NC_TABLE_INIT_SIZE);
 	    if(map_table == NULL)
 	    {
 		error("map_table init fail.");
@@ -134,14 +615,13 @@ int cfio_id_final()
 {
     if(NULL != assign_table)
     {
-	qhash_destroy_and_finalize(assign_table, cfio_id_val_t, 
-		hash_link, _val_free);
+	_nc_table_destroy(assign_table);
 	assign_table = NULL;
     }
 
     if(NULL != map_table)
     {
-	qhash_destroy_and_finalize(map_table, cfio_id_val_t, hash_link, _val_free);
+	_nc_table_destroy(map_table);
 	map_table = NULL;
     }
 
@@ -153,661 +633,824 @@ int cfio_id_assign_nc(int *nc_id)
 {
     assert(nc_id != NULL);
 
-    int i;
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
+    int ret;
+    cfio_id_file_t *file;
 
     open_nc_a ++;
-    
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = open_nc_a;
 
-    val = malloc(sizeof(cfio_id_val_t));
-    if(val == NULL)
+    if(NULL == (file = _file_create(open_nc_a)))
     {
-	error("malloc fail.");
 	return CFIO_ERROR_MALLOC;
     }
-    memset(val, 0, sizeof(cfio_id_val_t));
-    val->client_nc_id = open_nc_a;
-    val->var_head = malloc(sizeof(qlist_head_t));
-    if(val->var_head == NULL)
+    if((ret = _name_table_init(&file->dim_names,
+		    CFIO_ID_NAME_TABLE_INIT_SIZE)) < 0 ||
+	    (ret = _name_table_init(&file->var_names,
+		CFIO_ID_NAME_TABLE_INIT_SIZE)) < 0 ||
+	    (ret = _nc_table_add(assign_table, file)) < 0)
     {
-	error("malloc fail.");
-	return CFIO_ERROR_MALLOC;
+	_file_free(file);
+	return ret;
     }
-    val->dim_head = malloc(sizeof(qlist_head_t));
-    if(val->dim_head == NULL)
+    *nc_id = open_nc_a;
+    debug(DEBUG_ID, "assign nc_id = %d", *nc_id);
+
+    debug(DEBUG_ID, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_assign_schema(int *schema_id)
+{
+    int ret;
+    cfio_id_file_t *file;
+
+    if((ret = cfio_id_assign_nc(schema_id)) < 0)
+    {
+	return ret;
+    }
+    file = _get_file(assign_table, *schema_id);
+    file->is_schema = 1;
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_inq_nc(int nc_id, int *is_schema, int *rec_dim_id)
+{
+    cfio_id_file_t *file;
+
+    if(NULL == (file = _get_file(assign_table, nc_id)))
+    {
+	error("nc_id(%d) not found in assign_table.", nc_id);
+	return CFIO_ERROR_NC_NO_EXIST;
+    }
+    *is_schema = file->is_schema;
+    *rec_dim_id = file->client_rec_dim;
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_assign_nc_from(int schema_id, int *nc_id)
+{
+    assert(nc_id != NULL);
+
+    int ret, i;
+    cfio_id_file_t *file, *schema;
+    cfio_id_decomp_t *decomp;
+
+    if(NULL == (schema = _get_file(assign_table, schema_id)))
+    {
+	error("schema(%d) not found in assign_table.", schema_id);
+	return CFIO_ERROR_NC_NO_EXIST;
+    }
+
+    open_nc_a ++;
+
+    if(NULL == (file = _file_create(open_nc_a)))
     {
-	error("malloc fail.");
 	return CFIO_ERROR_MALLOC;
     }
-    INIT_QLIST_HEAD(val->var_head);
-    INIT_QLIST_HEAD(val->dim_head);
-    qhash_add(assign_table, &key, &(val->hash_link));
+    if((ret = _name_table_copy(&file->dim_names, &schema->dim_names,
+		    file->arena)) < 0 ||
+	    (ret = _name_table_copy(&file->var_names, &schema->var_names,
+		file->arena)) < 0 ||
+	    (ret = _nc_table_add(assign_table, file)) < 0)
+    {
+	_file_free(file);
+	return ret;
+    }
+    file->client_dim_a = schema->client_dim_a;
+    file->client_var_a = schema->client_var_a;
+    file->client_rec_dim = schema->client_rec_dim;
+    for(i = 0; i < schema->decomp_size; i ++)
+    {
+	decomp = schema->decomps[i];
+	if(NULL != decomp && (ret = cfio_id_set_decomp(open_nc_a, i, 
+			decomp->ndims, decomp->start, decomp->count,
+			decomp->xtype)) < 0)
+	{
+	    cfio_id_remove_nc(open_nc_a);
+	    return ret;
+	}
+    }
     *nc_id = open_nc_a;
-    debug(DEBUG_ID, "assign nc_id = %d", *nc_id);
+    debug(DEBUG_ID, "assign nc_id = %d from schema(%d)", *nc_id, schema_id);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_remove_nc(int nc_id)
+{
+    int i;
+    cfio_id_file_t *file;
+
+    if((i = _nc_table_find(assign_table, nc_id)) < 0)
+    {
+	error("nc_id(%d) not found in assign_table.", nc_id);
+	return CFIO_ERROR_NC_NO_EXIST;
+    }
+    file = assign_table->slots[i].file;
+    _nc_table_del(assign_table, i);
+    _file_free(file);
+
+    debug(DEBUG_ID, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: find the id of the name, assign a new id if the name is not found
+ *	and assign is set
+ */
+static int _assign_id(int nc_id, char *name,
+	int *id, int is_var, int assign)
+{
+    int ret;
+    uint32_t hash;
+    cfio_id_file_t *file;
+    cfio_id_name_table_t *table;
+    cfio_id_name_t *slot;
+    int *amount;
+
+    if(NULL == (file = _get_file(assign_table, nc_id)))
+    {
+	error("nc_id(%d) not found in assign_table.", nc_id);
+	return CFIO_ERROR_NC_NO_EXIST;
+    }
+    table = is_var ? &file->var_names : &file->dim_names;
+    amount = is_var ? &file->client_var_a : &file->client_dim_a;
+
+    hash = _name_hash(name);
+    slot = _name_table_find(table, name, hash);
+    if(NULL != slot->name)
+    {
+	*id = slot->id;
+	return CFIO_ERROR_NONE;
+    }
+    if(!assign)
+    {
+	return CFIO_ERROR_VAR_NO_EXIST;
+    }
+
+    if((ret = _name_table_add(table, file->arena, name, hash,
+		    *amount + 1)) < 0)
+    {
+	return ret;
+    }
+    (*amount) ++;
+    *id = *amount;
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_assign_dim(int nc_id, char *dim_name, size_t len, int *dim_id)
+{
+    assert(dim_id != NULL);
+
+    int ret;
+
+    if((ret = _assign_id(nc_id, dim_name, dim_id, 0, 1)) < 0)
+    {
+	return ret;
+    }
+    if(CFIO_UNLIMITED == len)
+    {
+	_get_file(assign_table, nc_id)->client_rec_dim = *dim_id;
+    }
+    debug(DEBUG_ID, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_assign_var(int nc_id, char *var_name, int *var_id)
+{
+    assert(var_id != NULL);
+
+    int ret;
+
+    if((ret = _assign_id(nc_id, var_name, var_id, 1, 1)) < 0)
+    {
+	return ret;
+    }
+    debug(DEBUG_ID, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_set_decomp(int nc_id, int var_id, 
+	int ndims, size_t *start, size_t *count, cfio_type xtype)
+{
+    int ret;
+    cfio_id_file_t *file;
+    cfio_id_decomp_t *decomp;
+
+    if(NULL == (file = _get_file(assign_table, nc_id)))
+    {
+	error("nc_id(%d) not found in assign_table.", nc_id);
+	return CFIO_ERROR_NC_NO_EXIST;
+    }
+    if((ret = _ensure_array((void ***)&file->decomps, &file->decomp_size,
+		    var_id)) < 0)
+    {
+	return ret;
+    }
+
+    /* a redefined var keeps the old copy in the arena, which is rare */
+    decomp = cfio_arena_alloc(file->arena, sizeof(cfio_id_decomp_t));
+    if(NULL == decomp ||
+	    NULL == (decomp->start = cfio_arena_memdup(file->arena, start,
+		    sizeof(size_t) * ndims)) ||
+	    NULL == (decomp->count = cfio_arena_memdup(file->arena, count,
+		    sizeof(size_t) * ndims)))
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    decomp->ndims = ndims;
+    decomp->xtype = xtype;
+    file->decomps[var_id] = decomp;
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_get_decomp(int nc_id, int var_id, cfio_id_decomp_t **decomp)
+{
+    cfio_id_file_t *file;
+
+    assert(NULL != decomp);
+
+    *decomp = NULL;
+    if(NULL == (file = _get_file(assign_table, nc_id)))
+    {
+	error("nc_id(%d) not found in assign_table.", nc_id);
+	return CFIO_ERROR_NC_NO_EXIST;
+    }
+    if(var_id < 0 || var_id >= file->decomp_size || 
+	    NULL == file->decomps[var_id])
+    {
+	return CFIO_ERROR_VAR_NO_EXIST;
+    }
+    *decomp = file->decomps[var_id];
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_inq_var(int nc_id, char *var_name, int *var_id)
+{
+    assert(var_id != NULL);
+
+    int ret;
+
+    if((ret = _assign_id(nc_id, var_name, var_id, 1, 0)) < 0)
+    {
+	return ret;
+    }
+    debug(DEBUG_ID, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_map_nc(
+	int client_nc_id, int server_nc_id)
+{
+    int ret;
+    cfio_id_file_t *file;
+
+    if(NULL == (file = _file_create(client_nc_id)))
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    file->nc.nc_id = server_nc_id;
+    file->nc.nc_status = DEFINE_MODE;
+
+    if((ret = _nc_table_add(map_table, file)) < 0)
+    {
+	_file_free(file);
+	return ret;
+    }
+
+    debug(DEBUG_ID, "map ((%d, 0, 0)->(%d, 0, 0)",
+	     client_nc_id, server_nc_id);
 
-    debug(DEBUG_ID, "success return.");
     return CFIO_ERROR_NONE;
 }
 
-int cfio_id_remove_nc(int nc_id)
+int cfio_id_map_nc_from(int client_nc_id, int server_nc_id, int schema_nc_id)
 {
-    cfio_id_key_t key;
-    struct qhash_head *link;
-    
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = nc_id;
+    int ret, i;
+    cfio_id_file_t *file, *schema;
+    cfio_id_dim_t *dim;
 
-    if(NULL == (link = qhash_search(assign_table, &key)))
+    if(NULL == (schema = _get_file(map_table, schema_nc_id)))
     {
-	error("nc_id(%d) not found in assign_table.", nc_id);
-	return CFIO_ERROR_NC_NO_EXIST;
-    }else
+	debug(DEBUG_ID, "get schema (%d, 0, 0) null", schema_nc_id);
+	return CFIO_ID_HASH_GET_NULL;
+    }
+    if(NULL == (file = _file_create(client_nc_id)))
     {
-	qhash_del(link);
-	cfio_id_val_free(qlist_entry(link, cfio_id_val_t, hash_link));
-	debug(DEBUG_ID, "success return.");
-	return CFIO_ERROR_NONE;
+	return CFIO_ERROR_MALLOC;
     }
-}
-
-int cfio_id_assign_dim(int nc_id, char *dim_name, int *dim_id)
-{
-    assert(dim_id != NULL);
-    
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
-    cfio_id_client_name_t *name_entry;
-    struct qhash_head *link;
+    file->nc.nc_id = server_nc_id;
+    file->nc.nc_status = DEFINE_MODE;
 
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = nc_id;
-
-    if(NULL == (link = qhash_search(assign_table, &key)))
+    ret = CFIO_ERROR_MALLOC;
+    if(schema->dim_size > 0 && _ensure_array((void ***)&file->dims, 
+		&file->dim_size, schema->dim_size - 1) < 0)
     {
-	error("nc_id(%d) not found in assign_table.", nc_id);
-	return CFIO_ERROR_NC_NO_EXIST;
-    }else
+	goto RETURN;
+    }
+    for(i = 0; i < schema->dim_size; i ++)
     {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	link = qlist_find(val->dim_head, _compare_client_name, dim_name);
-	if(link == NULL)
+	if(NULL == (dim = schema->dims[i]))
 	{
-	    val->client_dim_a ++;
-	    *dim_id = val->client_dim_a;
-	    name_entry = malloc(sizeof(cfio_id_client_name_t));
-	    if(name_entry == NULL)
-	    {
-		error("malloc fail.");
-		return CFIO_ERROR_MALLOC;
-	    }
-
-	    name_entry->name = strdup(dim_name);
-	    name_entry->id = *dim_id;
-	    qlist_add(&name_entry->link, val->dim_head);
-	}else
+	    continue;
+	}
+	file->dims[i] = cfio_arena_memdup(file->arena, dim, 
+		sizeof(cfio_id_dim_t));
+	if(NULL == file->dims[i] || NULL == (file->dims[i]->name = 
+		    cfio_arena_strdup(file->arena, dim->name)))
 	{
-	    name_entry = qlist_entry(link, cfio_id_client_name_t, link);
-	    *dim_id = name_entry->id;
+	    goto RETURN;
 	}
-	debug(DEBUG_ID, "success return.");
-	return CFIO_ERROR_NONE;
     }
-}
-
-int cfio_id_assign_var(int nc_id, char *var_name, int *var_id)
-{
-    assert(var_id != NULL);
-
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
-    cfio_id_client_name_t *name_entry;
-    struct qhash_head *link;
-    
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = nc_id;
-
-    if(NULL == (link = qhash_search(assign_table, &key)))
+    if(schema->var_size > 0 && _ensure_array((void ***)&file->vars, 
+		&file->var_size, schema->var_size - 1) < 0)
     {
-	error("nc_id(%d) not found in assign_table.", nc_id);
-	return CFIO_ERROR_NC_NO_EXIST;
-    }else
+	goto RETURN;
+    }
+    for(i = 0; i < schema->var_size; i ++)
     {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	link = qlist_find(val->var_head, _compare_client_name, var_name);
-	if(link == NULL)
-	{
-	    val->client_var_a ++;
-	    *var_id = val->client_var_a;
-	    name_entry = malloc(sizeof(cfio_id_client_name_t));
-	    if(name_entry == NULL)
-	    {
-		error("malloc fail.");
-		return CFIO_ERROR_MALLOC;
-	    }
-
-	    name_entry->name = strdup(var_name);
-	    name_entry->id = *var_id;
-	    qlist_add(&name_entry->link, val->var_head);
-	}else
+	if(NULL != schema->vars[i] && NULL == (file->vars[i] = 
+		    _copy_var(file->arena, schema->vars[i])))
 	{
-	    name_entry = qlist_entry(link, cfio_id_client_name_t, link);
-	    *var_id = name_entry->id;
+	    goto RETURN;
 	}
-	debug(DEBUG_ID, "success return.");
-	return CFIO_ERROR_NONE;
     }
+    if(_copy_atts(file->arena, &file->att_head, &schema->att_head) < 0)
+    {
+	goto RETURN;
+    }
+    if((ret = _nc_table_add(map_table, file)) < 0)
+    {
+	goto RETURN;
+    }
+
+    debug(DEBUG_ID, "map ((%d, 0, 0)->(%d, 0, 0)) from schema(%d)",
+	     client_nc_id, server_nc_id, schema_nc_id);
+
+    return CFIO_ERROR_NONE;
+
+RETURN:
+    _file_free(file);
+    return ret;
 }
 
-int cfio_id_inq_var(int nc_id, char *var_name, int *var_id)
+int cfio_id_copy_var_decomp(int client_nc_id, int schema_nc_id, 
+	int client_index)
 {
-    assert(var_id != NULL);
-	
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
-    cfio_id_client_name_t *name_entry;
-    struct qhash_head *link;
-    
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = nc_id;
+    int i;
+    size_t offset, size;
+    cfio_id_file_t *file, *schema;
+    cfio_id_var_t *var, *src;
 
-    if(NULL == (link = qhash_search(assign_table, &key)))
+    if(NULL == (file = _get_file(map_table, client_nc_id)) ||
+	    NULL == (schema = _get_file(map_table, schema_nc_id)))
     {
-	error("nc_id(%d) not found in assign_table.", nc_id);
-	return CFIO_ERROR_NC_NO_EXIST;
-    }else
+	debug(DEBUG_ID, "get nc (%d, 0, 0) or schema (%d, 0, 0) null", 
+		client_nc_id, schema_nc_id);
+	return CFIO_ID_HASH_GET_NULL;
+    }
+
+    for(i = 0; i < schema->var_size && i < file->var_size; i ++)
     {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	link = qlist_find(val->var_head, _compare_client_name, var_name);
-	if(link == NULL)
-	{
-	    return CFIO_ERROR_VAR_NO_EXIST;
-	}else
+	if(NULL == (src = schema->vars[i]) || NULL == (var = file->vars[i]) ||
+		src->ndims != var->ndims)
 	{
-	    name_entry = qlist_entry(link, cfio_id_client_name_t, link);
-	    *var_id = name_entry->id;
+	    continue;
 	}
-	debug(DEBUG_ID, "success return.");
-	return CFIO_ERROR_NONE;
+	assert(client_index >= 0 && client_index < var->client_num);
+	offset = client_index * var->ndims;
+	size = sizeof(size_t) * var->ndims;
+	memcpy(var->client_start + offset, src->client_start + offset, size);
+	memcpy(var->client_count + offset, src->client_count + offset, size);
     }
-}
 
-int cfio_id_map_nc(
-	int client_nc_id, int server_nc_id)
-{
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
+    debug(DEBUG_ID, "copy decomp of client %d from schema(%d) to (%d, 0, 0)",
+	    client_index, schema_nc_id, client_nc_id);
 
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
+    return CFIO_ERROR_NONE;
+}
 
-    val = malloc(sizeof(cfio_id_val_t));
-    memset(val, 0, sizeof(cfio_id_val_t));
-    val->client_nc_id = client_nc_id;
-    val->nc = malloc(sizeof(cfio_id_nc_t));
-    val->nc->nc_id = server_nc_id;
-    val->nc->nc_status = DEFINE_MODE;
+int cfio_id_unmap_nc(int client_nc_id)
+{
+    int i;
+    cfio_id_file_t *file;
 
-    qhash_add(map_table, &key, &(val->hash_link));
-    INIT_QLIST_HEAD(&(val->link));
+    if((i = _nc_table_find(map_table, client_nc_id)) < 0)
+    {
+	debug(DEBUG_ID, "get nc (%d, 0, 0) null", client_nc_id);
+	return CFIO_ID_HASH_GET_NULL;
+    }
+    file = map_table->slots[i].file;
+    _nc_table_del(map_table, i);
+    _file_free(file);
 
-    debug(DEBUG_ID, "map ((%d, 0, 0)->(%d, 0, 0)", 
-	     client_nc_id, server_nc_id);
+    debug(DEBUG_ID, "unmap (%d, 0, 0)", client_nc_id);
 
     return CFIO_ERROR_NONE;
 }
 
-/**
- * name : addr_copy
- **/
 int cfio_id_map_dim(
-	int client_nc_id, int client_dim_id, 
+	int client_nc_id, int client_dim_id,
 	int server_nc_id, int server_dim_id,
 	char *name, int dim_len)
 {
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
-    cfio_id_val_t *nc_val;
-    struct qhash_head *link;
-
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
-
-    link = qhash_search(map_table, &key);
-    nc_val = qlist_entry(link, cfio_id_val_t, hash_link);
-    
-    key.client_dim_id = client_dim_id;
-
-    val = malloc(sizeof(cfio_id_val_t));
-    memset(val, 0, sizeof(cfio_id_val_t));
-    val->client_nc_id = client_nc_id;
-    val->client_dim_id = client_dim_id;
-    val->dim = malloc(sizeof(cfio_id_dim_t));
-    memset(val->dim, 0, sizeof(cfio_id_dim_t));
-    val->dim->nc_id = server_nc_id;
-    val->dim->dim_id = server_dim_id;
-    val->dim->name = name;
-    val->dim->dim_len = CFIO_ID_DIM_LOCAL_NULL;
-    val->dim->global_dim_len = dim_len;
-
-    qhash_add(map_table, &key, &(val->hash_link));
-    qlist_add_tail(&(val->link), &(nc_val->link));
-    
+    int ret;
+    cfio_id_file_t *file;
+    cfio_id_dim_t *dim;
+
+    if(NULL == (file = _get_file(map_table, client_nc_id)))
+    {
+	debug(DEBUG_ID, "get nc (%d, 0, 0) null", client_nc_id);
+	return CFIO_ID_HASH_GET_NULL;
+    }
+    if(client_dim_id < 0)
+    {
+	return CFIO_ERROR_INVALID_DIM;
+    }
+    if((ret = _ensure_array((void ***)&file->dims, &file->dim_size,
+		    client_dim_id)) < 0)
+    {
+	return ret;
+    }
+
+    dim = cfio_arena_alloc(file->arena, sizeof(cfio_id_dim_t));
+    if(NULL == dim || NULL == (dim->name = cfio_arena_strdup(file->arena, name)))
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    dim->nc_id = server_nc_id;
+    dim->dim_id = server_dim_id;
+    dim->dim_len = CFIO_ID_DIM_LOCAL_NULL;
+    dim->global_dim_len = dim_len;
+    file->dims[client_dim_id] = dim;
+
     debug(DEBUG_ID, "map ((%d, %d, 0)->(%d, %d, 0))",
 	    client_nc_id, client_dim_id, server_nc_id, server_dim_id);
 
     return CFIO_ERROR_NONE;
 }
 
-/**
- * name, start, count , dim_ids : addr_copy
- **/
 int cfio_id_map_var(
-	char *name, 
+	char *name,
 	int client_nc_id, int client_var_id,
 	int server_nc_id, int server_var_id,
 	int ndims, int *dim_ids,
 	size_t *start, size_t *count,
 	cfio_type data_type, int client_num)
 {
-    int i;
-    size_t data_size;
-    cfio_id_val_t *nc_val;
-
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
-    struct qhash_head *link;
-
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
-    
-    link = qhash_search(map_table, &key);
-    nc_val = qlist_entry(link, cfio_id_val_t, hash_link);
-    
-    key.client_var_id = client_var_id;
-
-    val = malloc(sizeof(cfio_id_val_t));
-    memset(val, 0, sizeof(cfio_id_val_t));
-    val->client_nc_id = client_nc_id;
-    val->client_var_id = client_var_id;
-
-    val->var = malloc(sizeof(cfio_id_var_t));
-    val->var->name = name;
-    val->var->nc_id = server_nc_id;
-    val->var->var_id = server_var_id;
-    val->var->ndims = ndims;
-    val->var->client_num = client_num;
-    val->var->dim_ids = dim_ids;
-    val->var->start = start;
-    val->var->count = count;
+    int ret;
+    cfio_id_file_t *file;
+    cfio_id_var_t *var;
+    cfio_arena_t *arena;
 
     assert(client_num > 0);
-    val->var->recv_data = malloc(sizeof(cfio_id_data_t) * client_num);
-    memset(val->var->recv_data, 0, sizeof(cfio_id_data_t) * client_num);
-    val->var->data_type = data_type;
 
-    val->var->att_head = malloc(sizeof(qlist_head_t));
-    INIT_QLIST_HEAD(val->var->att_head);
+    if(NULL == (file = _get_file(map_table, client_nc_id)))
+    {
+	debug(DEBUG_ID, "get nc (%d, 0, 0) null", client_nc_id);
+	return CFIO_ID_HASH_GET_NULL;
+    }
+    if(client_var_id < 0)
+    {
+	return CFIO_ERROR_INVALID_VAR;
+    }
+    if((ret = _ensure_array((void ***)&file->vars, &file->var_size,
+		    client_var_id)) < 0)
+    {
+	return ret;
+    }
 
-    qhash_add(map_table, &key, &(val->hash_link));
-    qlist_add_tail(&(val->link), &(nc_val->link));
-    
-    debug(DEBUG_ID, "map ((%d, 0, %d)->(%d, 0, %d))",  
+    arena = file->arena;
+    var = cfio_arena_alloc(arena, sizeof(cfio_id_var_t));
+    if(NULL == var)
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    if(NULL != name)
+    {
+	var->name = cfio_arena_strdup(arena, name);
+	var->dim_ids = cfio_arena_memdup(arena, dim_ids, sizeof(int) * ndims);
+    }else
+    {
+	/* only start and count is known, the rest is set by set_var */
+	var->dim_ids = cfio_arena_alloc(arena, sizeof(int) * ndims);
+    }
+    var->start = cfio_arena_memdup(arena, start, sizeof(size_t) * ndims);
+    var->count = cfio_arena_memdup(arena, count, sizeof(size_t) * ndims);
+    var->client_start = cfio_arena_alloc(arena, 
+	    sizeof(size_t) * ndims * client_num);
+    var->client_count = cfio_arena_alloc(arena, 
+	    sizeof(size_t) * ndims * client_num);
+    var->recv_data = cfio_arena_alloc(arena,
+	    sizeof(cfio_id_data_t) * client_num);
+    var->rec_head = cfio_arena_alloc(arena, sizeof(qlist_head_t));
+    var->att_head = cfio_arena_alloc(arena, sizeof(qlist_head_t));
+    if((NULL != name && NULL == var->name) || NULL == var->dim_ids || 
+	    NULL == var->start || NULL == var->count || 
+	    NULL == var->client_start || NULL == var->client_count ||
+	    NULL == var->recv_data ||
+	    NULL == var->rec_head || NULL == var->att_head)
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    var->nc_id = server_nc_id;
+    var->var_id = server_var_id;
+    var->ndims = ndims;
+    var->client_num = client_num;
+    var->data_type = data_type;
+    var->is_record = 0;
+    INIT_QLIST_HEAD(var->rec_head);
+    INIT_QLIST_HEAD(var->att_head);
+    file->vars[client_var_id] = var;
+
+    debug(DEBUG_ID, "map ((%d, 0, %d)->(%d, 0, %d))",
 	    client_nc_id, client_var_id, server_nc_id, server_var_id);
-    debug(DEBUG_ID, "client_num = %d",  
+    debug(DEBUG_ID, "client_num = %d",
 	    client_num);
 
     return CFIO_ERROR_NONE;
 }
 
-int cfio_id_get_val(
-	int client_nc_id, int client_var_id, int client_dim_id,
-	cfio_id_val_t **val)
+int cfio_id_put_var_decomp(
+	int client_nc_id, int client_var_id, int client_index,
+	size_t *start, size_t *count)
 {
-    cfio_id_key_t key;
-    struct qhash_head *link;
-    
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
-    key.client_var_id = client_var_id;
-    key.client_dim_id = client_dim_id;
+    cfio_id_var_t *var;
 
-    if(NULL == (link = qhash_search(map_table, &key)))
+    if(CFIO_ID_HASH_GET_NULL ==
+	    cfio_id_get_var(client_nc_id, client_var_id, &var))
     {
-	debug(DEBUG_ID, "get nc (%d, 0, 0) null", client_nc_id);
+	debug(DEBUG_ID, "Can't find var (%d, 0, %d)",
+		client_nc_id, client_var_id);
 	return CFIO_ID_HASH_GET_NULL;
-    }else
+    }
+    assert(client_index >= 0 && client_index < var->client_num);
+
+    memcpy(var->client_start + client_index * var->ndims, start,
+	    sizeof(size_t) * var->ndims);
+    memcpy(var->client_count + client_index * var->ndims, count,
+	    sizeof(size_t) * var->ndims);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_set_var(
+	int client_nc_id, int client_var_id,
+	char *name, int *dim_ids, cfio_type data_type)
+{
+    cfio_id_file_t *file;
+    cfio_id_var_t *var;
+
+    if(CFIO_ID_HASH_GET_NULL ==
+	    cfio_id_get_var(client_nc_id, client_var_id, &var))
     {
-	*val = qlist_entry(link, cfio_id_val_t, hash_link);
-	return CFIO_ERROR_NONE;
+	debug(DEBUG_ID, "Can't find var (%d, 0, %d)",
+		client_nc_id, client_var_id);
+	return CFIO_ID_HASH_GET_NULL;
+    }
+    cfio_id_get_file(client_nc_id, &file);
+
+    if(NULL == (var->name = cfio_arena_strdup(file->arena, name)))
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    memcpy(var->dim_ids, dim_ids, sizeof(int) * var->ndims);
+    var->data_type = data_type;
+
+    debug(DEBUG_ID, "set var (%d, 0, %d) : %s", 
+	    client_nc_id, client_var_id, name);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_get_file(
+	int client_nc_id, cfio_id_file_t **file)
+{
+    if(NULL == (*file = _get_file(map_table, client_nc_id)))
+    {
+	debug(DEBUG_ID, "get nc (%d, 0, 0) null", client_nc_id);
+	return CFIO_ID_HASH_GET_NULL;
     }
+
+    return CFIO_ERROR_NONE;
 }
 
 int cfio_id_get_nc(
 	int client_nc_id, cfio_id_nc_t **nc)
 {
-    cfio_id_key_t key;
-    struct qhash_head *link;
-    cfio_id_val_t *val;
-
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
+    cfio_id_file_t *file;
 
-    if(NULL == (link = qhash_search(map_table, &key)))
+    if(NULL == (file = _get_file(map_table, client_nc_id)))
     {
 	debug(DEBUG_ID, "get nc (%d, 0, 0) null", client_nc_id);
 	return CFIO_ID_HASH_GET_NULL;
-    }else
-    {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	assert(val->nc != NULL);
-	*nc = val->nc;
-    
-	debug(DEBUG_ID, "get (%d, 0, 0)", client_nc_id);
-	
-	return CFIO_ERROR_NONE;
     }
+    *nc = &file->nc;
+
+    debug(DEBUG_ID, "get (%d, 0, 0)", client_nc_id);
+
+    return CFIO_ERROR_NONE;
 }
 
 int cfio_id_get_dim(
-	int client_nc_id, int client_dim_id, 
+	int client_nc_id, int client_dim_id,
 	cfio_id_dim_t **dim)
 {
-    cfio_id_key_t key;
-    struct qhash_head *link;
-    cfio_id_val_t *val;
+    cfio_id_file_t *file;
 
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
-    key.client_dim_id = client_dim_id;
-
-    if(NULL == (link = qhash_search(map_table, &key)))
+    if(NULL == (file = _get_file(map_table, client_nc_id)) ||
+	    client_dim_id < 0 || client_dim_id >= file->dim_size ||
+	    NULL == file->dims[client_dim_id])
     {
-	debug(DEBUG_ID, "get dim (%d, %d, 0) null" ,
+	debug(DEBUG_ID, "get dim (%d, %d, 0) null",
 		client_nc_id, client_dim_id);
 	return CFIO_ID_HASH_GET_NULL;
-    }else
-    {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	*dim = val->dim;
-	assert(val->dim != NULL);
-	debug(DEBUG_ID, "get (%d, %d, 0)", client_nc_id, client_dim_id);
-	return CFIO_ERROR_NONE;
     }
+    *dim = file->dims[client_dim_id];
+    debug(DEBUG_ID, "get (%d, %d, 0)", client_nc_id, client_dim_id);
+
+    return CFIO_ERROR_NONE;
 }
 
 int cfio_id_get_var(
-	int client_nc_id, int client_var_id, 
+	int client_nc_id, int client_var_id,
 	cfio_id_var_t **var)
 {
-    cfio_id_key_t key;
-    struct qhash_head *link;
-    cfio_id_val_t *val;
-
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
-    key.client_var_id = client_var_id;
+    cfio_id_file_t *file;
 
-    if(NULL == (link = qhash_search(map_table, &key)))
+    if(NULL == (file = _get_file(map_table, client_nc_id)) ||
+	    client_var_id < 0 || client_var_id >= file->var_size ||
+	    NULL == file->vars[client_var_id])
     {
 	debug(DEBUG_ID, "get var (%d, 0, %d) null",
 		client_nc_id, client_var_id);
 	return CFIO_ID_HASH_GET_NULL;
-    }else
-    {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	assert(val->var != NULL);
-	*var = val->var;
-	debug(DEBUG_ID, "get (%d, 0, %d)", client_nc_id, client_var_id);
-	return CFIO_ERROR_NONE;
     }
+    *var = file->vars[client_var_id];
+    debug(DEBUG_ID, "get (%d, 0, %d)", client_nc_id, client_var_id);
+
+    return CFIO_ERROR_NONE;
 }
 /**
  * start, count , data : addr_copy
  **/
-
 int cfio_id_put_var(
 	int client_nc_id, int client_var_id,
 	int client_index,
-	size_t *start, size_t *count, 
-	char *data)
+	size_t *start, size_t *count,
+	cfio_type type, char *data, const cfio_latency_stamp_t *stamp)
 {
     assert(NULL != start);
     assert(NULL != count);
     assert(NULL != data);
 
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
-    struct qhash_head *link;
     cfio_id_var_t *var;
-    int src_indx, dst_index;
-    int i;
-
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
-    key.client_var_id = client_var_id;
+    cfio_id_data_t *recv_data;
+    cfio_id_rec_t *rec;
 
-    if(NULL == (link = qhash_search(map_table, &key)))
+    if(CFIO_ID_HASH_GET_NULL ==
+	    cfio_id_get_var(client_nc_id, client_var_id, &var))
     {
-	debug(DEBUG_ID, "Can't find var (%d, 0, %d)", 
+	debug(DEBUG_ID, "Can't find var (%d, 0, %d)",
 		client_nc_id, client_var_id);
 	return CFIO_ID_HASH_GET_NULL;
-    }else
+    }
+
+    recv_data = var->recv_data;
+    if(var->is_record)
     {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	var = val->var;
-
-	//for(i = 0; i < var->ndims; i ++)
-	//{
-	//    if(start[i] + count[i] > var->start[i] + var->count[i] ||
-	//	    start[i] < var->start[i])
-	//    {
-	//	debug(DEBUG_ID, "Index exceeds : (start[%d] = %lu), "
-	//		"(count[%d] = %lu) ; (var(%d, 0, %d) : (start[%d] "
-	//		"= %lu), (count[%d] = %lu", i, start[i], i, count[i],
-	//		client_nc_id, client_var_id, 
-	//		i, var->start[i], i, var->count[i]);
-	//	return CFIO_ERROR_EXCEED_BOUND;
-	//    }
-	//}
-
-	//float *_data = data;
-	//for(i = 0; i < 4; i ++)
-	//{
-	//    printf("%f, ", _data[i]);
-	//}
-	//printf("\n");
-
-	if(NULL != var->recv_data[client_index].buf)
-	{
-	    free(var->recv_data[client_index].buf);
-	}
-	if(NULL != var->recv_data[client_index].start)
-	{
-	    free(var->recv_data[client_index].start);
-	}
-	if(NULL != var->recv_data[client_index].count)
+	if(NULL == (rec = _get_rec(var, start[0], 1)))
 	{
-	    free(var->recv_data[client_index].count);
+	    return CFIO_ERROR_MALLOC;
 	}
-	var->recv_data[client_index].buf = data;
-	var->recv_data[client_index].start = start;
-	var->recv_data[client_index].count = count;
-	debug(DEBUG_ID, "client_index = %d", client_index);
+	recv_data = rec->recv_data;
+    }
 
-	debug(DEBUG_ID, "put var ((%d, 0, %d)", client_nc_id, client_var_id);
-	return CFIO_ERROR_NONE;
+    if(NULL != recv_data[client_index].buf)
+    {
+	free(recv_data[client_index].buf);
+    }
+    if(NULL != recv_data[client_index].start)
+    {
+	free(recv_data[client_index].start);
     }
+    if(NULL != recv_data[client_index].count)
+    {
+	free(recv_data[client_index].count);
+    }
+    recv_data[client_index].buf = data;
+    recv_data[client_index].start = start;
+    recv_data[client_index].count = count;
+    recv_data[client_index].type = type;
+    recv_data[client_index].stamp = *stamp;
+    debug(DEBUG_ID, "client_index = %d", client_index);
+
+    debug(DEBUG_ID, "put var ((%d, 0, %d)", client_nc_id, client_var_id);
+    return CFIO_ERROR_NONE;
 }
 
 int cfio_id_put_att(
 	int client_nc_id, int client_var_id,
 	char *name, cfio_type xtype, int len, char *data)
 {
-    cfio_id_key_t key;
-    cfio_id_val_t *val;
-    struct qhash_head *link;
+    cfio_id_file_t *file;
     cfio_id_var_t *var;
-    cfio_id_att_t *att;
-    int i;
+    cfio_id_att_t *att, *iter;
+    qlist_head_t *att_head;
+    size_t ele_size = 0;
 
-    memset(&key, 0, sizeof(cfio_id_key_t));
-    key.client_nc_id = client_nc_id;
-    key.client_var_id = client_var_id;
-
-    if(NULL == (link = qhash_search(map_table, &key)))
+    if(-1 == client_var_id) /* NC_GLOBAL */
     {
-	debug(DEBUG_ID, "Can't find var (%d, 0, %d)", 
-		client_nc_id, client_var_id);
-	return CFIO_ID_HASH_GET_NULL;
+	if(NULL == (file = _get_file(map_table, client_nc_id)))
+	{
+	    debug(DEBUG_ID, "get nc (%d, 0, 0) null", client_nc_id);
+	    return CFIO_ID_HASH_GET_NULL;
+	}
+	att_head = &file->att_head;
     }else
     {
-	val = qlist_entry(link, cfio_id_val_t, hash_link);
-	var = val->var;
-	
-	att = malloc(sizeof(cfio_id_att_t));
-	att->name = name;
-	att->xtype = xtype;
-	att->len = len;
-	att->data = data;
-	qlist_add_tail(&(att->link), var->att_head);
-
-	debug(DEBUG_ID, "put att(%s)", att->name);
-	
-	return CFIO_ERROR_NONE;
+	if(CFIO_ID_HASH_GET_NULL ==
+		cfio_id_get_var(client_nc_id, client_var_id, &var))
+	{
+	    debug(DEBUG_ID, "Can't find var (%d, 0, %d)",
+		    client_nc_id, client_var_id);
+	    return CFIO_ID_HASH_GET_NULL;
+	}
+	cfio_id_get_file(client_nc_id, &file);
+	att_head = var->att_head;
     }
-} 
-
-void cfio_id_val_free(cfio_id_val_t *val)
-{
-    int i;
-    cfio_id_data_t *recv_data;
-    cfio_id_att_t *att, *next;
-    cfio_id_client_name_t *name, *name_next;
 
-    debug(DEBUG_ID, "start free.");
-
-    if(NULL != val)
+    att = NULL;
+    qlist_for_each_entry(iter, att_head, link)
     {
-	if(NULL != val->nc)
-	{
-	    free(val->nc);
-	    val->nc = NULL;
-	}
-	if(NULL != val->dim)
-	{
-	    if(NULL != val->dim->name)
-	    {
-		free(val->dim->name);
-		val->dim->name = NULL;
-	    }
-	    free(val->dim);
-	    val->dim = NULL;
-	}
-	if(NULL != val->var)
-	{
-	    if(NULL != val->var->name)
-	    {
-		free(val->var->name);
-		val->var->name = NULL;
-	    }
-	    if(NULL != val->var->dim_ids)
-	    {
-		free(val->var->dim_ids);
-		val->var->dim_ids = NULL;
-	    }
-	    if(NULL != val->var->start)
-	    {
-		free(val->var->start);
-		val->var->start = NULL;
-	    }
-	    if(NULL != val->var->count)
-	    {
-		free(val->var->count);
-		val->var->count = NULL;
-	    }
-	    recv_data = val->var->recv_data;
-	    if(NULL != recv_data)
-	    {
-		for(i = 0; i < val->var->client_num; i ++)
-		{
-		    if(NULL != recv_data[i].buf)
-		    {
-			free(recv_data[i].buf);
-			recv_data[i].buf = NULL;
-		    }
-		    if(NULL != recv_data[i].start)
-		    {
-			free(recv_data[i].start);
-			recv_data[i].start = NULL;
-		    }
-		    if(NULL != recv_data[i].count)
-		    {
-			free(recv_data[i].count);
-			recv_data[i].count = NULL;
-		    }
-		}
-		free(recv_data);
-		recv_data = NULL;
-	    }
-	    if(NULL != val->var->att_head)
-	    {
-		qlist_for_each_entry_safe(att, next, val->var->att_head, link)
-		{
-		    assert(att != NULL);
-		   if(att->name != NULL)
-		   {
-		       free(att->name);
-		       att->name = NULL;
-		   }
-		   if(att->data != NULL)
-		   {
-		       free(att->data);
-		       att->data = NULL;
-		   }
-		   free(att);
-		}
-		free(val->var->att_head);
-		val->var->att_head = NULL;
-	    }
-	    free(val->var);
-	    val->var = NULL;
-	} /* end var */
-	/* free var name list and dim name list */
-	if(val->var_head != NULL)
+	if(0 == strcmp(iter->name, name))
 	{
-	    qlist_for_each_entry_safe(name, name_next, val->var_head, link)
-	    {
-		if(name->name != NULL)
-		{
-		    free(name->name);
-		    name->name = NULL;
-		}
-		free(name);
-	    }
-	    free(val->var_head);
-	    val->var_head = NULL;
+	    att = iter;
+	    break;
 	}
-	if(val->dim_head != NULL)
+    }
+
+    cfio_types_size(ele_size, xtype);
+    if(NULL == att)
+    {
+	att = cfio_arena_alloc(file->arena, sizeof(cfio_id_att_t));
+	if(NULL == att ||
+		NULL == (att->name = cfio_arena_strdup(file->arena, name)))
 	{
-	    qlist_for_each_entry_safe(name, name_next, val->dim_head, link)
-	    {
-		if(name->name != NULL)
-		{
-		    free(name->name);
-		    name->name = NULL;
-		}
-		free(name);
-	    }
-	    free(val->dim_head);
-	    val->dim_head = NULL;
+	    return CFIO_ERROR_MALLOC;
 	}
-	
-	free(val);
-	val = NULL;
+	qlist_add_tail(&(att->link), att_head);
+    }
+    /* the old data of a replaced att stays in arena until the file is closed */
+    if(NULL == (att->data = cfio_arena_memdup(file->arena, data,
+		    ele_size * len)))
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    att->xtype = xtype;
+    att->len = len;
+
+    debug(DEBUG_ID, "put att(%s)", att->name);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_id_get_var_data(cfio_id_var_t *var, size_t rec,
+	cfio_id_data_t **recv_data)
+{
+    cfio_id_rec_t *entry;
+
+    assert(NULL != var);
+    assert(NULL != recv_data);
+
+    if(!var->is_record)
+    {
+	*recv_data = var->recv_data;
+	return CFIO_ERROR_NONE;
+    }
+
+    if(NULL == (entry = _get_rec(var, rec, 0)))
+    {
+	debug(DEBUG_ID, "var(%s) has no record(%lu)", var->name, rec);
+	return CFIO_ID_HASH_GET_NULL;
+    }
+    *recv_data = entry->recv_data;
+
+    return CFIO_ERROR_NONE;
+}
+
+void cfio_id_del_var_rec(cfio_id_var_t *var, size_t rec)
+{
+    cfio_id_rec_t *entry;
+
+    assert(NULL != var);
+
+    if(NULL != (entry = _get_rec(var, rec, 0)))
+    {
+	_free_rec(var, entry);
     }
-    debug(DEBUG_ID, "success return.");
 }
-	
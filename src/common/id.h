@@ -15,11 +15,17 @@
 #ifndef _ID_H
 #define _ID_H
 
+#include <stdint.h>
+
 #include "quicklist.h"
+#include "arena.h"
 #include "cfio_types.h"
+#include "latency.h"
 
-#define MAP_HASH_TABLE_SIZE 1024
-#define ASSIGN_HASH_TABLE_SIZE 1024
+/* init size of the open addressing tables and the id arrays, power of 2 */
+#define CFIO_ID_NC_TABLE_INIT_SIZE	16
+#define CFIO_ID_NAME_TABLE_INIT_SIZE	64
+#define CFIO_ID_ARRAY_INIT_SIZE		64
 
 #define CFIO_ID_INIT_CLIENT	    0
 #define CFIO_ID_INIT_SERVER	    1
@@ -29,6 +35,7 @@
 					   Table*/
 #define DEFINE_MODE 0
 #define DATA_MODE   1
+#define SCHEMA_MODE 2	/* the nc is a schema, which has no real file */
 
 /**
  *  * special id assigned to nc, dim and var when the real server nc ,dim or var id 
@@ -41,24 +48,26 @@
 				     dim_len will to set to this value, mean that
 				     we don't need to call nc_def_dim */
 
-
-#define cfio_id_val_entry(ptr, member) \
-    (cfio_id_val_t *)((char *)ptr - (size_t)&(((cfio_id_val_t *)0)->member)) 
 /** @brief: store recv data in var */
 typedef struct
 {
     char *buf;		    /* pointer to the data */
     size_t *start;	    /* vector of ndims start index of the variable */
     size_t *count;	    /* vector of ndims count index of the variable */
+    cfio_type type;	    /* type of buf, converted into the type of the
+			       variable when merged */
+    cfio_latency_stamp_t 
+	stamp;		    /* stamps of the put_vara, for the latency */
 }cfio_id_data_t;
 
-/* quicklist entry for var and dim's name */
+/** @brief: store the recv data of one record of a record variable */
 typedef struct
 {
-    char *name;		    /* name of dim or var */
-    int id;		    /* id of dim or var */
+    size_t rec;		    /* index in the record dimension */
+    cfio_id_data_t 
+	*recv_data;	    /* pointer to data vector recieved from client */
     qlist_head_t link;
-}cfio_id_client_name_t;
+}cfio_id_rec_t;
 
 /** @brief: store a nc file information in server */
 typedef struct 
@@ -75,8 +84,11 @@ typedef struct
     int dim_id;		    /* id of the dimension */
     
     int dim_len;	    /* length of the dim */
-    int global_dim_len;
+    int global_dim_len;	    /* CFIO_UNLIMITED for the record dim */
 }cfio_id_dim_t;
+
+#define cfio_id_dim_is_record(dim) (CFIO_UNLIMITED == (dim)->global_dim_len)
+
 /** @brief: store a variable information in server */
 typedef struct
 {
@@ -86,14 +98,20 @@ typedef struct
     
     int ndims;		    /* number of dimensions for the variable */
     int client_num;	    /* number of clients */
-    //size_t *dims_len;	    /* vector of ndims dimension length for the variable */
     int *dim_ids;	    /* vector of ndims dimension ids for the variable */
     size_t *start;	    /* vector of ndims start index of the variable */
     size_t *count;	    /* vector of ndims count index of the variable */
+    size_t *client_start;   /* client_num vectors of ndims start declared by
+			       each client in def_var, used to decode put_vara */
+    size_t *client_count;   /* client_num vectors of ndims count declared by
+			       each client in def_var */
     cfio_id_data_t 
 	*recv_data;	    /* pointer to data vector recieved from client */
+    int is_record;	    /* 1 if the first dim is the record dim, the data of 
+			       each record is stored in rec_head */
+    qlist_head_t
+	*rec_head;	    /* cfio_id_rec_t list of the records being recieved */
     cfio_type data_type;          /* type of data, define in cfio_types.h */
-    //size_t ele_size;	    /* size of each element in the variable array */
     qlist_head_t 
 	*att_head;	    /* variable attribute list */
 
@@ -108,33 +126,60 @@ typedef struct
     qlist_head_t link;
 }cfio_id_att_t;
 
-/** @brief: id hash entry key */
+/** @brief: start and count of a variable declared in def_var by the client */
 typedef struct
 {
-    int client_nc_id;	/* id of nc file in client */
-    int client_dim_id;	/* id of nc dim in client */
-    int client_var_id;	/* id of nc var in client */
-}cfio_id_key_t;
+    int ndims;
+    size_t *start;
+    size_t *count;
+    cfio_type xtype;	    /* type of the var in file */
+}cfio_id_decomp_t;
 
-/** @brief: id hash entry key */
+/** @brief: slot of the open addressing name table */
+typedef struct
+{
+    uint32_t hash;	    /* hash of the name */
+    int id;		    /* id of dim or var */
+    char *name;		    /* name of dim or var, NULL if the slot is empty */
+}cfio_id_name_t;
+
+/** @brief: open addressing table, map name to dim or var id in client */
+typedef struct
+{
+    int size;		    /* amount of slots, power of 2 */
+    int num;		    /* amount of used slots */
+    cfio_id_name_t *slots;
+}cfio_id_name_table_t;
+
+/**
+ * @brief: all id information of a nc file, all the memory except the recv data
+ *	is allocated from the arena of the file, and freed together when the
+ *	file is closed
+ **/
 typedef struct
 {
     int client_nc_id;	/* id of nc file in client */
-    int client_dim_id;	/* id of nc dim in client */
-    int client_var_id;	/* id of nc var in client */
-    
+    cfio_arena_t *arena;
+
     /* only in client */
     int client_var_a;	/* amount of defined var in client*/
     int client_dim_a;	/* amount of defined dim in client*/
-    qlist_head_t *var_head, *dim_head;
-		  /* quicklist to store var and dim name that defined before*/
-   
-    cfio_id_nc_t *nc;   /* nc file infomation in server */
-    cfio_id_dim_t *dim; /* dim infomation in server */
-    cfio_id_var_t *var; /* nc var infomation in server */
-    qlist_head_t hash_link;	
-    qlist_head_t link; /* link for interator */
-}cfio_id_val_t;
+    cfio_id_name_table_t 
+	dim_names, var_names;	/* name of the dims and vars defined before */
+    int client_rec_dim;	/* id of the record dim, 0 if not defined */
+    int is_schema;	/* 1 if the file is a schema */
+    int decomp_size;	/* size of decomps */
+    cfio_id_decomp_t 
+	**decomps;	/* indexed by client var id, NULL if not defined */
+
+    /* only in server */
+    cfio_id_nc_t nc;	/* nc file infomation */
+    int dim_size;	/* size of dims */
+    int var_size;	/* size of vars */
+    cfio_id_dim_t **dims;   /* indexed by client dim id, NULL if not defined */
+    cfio_id_var_t **vars;   /* indexed by client var id, NULL if not defined */
+    qlist_head_t att_head;  /* global att list, only used by schema */
+}cfio_id_file_t;
 
 /**
  * @brief: init 
@@ -158,6 +203,34 @@ int cfio_id_final();
  * @return: error code
  */
 int cfio_id_assign_nc(int *nc_id);
+/**
+ * @brief: assign a nc id for a schema in client
+ *
+ * @param schema_id: the assigned schema id
+ *
+ * @return: error code
+ */
+int cfio_id_assign_schema(int *schema_id);
+/**
+ * @brief: inquire information of a nc file in client
+ *
+ * @param nc_id: the nc file id
+ * @param is_schema: return 1 if the nc is a schema
+ * @param rec_dim_id: return id of the record dim, 0 if not defined
+ *
+ * @return: error code
+ */
+int cfio_id_inq_nc(int nc_id, int *is_schema, int *rec_dim_id);
+/**
+ * @brief: assign a nc id in client for a file created from a schema, the dim
+ *	and var ids of the schema are inherited by the file
+ *
+ * @param schema_id: the nc id of the schema
+ * @param nc_id: the assigned nc id
+ *
+ * @return: error code
+ */
+int cfio_id_assign_nc_from(int schema_id, int *nc_id);
 /**
  * @brief: remove a nc_id from the assign_table, it will be called in cfio_close
  *
@@ -170,11 +243,13 @@ int cfio_id_remove_nc(int nc_id);
  * @brief: assign a nc dim id in client
  *
  * @param nc_id: the nc file id
+ * @param dim_name: name of the dim
+ * @param len: length of the dim, CFIO_UNLIMITED for the record dim
  * @param dim_id: the assigned dim id
  *
  * @return: error code
  */
-int cfio_id_assign_dim(int nc_id, char *dim_name, int *dim_id);
+int cfio_id_assign_dim(int nc_id, char *dim_name, size_t len, int *dim_id);
 /**
  * @brief: assign a nc var id in client
  *
@@ -184,6 +259,31 @@ int cfio_id_assign_dim(int nc_id, char *dim_name, int *dim_id);
  * @return: error code
  */
 int cfio_id_assign_var(int nc_id, char *var_name, int *var_id);
+/**
+ * @brief: set the start and count declared by the client in def_var, which
+ *	put_vara is encoded against
+ *
+ * @param nc_id: the nc file id
+ * @param var_id: the var id
+ * @param ndims: number of dimensions for the variable
+ * @param start: start of the client's part, copied into the file's arena
+ * @param count: count of the client's part, copied into the file's arena
+ * @param xtype: type of the var in file
+ *
+ * @return: error code
+ */
+int cfio_id_set_decomp(int nc_id, int var_id, 
+	int ndims, size_t *start, size_t *count, cfio_type xtype);
+/**
+ * @brief: get the start and count declared by the client in def_var
+ *
+ * @param nc_id: the nc file id
+ * @param var_id: the var id
+ * @param decomp: return the decomposition, NULL if the var is not defined
+ *
+ * @return: error code
+ */
+int cfio_id_get_decomp(int nc_id, int var_id, cfio_id_decomp_t **decomp);
 /**
  * @brief: get a var id in client
  *
@@ -203,6 +303,42 @@ int cfio_id_inq_var(int nc_id, char *var_name, int *var_id);
  * @return: error code
  */
 int cfio_id_map_nc(int client_nc_id, int server_nc_id);
+/**
+ * @brief: add a new map(client_nc_id->server_nc_id) in server for a file 
+ *	created from a schema, all dims, vars and atts of the schema are copied
+ *	into the file
+ *
+ * @param client_nc_id: the nc file id in client
+ * @param server_nc_id: the nc file id in server
+ * @param schema_nc_id: the nc id of the schema in client
+ *
+ * @return: error code
+ */
+int cfio_id_map_nc_from(int client_nc_id, int server_nc_id, int schema_nc_id);
+/**
+ * @brief: copy the start and count a client declared in the schema into the 
+ *	vars of a file created from it. the file is copied from the schema when
+ *	the create msg of the first client is handled, when the defs of the 
+ *	other clients may not be, so it's called for the create msg of each
+ *	client, which follows all the defs of the client
+ *
+ * @param client_nc_id: the nc file id in client
+ * @param schema_nc_id: the nc id of the schema in client
+ * @param client_index: index of the client in its server
+ *
+ * @return: error code
+ */
+int cfio_id_copy_var_decomp(int client_nc_id, int schema_nc_id, 
+	int client_index);
+/**
+ * @brief: remove the map of a nc file and free all its dims, vars and atts in
+ *	server, it will be called when the file is closed
+ *
+ * @param client_nc_id: the nc file id in client
+ *
+ * @return: error code
+ */
+int cfio_id_unmap_nc(int client_nc_id);
 /**
  * @brief: add a new map((client_nc_id, client_dim_id)->(server_nc_id, 
  *	server_dim_id)) in server
@@ -211,7 +347,7 @@ int cfio_id_map_nc(int client_nc_id, int server_nc_id);
  * @param client_dim_id: the dim id in client
  * @param server_nc_id: the nc file id in server
  * @param server_dim_id: the dim id in server
- * @param name: name of dim
+ * @param name: name of dim, copied into the file's arena
  * @param dim_len: length of dim
  *
  * @return: error code
@@ -235,6 +371,10 @@ int cfio_id_map_dim(
  * @param data_type: type of data 
  * @param client_num: number of the server's client num
  *
+ * name, dim_ids, start and count are copied into the file's arena. name and
+ * dim_ids can be NULL when only the start and count of a client is known, 
+ * they are set by cfio_id_set_var later
+ *
  * @return: error code
  */
 int cfio_id_map_var(
@@ -244,9 +384,47 @@ int cfio_id_map_var(
 	int ndims, int *dim_ids,
 	size_t *start, size_t *count,
 	cfio_type data_type, int client_num);
-int cfio_id_get_val(
-	int client_nc_id, int client_var_id, int client_dim_id,
-	cfio_id_val_t **val);
+/**
+ * @brief: set the name, dim ids and data type of a var which is mapped with 
+ *	NULL name
+ *
+ * @param client_nc_id: the nc file id in client
+ * @param client_var_id: the var id in client
+ * @param name: name of var, copied into the file's arena
+ * @param dim_ids: id of dimensions for the variable, ndims of the var is used
+ * @param data_type: type of data
+ *
+ * @return: error code
+ */
+int cfio_id_set_var(
+	int client_nc_id, int client_var_id,
+	char *name, int *dim_ids, cfio_type data_type);
+/**
+ * @brief: set the start and count declared by a client in def_var in server,
+ *	used to decode the put_vara of the client
+ *
+ * @param client_nc_id: the nc file id in client
+ * @param client_var_id: the var id in client
+ * @param client_index: index of the client in the server
+ * @param start: start of the client's part
+ * @param count: count of the client's part
+ *
+ * @return: error code
+ */
+int cfio_id_put_var_decomp(
+	int client_nc_id, int client_var_id, int client_index,
+	size_t *start, size_t *count);
+/**
+ * @brief: get all id information of a nc file in server, used to iterate over
+ *	the dims and vars of the file
+ *
+ * @param client_nc_id: the nc file id in client
+ * @param file: pointer to the file information in server
+ *
+ * @return: error code
+ */
+int cfio_id_get_file(
+	int client_nc_id, cfio_id_file_t **file);
 /**
  * @brief: get server_nc_id by client_nc_id in server
  *
@@ -286,14 +464,17 @@ int cfio_id_get_var(
 
 /**
  * @brief: put part of variable data in the recv data vector which is stored in the 
- *	hash table
+ *	hash table, for record variable, the data is put in the vector of the 
+ *	record start[0]
  *
  * @param client_nc_id: the nc file id in client
  * @param client_var_id: the variable id in client
  * @param client_index: client data index in the recv data vector
  * @param start: start index of the variable in the whole variable array
  * @param count: count of the variable
+ * @param type: type of the data
  * @param data: pointer to the date
+ * @param stamp: stamps of the put_vara
  *
  * @return: error code
  */
@@ -301,7 +482,7 @@ int cfio_id_put_var(
 	int client_nc_id, int client_var_id,
 	int client_index,
 	size_t *start, size_t *count, 
-	char *data);
+	cfio_type type, char *data, const cfio_latency_stamp_t *stamp);
 /**
  * @brief: merge a variable's recv data into its data
  *
@@ -310,7 +491,41 @@ int cfio_id_put_var(
  * @return: error code
  */
 int cfio_id_merge_var_data(cfio_id_var_t *var);
-
-void cfio_id_val_free(cfio_id_val_t *val);
+/**
+ * @brief: add an att to a variable in server, the att is put into file 
+ *	when the variable is defined, an att with the same name is replaced
+ *
+ * @param client_nc_id: the nc file id in client
+ * @param client_var_id: the variable id in client, NC_GLOBAL for the global
+ *	att of a schema
+ * @param name: name of the att, copied into the file's arena
+ * @param xtype: type of the att
+ * @param len: len of the att data
+ * @param data: the att data, copied into the file's arena
+ *
+ * @return: error code
+ */
+int cfio_id_put_att(
+	int client_nc_id, int client_var_id,
+	char *name, cfio_type xtype, int len, char *data);
+/**
+ * @brief: get the recv data vector of a variable
+ *
+ * @param var: the variable
+ * @param rec: index of the record, only used by record variable
+ * @param recv_data: return the recv data vector
+ *
+ * @return: error code
+ */
+int cfio_id_get_var_data(cfio_id_var_t *var, size_t rec, 
+	cfio_id_data_t **recv_data);
+/**
+ * @brief: free the recv data vector of a record of record variable, called 
+ *	after the record is merged and written
+ *
+ * @param var: the record variable
+ * @param rec: index of the record
+ */
+void cfio_id_del_var_rec(cfio_id_var_t *var, size_t rec);
 
 #endif
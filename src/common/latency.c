@@ -0,0 +1,407 @@
+/****************************************************************************
+ *       Filename:  latency.c
+ *
+ *    Description:  end to end latency of the put_vara requests
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "latency.h"
+#include "stats.h"
+#include "map.h"
+#include "quicklist.h"
+#include "transport.h"
+#include "debug.h"
+#include "cfio_error.h"
+
+/* a cfio_latency_hist_t is handled as an array of uint64_t */
+#define _HIST_SIZE (sizeof(cfio_latency_hist_t) / sizeof(uint64_t))
+
+/** @brief: histograms of a var, the vars of the same name in different files
+ * are added together */
+typedef struct
+{
+    char *name;
+    cfio_latency_hist_t hist[CFIO_LATENCY_STAGE_NUM];
+    qlist_head_t link;
+}_var_latency_t;
+
+cfio_proc_local int cfio_latency_on = 0;
+
+static cfio_proc_local int latency_rank;
+/* clients of the server, and the stamps of them kept while merging a var */
+static cfio_proc_local int client_num;
+static cfio_proc_local int *client_ids;
+static cfio_proc_local cfio_latency_stamp_t *pending;
+static cfio_proc_local uint64_t merge_start, merge_end;
+/* histograms of each client of the server */
+static cfio_proc_local cfio_latency_hist_t (*client_hist)[CFIO_LATENCY_STAGE_NUM];
+static cfio_proc_local qlist_head_t var_head;
+
+static const char *stage_names[CFIO_LATENCY_STAGE_NUM] =
+{
+    "client", "wire", "queue", "wait", "merge", "backend", "total"
+};
+
+uint64_t cfio_latency_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int cfio_latency_init(int rank)
+{
+    char *on;
+
+    latency_rank = rank;
+    cfio_latency_on = 0;
+    client_num = 0;
+    client_ids = NULL;
+    pending = NULL;
+    client_hist = NULL;
+    INIT_QLIST_HEAD(&var_head);
+
+    if(NULL == (on = getenv(CFIO_LATENCY_ENV)) || 0 == strcmp(on, "0"))
+    {
+	return CFIO_ERROR_NONE;
+    }
+    cfio_latency_on = 1;
+
+    if(CFIO_MAP_TYPE_SERVER != cfio_map_proc_type(rank))
+    {
+	return CFIO_ERROR_NONE;
+    }
+    client_num = cfio_map_get_client_num_of_server(rank);
+    client_ids = malloc(client_num * sizeof(int));
+    pending = malloc(client_num * sizeof(cfio_latency_stamp_t));
+    client_hist = calloc(client_num, sizeof(*client_hist));
+    if(NULL == client_ids || NULL == pending || NULL == client_hist)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    cfio_map_get_clients(rank, client_ids);
+
+    return CFIO_ERROR_NONE;
+}
+
+void cfio_latency_begin(const cfio_latency_stamp_t *stamps, size_t stride)
+{
+    int i;
+
+    if(NULL == pending)
+    {
+	return;
+    }
+    for(i = 0; i < client_num; i ++)
+    {
+	pending[i] = *(const cfio_latency_stamp_t *)
+	    ((const char *)stamps + i * stride);
+    }
+    merge_start = cfio_latency_now();
+}
+
+void cfio_latency_merged()
+{
+    if(NULL != pending)
+    {
+	merge_end = cfio_latency_now();
+    }
+}
+
+/**
+ * @brief: add the time from begin to end into a histogram, nothing is added if
+ *	either is not stamped
+ */
+static void _hist_add(cfio_latency_hist_t *hist, uint64_t begin, uint64_t end)
+{
+    uint64_t ns, us;
+    int i;
+
+    if(0 == begin || 0 == end)
+    {
+	return;
+    }
+    ns = end > begin ? end - begin : 0;
+
+    for(i = 0, us = ns / 1000; us > 1 && i < CFIO_LATENCY_BUCKET_NUM - 1;
+	    i ++, us >>= 1);
+    hist->bucket[i] ++;
+    hist->count ++;
+    hist->sum += ns;
+    if(ns > hist->max)
+    {
+	hist->max = ns;
+    }
+}
+
+/**
+ * @brief: add the stages of a client's part of a var
+ */
+static void _stages_add(cfio_latency_hist_t *hist,
+	const cfio_latency_stamp_t *stamp, uint64_t written)
+{
+    _hist_add(&hist[CFIO_LATENCY_CLIENT], stamp->call, stamp->send);
+    _hist_add(&hist[CFIO_LATENCY_WIRE], stamp->send, stamp->recv);
+    _hist_add(&hist[CFIO_LATENCY_QUEUE], stamp->recv, stamp->decode);
+    _hist_add(&hist[CFIO_LATENCY_WAIT], stamp->decode, merge_start);
+    _hist_add(&hist[CFIO_LATENCY_MERGE], merge_start, merge_end);
+    _hist_add(&hist[CFIO_LATENCY_BACKEND], merge_end, written);
+    _hist_add(&hist[CFIO_LATENCY_TOTAL], stamp->call, written);
+}
+
+static _var_latency_t *_get_var(const char *name)
+{
+    _var_latency_t *var;
+
+    qlist_for_each_entry(var, &var_head, link)
+    {
+	if(0 == strcmp(var->name, name))
+	{
+	    return var;
+	}
+    }
+
+    if(NULL == (var = calloc(1, sizeof(_var_latency_t))))
+    {
+	return NULL;
+    }
+    if(NULL == (var->name = strdup(name)))
+    {
+	free(var);
+	return NULL;
+    }
+    qlist_add_tail(&var->link, &var_head);
+
+    return var;
+}
+
+void cfio_latency_end(const char *var_name)
+{
+    int i;
+    uint64_t written;
+    _var_latency_t *var;
+
+    if(NULL == pending)
+    {
+	return;
+    }
+    written = cfio_latency_now();
+
+    if(NULL == (var = _get_var(var_name)))
+    {
+	error("malloc fail.");
+	return;
+    }
+    for(i = 0; i < client_num; i ++)
+    {
+	/* the parts not stamped, e.g. replayed, are not counted */
+	if(0 == pending[i].call)
+	{
+	    continue;
+	}
+	_stages_add(var->hist, &pending[i], written);
+	_stages_add(client_hist[i], &pending[i], written);
+    }
+}
+
+/**
+ * @brief: write histograms of all stages as a json object, the trailing empty
+ *	buckets are omitted
+ */
+static void _write_hist(FILE *fp, const cfio_latency_hist_t *hist)
+{
+    int i, j, n;
+
+    fprintf(fp, "{");
+    for(i = 0; i < CFIO_LATENCY_STAGE_NUM; i ++)
+    {
+	for(n = CFIO_LATENCY_BUCKET_NUM; n > 0 && 0 == hist[i].bucket[n - 1];
+		n --);
+	fprintf(fp, "%s\"%s\":{\"count\":%llu,\"sum_ns\":%llu,\"max_ns\":%llu,"
+		"\"buckets\":[", 0 == i ? "" : ",", stage_names[i],
+		(unsigned long long)hist[i].count,
+		(unsigned long long)hist[i].sum,
+		(unsigned long long)hist[i].max);
+	for(j = 0; j < n; j ++)
+	{
+	    fprintf(fp, "%s%llu", 0 == j ? "" : ",",
+		    (unsigned long long)hist[i].bucket[j]);
+	}
+	fprintf(fp, "]}");
+    }
+    fprintf(fp, "}");
+}
+
+/**
+ * @brief: add histograms of all stages into sum
+ */
+static void _hist_sum(cfio_latency_hist_t *sum, const cfio_latency_hist_t *hist)
+{
+    int i, j;
+
+    for(i = 0; i < CFIO_LATENCY_STAGE_NUM; i ++)
+    {
+	sum[i].count += hist[i].count;
+	sum[i].sum += hist[i].sum;
+	if(hist[i].max > sum[i].max)
+	{
+	    sum[i].max = hist[i].max;
+	}
+	for(j = 0; j < CFIO_LATENCY_BUCKET_NUM; j ++)
+	{
+	    sum[i].bucket[j] += hist[i].bucket[j];
+	}
+    }
+}
+
+/**
+ * @brief: write the histograms of the server
+ *
+ * @param total: return the sum of the histograms of all clients
+ */
+static int _write_server(const char *prefix, cfio_latency_hist_t *total)
+{
+    char path[256];
+    FILE *fp;
+    int i;
+    _var_latency_t *var;
+
+    for(i = 0; i < client_num; i ++)
+    {
+	_hist_sum(total, client_hist[i]);
+    }
+
+    snprintf(path, sizeof(path), "%s.%d.latency.json", prefix, latency_rank);
+    if(NULL == (fp = fopen(path, "w")))
+    {
+	error("open latency file %s fail.", path);
+	return CFIO_ERROR_FILE;
+    }
+    fprintf(fp, "{\"total\":");
+    _write_hist(fp, total);
+    fprintf(fp, ",\n\"vars\":{");
+    i = 0;
+    qlist_for_each_entry(var, &var_head, link)
+    {
+	fprintf(fp, "%s\n\"%s\":", 0 == i ++ ? "" : ",", var->name);
+	_write_hist(fp, var->hist);
+    }
+    fprintf(fp, "},\n\"clients\":{");
+    for(i = 0; i < client_num; i ++)
+    {
+	fprintf(fp, "%s\n\"%d\":", 0 == i ? "" : ",", client_ids[i]);
+	_write_hist(fp, client_hist[i]);
+    }
+    fprintf(fp, "}}\n");
+    fclose(fp);
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: write the histograms of all servers gathered, by rank 0
+ */
+static int _write_all(const char *prefix, const uint64_t *all, int size)
+{
+    char path[256];
+    FILE *fp;
+    int i, server_num = 0;
+    cfio_latency_hist_t sum[CFIO_LATENCY_STAGE_NUM];
+    const cfio_latency_hist_t *hist;
+
+    memset(sum, 0, sizeof(sum));
+    for(i = 0; i < size; i ++)
+    {
+	hist = (const cfio_latency_hist_t *)
+	    (all + i * _HIST_SIZE * CFIO_LATENCY_STAGE_NUM);
+	if(0 != hist[CFIO_LATENCY_TOTAL].count)
+	{
+	    server_num ++;
+	    _hist_sum(sum, hist);
+	}
+    }
+
+    snprintf(path, sizeof(path), "%s.latency.json", prefix);
+    if(NULL == (fp = fopen(path, "w")))
+    {
+	error("open latency file %s fail.", path);
+	return CFIO_ERROR_FILE;
+    }
+    fprintf(fp, "{\"servers\":%d,\n\"total\":", server_num);
+    _write_hist(fp, sum);
+    fprintf(fp, "}\n");
+    fclose(fp);
+
+    return CFIO_ERROR_NONE;
+}
+
+static void _free()
+{
+    _var_latency_t *var, *next;
+
+    qlist_for_each_entry_safe(var, next, &var_head, link)
+    {
+	qlist_del(&var->link);
+	free(var->name);
+	free(var);
+    }
+    free(client_ids);
+    free(pending);
+    free(client_hist);
+    client_ids = NULL;
+    pending = NULL;
+    client_hist = NULL;
+    client_num = 0;
+}
+
+int cfio_latency_final()
+{
+    char *prefix;
+    cfio_latency_hist_t total[CFIO_LATENCY_STAGE_NUM];
+    uint64_t *all;
+    int size, ret = CFIO_ERROR_NONE;
+
+    if(!cfio_latency_on || NULL == (prefix = getenv(CFIO_STATS_ENV)))
+    {
+	_free();
+	return CFIO_ERROR_NONE;
+    }
+    cfio_latency_on = 0;
+
+    memset(total, 0, sizeof(total));
+    if(NULL != client_hist)
+    {
+	ret = _write_server(prefix, total);
+    }
+
+    size = cfio_transport_size();
+    all = malloc(sizeof(total) * size);
+    if(NULL == all)
+    {
+	error("malloc fail.");
+	_free();
+	return CFIO_ERROR_MALLOC;
+    }
+    if(MPI_SUCCESS != cfio_transport_allgather((uint64_t *)total,
+		_HIST_SIZE * CFIO_LATENCY_STAGE_NUM, all, MPI_COMM_WORLD))
+    {
+	error("allgather histograms fail.");
+	ret = CFIO_ERROR_TRANSPORT;
+    }else if(0 == latency_rank)
+    {
+	ret = _write_all(prefix, all, size);
+    }
+    free(all);
+    _free();
+
+    return ret;
+}
@@ -0,0 +1,112 @@
+/****************************************************************************
+ *       Filename:  latency.h
+ *
+ *    Description:  end to end latency of the put_vara requests
+ *
+ *		    if CFIO_LATENCY_ENV is set, each put_vara carries a
+ *		    cfio_msg_stamp_t, stamped by the client when it's called
+ *		    and when the MPI message containing it is sent. the server
+ *		    stamps it when it's received and decoded, and when the var
+ *		    it belongs to is merged and written by the backend. the
+ *		    time between the stamps is split into the stages below,
+ *		    and added into log2 histograms of each var and each client
+ *
+ *		    the stamps are of the realtime clock, so the wire stage of
+ *		    procs on different nodes includes the skew of their
+ *		    clocks, it's 0 if the skew makes it negative
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <stdint.h>
+
+#include "define.h"
+
+/* env variable to track the latency, it must be set in all procs or none.
+ * the histograms are written with the stats report, i.e. if CFIO_STATS_ENV is
+ * also set, server i writes <prefix>.i.latency.json, and rank 0 writes the
+ * histograms of all servers into <prefix>.latency.json */
+#define CFIO_LATENCY_ENV	"CFIO_LATENCY"
+
+/* stages of a put_vara */
+#define CFIO_LATENCY_CLIENT	0   /* call to send, packed and merged in
+				       client, or blocked for buffer */
+#define CFIO_LATENCY_WIRE	1   /* send to recv */
+#define CFIO_LATENCY_QUEUE	2   /* recv to decode, queued in server */
+#define CFIO_LATENCY_WAIT	3   /* decode to merge, waiting for the data
+				       of the slowest client of the var */
+#define CFIO_LATENCY_MERGE	4   /* merge of the var */
+#define CFIO_LATENCY_BACKEND	5   /* merge to written by the backend */
+#define CFIO_LATENCY_TOTAL	6   /* call to written */
+#define CFIO_LATENCY_STAGE_NUM	7
+
+/* bucket i counts the latency in [2^i, 2^(i+1)) us, bucket 0 also counts the
+ * ones less than 1 us, and the last one the ones greater */
+#define CFIO_LATENCY_BUCKET_NUM	32
+
+/** @brief: stamps of a put_vara in server, in ns of cfio_latency_now, 0 if
+ * not stamped */
+typedef struct
+{
+    uint64_t call;	/* from cfio_msg_stamp_t */
+    uint64_t send;	/* from cfio_msg_stamp_t */
+    uint64_t recv;
+    uint64_t decode;
+}cfio_latency_stamp_t;
+
+/** @brief: latency histogram of a stage */
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum;	/* in ns */
+    uint64_t max;	/* in ns */
+    uint64_t bucket[CFIO_LATENCY_BUCKET_NUM];
+}cfio_latency_hist_t;
+
+/* whether the put_vara is stamped */
+extern cfio_proc_local int cfio_latency_on;
+
+/**
+ * @brief: get the time of a stamp, the realtime clock in ns
+ */
+uint64_t cfio_latency_now();
+/**
+ * @brief: init the latency by CFIO_LATENCY_ENV, called after the map is inited
+ *
+ * @param rank: rank of the proc
+ *
+ * @return: error code
+ */
+int cfio_latency_init(int rank);
+/**
+ * @brief: begin the merge of a var, the stamps of its clients are kept until
+ *	cfio_latency_end
+ *
+ * @param stamps: the stamp of each client of the server, got by client index
+ * @param stride: bytes between the stamps of two clients
+ */
+void cfio_latency_begin(const cfio_latency_stamp_t *stamps, size_t stride);
+/**
+ * @brief: the merge begun by cfio_latency_begin is done
+ */
+void cfio_latency_merged();
+/**
+ * @brief: the var is written by the backend, add the stages of its clients
+ *	into the histograms
+ *
+ * @param var_name: name of the var
+ */
+void cfio_latency_end(const char *var_name);
+/**
+ * @brief: write the histograms if CFIO_LATENCY_ENV and CFIO_STATS_ENV are
+ *	set, it's collective on all procs in that case, and free the histograms
+ *
+ * @return: error code
+ */
+int cfio_latency_final();
+
+#endif
@@ -0,0 +1,412 @@
+/****************************************************************************
+ *       Filename:  loopback.c
+ *
+ *    Description:  transport between the threads of a process, each thread
+ *		    acts as a proc. a msg is not copied until it's received,
+ *		    ssend waits on the msg till the receiver has copied it,
+ *		    as a rendezvous MPI_Ssend does. if a proc fails, the run
+ *		    fails, the procs blocked in the transport are woken up
+ *		    and its functions return error from then on
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "transport.h"
+#include "debug.h"
+#include "define.h"
+#include "cfio_error.h"
+
+typedef struct cfio_loopback_msg
+{
+    void *buf;
+    int size;
+    int src;
+    int tag;
+    int done;			/* whether it's received */
+    pthread_cond_t done_cond;
+    struct cfio_loopback_msg *next;
+}cfio_loopback_msg_t;
+
+/**
+ * @brief: msgs sent to a proc and not received yet, in the order of sending
+ **/
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;	/* signaled when a msg is added */
+    cfio_loopback_msg_t *head, *tail;
+}cfio_loopback_box_t;
+
+typedef struct
+{
+    int rank;
+    void (*func)(int rank, int size, void *arg);
+    void *arg;
+}cfio_loopback_proc_t;
+
+static int proc_num;
+static cfio_loopback_box_t *boxes;
+static uint64_t **gather_bufs;	/* send_buf of each proc in allgather */
+/* a pthread barrier can't be woken up when the run fails, so the barrier is
+ * a counter of the waiting procs and the generation of the barrier */
+static pthread_mutex_t barrier_mutex;
+static pthread_cond_t barrier_cond;
+static int barrier_count, barrier_gen;
+/* error of the first failed proc, set before the procs are woken up */
+static int fail_error;
+
+static __thread int loopback_rank;
+
+static int _rank()
+{
+    return loopback_rank;
+}
+
+static int _size()
+{
+    return proc_num;
+}
+
+/**
+ * @brief: remove a msg from a box, need the box's mutex
+ *
+ * @param prev: the msg before it, NULL if it's the head
+ */
+static void _unlink(cfio_loopback_box_t *box, cfio_loopback_msg_t *msg,
+	cfio_loopback_msg_t *prev)
+{
+    if(NULL == prev)
+    {
+	box->head = msg->next;
+    }else
+    {
+	prev->next = msg->next;
+    }
+    if(box->tail == msg)
+    {
+	box->tail = prev;
+    }
+}
+
+static int _ssend(void *buf, int size, int dst, int tag, MPI_Comm comm)
+{
+    cfio_loopback_box_t *box = boxes + dst;
+    cfio_loopback_msg_t msg, *prev, *next;
+    int ret = MPI_SUCCESS;
+
+    msg.buf = buf;
+    msg.size = size;
+    msg.src = loopback_rank;
+    msg.tag = tag;
+    msg.done = 0;
+    msg.next = NULL;
+    pthread_cond_init(&msg.done_cond, NULL);
+
+    pthread_mutex_lock(&box->mutex);
+    if(fail_error < 0)
+    {
+	pthread_mutex_unlock(&box->mutex);
+	pthread_cond_destroy(&msg.done_cond);
+	return MPI_ERR_OTHER;
+    }
+    if(NULL == box->tail)
+    {
+	box->head = &msg;
+    }else
+    {
+	box->tail->next = &msg;
+    }
+    box->tail = &msg;
+    pthread_cond_broadcast(&box->cond);
+    while(!msg.done && 0 == fail_error)
+    {
+	pthread_cond_wait(&msg.done_cond, &box->mutex);
+    }
+    if(!msg.done)
+    {
+	/* the msg is on the stack, it can't be left in the box */
+	for(prev = NULL, next = box->head; next != &msg; next = next->next)
+	{
+	    prev = next;
+	}
+	_unlink(box, &msg, prev);
+	ret = MPI_ERR_OTHER;
+    }
+    pthread_mutex_unlock(&box->mutex);
+
+    pthread_cond_destroy(&msg.done_cond);
+
+    return ret;
+}
+
+/**
+ * @brief: find the first msg of src and tag in a box, need the box's mutex
+ *
+ * @param prev: return the msg before the found one, NULL if it's the head
+ *
+ * @return: the msg, NULL if not found
+ */
+static cfio_loopback_msg_t *_find(cfio_loopback_box_t *box, int src, int tag,
+	cfio_loopback_msg_t **prev)
+{
+    cfio_loopback_msg_t *msg;
+
+    *prev = NULL;
+    for(msg = box->head; NULL != msg; msg = msg->next)
+    {
+	if((MPI_ANY_SOURCE == src || msg->src == src) &&
+		(MPI_ANY_TAG == tag || msg->tag == tag))
+	{
+	    return msg;
+	}
+	*prev = msg;
+    }
+
+    return NULL;
+}
+
+static int _recv(void *buf, int max_size, int src, MPI_Comm comm,
+	int *size, int *source, int *tag)
+{
+    cfio_loopback_box_t *box = boxes + loopback_rank;
+    cfio_loopback_msg_t *msg, *prev;
+    int ret = MPI_SUCCESS;
+
+    pthread_mutex_lock(&box->mutex);
+    while(0 == fail_error && 
+	    NULL == (msg = _find(box, src, MPI_ANY_TAG, &prev)))
+    {
+	pthread_cond_wait(&box->cond, &box->mutex);
+    }
+    if(fail_error < 0)
+    {
+	pthread_mutex_unlock(&box->mutex);
+	return MPI_ERR_OTHER;
+    }
+    _unlink(box, msg, prev);
+
+    *size = msg->size;
+    if(msg->size > max_size)
+    {
+	*size = max_size;
+	ret = MPI_ERR_TRUNCATE;
+    }
+    memcpy(buf, msg->buf, *size);
+    *source = msg->src;
+    *tag = msg->tag;
+
+    msg->done = 1;
+    pthread_cond_signal(&msg->done_cond);
+    pthread_mutex_unlock(&box->mutex);
+
+    return ret;
+}
+
+static int _iprobe(int src, int tag, MPI_Comm comm, int *flag)
+{
+    cfio_loopback_box_t *box = boxes + loopback_rank;
+    cfio_loopback_msg_t *prev;
+
+    pthread_mutex_lock(&box->mutex);
+    *flag = (NULL != _find(box, src, tag, &prev));
+    pthread_mutex_unlock(&box->mutex);
+
+    return MPI_SUCCESS;
+}
+
+/**
+ * @brief: wait until all procs reach the barrier
+ *
+ * @return: MPI_SUCCESS, or MPI_ERR_OTHER if the run fails
+ */
+static int _barrier_wait()
+{
+    int gen, ret = MPI_SUCCESS;
+
+    pthread_mutex_lock(&barrier_mutex);
+    gen = barrier_gen;
+    if(++ barrier_count == proc_num)
+    {
+	barrier_count = 0;
+	barrier_gen ++;
+	pthread_cond_broadcast(&barrier_cond);
+    }
+    while(gen == barrier_gen && 0 == fail_error)
+    {
+	pthread_cond_wait(&barrier_cond, &barrier_mutex);
+    }
+    if(gen == barrier_gen)
+    {
+	ret = MPI_ERR_OTHER;
+    }
+    pthread_mutex_unlock(&barrier_mutex);
+
+    return ret;
+}
+
+static int _allgather(uint64_t *send_buf, int count, uint64_t *recv_buf,
+	MPI_Comm comm)
+{
+    int i;
+
+    gather_bufs[loopback_rank] = send_buf;
+    if(MPI_SUCCESS != _barrier_wait())
+    {
+	return MPI_ERR_OTHER;
+    }
+    for(i = 0; i < proc_num; i ++)
+    {
+	memcpy(recv_buf + i * count, gather_bufs[i],
+		sizeof(uint64_t) * count);
+    }
+    /* send_buf of others can't be freed before all have copied */
+    return _barrier_wait();
+}
+
+static int _barrier(MPI_Comm comm)
+{
+    return _barrier_wait();
+}
+
+cfio_transport_t cfio_transport_loopback =
+{
+    .name	= CFIO_TRANSPORT_LOOPBACK,
+    .rank	= _rank,
+    .size	= _size,
+    .ssend	= _ssend,
+    .recv	= _recv,
+    .iprobe	= _iprobe,
+    .allgather	= _allgather,
+    .barrier	= _barrier,
+};
+
+static void *_proc_thread(void *arg)
+{
+    cfio_loopback_proc_t *proc = arg;
+
+    loopback_rank = proc->rank;
+    proc->func(proc->rank, proc_num, proc->arg);
+
+    return (void *)0;
+}
+
+void cfio_transport_loopback_fail(int ret)
+{
+    int i;
+    cfio_loopback_msg_t *msg;
+
+    if(!cfio_transport_is_loopback() || ret >= 0)
+    {
+	return;
+    }
+
+    pthread_mutex_lock(&barrier_mutex);
+    if(0 != fail_error)
+    {
+	pthread_mutex_unlock(&barrier_mutex);
+	return;
+    }
+    fail_error = ret;
+    pthread_cond_broadcast(&barrier_cond);
+    pthread_mutex_unlock(&barrier_mutex);
+
+    error("proc %d fails(%d), the loopback run fails.", loopback_rank, ret);
+    for(i = 0; i < proc_num; i ++)
+    {
+	pthread_mutex_lock(&boxes[i].mutex);
+	pthread_cond_broadcast(&boxes[i].cond);
+	for(msg = boxes[i].head; NULL != msg; msg = msg->next)
+	{
+	    pthread_cond_signal(&msg->done_cond);
+	}
+	pthread_mutex_unlock(&boxes[i].mutex);
+    }
+}
+
+int cfio_transport_loopback_run(int _proc_num,
+	void (*func)(int rank, int size, void *arg), void *arg)
+{
+    int i, ret = CFIO_ERROR_NONE;
+    pthread_t *threads;
+    cfio_loopback_proc_t *procs;
+
+#if (defined async_send) || (defined async_isend)
+    error("the loopback can't be used with async_send or async_isend.");
+    return CFIO_ERROR_INVALID_INIT_ARG;
+#endif
+    if(_proc_num <= 0 || _proc_num > CFIO_LOOPBACK_MAX_PROC)
+    {
+	error("invalid proc num(%d) of loopback.", _proc_num);
+	return CFIO_ERROR_INVALID_INIT_ARG;
+    }
+    if(cfio_transport_is_loopback())
+    {
+	error("the loopback is already running.");
+	return CFIO_ERROR_INVALID_INIT_ARG;
+    }
+
+    proc_num = _proc_num;
+    boxes = calloc(proc_num, sizeof(cfio_loopback_box_t));
+    gather_bufs = calloc(proc_num, sizeof(uint64_t *));
+    threads = calloc(proc_num, sizeof(pthread_t));
+    procs = calloc(proc_num, sizeof(cfio_loopback_proc_t));
+    if(NULL == boxes || NULL == gather_bufs ||
+	    NULL == threads || NULL == procs)
+    {
+	error("malloc fail for loopback.");
+	ret = CFIO_ERROR_MALLOC;
+	goto RETURN;
+    }
+    for(i = 0; i < proc_num; i ++)
+    {
+	pthread_mutex_init(&boxes[i].mutex, NULL);
+	pthread_cond_init(&boxes[i].cond, NULL);
+    }
+    pthread_mutex_init(&barrier_mutex, NULL);
+    pthread_cond_init(&barrier_cond, NULL);
+    barrier_count = 0;
+    barrier_gen = 0;
+    fail_error = 0;
+
+    cfio_transport = &cfio_transport_loopback;
+    for(i = 0; i < proc_num; i ++)
+    {
+	procs[i].rank = i;
+	procs[i].func = func;
+	procs[i].arg = arg;
+	if(0 != pthread_create(&threads[i], NULL, _proc_thread, &procs[i]))
+	{
+	    /* the started procs can't finish without the others */
+	    error("create thread of proc %d fail.", i);
+	    abort();
+	}
+    }
+    for(i = 0; i < proc_num; i ++)
+    {
+	pthread_join(threads[i], NULL);
+    }
+    cfio_transport = &cfio_transport_mpi;
+    ret = fail_error;
+
+    pthread_mutex_destroy(&barrier_mutex);
+    pthread_cond_destroy(&barrier_cond);
+    for(i = 0; i < proc_num; i ++)
+    {
+	pthread_mutex_destroy(&boxes[i].mutex);
+	pthread_cond_destroy(&boxes[i].cond);
+    }
+
+RETURN:
+    free(boxes);
+    boxes = NULL;
+    free(gather_bufs);
+    gather_bufs = NULL;
+    free(threads);
+    free(procs);
+    return ret;
+}
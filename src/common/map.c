@@ -13,20 +13,45 @@
  *        Company:  HPC Tsinghua
  ***************************************************************************/
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "mpi.h"
 #include "map.h"
 #include "debug.h"
+#include "define.h"
+#include "transport.h"
 #include "cfio_error.h"
 
-static int client_amount;
-static int client_x_num;
-static int client_y_num;
-static MPI_Comm comm;
-static int server_amount;
-static int server_x_num;
-static int server_y_num;
-static int server_comm;
+static cfio_proc_local int client_amount;
+static cfio_proc_local int client_x_num;
+static cfio_proc_local int client_y_num;
+static cfio_proc_local MPI_Comm comm;
+static cfio_proc_local int server_amount;
+static cfio_proc_local int server_x_num;
+static cfio_proc_local int server_y_num;
+static cfio_proc_local MPI_Comm server_comm;
+
+/**
+ * the map between clients and servers, built in init, so that any 
+ * decomposition can be looked up in the same way
+ **/
+/* server index of each client */
+static cfio_proc_local int *client_server;
+/* index of each client in its server */
+static cfio_proc_local int *client_index;
+/* clients of server i are server_client[server_offset[i] ~ 
+ * server_offset[i + 1] - 1] */
+static cfio_proc_local int *server_offset;
+/* client ids, in order of client index */
+static cfio_proc_local int *server_client;
+
+/** @brief: key used to sort clients when grouping blocks */
+typedef struct
+{
+    uint64_t center;	/* 2 * start + count of the block in the split dim */
+    int client_id;
+}cfio_map_key_t;
 
 /**
  * @brief: get all factor of a interger n
@@ -161,6 +186,206 @@ static int _gen_server_x_and_y(int best_server_amount)
     }
 }
 
+static void _free_map()
+{
+    free(client_server);
+    client_server = NULL;
+    free(client_index);
+    client_index = NULL;
+    free(server_offset);
+    server_offset = NULL;
+    free(server_client);
+    server_client = NULL;
+}
+
+static int _alloc_map()
+{
+    client_server = malloc(sizeof(int) * client_amount);
+    client_index = malloc(sizeof(int) * client_amount);
+    server_offset = malloc(sizeof(int) * (server_amount + 1));
+    server_client = malloc(sizeof(int) * client_amount);
+    if(NULL == client_server || NULL == client_index || 
+	    NULL == server_offset || NULL == server_client)
+    {
+	error("malloc fail for map.");
+	_free_map();
+	return CFIO_ERROR_MALLOC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: build server_offset and server_client from client_server and 
+ *	client_index
+ */
+static void _build_server_client()
+{
+    int i;
+
+    for(i = 0; i <= server_amount; i ++)
+    {
+	server_offset[i] = 0;
+    }
+    for(i = 0; i < client_amount; i ++)
+    {
+	server_offset[client_server[i] + 1] ++;
+    }
+    for(i = 0; i < server_amount; i ++)
+    {
+	server_offset[i + 1] += server_offset[i];
+    }
+    for(i = 0; i < client_amount; i ++)
+    {
+	server_client[server_offset[client_server[i]] + client_index[i]] = i;
+    }
+}
+
+/**
+ * @brief: map the clients of a x * y grid, each server gets a sub-grid of 
+ *	client_x_num / server_x_num * client_y_num / server_y_num clients
+ */
+static void _map_grid()
+{
+    int client_id;
+    int client_x_index, client_y_index;
+    int client_per_server_x, client_per_server_y;
+
+    client_per_server_x = client_x_num / server_x_num;
+    client_per_server_y = client_y_num / server_y_num;
+
+    for(client_id = 0; client_id < client_amount; client_id ++)
+    {
+	client_x_index = client_id % client_x_num;
+	client_y_index = client_id / client_x_num;
+
+	client_server[client_id] = client_x_index / client_per_server_x + 
+	    client_y_index / client_per_server_y * server_x_num;
+	client_index[client_id] = client_x_index % client_per_server_x +
+	    client_y_index % client_per_server_y * client_per_server_x;
+    }
+
+    _build_server_client();
+}
+
+static int _compare_key(const void *a, const void *b)
+{
+    const cfio_map_key_t *key_a = a, *key_b = b;
+
+    if(key_a->center != key_b->center)
+    {
+	return key_a->center < key_b->center ? -1 : 1;
+    }
+    return key_a->client_id - key_b->client_id;
+}
+
+/**
+ * @brief: group clients onto servers by recursive bisection, the clients are 
+ *	split at the median of their block centers along the dim where the 
+ *	centers spread most, and the two halves get servers in proportion, 
+ *	until one server is left
+ *
+ * @param ndims: number of dims of the blocks
+ * @param blocks: start and count of the block of each client, 2 * ndims each
+ * @param keys: the clients to be grouped
+ * @param n: amount of the clients
+ * @param server_begin: index of the first server for the clients
+ * @param s: amount of servers for the clients, no more than n
+ */
+static void _group_blocks(int ndims, const uint64_t *blocks, 
+	cfio_map_key_t *keys, int n, int server_begin, int s)
+{
+    int i, dim, split_dim, n1, s1;
+    uint64_t center, min, max, max_spread;
+    const uint64_t *block;
+
+    if(1 == s)
+    {
+	for(i = 0; i < n; i ++)
+	{
+	    client_server[keys[i].client_id] = server_begin;
+	}
+	return;
+    }
+
+    split_dim = 0;
+    max_spread = 0;
+    for(dim = 0; dim < ndims; dim ++)
+    {
+	min = UINT64_MAX;
+	max = 0;
+	for(i = 0; i < n; i ++)
+	{
+	    block = blocks + 2 * ndims * keys[i].client_id;
+	    center = 2 * block[dim] + block[ndims + dim];
+	    min = center < min ? center : min;
+	    max = center > max ? center : max;
+	}
+	if(max - min > max_spread)
+	{
+	    max_spread = max - min;
+	    split_dim = dim;
+	}
+    }
+    for(i = 0; i < n; i ++)
+    {
+	block = blocks + 2 * ndims * keys[i].client_id;
+	keys[i].center = 2 * block[split_dim] + block[ndims + split_dim];
+    }
+    qsort(keys, n, sizeof(cfio_map_key_t), _compare_key);
+
+    s1 = s / 2;
+    n1 = (int)((int64_t)n * s1 / s);
+    if(n1 < s1)
+    {
+	n1 = s1;
+    }
+    if(n - n1 < s - s1)
+    {
+	n1 = n - (s - s1);
+    }
+
+    _group_blocks(ndims, blocks, keys, n1, server_begin, s1);
+    _group_blocks(ndims, blocks, keys + n1, n - n1, server_begin + s1, s - s1);
+}
+
+/**
+ * @brief: map the clients by their blocks, clients in a server are ordered by
+ *	their ids
+ */
+static int _map_blocks(int ndims, const uint64_t *blocks)
+{
+    int i;
+    cfio_map_key_t *keys;
+
+    keys = malloc(sizeof(cfio_map_key_t) * client_amount);
+    if(NULL == keys)
+    {
+	error("malloc fail for keys.");
+	return CFIO_ERROR_MALLOC;
+    }
+    for(i = 0; i < client_amount; i ++)
+    {
+	keys[i].client_id = i;
+    }
+    _group_blocks(ndims, blocks, keys, client_amount, 0, server_amount);
+    free(keys);
+
+    /* count clients of each server in server_offset before it's built */
+    for(i = 0; i < server_amount; i ++)
+    {
+	server_offset[i] = 0;
+    }
+    for(i = 0; i < client_amount; i ++)
+    {
+	client_index[i] = server_offset[client_server[i]] ++;
+    }
+
+    _build_server_client();
+
+    return CFIO_ERROR_NONE;
+}
+
 int cfio_map_init(
 	int _client_x_num, int _client_y_num,
 	int _server_amount, int best_server_amount,
@@ -170,7 +395,7 @@ int cfio_map_init(
     assert(_client_y_num > 0);
     assert(best_server_amount > 0);
 
-    int i, ret;
+    int ret;
 
     client_x_num = _client_x_num;
     client_y_num = _client_y_num;
@@ -185,12 +410,128 @@ int cfio_map_init(
 	error("");
 	return ret;
     }
+    if((ret = _alloc_map()) < 0)
+    {
+	return ret;
+    }
+    _map_grid();
     
     debug(DEBUG_MAP, "success return.");
     return CFIO_ERROR_NONE;
 }
+
+int cfio_map_init_nd(
+	int _client_amount, int ndims, size_t *start, size_t *count,
+	int _server_amount, int best_server_amount,
+	MPI_Comm _comm, MPI_Comm _server_comm)
+{
+    assert(_client_amount > 0);
+    assert(ndims > 0);
+    assert(best_server_amount > 0);
+
+    int i, rank, size, ret;
+    uint64_t *local, *blocks;
+
+    client_amount = _client_amount;
+    comm = _comm;
+    server_comm = _server_comm;
+
+    if(best_server_amount > client_amount)
+    {
+	best_server_amount = client_amount;
+    }
+    if(_server_amount < best_server_amount)
+    {
+	error("You should start more proccess, the best value is %d",
+		best_server_amount + client_amount);
+	return CFIO_ERROR_INVALID_INIT_ARG;
+    }
+    /* reassign server amount for some on may start more proc than needed */
+    server_amount = best_server_amount;
+
+    rank = cfio_transport_rank();
+    size = cfio_transport_size();
+
+    local = malloc(sizeof(uint64_t) * 2 * ndims);
+    blocks = malloc(sizeof(uint64_t) * 2 * ndims * size);
+    if(NULL == local || NULL == blocks)
+    {
+	free(local);
+	free(blocks);
+	error("malloc fail for blocks.");
+	return CFIO_ERROR_MALLOC;
+    }
+    for(i = 0; i < ndims; i ++)
+    {
+	local[i] = rank < client_amount ? start[i] : 0;
+	local[ndims + i] = rank < client_amount ? count[i] : 0;
+    }
+    ret = cfio_transport_allgather(local, 2 * ndims, blocks, comm);
+    free(local);
+    if(MPI_SUCCESS != ret)
+    {
+	free(blocks);
+	error("allgather blocks fail.");
+	return CFIO_ERROR_TRANSPORT;
+    }
+
+    if((ret = _alloc_map()) < 0 || (ret = _map_blocks(ndims, blocks)) < 0)
+    {
+	free(blocks);
+	_free_map();
+	return ret;
+    }
+    free(blocks);
+
+    for(i = 0; i < client_amount; i ++)
+    {
+	debug(DEBUG_MAP, "client(%d)->server(%d), index(%d)", 
+		i, client_server[i] + client_amount, client_index[i]);
+    }
+    debug(DEBUG_MAP, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_map_init_table(
+	int _client_amount, int _server_amount, 
+	const int *_client_server, const int *_client_index,
+	MPI_Comm _comm, MPI_Comm _server_comm)
+{
+    assert(_client_amount > 0);
+    assert(_server_amount > 0);
+
+    int i, ret;
+
+    client_amount = _client_amount;
+    server_amount = _server_amount;
+    comm = _comm;
+    server_comm = _server_comm;
+
+    for(i = 0; i < client_amount; i ++)
+    {
+	if(_client_server[i] < 0 || _client_server[i] >= server_amount ||
+		_client_index[i] < 0 || _client_index[i] >= client_amount)
+	{
+	    error("invalid map of client %d.", i);
+	    return CFIO_ERROR_INVALID_INIT_ARG;
+	}
+    }
+    if((ret = _alloc_map()) < 0)
+    {
+	return ret;
+    }
+    memcpy(client_server, _client_server, sizeof(int) * client_amount);
+    memcpy(client_index, _client_index, sizeof(int) * client_amount);
+    _build_server_client();
+
+    debug(DEBUG_MAP, "success return.");
+    return CFIO_ERROR_NONE;
+}
+
 int cfio_map_final()
 {
+    _free_map();
+
     return CFIO_ERROR_NONE;
 }
 int cfio_map_proc_type(int proc_id)
@@ -209,12 +550,12 @@ int cfio_map_proc_type(int proc_id)
 	return CFIO_MAP_TYPE_BLANK;
     }
 }
-int cfio_map_get_comm()
+MPI_Comm cfio_map_get_comm()
 {
     return comm; 
 }
 
-int cfio_map_get_server_comm()
+MPI_Comm cfio_map_get_server_comm()
 {
     return server_comm; 
 }
@@ -231,33 +572,15 @@ int cfio_map_get_client_amount()
 
 int cfio_map_get_clients(int server_id, int *client_id)
 {
-    int client_x_index, client_y_index;
-    int client_x_start_index, client_y_start_index;
-    int client_per_server_x, client_per_server_y;
-    int server_x_index, server_y_index;
-    int client_num;
     int i;
     int server_index;
    
     server_index = cfio_map_get_server_index(server_id);
-    server_x_index = server_index % server_x_num;
-    server_y_index = server_index / server_x_num;
-
-    debug(DEBUG_MAP, "rank(%d) : (%d, %d)", server_id, server_x_index, 
-	    server_y_index);
-
-    client_num = cfio_map_get_client_num_of_server(server_id);
-    client_per_server_x = client_x_num / server_x_num;
-    client_per_server_y = client_y_num / server_y_num;
 
-    client_x_start_index = server_x_index * client_per_server_x;
-    client_y_start_index = server_y_index * client_per_server_y;
-    
-    for(i = 0; i < client_num ; i ++)
+    for(i = server_offset[server_index]; 
+	    i < server_offset[server_index + 1]; i ++)
     {
-	client_x_index = i % client_per_server_x + client_x_start_index;
-	client_y_index = i / client_per_server_x + client_y_start_index;
-	client_id[i] = client_x_index + client_y_index * client_x_num;
+	client_id[i - server_offset[server_index]] = server_client[i];
     }
 
     return CFIO_ERROR_NONE;
@@ -265,29 +588,12 @@ int cfio_map_get_clients(int server_id, int *client_id)
 
 int cfio_map_get_client_num_of_server(int server_id)
 {
+    int server_index, client_num;
 
     assert(cfio_map_proc_type(server_id) == CFIO_MAP_TYPE_SERVER);
-    /* consider only partition of one dimension, and not  divisible(zheng cu)*/
-    //int client_num_per_server, low_server_num;
-    //low_server_num = server_amount - (client_y_num % server_amount);
-    //client_num_per_server = (client_y_num / server_amount) * client_x_num;
-    //
-    //if(server_id < low_server_num) 
-    //{
-    //    /**
-    //     *low servers
-    //     **/
-    //    *client_num = client_num_per_server;
-    //}else
-    //{
-    //    *client_num = client_num_per_server + client_x_num;
-    //}
-    
-    /* consider partition of two dimension and only divisible*/
-    int client_per_server, client_num;
 
-    client_per_server = client_amount / server_amount;
-    client_num = client_per_server;
+    server_index = cfio_map_get_server_index(server_id);
+    client_num = server_offset[server_index + 1] - server_offset[server_index];
 
     debug(DEBUG_MAP, "client number of server(%d) : %d", server_id, client_num);
     return client_num;
@@ -300,94 +606,23 @@ int cfio_map_get_server_index(int server_id)
 }
 int cfio_map_get_client_index_of_server(int client_id)
 {
-    //assert(cfio_map_proc_type(client_id) == CFIO_MAP_TYPE_CLIENT);
-    /* consider only partition of one dimension, and not  divisible(zheng cu)*/
-    //int client_num_per_server, low_server_num;
-
-    //low_server_num = server_amount - (client_y_num % server_amount);
-    //client_num_per_server = (client_y_num / server_amount) * client_x_num;
-    //
-    //if(client_num_per_server * low_server_num > client_id) 
-    //{
-    //    /**
-    //     *low servers
-    //     **/
-    //    *client_index = client_id % client_num_per_server;
-    //}else
-    //{
-    //    client_id -= client_num_per_server * low_server_num;
-    //    client_num_per_server += client_x_num;
-    //    *client_index = client_id % client_num_per_server;
-    //}
-    
-    /* consider partition of two dimension and only divisible*/
-    int client_x_index, client_y_index;
-    int client_per_server_x, client_per_server_y;
-    int client_x_index_in_server, client_y_index_in_server;
-    int client_index;
-    
-    client_x_index = client_id % client_x_num;
-    client_y_index = client_id / client_x_num;
-
-    client_per_server_x = client_x_num / server_x_num;
-    client_per_server_y = client_y_num / server_y_num;
+    assert(client_id >= 0 && client_id < client_amount);
 
-    client_x_index_in_server = client_x_index % client_per_server_x;
-    client_y_index_in_server = client_y_index % client_per_server_y;
-
-    client_index = client_x_index_in_server + 
-	client_y_index_in_server * client_per_server_x;
-
-    debug(DEBUG_MAP, "client index of client(%d) : %d", client_id, client_index);
-    return client_index;
+    debug(DEBUG_MAP, "client index of client(%d) : %d", 
+	    client_id, client_index[client_id]);
+    return client_index[client_id];
 }
 
 int cfio_map_get_server_of_client(int client_id)
 {
-    int server_id;
-    int client_x_index, client_y_index;
-    int server_x_index, server_y_index;
-    int client_per_server_x, client_per_server_y;
-    
-    client_x_index = client_id % client_x_num;
-    client_y_index = client_id / client_x_num;
+    assert(client_id >= 0 && client_id < client_amount);
 
-    client_per_server_x = client_x_num / server_x_num;
-    client_per_server_y = client_y_num / server_y_num;
-
-    server_x_index = client_x_index / client_per_server_x;
-    server_y_index = client_y_index / client_per_server_y;
-
-    server_id = server_x_index + server_y_index * server_x_num;
-
-    return server_id + client_amount;
+    return client_server[client_id] + client_amount;
 }
 
 int cfio_map_forwarding(
 	cfio_msg_t *msg)
 {
-    /* consider only partition of one dimension, and not  divisible(zheng cu)*/
-    //int x_proc, y_proc;
-    //int low_server_num, client_y_per_server;
-
-    //x_proc = msg->src % client_x_num;
-    //y_proc = msg->src / client_x_num;
-    //
-    //assert(client_y_num >= server_amount);
-
-    //low_server_num = server_amount - (client_y_num % server_amount);
-    //client_y_per_server = client_y_num / server_amount;
-    //
-    //if(client_y_per_server * low_server_num <= y_proc)
-    //{
-    //    msg->dst = (y_proc - client_y_per_server * low_server_num) / 
-    //        (client_y_per_server + 1) + low_server_num;
-    //}else
-    //{
-    //    msg->dst = y_proc / client_y_per_server; 
-    //}
-    
-    /* consider partition of two dimension and only divisible*/
     msg->dst = cfio_map_get_server_of_client(msg->src);
     
     msg->comm = comm;
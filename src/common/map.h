@@ -38,6 +38,44 @@ int cfio_map_init(
 	int _client_x_num, int _client_y_num,
 	int _server_amount, int best_server_amount,
 	MPI_Comm _comm, MPI_Comm server_comm);
+/**
+ * @brief: cfio map var init by the block of each client, for any number of
+ *	dims and irregular decompositions. clients are grouped onto servers 
+ *	by recursive bisection of their blocks, so a server gets clients close
+ *	to each other, and the amount of clients of each server may differ. 
+ *	it's collective in _comm
+ *
+ * @param _client_amount: client proc num, the clients are proc 0 ~ 
+ *	_client_amount - 1 in _comm
+ * @param ndims: number of dims of the blocks
+ * @param start: start of the block of this proc, not used in server proc
+ * @param count: count of the block of this proc, not used in server proc
+ * @param _server_amount: server proc num
+ * @param best_server_amount: best server proc num
+ * @param _comm: 
+ *
+ * @return: error code
+ */
+int cfio_map_init_nd(
+	int _client_amount, int ndims, size_t *start, size_t *count,
+	int _server_amount, int best_server_amount,
+	MPI_Comm _comm, MPI_Comm server_comm);
+/**
+ * @brief: cfio map var init by the given map, e.g. the map rebuilt from the 
+ *	capture files in replay, it's not collective
+ *
+ * @param _client_amount: client proc num
+ * @param _server_amount: server proc num
+ * @param _client_server: server index of each client
+ * @param _client_index: index of each client in its server
+ * @param _comm: 
+ *
+ * @return: error code
+ */
+int cfio_map_init_table(
+	int _client_amount, int _server_amount, 
+	const int *_client_server, const int *_client_index,
+	MPI_Comm _comm, MPI_Comm server_comm);
 /**
  * @brief: cfio map finalize
  *
@@ -57,8 +95,8 @@ int cfio_map_proc_type(int porc_id);
  *
  * @return: MPI Communication
  */
-int cfio_map_get_comm();
-int cfio_map_get_server_comm();
+MPI_Comm cfio_map_get_comm();
+MPI_Comm cfio_map_get_server_comm();
 /**
  * @brief: get server proc amount
  *
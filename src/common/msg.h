@@ -26,10 +26,15 @@
 #define FUNC_NC_CREATE		((uint32_t)1)
 #define FUNC_NC_ENDDEF		((uint32_t)2)
 #define FUNC_NC_CLOSE		((uint32_t)3)
+#define FUNC_SCHEMA_BEGIN	((uint32_t)4)
+#define FUNC_NC_CREATE_SCHEMA	((uint32_t)5)
+#define FUNC_SCHEMA_FREE	((uint32_t)6)
 #define FUNC_NC_DEF_DIM		((uint32_t)11)
 #define FUNC_NC_DEF_VAR		((uint32_t)12)
 #define FUNC_PUT_ATT		((uint32_t)13)
+#define FUNC_NC_DEF_VAR_PART	((uint32_t)14)
 #define FUNC_NC_PUT_VARA	((uint32_t)20)
+#define FUNC_NC_PUT_VARA_MULTI	((uint32_t)21)
 #define FUNC_IO_END		((uint32_t)30)
 #define FUNC_FINAL		((uint32_t)40)
 /* below two are only used in io.c */
@@ -39,6 +44,74 @@
 //define for msg buf size in a proc
 #define MSG_BUF_SIZE ((size_t)512*1024)
 
+/* version of the wire format, increased when the layout of any msg changes */
+#define CFIO_MSG_VERSION	3
+/**
+ * size of each msg is padded to CFIO_MSG_ALIGN, so that the msgs merged into 
+ * one MPI message stay aligned and the fixed part of them can be read by 
+ * pointer cast
+ **/
+#define CFIO_MSG_ALIGN		8
+#define cfio_msg_align(size) \
+    (((size) + CFIO_MSG_ALIGN - 1) & ~((size_t)CFIO_MSG_ALIGN - 1))
+
+/** @brief: head of every msg */
+typedef struct
+{
+    uint32_t size;	/* size of the msg, include the head and padding */
+    uint16_t func_code;	/* function code , like FUNC_NC_CREATE */
+    uint8_t version;	/* CFIO_MSG_VERSION */
+    uint8_t flags;	/* flags of the function, like CFIO_MSG_PUT_DECOMP */
+}cfio_msg_head_t;
+
+/** @brief: msg which only contains a nc id, like enddef and close */
+typedef struct
+{
+    cfio_msg_head_t head;
+    int32_t ncid;
+    int32_t pad;
+}cfio_msg_nc_t;
+
+/**
+ * flags of put_vara, show how start and count are encoded against the start 
+ * and count declared in def_var by the client. if no flag is set, start and
+ * count follow the fixed part as two uint64_t vectors
+ **/
+#define CFIO_MSG_PUT_DECOMP	0x1 /* equal to the declared ones except 
+				       start[0], which is in the fixed part, 
+				       usually the record index */
+#define CFIO_MSG_PUT_DELTA	0x2 /* follow as two int32_t delta vectors */
+#define CFIO_MSG_PUT_STAMP	0x4 /* a cfio_msg_stamp_t follows the fixed part,
+				       before start and count */
+
+/** @brief: fixed part of put_vara, followed by start, count and data */
+typedef struct
+{
+    cfio_msg_head_t head;
+    int32_t ncid;
+    int32_t varid;
+    uint32_t start0;	/* start[0], only used with CFIO_MSG_PUT_DECOMP */
+    uint16_t ndims;
+    uint8_t fp_type;	/* cfio_type of the data */
+    uint8_t pad;
+}cfio_msg_put_vara_t;
+
+/** @brief: stamps of put_vara for the latency tracking, in ns of 
+ * cfio_latency_now, 0 if not stamped */
+typedef struct
+{
+    uint64_t call;	/* put_vara is called */
+    uint64_t send;	/* the MPI message containing it is sent */
+}cfio_msg_stamp_t;
+
+/** @brief: fixed part of put_vara_multi, followed by n put_vara msgs */
+typedef struct
+{
+    cfio_msg_head_t head;
+    int32_t ncid;
+    int32_t n;
+}cfio_msg_put_vara_multi_t;
+
 typedef struct
 {
     uint32_t func_code;	/* function code , like FUNC_NC_CREATE */
@@ -48,6 +121,8 @@ typedef struct
     int dst;		/* id of dst porc */  
     MPI_Comm comm;	/* communication  */
     MPI_Request req;	/* MPI request of the send msg */
+    uint64_t recv_time;	/* cfio_latency_now when received, 0 if the latency
+			   isn't tracked */
     qlist_head_t link;	/* quicklist head */
 }cfio_msg_t;
 
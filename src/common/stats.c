@@ -0,0 +1,143 @@
+/****************************************************************************
+ *       Filename:  stats.c
+ *
+ *    Description:  runtime statistics, and the report in final
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+#include "debug.h"
+#include "cfio_error.h"
+
+/* the fields of cfio_stats_t are all uint64_t, they are handled as an array */
+#define _FIELD_NUM (sizeof(cfio_stats_t) / sizeof(uint64_t))
+
+cfio_stats_t cfio_stats;
+
+static int stats_rank;
+
+/* names of the fields, in the order of cfio_stats_t */
+static const char *field_names[] =
+{
+    "msg_num", "msg_bytes", "msg_merged", "send_num", "send_bytes",
+    "send_time", "buf_wait_num", "buf_wait_time",
+    "recv_num", "recv_bytes", "recv_min_size", "recv_max_size",
+    "recv_buf_full", "decode_num", "decode_time", "merge_time",
+    "backend_num", "backend_time", "write_bytes"
+};
+
+int cfio_stats_init(int rank)
+{
+    stats_rank = rank;
+    memset(&cfio_stats, 0, sizeof(cfio_stats_t));
+
+    return CFIO_ERROR_NONE;
+}
+
+void cfio_stats_get(cfio_stats_t *stats)
+{
+    size_t i;
+    uint64_t *src = (uint64_t *)&cfio_stats, *dst = (uint64_t *)stats;
+
+    for(i = 0; i < _FIELD_NUM; i ++)
+    {
+	dst[i] = *(volatile uint64_t *)(src + i);
+    }
+}
+
+/**
+ * @brief: write fields as a json object
+ */
+static void _write_fields(FILE *fp, const uint64_t *fields)
+{
+    size_t i;
+
+    fprintf(fp, "{");
+    for(i = 0; i < _FIELD_NUM; i ++)
+    {
+	fprintf(fp, "%s\"%s\":%llu", 0 == i ? "" : ",", field_names[i],
+		(unsigned long long)fields[i]);
+    }
+    fprintf(fp, "}");
+}
+
+int cfio_stats_final()
+{
+    char *prefix, path[256];
+    FILE *fp;
+    size_t i;
+    uint64_t local[_FIELD_NUM], min_in[_FIELD_NUM];
+    uint64_t sum[_FIELD_NUM], min[_FIELD_NUM], max[_FIELD_NUM];
+    int size, ret = CFIO_ERROR_NONE;
+
+    if(sizeof(field_names) / sizeof(field_names[0]) != _FIELD_NUM)
+    {
+	error("field_names doesn't match cfio_stats_t.");
+	return CFIO_ERROR_INVALID_INIT_ARG;
+    }
+    if(NULL == (prefix = getenv(CFIO_STATS_ENV)))
+    {
+	return CFIO_ERROR_NONE;
+    }
+
+    cfio_stats_get((cfio_stats_t *)local);
+
+    snprintf(path, sizeof(path), "%s.%d.json", prefix, stats_rank);
+    if(NULL == (fp = fopen(path, "w")))
+    {
+	error("open stats file %s fail.", path);
+	ret = CFIO_ERROR_FILE;
+    }else
+    {
+	_write_fields(fp, local);
+	fprintf(fp, "\n");
+	fclose(fp);
+    }
+
+    /* min is of the procs which have the field, e.g. recv_num of servers */
+    for(i = 0; i < _FIELD_NUM; i ++)
+    {
+	min_in[i] = 0 == local[i] ? UINT64_MAX : local[i];
+    }
+    MPI_Reduce(local, sum, _FIELD_NUM, MPI_UINT64_T, MPI_SUM, 0,
+	    MPI_COMM_WORLD);
+    MPI_Reduce(min_in, min, _FIELD_NUM, MPI_UINT64_T, MPI_MIN, 0,
+	    MPI_COMM_WORLD);
+    MPI_Reduce(local, max, _FIELD_NUM, MPI_UINT64_T, MPI_MAX, 0,
+	    MPI_COMM_WORLD);
+    if(0 != stats_rank)
+    {
+	return ret;
+    }
+
+    for(i = 0; i < _FIELD_NUM; i ++)
+    {
+	if(UINT64_MAX == min[i])
+	{
+	    min[i] = 0;
+	}
+    }
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    snprintf(path, sizeof(path), "%s.json", prefix);
+    if(NULL == (fp = fopen(path, "w")))
+    {
+	error("open stats file %s fail.", path);
+	return CFIO_ERROR_FILE;
+    }
+    fprintf(fp, "{\"procs\":%d,\n\"sum\":", size);
+    _write_fields(fp, sum);
+    fprintf(fp, ",\n\"min\":");
+    _write_fields(fp, min);
+    fprintf(fp, ",\n\"max\":");
+    _write_fields(fp, max);
+    fprintf(fp, "}\n");
+    fclose(fp);
+
+    return ret;
+}
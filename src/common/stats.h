@@ -0,0 +1,99 @@
+/****************************************************************************
+ *       Filename:  stats.h
+ *
+ *    Description:  runtime statistics, counters are added atomically by all
+ *		    threads, and reported in final if CFIO_STATS_ENV is set
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdint.h>
+
+#include "mpi.h"
+#include "cfio_types.h"
+#include "trace.h"
+
+/* env variable of the report file prefix, e.g. CFIO_STATS=/tmp/cfio, then
+ * rank i writes /tmp/cfio.i.json, and rank 0 also writes the sum, min and max
+ * of all ranks into /tmp/cfio.json. it must be set in all procs or none */
+#define CFIO_STATS_ENV	"CFIO_STATS"
+
+extern cfio_stats_t cfio_stats;
+
+/**
+ * @brief: add n to a field of cfio_stats
+ */
+#define cfio_stats_add(field, n) \
+    __sync_fetch_and_add(&cfio_stats.field, (uint64_t)(n))
+/**
+ * @brief: begin a timed event, declare t and set it to the current time, t
+ *	can also be used by cfio_trace_end
+ */
+#define cfio_stats_begin(t) \
+    uint64_t t = cfio_trace_now()
+/**
+ * @brief: add the time since t to a field of cfio_stats
+ */
+#define cfio_stats_time(field, t) \
+    cfio_stats_add(field, cfio_trace_now() - (t))
+
+/**
+ * @brief: set a gauge of cfio_stats to v if v is less, 0 means unset
+ */
+static inline void cfio_stats_min(uint64_t *field, uint64_t v)
+{
+    uint64_t old;
+
+    do
+    {
+	old = *(volatile uint64_t *)field;
+	if(0 != old && old <= v)
+	{
+	    return;
+	}
+    }while(!__sync_bool_compare_and_swap(field, old, v));
+}
+/**
+ * @brief: set a gauge of cfio_stats to v if v is greater
+ */
+static inline void cfio_stats_max(uint64_t *field, uint64_t v)
+{
+    uint64_t old;
+
+    do
+    {
+	old = *(volatile uint64_t *)field;
+	if(old >= v)
+	{
+	    return;
+	}
+    }while(!__sync_bool_compare_and_swap(field, old, v));
+}
+
+/**
+ * @brief: init the stats, clear all the counters
+ *
+ * @param rank: rank of the proc in MPI_COMM_WORLD
+ *
+ * @return: error code
+ */
+int cfio_stats_init(int rank);
+/**
+ * @brief: get a copy of the stats
+ *
+ * @param stats: the copy
+ */
+void cfio_stats_get(cfio_stats_t *stats);
+/**
+ * @brief: write the report if CFIO_STATS_ENV is set, it's collective on
+ *	MPI_COMM_WORLD in that case
+ *
+ * @return: error code
+ */
+int cfio_stats_final();
+
+#endif
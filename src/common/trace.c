@@ -0,0 +1,215 @@
+/****************************************************************************
+ *       Filename:  trace.c
+ *
+ *    Description:  event tracing, each thread records events into its own
+ *		    ring, and each rank dumps a Chrome trace (JSON) in final
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "trace.h"
+#include "debug.h"
+#include "cfio_error.h"
+
+typedef struct
+{
+    const char *name;	/* name of the event */
+    uint64_t start;	/* start time, in ns */
+    uint64_t dur;	/* duration, in ns */
+    int64_t arg;	/* argument of the event */
+}cfio_trace_event_t;
+
+/**
+ * @brief: ring of events of a thread, only written by the thread, so no lock
+ *	is needed
+ **/
+typedef struct cfio_trace_ring
+{
+    int tid;			/* id of the thread in the trace */
+    const char *name;		/* name of the thread */
+    uint64_t num;		/* amount of events added */
+    cfio_trace_event_t *events;	/* CFIO_TRACE_RING_SIZE events */
+    struct cfio_trace_ring *next;
+}cfio_trace_ring_t;
+
+int cfio_trace_on = 0;
+
+static char *prefix;
+static int trace_rank;
+static int thread_num;
+/* rings of all threads, a new ring is pushed by compare and swap */
+static cfio_trace_ring_t *rings;
+
+static __thread cfio_trace_ring_t *ring;
+static __thread int ring_fail;
+
+/**
+ * @brief: get the ring of the calling thread, create it the first time
+ *
+ * @return: the ring, NULL if malloc fail
+ */
+static cfio_trace_ring_t *_get_ring()
+{
+    cfio_trace_ring_t *new_ring;
+
+    if(NULL != ring || ring_fail)
+    {
+	return ring;
+    }
+
+    new_ring = malloc(sizeof(cfio_trace_ring_t));
+    if(NULL == new_ring || NULL == (new_ring->events =
+		malloc(sizeof(cfio_trace_event_t) * CFIO_TRACE_RING_SIZE)))
+    {
+	free(new_ring);
+	error("malloc for trace ring fail, the thread is not traced.");
+	ring_fail = 1;
+	return NULL;
+    }
+    new_ring->tid = __sync_fetch_and_add(&thread_num, 1);
+    new_ring->name = NULL;
+    new_ring->num = 0;
+    do
+    {
+	new_ring->next = rings;
+    }while(!__sync_bool_compare_and_swap(&rings, new_ring->next, new_ring));
+
+    ring = new_ring;
+    return ring;
+}
+
+uint64_t cfio_trace_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void cfio_trace_add(const char *name, uint64_t start, int64_t arg)
+{
+    cfio_trace_ring_t *_ring;
+    cfio_trace_event_t *event;
+    uint64_t end;
+
+    end = cfio_trace_now();
+    if(NULL == (_ring = _get_ring()))
+    {
+	return;
+    }
+
+    event = _ring->events + (_ring->num & (CFIO_TRACE_RING_SIZE - 1));
+    event->name = name;
+    event->start = start;
+    event->dur = end - start;
+    event->arg = arg;
+    _ring->num ++;
+}
+
+void cfio_trace_thread_name(const char *name)
+{
+    cfio_trace_ring_t *_ring;
+
+    if(cfio_trace_on && NULL != (_ring = _get_ring()))
+    {
+	_ring->name = name;
+    }
+}
+
+int cfio_trace_init(int rank)
+{
+    char *env;
+
+    trace_rank = rank;
+    if(NULL == (env = getenv(CFIO_TRACE_ENV)))
+    {
+	cfio_trace_on = 0;
+	return CFIO_ERROR_NONE;
+    }
+
+    prefix = env;
+    cfio_trace_on = 1;
+    cfio_trace_thread_name("main");
+
+    debug(DEBUG_TIME, "trace into %s.%d.json", prefix, rank);
+    return CFIO_ERROR_NONE;
+}
+
+static void _dump_ring(FILE *fp, cfio_trace_ring_t *_ring, int *first)
+{
+    uint64_t i, begin;
+    cfio_trace_event_t *event;
+
+    if(NULL != _ring->name)
+    {
+	fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+		"\"tid\":%d,\"args\":{\"name\":\"%s\"}}", *first ? "" : ",",
+		trace_rank, _ring->tid, _ring->name);
+	*first = 0;
+    }
+
+    begin = _ring->num > CFIO_TRACE_RING_SIZE ?
+	_ring->num - CFIO_TRACE_RING_SIZE : 0;
+    for(i = begin; i < _ring->num; i ++)
+    {
+	event = _ring->events + (i & (CFIO_TRACE_RING_SIZE - 1));
+	/* ts and dur are in us */
+	fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+		"\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"args\":{\"arg\":%lld}}",
+		*first ? "" : ",", event->name, trace_rank, _ring->tid,
+		(unsigned long long)(event->start / 1000),
+		(unsigned)(event->start % 1000),
+		(unsigned long long)(event->dur / 1000),
+		(unsigned)(event->dur % 1000), (long long)event->arg);
+	*first = 0;
+    }
+}
+
+int cfio_trace_final()
+{
+    char path[256];
+    FILE *fp;
+    cfio_trace_ring_t *_ring, *next;
+    int first = 1, ret = CFIO_ERROR_NONE;
+
+    if(!cfio_trace_on)
+    {
+	return CFIO_ERROR_NONE;
+    }
+    cfio_trace_on = 0;
+
+    snprintf(path, sizeof(path), "%s.%d.json", prefix, trace_rank);
+    if(NULL == (fp = fopen(path, "w")))
+    {
+	error("open trace file %s fail.", path);
+	ret = CFIO_ERROR_FILE;
+    }else
+    {
+	fprintf(fp, "{\"traceEvents\":[");
+	fprintf(fp, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+		"\"args\":{\"name\":\"rank %d\"}}", trace_rank, trace_rank);
+	first = 0;
+	for(_ring = rings; NULL != _ring; _ring = _ring->next)
+	{
+	    _dump_ring(fp, _ring, &first);
+	}
+	fprintf(fp, "\n],\"displayTimeUnit\":\"ns\"}\n");
+	fclose(fp);
+    }
+
+    for(_ring = rings; NULL != _ring; _ring = next)
+    {
+	next = _ring->next;
+	free(_ring->events);
+	free(_ring);
+    }
+    rings = NULL;
+    ring = NULL;
+
+    return ret;
+}
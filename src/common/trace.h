@@ -0,0 +1,82 @@
+/****************************************************************************
+ *       Filename:  trace.h
+ *
+ *    Description:  event tracing, each thread records events into its own
+ *		    ring, and each rank dumps a Chrome trace (JSON) in final,
+ *		    which can be opened by chrome://tracing or Perfetto
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+/* env variable of the trace file prefix, tracing is on only if it's set, e.g.
+ * CFIO_TRACE=/tmp/cfio, then rank i dumps /tmp/cfio.i.json */
+#define CFIO_TRACE_ENV		"CFIO_TRACE"
+/* amount of events kept by each thread, the oldest are overwritten */
+#define CFIO_TRACE_RING_SIZE	(1 << 16)
+
+extern int cfio_trace_on;
+
+/**
+ * @brief: begin an event, declare t and set it to the current time, it's only
+ *	a branch if tracing is off
+ */
+#define cfio_trace_begin(t) \
+    uint64_t t = cfio_trace_on ? cfio_trace_now() : 0
+/**
+ * @brief: end an event begun by cfio_trace_begin
+ *
+ * @param name: name of the event, must be a string literal
+ * @param t: the t of cfio_trace_begin
+ * @param arg: an argument of the event, e.g. size of the data
+ */
+#define cfio_trace_end(name, t, arg) \
+    do { \
+	if(cfio_trace_on) \
+	{ \
+	    cfio_trace_add(name, t, arg); \
+	} \
+    } while(0)
+
+/**
+ * @brief: get current time, in ns
+ *
+ * @return: current time, in ns
+ */
+uint64_t cfio_trace_now();
+/**
+ * @brief: add an event ending now into the ring of the calling thread
+ *
+ * @param name: name of the event, must be a string literal
+ * @param start: start time of the event, in ns
+ * @param arg: an argument of the event
+ */
+void cfio_trace_add(const char *name, uint64_t start, int64_t arg);
+/**
+ * @brief: set the name of the calling thread shown in the trace
+ *
+ * @param name: name of the thread, must be a string literal
+ */
+void cfio_trace_thread_name(const char *name);
+/**
+ * @brief: init tracing, it's on if CFIO_TRACE_ENV is set
+ *
+ * @param rank: rank of the proc, used as pid in the trace
+ *
+ * @return: error code
+ */
+int cfio_trace_init(int rank);
+/**
+ * @brief: dump the trace and free the rings, all threads which trace must
+ *	have been finished
+ *
+ * @return: error code
+ */
+int cfio_trace_final();
+
+#endif
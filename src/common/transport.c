@@ -0,0 +1,78 @@
+/****************************************************************************
+ *       Filename:  transport.c
+ *
+ *    Description:  transport over MPI
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include "transport.h"
+
+cfio_transport_t *cfio_transport = &cfio_transport_mpi;
+
+static int _rank()
+{
+    int rank;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank;
+}
+
+static int _size()
+{
+    int size;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return size;
+}
+
+static int _ssend(void *buf, int size, int dst, int tag, MPI_Comm comm)
+{
+    return MPI_Ssend(buf, size, MPI_BYTE, dst, tag, comm);
+}
+
+static int _recv(void *buf, int max_size, int src, MPI_Comm comm,
+	int *size, int *source, int *tag)
+{
+    MPI_Status status;
+    int ret;
+
+    ret = MPI_Recv(buf, max_size, MPI_BYTE, src, MPI_ANY_TAG, comm, &status);
+    MPI_Get_count(&status, MPI_BYTE, size);
+    *source = status.MPI_SOURCE;
+    *tag = status.MPI_TAG;
+
+    return ret;
+}
+
+static int _iprobe(int src, int tag, MPI_Comm comm, int *flag)
+{
+    MPI_Status status;
+
+    return MPI_Iprobe(src, tag, comm, flag, &status);
+}
+
+static int _allgather(uint64_t *send_buf, int count, uint64_t *recv_buf,
+	MPI_Comm comm)
+{
+    return MPI_Allgather(send_buf, count, MPI_UNSIGNED_LONG_LONG,
+	    recv_buf, count, MPI_UNSIGNED_LONG_LONG, comm);
+}
+
+static int _barrier(MPI_Comm comm)
+{
+    return MPI_Barrier(comm);
+}
+
+cfio_transport_t cfio_transport_mpi =
+{
+    .name	= CFIO_TRANSPORT_MPI,
+    .rank	= _rank,
+    .size	= _size,
+    .ssend	= _ssend,
+    .recv	= _recv,
+    .iprobe	= _iprobe,
+    .allgather	= _allgather,
+    .barrier	= _barrier,
+};
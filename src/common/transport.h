@@ -0,0 +1,92 @@
+/****************************************************************************
+ *       Filename:  transport.h
+ *
+ *    Description:  transport of the msgs between clients and servers, over
+ *		    MPI, or over the loopback in a process whose threads act
+ *		    as the procs
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _TRANSPORT_H
+#define _TRANSPORT_H
+
+#include <stdint.h>
+
+#include "mpi.h"
+
+#define CFIO_TRANSPORT_MPI	"mpi"
+#define CFIO_TRANSPORT_LOOPBACK	"loopback"
+
+/* max amount of procs hosted by the loopback */
+#define CFIO_LOOPBACK_MAX_PROC	4096
+
+typedef struct
+{
+    const char *name;
+
+    /* rank and size of the proc in the world */
+    int (*rank)();
+    int (*size)();
+    /* send and return after the msg is received, as MPI_Ssend */
+    int (*ssend)(void *buf, int size, int dst, int tag, MPI_Comm comm);
+    /* recv a msg of any tag from src, size, source and tag are returned */
+    int (*recv)(void *buf, int max_size, int src, MPI_Comm comm,
+	    int *size, int *source, int *tag);
+    int (*iprobe)(int src, int tag, MPI_Comm comm, int *flag);
+    /* gather count uint64_t of each proc into recv_buf of all procs */
+    int (*allgather)(uint64_t *send_buf, int count, uint64_t *recv_buf,
+	    MPI_Comm comm);
+    int (*barrier)(MPI_Comm comm);
+}cfio_transport_t;
+
+extern cfio_transport_t cfio_transport_mpi;
+extern cfio_transport_t cfio_transport_loopback;
+
+/* the transport of the process, the loopback is selected only inside
+ * cfio_transport_loopback_run */
+extern cfio_transport_t *cfio_transport;
+
+/**
+ * @brief: whether the loopback is selected
+ */
+#define cfio_transport_is_loopback() \
+    (&cfio_transport_loopback == cfio_transport)
+
+#define cfio_transport_rank() cfio_transport->rank()
+#define cfio_transport_size() cfio_transport->size()
+#define cfio_transport_ssend(buf, size, dst, tag, comm) \
+    cfio_transport->ssend(buf, size, dst, tag, comm)
+#define cfio_transport_recv(buf, max_size, src, comm, size, source, tag) \
+    cfio_transport->recv(buf, max_size, src, comm, size, source, tag)
+#define cfio_transport_iprobe(src, tag, comm, flag) \
+    cfio_transport->iprobe(src, tag, comm, flag)
+#define cfio_transport_allgather(send_buf, count, recv_buf, comm) \
+    cfio_transport->allgather(send_buf, count, recv_buf, comm)
+#define cfio_transport_barrier(comm) cfio_transport->barrier(comm)
+
+/**
+ * @brief: run proc_num procs as threads of the process over the loopback,
+ *	proc i calls func(i, proc_num, arg) in thread i, and the transport 
+ *	functions called by it work as if it were rank i of proc_num MPI procs
+ *
+ * @param proc_num: amount of procs
+ * @param func: the main function of the procs
+ * @param arg: argument of func
+ *
+ * @return: error code, the error of the first failed proc if a proc fails
+ */
+int cfio_transport_loopback_run(int proc_num,
+	void (*func)(int rank, int size, void *arg), void *arg);
+/**
+ * @brief: fail the loopback run from a proc of it, e.g. its init fails, so
+ *	that the other procs don't wait for it forever. the procs blocked in
+ *	the transport are woken up, and the transport functions return error
+ *	from then on. it does nothing if the loopback is not running
+ *
+ * @param ret: the error code, the run returns the first one
+ */
+void cfio_transport_loopback_fail(int ret);
+
+#endif
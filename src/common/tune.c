@@ -0,0 +1,382 @@
+/****************************************************************************
+ *       Filename:  tune.c
+ *
+ *    Description:  autotune of the msg size and the client : server ratio
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tune.h"
+#include "map.h"
+#include "trace.h"
+#include "transport.h"
+#include "debug.h"
+#include "cfio_error.h"
+
+/* measures of a proc gathered in cfio_tune_final */
+#define _TYPE	    0	/* cfio map type of the proc */
+#define _TIME	    1	/* blocked time of client, busy time of server */
+#define _WALL	    2	/* time since cfio_tune_init */
+#define _SHIFT	    3	/* msg size shift of client */
+#define _MEASURE_NUM 4
+
+cfio_proc_local int cfio_tune_on = 0;
+
+static cfio_proc_local int tune_rank;
+static cfio_proc_local int tune_mode;
+static cfio_proc_local char tune_path[256];
+static cfio_proc_local uint64_t tune_start;
+/* loaded from the tuning file, 0 and -1 if not */
+static cfio_proc_local int loaded_ratio;
+static cfio_proc_local int loaded_shift;
+
+/* the msg size is max_msg_size >> shift */
+static cfio_proc_local size_t max_msg_size;
+static cfio_proc_local int shift;
+static cfio_proc_local int trial, trial_num;
+static cfio_proc_local int first_shift;	/* shift tried in the first epoch */
+static cfio_proc_local int best_shift;
+static cfio_proc_local double best_throughput;
+static cfio_proc_local uint64_t epoch_bytes, epoch_ns, total_ns;
+
+/**
+ * @brief: load the tuning file, it's not an error if it doesn't exist
+ */
+static void _load(const char *path)
+{
+    FILE *fp;
+    char line[256], key[64];
+    int value;
+
+    if(NULL == (fp = fopen(path, "r")))
+    {
+	debug(DEBUG_CFIO, "no tuning file %s", path);
+	return;
+    }
+    while(NULL != fgets(line, sizeof(line), fp))
+    {
+	if('#' == line[0] || 2 != sscanf(line, "%63s %d", key, &value))
+	{
+	    continue;
+	}
+	if(0 == strcmp(key, "ratio") && value > 0)
+	{
+	    loaded_ratio = value;
+	}else if(0 == strcmp(key, "msg_shift") && value >= 0)
+	{
+	    loaded_shift = value;
+	}
+    }
+    fclose(fp);
+
+    debug(DEBUG_CFIO, "load tuning file %s : ratio = %d, msg_shift = %d",
+	    path, loaded_ratio, loaded_shift);
+}
+
+/**
+ * @brief: share the ratio and msg size loaded by rank 0 with all procs, the
+ *	ratio decides the map, so the procs must not read the file on their own,
+ *	which may be missing on some nodes or rewritten while they start
+ *
+ * @return: error code
+ */
+static int _share_loaded()
+{
+    uint64_t local[2], *all;
+    int size;
+
+    local[0] = (uint64_t)(int64_t)loaded_ratio;
+    local[1] = (uint64_t)(int64_t)loaded_shift;
+
+    size = cfio_transport_size();
+    if(NULL == (all = malloc(sizeof(local) * size)))
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    if(MPI_SUCCESS != cfio_transport_allgather(local, 2, all, MPI_COMM_WORLD))
+    {
+	free(all);
+	error("allgather tuning file fail.");
+	return CFIO_ERROR_TRANSPORT;
+    }
+    loaded_ratio = (int)(int64_t)all[0];
+    loaded_shift = (int)(int64_t)all[1];
+    free(all);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_tune_init(int rank)
+{
+    char *mode, *path;
+    int ret;
+
+    tune_rank = rank;
+    tune_mode = CFIO_TUNE_OFF;
+    loaded_ratio = 0;
+    loaded_shift = -1;
+    cfio_tune_on = 0;
+
+    if(NULL == (mode = getenv(CFIO_TUNE_ENV)) || 0 == strcmp(mode, "off"))
+    {
+	return CFIO_ERROR_NONE;
+    }
+    if(0 == strcmp(mode, "load"))
+    {
+	tune_mode = CFIO_TUNE_LOAD;
+    }else if(0 == strcmp(mode, "auto"))
+    {
+	tune_mode = CFIO_TUNE_AUTO;
+    }else
+    {
+	error("invalid %s : %s, should be off, load or auto.",
+		CFIO_TUNE_ENV, mode);
+	return CFIO_ERROR_INVALID_INIT_ARG;
+    }
+
+    if(NULL == (path = getenv(CFIO_TUNE_FILE_ENV)))
+    {
+	path = CFIO_TUNE_DEFAULT_FILE;
+    }
+    snprintf(tune_path, sizeof(tune_path), "%s", path);
+    if(0 == tune_rank)
+    {
+	_load(tune_path);
+    }
+    if((ret = _share_loaded()) < 0)
+    {
+	return ret;
+    }
+
+    tune_start = cfio_trace_now();
+    epoch_bytes = epoch_ns = total_ns = 0;
+    cfio_tune_on = (CFIO_TUNE_AUTO == tune_mode);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_tune_ratio(int ratio, int client_num, int server_proc_num)
+{
+    int best_server_amount;
+
+    if(loaded_ratio <= 0 || loaded_ratio == ratio)
+    {
+	return ratio;
+    }
+
+    best_server_amount = client_num / loaded_ratio;
+    if(best_server_amount <= 0)
+    {
+	best_server_amount = 1;
+    }
+    if(best_server_amount > server_proc_num)
+    {
+	if(0 == tune_rank)
+	{
+	    error("tuned ratio %d needs %d server procs, only %d started, "
+		    "ratio %d is used.", loaded_ratio, best_server_amount,
+		    server_proc_num, ratio);
+	}
+	return ratio;
+    }
+
+    debug(DEBUG_CFIO, "use tuned ratio %d instead of %d", loaded_ratio, ratio);
+    return loaded_ratio;
+}
+
+/**
+ * @brief: shift of a trial epoch, the loaded one is tried first, and then the
+ *	others from the largest size
+ */
+static int _trial_shift(int k)
+{
+    if(0 == k)
+    {
+	return first_shift;
+    }
+    return k - 1 < first_shift ? k - 1 : k;
+}
+
+size_t cfio_tune_msg_size(size_t max_size)
+{
+    max_msg_size = max_size;
+
+    /* the sizes tried, not less than CFIO_TUNE_MIN_MSG_SIZE */
+    for(trial_num = 1; trial_num < CFIO_TUNE_TRIALS &&
+	    (max_size >> trial_num) >= CFIO_TUNE_MIN_MSG_SIZE; trial_num ++);
+
+    shift = 0;
+    if(loaded_shift > 0)
+    {
+	shift = loaded_shift < trial_num ? loaded_shift : trial_num - 1;
+    }
+    if(cfio_tune_on)
+    {
+	trial = 0;
+	first_shift = best_shift = shift;
+	best_throughput = 0.0;
+    }
+
+    return max_msg_size >> shift;
+}
+
+void cfio_tune_add(size_t size, uint64_t ns)
+{
+    epoch_bytes += size;
+    epoch_ns += ns;
+    total_ns += ns;
+}
+
+size_t cfio_tune_epoch()
+{
+    double throughput;
+
+    if(trial < trial_num && epoch_bytes > 0)
+    {
+	throughput = (double)epoch_bytes / (epoch_ns + 1);
+	debug(DEBUG_CFIO, "epoch %d : msg size = %lu, %lu bytes, "
+		"blocked %lu ns", trial, max_msg_size >> shift,
+		(unsigned long)epoch_bytes, (unsigned long)epoch_ns);
+	if(throughput > best_throughput)
+	{
+	    best_throughput = throughput;
+	    best_shift = shift;
+	}
+	trial ++;
+	if(trial < trial_num)
+	{
+	    shift = _trial_shift(trial);
+	}else
+	{
+	    shift = best_shift;
+	    debug(DEBUG_CFIO, "tuned msg size = %lu", max_msg_size >> shift);
+	}
+    }
+    epoch_bytes = epoch_ns = 0;
+
+    return max_msg_size >> shift;
+}
+
+/**
+ * @brief: write the tuning file, by rank 0
+ *
+ * @param measures: _MEASURE_NUM measures of each proc
+ * @param size: amount of procs
+ */
+static int _write(uint64_t *measures, int size)
+{
+    int i, client_num = 0, server_num = 0, ratio, need;
+    int shift_count[CFIO_TUNE_TRIALS] = {0}, msg_shift = 0;
+    double stall = 0.0, busy = 0.0;
+    uint64_t *m;
+    FILE *fp;
+
+    for(i = 0; i < size; i ++)
+    {
+	m = measures + i * _MEASURE_NUM;
+	if(0 == m[_WALL])
+	{
+	    continue;
+	}
+	if(CFIO_MAP_TYPE_CLIENT == m[_TYPE])
+	{
+	    client_num ++;
+	    stall += (double)m[_TIME] / m[_WALL];
+	    if(m[_SHIFT] < CFIO_TUNE_TRIALS)
+	    {
+		shift_count[m[_SHIFT]] ++;
+	    }
+	}else if(CFIO_MAP_TYPE_SERVER == m[_TYPE])
+	{
+	    server_num ++;
+	    busy += (double)m[_TIME] / m[_WALL];
+	}
+    }
+    if(0 == client_num || 0 == server_num)
+    {
+	return CFIO_ERROR_NONE;
+    }
+    stall /= client_num;
+    busy /= server_num;
+    for(i = 1; i < CFIO_TUNE_TRIALS; i ++)
+    {
+	if(shift_count[i] > shift_count[msg_shift])
+	{
+	    msg_shift = i;
+	}
+    }
+
+    /* the servers can't drain the clients, double them, or else size them
+     * for the target busy fraction */
+    if(stall > CFIO_TUNE_MAX_STALL)
+    {
+	need = server_num * 2;
+    }else
+    {
+	need = (int)(server_num * busy / CFIO_TUNE_TARGET_BUSY);
+	need += (need < server_num * busy / CFIO_TUNE_TARGET_BUSY);
+    }
+    need = need < 1 ? 1 : (need > client_num ? client_num : need);
+    ratio = client_num / need;
+
+    if(NULL == (fp = fopen(tune_path, "w")))
+    {
+	error("open tuning file %s fail.", tune_path);
+	return CFIO_ERROR_FILE;
+    }
+    fprintf(fp, "# written by cfio with %d clients and %d servers, "
+	    "client stall %.4f, server busy %.4f\n", client_num, server_num,
+	    stall, busy);
+    fprintf(fp, "ratio %d\n", ratio);
+    fprintf(fp, "msg_shift %d\n", msg_shift);
+    fclose(fp);
+
+    debug(DEBUG_CFIO, "tuning file %s : ratio = %d, msg_shift = %d",
+	    tune_path, ratio, msg_shift);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_tune_final(int proc_type)
+{
+    uint64_t local[_MEASURE_NUM], *measures;
+    int size, ret = CFIO_ERROR_NONE;
+
+    if(!cfio_tune_on)
+    {
+	return CFIO_ERROR_NONE;
+    }
+    cfio_tune_on = 0;
+
+    local[_TYPE] = proc_type;
+    local[_TIME] = total_ns;
+    local[_WALL] = cfio_trace_now() - tune_start;
+    local[_SHIFT] = shift;
+
+    size = cfio_transport_size();
+    if(NULL == (measures = malloc(sizeof(uint64_t) * _MEASURE_NUM * size)))
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    if(MPI_SUCCESS != cfio_transport_allgather(local, _MEASURE_NUM, measures,
+		MPI_COMM_WORLD))
+    {
+	free(measures);
+	error("allgather measures fail.");
+	return CFIO_ERROR_TRANSPORT;
+    }
+    if(0 == tune_rank)
+    {
+	ret = _write(measures, size);
+    }
+    free(measures);
+
+    return ret;
+}
@@ -0,0 +1,125 @@
+/****************************************************************************
+ *       Filename:  tune.h
+ *
+ *    Description:  autotune of the msg size and the client : server ratio
+ *
+ *		    in the first io epochs (the steps ended by cfio_io_end)
+ *		    each client tries the max msg size, its half, its quarter
+ *		    ..., and measures the drain throughput, which is bytes sent
+ *		    / time blocked in sending and waiting for buffer. the size
+ *		    of the best throughput is used for the rest of the run, it
+ *		    bounds both the merging of msgs and the packing of
+ *		    put_vara_multi
+ *
+ *		    in cfio_finalize, rank 0 gathers the stall fraction of the
+ *		    clients and the busy fraction of the servers, recommends
+ *		    the ratio of the next run, and writes it with the msg size
+ *		    into the tuning file, which is loaded by rank 0 in later
+ *		    cfio_init and shared with all procs, so that they build
+ *		    the same map
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _TUNE_H
+#define _TUNE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "define.h"
+#include "trace.h"
+
+/* env variable of the tuning mode, it must be set in all procs or none :
+ * off : default, the tuning file is not used
+ * load : the ratio and msg size are loaded from the tuning file
+ * auto : load, and then tune during the run and rewrite the file */
+#define CFIO_TUNE_ENV		"CFIO_TUNE"
+#define CFIO_TUNE_FILE_ENV	"CFIO_TUNE_FILE"
+#define CFIO_TUNE_DEFAULT_FILE	"cfio.tune"
+
+#define CFIO_TUNE_OFF		0
+#define CFIO_TUNE_LOAD		1
+#define CFIO_TUNE_AUTO		2
+
+/* max amount of msg sizes tried, one epoch each */
+#define CFIO_TUNE_TRIALS	4
+/* msg size is not tuned below it */
+#define CFIO_TUNE_MIN_MSG_SIZE	((size_t)64*1024)
+/* clients blocked more than this fraction of their time need more servers */
+#define CFIO_TUNE_MAX_STALL	0.05
+/* busy fraction the servers are sized for if the clients don't stall */
+#define CFIO_TUNE_TARGET_BUSY	0.7
+
+/* whether the proc measures for the tuning, it's the auto mode */
+extern cfio_proc_local int cfio_tune_on;
+
+/**
+ * @brief: add the time a client is blocked in sending a msg
+ */
+#define cfio_tune_add_send(size, t) \
+    do{ \
+	if(cfio_tune_on) cfio_tune_add(size, cfio_trace_now() - (t)); \
+    }while(0)
+/**
+ * @brief: add the time a client is blocked for buffer, or a server is busy
+ *	decoding
+ */
+#define cfio_tune_add_time(t) \
+    do{ \
+	if(cfio_tune_on) cfio_tune_add(0, cfio_trace_now() - (t)); \
+    }while(0)
+
+/**
+ * @brief: init the tuning by CFIO_TUNE_ENV, and load the tuning file by rank 0,
+ *	it's collective on all procs if CFIO_TUNE_ENV is load or auto
+ *
+ * @param rank: rank of the proc
+ *
+ * @return: error code
+ */
+int cfio_tune_init(int rank);
+/**
+ * @brief: get the ratio of cfio_init, the loaded one is used if the procs are
+ *	enough for it
+ *
+ * @param ratio: ratio passed to cfio_init
+ * @param client_num: amount of clients
+ * @param server_proc_num: amount of procs for servers
+ *
+ * @return: the ratio
+ */
+int cfio_tune_ratio(int ratio, int client_num, int server_proc_num);
+/**
+ * @brief: get the msg size a client begins with
+ *
+ * @param max_size: max msg size the server of the client can receive
+ *
+ * @return: the msg size, not more than max_size
+ */
+size_t cfio_tune_msg_size(size_t max_size);
+/**
+ * @brief: add bytes sent and time blocked, only called if cfio_tune_on
+ *
+ * @param size: bytes sent
+ * @param ns: time blocked, in ns
+ */
+void cfio_tune_add(size_t size, uint64_t ns);
+/**
+ * @brief: end an io epoch of a client, only called if cfio_tune_on
+ *
+ * @return: msg size of the next epoch
+ */
+size_t cfio_tune_epoch();
+/**
+ * @brief: gather the measures of all procs, and write the tuning file by
+ *	rank 0, it's collective on all procs if cfio_tune_on
+ *
+ * @param proc_type: cfio map type of the proc, like CFIO_MAP_TYPE_CLIENT
+ *
+ * @return: error code
+ */
+int cfio_tune_final(int proc_type);
+
+#endif
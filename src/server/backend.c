@@ -0,0 +1,296 @@
+/****************************************************************************
+ *       Filename:  backend.c
+ *
+ *    Description:  select the storage backend at runtime and forward the io
+ *		    operation to it
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "backend.h"
+#include "debug.h"
+#include "define.h"
+#include "cfio_error.h"
+#include "trace.h"
+#include "stats.h"
+#include "transport.h"
+
+/* end a backend call, for stats and trace */
+#define _backend_end(name, t, arg) \
+    do { \
+	cfio_stats_add(backend_num, 1); \
+	cfio_stats_time(backend_time, t); \
+	cfio_trace_end(name, t, arg); \
+    } while(0)
+
+static cfio_backend_t *backend_list[] = 
+{
+    &cfio_backend_pnetcdf,
+    &cfio_backend_null,
+    &cfio_backend_mem,
+    &cfio_backend_posix,
+    &cfio_backend_log,
+    NULL
+};
+
+static cfio_proc_local cfio_backend_t *backend = NULL;
+
+int cfio_backend_init(int server_id)
+{
+    int i, ret;
+    char *name;
+
+    name = getenv(CFIO_BACKEND_ENV);
+    if(NULL == name)
+    {
+#ifdef SVR_NO_IO
+	name = CFIO_BACKEND_NULL;
+#else
+	/* pnetcdf needs the servers to be MPI procs */
+	name = cfio_transport_is_loopback() ? 
+	    CFIO_BACKEND_NULL : CFIO_BACKEND_PNETCDF;
+#endif
+    }
+
+    backend = NULL;
+    for(i = 0; NULL != backend_list[i]; i ++)
+    {
+	if(0 == strcmp(name, backend_list[i]->name))
+	{
+	    backend = backend_list[i];
+	    break;
+	}
+    }
+    if(NULL == backend)
+    {
+	error("unknown backend(%s).", name);
+	return CFIO_ERROR_INVALID_BACKEND;
+    }
+
+    if(NULL != backend->init && (ret = backend->init(server_id)) < 0)
+    {
+	error("init backend(%s) fail.", name);
+	backend = NULL;
+	return ret;
+    }
+
+    debug(DEBUG_IO, "select backend(%s)", name);
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_backend_final()
+{
+    int ret = CFIO_ERROR_NONE;
+
+    if(NULL != backend && NULL != backend->final)
+    {
+	ret = backend->final();
+    }
+    backend = NULL;
+
+    return ret;
+}
+
+cfio_backend_t *cfio_backend_get()
+{
+    return backend;
+}
+
+/**
+ * @brief: get size of the data of a block
+ */
+static size_t _data_size(int ndims, size_t *count, cfio_type xtype)
+{
+    int i;
+    size_t size = 0;
+
+    cfio_types_size(size, xtype);
+    for(i = 0; i < ndims; i ++)
+    {
+	size *= count[i];
+    }
+
+    return size;
+}
+
+int cfio_backend_create(char *path, int cmode, int *nc_id)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+
+    ret = backend->create(path, cmode, nc_id);
+    _backend_end("backend_create", t, 0);
+
+    return ret;
+}
+
+int cfio_backend_def_dim(int nc_id, char *name, size_t len, int *dim_id)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+
+    ret = backend->def_dim(nc_id, name, len, dim_id);
+    _backend_end("backend_def_dim", t, nc_id);
+
+    return ret;
+}
+
+int cfio_backend_def_var(int nc_id, char *name, cfio_type xtype,
+	int ndims, int *dim_ids, int *var_id)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+
+    ret = backend->def_var(nc_id, name, xtype, ndims, dim_ids, var_id);
+    _backend_end("backend_def_var", t, nc_id);
+
+    return ret;
+}
+
+int cfio_backend_put_att(int nc_id, int var_id, char *name, 
+	cfio_type xtype, int len, void *data)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+
+    ret = backend->put_att(nc_id, var_id, name, xtype, len, data);
+    _backend_end("backend_put_att", t, nc_id);
+
+    return ret;
+}
+
+int cfio_backend_enddef(int nc_id)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+
+    ret = backend->enddef(nc_id);
+    _backend_end("backend_enddef", t, nc_id);
+
+    return ret;
+}
+
+int cfio_backend_put_vara(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+
+    ret = backend->put_vara(nc_id, var_id, ndims, start, count, xtype, data);
+    if(ret >= 0)
+    {
+	cfio_stats_add(write_bytes, _data_size(ndims, count, xtype));
+    }
+    _backend_end("backend_put_vara", t, var_id);
+
+    return ret;
+}
+
+int cfio_backend_put_varn(int nc_id, int var_id, int ndims, int num,
+	size_t *start, size_t *count, cfio_type xtype, int be, void *data)
+{
+    int i, ret = CFIO_ERROR_NONE;
+    size_t size, total_size = 0;
+    char *addr = data;
+
+    assert(NULL != backend);
+
+    cfio_stats_begin(t);
+
+    if(!be && NULL != backend->put_varn)
+    {
+	ret = backend->put_varn(nc_id, var_id, ndims, num, 
+		start, count, xtype, data);
+	for(i = 0; i < num; i ++)
+	{
+	    total_size += _data_size(ndims, count + i * ndims, xtype);
+	}
+	goto RETURN;
+    }
+
+    for(i = 0; i < num; i ++)
+    {
+	if(be)
+	{
+	    ret = backend->put_vara_be(nc_id, var_id, ndims, 
+		    start + i * ndims, count + i * ndims, xtype, addr);
+	}else
+	{
+	    ret = backend->put_vara(nc_id, var_id, ndims, 
+		    start + i * ndims, count + i * ndims, xtype, addr);
+	}
+	if(ret < 0)
+	{
+	    return ret;
+	}
+	size = _data_size(ndims, count + i * ndims, xtype);
+	total_size += size;
+	addr += size;
+    }
+
+RETURN:
+    if(ret >= 0)
+    {
+	cfio_stats_add(write_bytes, total_size);
+    }
+    _backend_end("backend_put_varn", t, num);
+
+    return ret;
+}
+
+int cfio_backend_has_put_vara_be()
+{
+    assert(NULL != backend);
+
+    return NULL != backend->put_vara_be;
+}
+
+int cfio_backend_put_vara_be(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+    assert(NULL != backend->put_vara_be);
+
+    ret = backend->put_vara_be(nc_id, var_id, ndims, 
+	    start, count, xtype, data);
+    if(ret >= 0)
+    {
+	cfio_stats_add(write_bytes, _data_size(ndims, count, xtype));
+    }
+    _backend_end("backend_put_vara_be", t, var_id);
+
+    return ret;
+}
+
+int cfio_backend_close(int nc_id)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    assert(NULL != backend);
+
+    ret = backend->close(nc_id);
+    _backend_end("backend_close", t, nc_id);
+
+    return ret;
+}
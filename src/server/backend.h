@@ -0,0 +1,209 @@
+/****************************************************************************
+ *       Filename:  backend.h
+ *
+ *    Description:  storage backend interface used by the server io module,
+ *		    the backend is selected at runtime
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _BACKEND_H
+#define _BACKEND_H
+
+#include <stdlib.h>
+
+#include "cfio_types.h"
+
+/* env variable used to select the backend, e.g. CFIO_BACKEND=null */
+#define CFIO_BACKEND_ENV	"CFIO_BACKEND"
+
+#define CFIO_BACKEND_PNETCDF	"pnetcdf"
+#define CFIO_BACKEND_NULL	"null"
+#define CFIO_BACKEND_MEM	"mem"
+#define CFIO_BACKEND_POSIX	"posix"
+#define CFIO_BACKEND_LOG	"log"
+
+/* max amount of files opened at the same time in null, mem, posix and log 
+ * backend */
+#define CFIO_BACKEND_MAX_FILE	256
+
+typedef struct
+{
+    const char *name;	    /* name of the backend, used to select it */
+
+    int (*init)(int server_id);
+    int (*final)();
+    int (*create)(char *path, int cmode, int *nc_id);
+    int (*def_dim)(int nc_id, char *name, size_t len, int *dim_id);
+    int (*def_var)(int nc_id, char *name, cfio_type xtype,
+	    int ndims, int *dim_ids, int *var_id);
+    int (*put_att)(int nc_id, int var_id, char *name, 
+	    cfio_type xtype, int len, void *data);
+    int (*enddef)(int nc_id);
+    int (*put_vara)(int nc_id, int var_id, int ndims, 
+	    size_t *start, size_t *count, cfio_type xtype, void *data);
+    /* put num rectangles in one request, their data is stored one by one,
+     * NULL if the backend only puts one at a time */
+    int (*put_varn)(int nc_id, int var_id, int ndims, int num,
+	    size_t *start, size_t *count, cfio_type xtype, void *data);
+    /* put data which is already big-endian as in file, so the server swaps
+     * it while merging, NULL if the backend only takes native data */
+    int (*put_vara_be)(int nc_id, int var_id, int ndims, 
+	    size_t *start, size_t *count, cfio_type xtype, void *data);
+    int (*close)(int nc_id);
+}cfio_backend_t;
+
+extern cfio_backend_t cfio_backend_pnetcdf;
+extern cfio_backend_t cfio_backend_null;
+extern cfio_backend_t cfio_backend_mem;
+extern cfio_backend_t cfio_backend_posix;
+extern cfio_backend_t cfio_backend_log;
+
+/**
+ * @brief: select the backend by the env variable CFIO_BACKEND and init it, 
+ *	pnetcdf is selected if the env is not set (null if SVR_NO_IO is defined
+ *	or the servers are over the loopback)
+ *
+ * @param server_id: the rank of the server proc
+ *
+ * @return: error code
+ */
+int cfio_backend_init(int server_id);
+/**
+ * @brief: finalize the selected backend
+ *
+ * @return: error code
+ */
+int cfio_backend_final();
+/**
+ * @brief: get the selected backend
+ *
+ * @return: pointer to the backend
+ */
+cfio_backend_t *cfio_backend_get();
+
+/**
+ * @brief: create a file
+ *
+ * @param path: the file name
+ * @param cmode: the creation mode flag
+ * @param nc_id: pointer to where the file id assigned by backend is to be 
+ *	stored
+ *
+ * @return: error code
+ */
+int cfio_backend_create(char *path, int cmode, int *nc_id);
+/**
+ * @brief: define a dimension
+ *
+ * @param nc_id: the file id
+ * @param name: name of the dimension
+ * @param len: length of the dimension
+ * @param dim_id: pointer to where the dim id is to be stored
+ *
+ * @return: error code
+ */
+int cfio_backend_def_dim(int nc_id, char *name, size_t len, int *dim_id);
+/**
+ * @brief: define a variable
+ *
+ * @param nc_id: the file id
+ * @param name: name of the variable
+ * @param xtype: type of the variable
+ * @param ndims: number of dimensions for the variable
+ * @param dim_ids: vector of ndims dimension ids
+ * @param var_id: pointer to where the var id is to be stored
+ *
+ * @return: error code
+ */
+int cfio_backend_def_var(int nc_id, char *name, cfio_type xtype,
+	int ndims, int *dim_ids, int *var_id);
+/**
+ * @brief: put an attribute
+ *
+ * @param nc_id: the file id
+ * @param var_id: the var id, or NC_GLOBAL for a global attribute
+ * @param name: name of the attribute
+ * @param xtype: type of the attribute
+ * @param len: number of values of the attribute
+ * @param data: pointer to the values
+ *
+ * @return: error code
+ */
+int cfio_backend_put_att(int nc_id, int var_id, char *name, 
+	cfio_type xtype, int len, void *data);
+/**
+ * @brief: leave define mode
+ *
+ * @param nc_id: the file id
+ *
+ * @return: error code
+ */
+int cfio_backend_enddef(int nc_id);
+/**
+ * @brief: write a block of a variable
+ *
+ * @param nc_id: the file id
+ * @param var_id: the var id
+ * @param ndims: number of dimensions for the variable
+ * @param start: start index of the block
+ * @param count: count of the block
+ * @param xtype: type of the data
+ * @param data: pointer to the data
+ *
+ * @return: error code
+ */
+int cfio_backend_put_vara(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data);
+/**
+ * @brief: write rectangles of a variable, the data of the rectangles is 
+ *	stored one by one. if the backend has no put_varn, the rectangles are
+ *	written by put_vara (or put_vara_be) one at a time
+ *
+ * @param nc_id: the file id
+ * @param var_id: the var id
+ * @param ndims: number of dimensions for the variable
+ * @param num: amount of the rectangles
+ * @param start: start of the rectangles, num vectors of ndims
+ * @param count: count of the rectangles, num vectors of ndims
+ * @param xtype: type of the data
+ * @param be: 1 if the data is big-endian, see cfio_backend_put_vara_be
+ * @param data: pointer to the data
+ *
+ * @return: error code
+ */
+int cfio_backend_put_varn(int nc_id, int var_id, int ndims, int num,
+	size_t *start, size_t *count, cfio_type xtype, int be, void *data);
+/**
+ * @brief: whether the selected backend takes big-endian data in put_vara_be
+ *
+ * @return: 1 if it does, else 0
+ */
+int cfio_backend_has_put_vara_be();
+/**
+ * @brief: write a block of a variable, data is in big-endian. only valid if
+ *	cfio_backend_has_put_vara_be
+ *
+ * @param nc_id: the file id
+ * @param var_id: the var id
+ * @param ndims: number of dimensions for the variable
+ * @param start: start index of the block
+ * @param count: count of the block
+ * @param xtype: type of the data
+ * @param data: pointer to the data, in big-endian
+ *
+ * @return: error code
+ */
+int cfio_backend_put_vara_be(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data);
+/**
+ * @brief: close a file
+ *
+ * @param nc_id: the file id
+ *
+ * @return: error code
+ */
+int cfio_backend_close(int nc_id);
+
+#endif
@@ -0,0 +1,424 @@
+/****************************************************************************
+ *       Filename:  backend_log.c
+ *
+ *    Description:  append-only log backend, each server appends every merged
+ *		    block sequentially to its own log file, and writes a
+ *		    fixed-size record index, the netCDF file is produced
+ *		    offline by cfio_log2nc. The format is in backend_log.h
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "backend.h"
+#include "backend_log.h"
+#include "map.h"
+#include "debug.h"
+#include "define.h"
+#include "cfio_error.h"
+
+/* amount of index records buffered before written to the index file */
+#define LOG_INDEX_BUF_NUM   1024
+
+typedef struct
+{
+    int data_fd;	/* fd of the log file, -1 if the slot is not used */
+    int index_fd;	/* fd of the index file */
+    uint64_t offset;	/* current size of the log file */
+    int dim_num;	/* amount of defined dim */
+    int var_num;	/* amount of defined var */
+    int rec_num;	/* amount of buffered index records */
+    cfio_log_rec_t *recs;   /* buffered index records */
+}cfio_log_file_t;
+
+static cfio_proc_local cfio_log_file_t *files;
+static cfio_proc_local int server_index;
+
+static int _write_all(int fd, const void *buf, size_t size)
+{
+    const char *addr = buf;
+    ssize_t ret;
+
+    while(size > 0)
+    {
+	ret = write(fd, addr, size);
+	if(ret < 0)
+	{
+	    if(EINTR == errno)
+	    {
+		continue;
+	    }
+	    error("write error(%s)", strerror(errno));
+	    return CFIO_ERROR_FILE;
+	}
+	addr += ret;
+	size -= ret;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _flush_index(cfio_log_file_t *file)
+{
+    int ret;
+
+    if(0 == file->rec_num)
+    {
+	return CFIO_ERROR_NONE;
+    }
+    ret = _write_all(file->index_fd, file->recs,
+	    sizeof(cfio_log_rec_t) * file->rec_num);
+    file->rec_num = 0;
+
+    return ret;
+}
+
+/**
+ * @brief: get a new index record, the record is zeroed
+ *
+ * @param file: the log file
+ * @param rec: return the record
+ *
+ * @return: error code
+ */
+static int _new_rec(cfio_log_file_t *file, cfio_log_rec_t **rec)
+{
+    int ret;
+
+    if(LOG_INDEX_BUF_NUM == file->rec_num)
+    {
+	if((ret = _flush_index(file)) < 0)
+	{
+	    return ret;
+	}
+    }
+    *rec = &file->recs[file->rec_num ++];
+    memset(*rec, 0, sizeof(cfio_log_rec_t));
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: append payload to the log file, and set offset and size of rec
+ */
+static int _append(cfio_log_file_t *file, cfio_log_rec_t *rec,
+	const void *buf, size_t size)
+{
+    int ret;
+
+    if((ret = _write_all(file->data_fd, buf, size)) < 0)
+    {
+	return ret;
+    }
+    rec->offset = file->offset;
+    rec->size += size;
+    file->offset += size;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _init(int server_id)
+{
+    int i;
+
+    server_index = cfio_map_get_server_index(server_id);
+
+    files = malloc(sizeof(cfio_log_file_t) * CFIO_BACKEND_MAX_FILE);
+    if(NULL == files)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+    {
+	files[i].data_fd = -1;
+	files[i].recs = NULL;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _close(int nc_id);
+
+static int _final()
+{
+    int i;
+
+    if(NULL != files)
+    {
+	for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+	{
+	    if(files[i].data_fd >= 0)
+	    {
+		_close(i);
+	    }
+	}
+	free(files);
+	files = NULL;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _create(char *path, int cmode, int *nc_id)
+{
+    int i, ret;
+    char *_path;
+    cfio_log_file_t *file;
+    cfio_log_head_t head;
+
+    for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+    {
+	if(files[i].data_fd < 0)
+	{
+	    break;
+	}
+    }
+    if(CFIO_BACKEND_MAX_FILE == i)
+    {
+	error("too many opened files.");
+	return CFIO_ERROR_TOO_MANY_FILE;
+    }
+    file = &files[i];
+
+    _path = malloc(strlen(path) + 32);
+    file->recs = malloc(sizeof(cfio_log_rec_t) * LOG_INDEX_BUF_NUM);
+    if(NULL == _path || NULL == file->recs)
+    {
+	error("malloc fail.");
+	ret = CFIO_ERROR_MALLOC;
+	goto RETURN;
+    }
+
+    sprintf(_path, "%s.%s.%d", path, CFIO_LOG_DATA_SUFFIX, server_index);
+    file->data_fd = open(_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(file->data_fd < 0)
+    {
+	error("open %s error(%s)", _path, strerror(errno));
+	ret = CFIO_ERROR_FILE;
+	goto RETURN;
+    }
+    sprintf(_path, "%s.%s.%d", path, CFIO_LOG_INDEX_SUFFIX, server_index);
+    file->index_fd = open(_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(file->index_fd < 0)
+    {
+	error("open %s error(%s)", _path, strerror(errno));
+	close(file->data_fd);
+	file->data_fd = -1;
+	ret = CFIO_ERROR_FILE;
+	goto RETURN;
+    }
+
+    memset(&head, 0, sizeof(cfio_log_head_t));
+    head.magic = CFIO_LOG_MAGIC;
+    head.version = CFIO_LOG_VERSION;
+    head.server_index = server_index;
+    head.rec_size = sizeof(cfio_log_rec_t);
+    head.cmode = cmode;
+    if((ret = _write_all(file->index_fd, &head, sizeof(head))) < 0)
+    {
+	close(file->index_fd);
+	close(file->data_fd);
+	file->data_fd = -1;
+	goto RETURN;
+    }
+
+    file->offset = 0;
+    file->dim_num = 0;
+    file->var_num = 0;
+    file->rec_num = 0;
+    *nc_id = i;
+
+    debug(DEBUG_IO, "create log file(%s) : %d", path, i);
+    ret = CFIO_ERROR_NONE;
+
+RETURN:
+    if(NULL != _path)
+    {
+	free(_path);
+	_path = NULL;
+    }
+    if(ret < 0 && NULL != file->recs)
+    {
+	free(file->recs);
+	file->recs = NULL;
+    }
+    return ret;
+}
+
+static int _def_dim(int nc_id, char *name, size_t len, int *dim_id)
+{
+    int ret;
+    cfio_log_file_t *file = &files[nc_id];
+    cfio_log_rec_t *rec;
+
+    assert(file->data_fd >= 0);
+
+    if((ret = _new_rec(file, &rec)) < 0)
+    {
+	return ret;
+    }
+    rec->type = CFIO_LOG_REC_DIM;
+    rec->id = file->dim_num;
+    rec->start[0] = len;
+    if((ret = _append(file, rec, name, strlen(name) + 1)) < 0)
+    {
+	return ret;
+    }
+
+    *dim_id = file->dim_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_var(int nc_id, char *name, cfio_type xtype,
+	int ndims, int *dim_ids, int *var_id)
+{
+    int i, ret;
+    cfio_log_file_t *file = &files[nc_id];
+    cfio_log_rec_t *rec;
+
+    assert(file->data_fd >= 0);
+
+    if(ndims > CFIO_LOG_MAX_DIMS)
+    {
+	error("var(%s) has too many dims(%d).", name, ndims);
+	return CFIO_ERROR_WRONG_NDIMS;
+    }
+
+    if((ret = _new_rec(file, &rec)) < 0)
+    {
+	return ret;
+    }
+    rec->type = CFIO_LOG_REC_VAR;
+    rec->id = file->var_num;
+    rec->xtype = xtype;
+    rec->ndims = ndims;
+    for(i = 0; i < ndims; i ++)
+    {
+	rec->start[i] = dim_ids[i];
+    }
+    if((ret = _append(file, rec, name, strlen(name) + 1)) < 0)
+    {
+	return ret;
+    }
+
+    *var_id = file->var_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_att(int nc_id, int var_id, char *name,
+	cfio_type xtype, int len, void *data)
+{
+    int ret;
+    size_t ele_size = 0;
+    uint64_t offset;
+    cfio_log_file_t *file = &files[nc_id];
+    cfio_log_rec_t *rec;
+
+    assert(file->data_fd >= 0);
+
+    if((ret = _new_rec(file, &rec)) < 0)
+    {
+	return ret;
+    }
+    rec->type = CFIO_LOG_REC_ATT;
+    rec->id = var_id;
+    rec->xtype = xtype;
+    rec->ndims = len;
+    cfio_types_size(ele_size, xtype);
+    if((ret = _append(file, rec, name, strlen(name) + 1)) < 0)
+    {
+	return ret;
+    }
+    offset = rec->offset;
+    if((ret = _append(file, rec, data, ele_size * len)) < 0)
+    {
+	return ret;
+    }
+    rec->offset = offset;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _enddef(int nc_id)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_vara(int nc_id, int var_id, int ndims,
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    int i, ret;
+    size_t data_size, ele_size = 0;
+    cfio_log_file_t *file = &files[nc_id];
+    cfio_log_rec_t *rec;
+
+    assert(file->data_fd >= 0);
+    assert(ndims <= CFIO_LOG_MAX_DIMS);
+
+    if((ret = _new_rec(file, &rec)) < 0)
+    {
+	return ret;
+    }
+    rec->type = CFIO_LOG_REC_DATA;
+    rec->id = var_id;
+    rec->xtype = xtype;
+    rec->ndims = ndims;
+
+    cfio_types_size(ele_size, xtype);
+    data_size = ele_size;
+    for(i = 0; i < ndims; i ++)
+    {
+	rec->start[i] = start[i];
+	rec->count[i] = count[i];
+	data_size *= count[i];
+    }
+
+    return _append(file, rec, data, data_size);
+}
+
+static int _close(int nc_id)
+{
+    int ret;
+    cfio_log_file_t *file = &files[nc_id];
+
+    assert(file->data_fd >= 0);
+
+    ret = _flush_index(file);
+
+    if(close(file->index_fd) < 0 || close(file->data_fd) < 0)
+    {
+	error("close file(%d) error(%s)", nc_id, strerror(errno));
+	ret = CFIO_ERROR_FILE;
+    }
+    file->data_fd = -1;
+    free(file->recs);
+    file->recs = NULL;
+
+    return ret;
+}
+
+cfio_backend_t cfio_backend_log =
+{
+    .name	= CFIO_BACKEND_LOG,
+    .init	= _init,
+    .final	= _final,
+    .create	= _create,
+    .def_dim	= _def_dim,
+    .def_var	= _def_var,
+    .put_att	= _put_att,
+    .enddef	= _enddef,
+    .put_vara	= _put_vara,
+    .close	= _close,
+};
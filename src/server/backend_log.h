@@ -0,0 +1,71 @@
+/****************************************************************************
+ *       Filename:  backend_log.h
+ *
+ *    Description:  on-disk format of the append-only log backend, shared by
+ *		    the server and the offline converter (cfio_log2nc)
+ *
+ *		    For every file created by the client, each server writes
+ *		    two files :
+ *		    path.log.server_index : payload, appended sequentially
+ *		    path.idx.server_index : cfio_log_head_t followed by
+ *			fixed-size cfio_log_rec_t, which can be mmaped and
+ *			walked as an array
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _BACKEND_LOG_H
+#define _BACKEND_LOG_H
+
+#include <stdint.h>
+
+#define CFIO_LOG_MAGIC		0x474c4643  /* "CFLG" */
+#define CFIO_LOG_VERSION	1
+
+#define CFIO_LOG_DATA_SUFFIX	"log"
+#define CFIO_LOG_INDEX_SUFFIX	"idx"
+
+/* max ndims of a var which can be stored in the log */
+#define CFIO_LOG_MAX_DIMS	8
+
+/* type of the index record */
+#define CFIO_LOG_REC_DIM	1   /* payload : name */
+#define CFIO_LOG_REC_VAR	2   /* payload : name */
+#define CFIO_LOG_REC_ATT	3   /* payload : name, data */
+#define CFIO_LOG_REC_DATA	4   /* payload : merged data block */
+
+typedef struct
+{
+    uint32_t magic;	    /* CFIO_LOG_MAGIC */
+    uint32_t version;	    /* CFIO_LOG_VERSION */
+    uint32_t server_index;  /* index of the server which write the log */
+    uint32_t rec_size;	    /* sizeof(cfio_log_rec_t) */
+    int32_t cmode;	    /* cmode passed to create */
+    uint32_t reserved;
+}cfio_log_head_t;
+
+/**
+ * meaning of the fields for each record type:
+ *
+ *	    id	    xtype   ndims   start	count
+ * DIM	    dim_id  -	    -	    [0]:len	-
+ * VAR	    var_id  type    ndims   dim_ids	-
+ * ATT	    var_id  type    len	    -		-
+ * DATA	    var_id  type    ndims   start	count
+ *
+ * the name in payload is '\0' terminated, the att data follows the name
+ **/
+typedef struct
+{
+    uint32_t type;	    /* CFIO_LOG_REC_* */
+    int32_t id;
+    int32_t xtype;	    /* cfio_type */
+    int32_t ndims;
+    uint64_t offset;	    /* offset of the payload in the log file */
+    uint64_t size;	    /* size of the payload */
+    uint64_t start[CFIO_LOG_MAX_DIMS];
+    uint64_t count[CFIO_LOG_MAX_DIMS];
+}cfio_log_rec_t;
+
+#endif
@@ -0,0 +1,186 @@
+/****************************************************************************
+ *       Filename:  backend_mem.c
+ *
+ *    Description:  in-memory backend, variable data is copied into a memory 
+ *		    buffer of the file and dropped when the file is closed
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <string.h>
+#include <assert.h>
+
+#include "backend.h"
+#include "debug.h"
+#include "define.h"
+#include "cfio_error.h"
+
+#define MEM_INIT_SIZE ((size_t)1024*1024)
+
+typedef struct
+{
+    int used;		/* whether the slot is used by an opened file */
+    char *data;		/* the memory buffer */
+    size_t size;	/* used size of the buffer */
+    size_t capacity;	/* space size of the buffer */
+    int dim_num;	/* amount of defined dim */
+    int var_num;	/* amount of defined var */
+}cfio_mem_file_t;
+
+static cfio_proc_local cfio_mem_file_t *files;
+
+static int _init(int server_id)
+{
+    files = malloc(sizeof(cfio_mem_file_t) * CFIO_BACKEND_MAX_FILE);
+    if(NULL == files)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    memset(files, 0, sizeof(cfio_mem_file_t) * CFIO_BACKEND_MAX_FILE);
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _final()
+{
+    int i;
+
+    if(NULL != files)
+    {
+	for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+	{
+	    if(NULL != files[i].data)
+	    {
+		free(files[i].data);
+	    }
+	}
+	free(files);
+	files = NULL;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _create(char *path, int cmode, int *nc_id)
+{
+    int i;
+
+    for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+    {
+	if(!files[i].used)
+	{
+	    memset(&files[i], 0, sizeof(cfio_mem_file_t));
+	    files[i].used = 1;
+	    *nc_id = i;
+	    debug(DEBUG_IO, "create mem file(%s) : %d", path, i);
+	    return CFIO_ERROR_NONE;
+	}
+    }
+
+    error("too many opened files.");
+    return CFIO_ERROR_TOO_MANY_FILE;
+}
+
+static int _def_dim(int nc_id, char *name, size_t len, int *dim_id)
+{
+    assert(files[nc_id].used);
+
+    *dim_id = files[nc_id].dim_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_var(int nc_id, char *name, cfio_type xtype,
+	int ndims, int *dim_ids, int *var_id)
+{
+    assert(files[nc_id].used);
+
+    *var_id = files[nc_id].var_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_att(int nc_id, int var_id, char *name, 
+	cfio_type xtype, int len, void *data)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _enddef(int nc_id)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_vara(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    int i;
+    size_t data_size, ele_size = 0, capacity;
+    cfio_mem_file_t *file = &files[nc_id];
+    char *addr;
+
+    assert(file->used);
+
+    cfio_types_size(ele_size, xtype);
+    data_size = ele_size;
+    for(i = 0; i < ndims; i ++)
+    {
+	data_size *= count[i];
+    }
+
+    if(file->size + data_size > file->capacity)
+    {
+	capacity = file->capacity == 0 ? MEM_INIT_SIZE : file->capacity;
+	while(file->size + data_size > capacity)
+	{
+	    capacity *= 2;
+	}
+	addr = realloc(file->data, capacity);
+	if(NULL == addr)
+	{
+	    error("realloc fail.");
+	    return CFIO_ERROR_MALLOC;
+	}
+	file->data = addr;
+	file->capacity = capacity;
+    }
+
+    memcpy(file->data + file->size, data, data_size);
+    file->size += data_size;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _close(int nc_id)
+{
+    cfio_mem_file_t *file = &files[nc_id];
+
+    assert(file->used);
+
+    debug(DEBUG_IO, "close mem file(%d), size = %lu", nc_id, file->size);
+
+    if(NULL != file->data)
+    {
+	free(file->data);
+	file->data = NULL;
+    }
+    file->used = 0;
+
+    return CFIO_ERROR_NONE;
+}
+
+cfio_backend_t cfio_backend_mem = 
+{
+    .name	= CFIO_BACKEND_MEM,
+    .init	= _init,
+    .final	= _final,
+    .create	= _create,
+    .def_dim	= _def_dim,
+    .def_var	= _def_var,
+    .put_att	= _put_att,
+    .enddef	= _enddef,
+    .put_vara	= _put_vara,
+    .close	= _close,
+};
@@ -0,0 +1,83 @@
+/****************************************************************************
+ *       Filename:  backend_null.c
+ *
+ *    Description:  null backend, all io operations are dropped, used to 
+ *		    measure the transport alone
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include "backend.h"
+#include "debug.h"
+#include "define.h"
+#include "cfio_error.h"
+
+static cfio_proc_local int nc_num;
+static cfio_proc_local int id_num;
+
+static int _init(int server_id)
+{
+    nc_num = 0;
+    id_num = 0;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _create(char *path, int cmode, int *nc_id)
+{
+    *nc_id = nc_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_dim(int nc_id, char *name, size_t len, int *dim_id)
+{
+    *dim_id = id_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_var(int nc_id, char *name, cfio_type xtype,
+	int ndims, int *dim_ids, int *var_id)
+{
+    *var_id = id_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_att(int nc_id, int var_id, char *name, 
+	cfio_type xtype, int len, void *data)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _enddef(int nc_id)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_vara(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _close(int nc_id)
+{
+    return CFIO_ERROR_NONE;
+}
+
+cfio_backend_t cfio_backend_null = 
+{
+    .name	= CFIO_BACKEND_NULL,
+    .init	= _init,
+    .final	= NULL,
+    .create	= _create,
+    .def_dim	= _def_dim,
+    .def_var	= _def_var,
+    .put_att	= _put_att,
+    .enddef	= _enddef,
+    .put_vara	= _put_vara,
+    .close	= _close,
+};
@@ -0,0 +1,325 @@
+/****************************************************************************
+ *       Filename:  backend_pnetcdf.c
+ *
+ *    Description:  pnetcdf backend, all servers write one shared nc file with
+ *		    collective operations
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <pnetcdf.h>
+#include <assert.h>
+
+#include "mpi.h"
+
+#include "backend.h"
+#include "map.h"
+#include "debug.h"
+#include "cfio_types.h"
+#include "cfio_error.h"
+
+static int _init(int server_id)
+{
+    /* the servers over the loopback are threads which have no comm */
+    if(MPI_COMM_NULL == cfio_map_get_server_comm())
+    {
+	error("pnetcdf backend needs the servers to be MPI procs.");
+	return CFIO_ERROR_INVALID_BACKEND;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _create(char *path, int cmode, int *nc_id)
+{
+    int ret;
+    MPI_Info info;
+
+    /**
+     * pnetcdf has no way to put data which is already big-endian, instead let 
+     * it swap the merged data in place rather than into another buffer, the
+     * merged data is freed after put, so it's safe to be modified
+     **/
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "nc_in_place_swap", "enable");
+    ret = ncmpi_create(cfio_map_get_server_comm(), path, cmode, 
+	    info, nc_id);
+    MPI_Info_free(&info);
+    if(ret != NC_NOERR)
+    {
+	error("Error happened when open %s error(%s)", 
+		path, ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_dim(int nc_id, char *name, size_t len, int *dim_id)
+{
+    int ret;
+
+    ret = ncmpi_def_dim(nc_id, name, len, dim_id);
+    if(ret != NC_NOERR)
+    {
+	error("def dim(%s) error(%s)", name, ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_var(int nc_id, char *name, cfio_type xtype,
+	int ndims, int *dim_ids, int *var_id)
+{
+    int ret;
+
+    ret = ncmpi_def_var(nc_id, name, cfio_type_to_nc(xtype), ndims, 
+	    dim_ids, var_id);
+    if(ret != NC_NOERR)
+    {
+	error("def var(%s) error(%s)", name, ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_att(int nc_id, int var_id, char *name, 
+	cfio_type xtype, int len, void *data)
+{
+    int ret;
+    nc_type type = cfio_type_to_nc(xtype);
+
+    switch(xtype)
+    {
+	case CFIO_BYTE :
+	    ret = ncmpi_put_att_schar(nc_id, var_id, name, type, len, 
+		    (const signed char *)data);
+	    break;
+	case CFIO_CHAR :
+	    ret = ncmpi_put_att_text(nc_id, var_id, name, len, 
+		    (const char *)data);
+	    break;
+	case CFIO_SHORT :
+	    ret = ncmpi_put_att_short(nc_id, var_id, name, type, len, 
+		    (const short *)data);
+	    break;
+	case CFIO_INT :
+	    ret = ncmpi_put_att_int(nc_id, var_id, name, type, len, 
+		    (const int *)data);
+	    break;
+	case CFIO_FLOAT :
+	    ret = ncmpi_put_att_float(nc_id, var_id, name, type, len, 
+		    (const float *)data);
+	    break;
+	case CFIO_DOUBLE :
+	    ret = ncmpi_put_att_double(nc_id, var_id, name, type, len, 
+		    (const double *)data);
+	    break;
+	default :
+	    error("unknown att type(%d)", xtype);
+	    return CFIO_ERROR_NC;
+    }
+    if(ret != NC_NOERR)
+    {
+	error("put att(%s) error(%s)", name, ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _enddef(int nc_id)
+{
+    int ret;
+
+    ret = ncmpi_enddef(nc_id);
+    if(ret != NC_NOERR)
+    {
+	error("enddef error(%s)", ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_vara(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    int i, ret;
+    MPI_Offset *pnc_start, *pnc_count;
+
+    pnc_start = malloc(sizeof(MPI_Offset) * ndims);
+    pnc_count = malloc(sizeof(MPI_Offset) * ndims);
+    if(NULL == pnc_start || NULL == pnc_count)
+    {
+	free(pnc_start);
+	free(pnc_count);
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    for(i = 0; i < ndims; i ++)
+    {
+	pnc_start[i] = start[i];
+	pnc_count[i] = count[i];
+	debug(DEBUG_IO, "dim %d: start(%lld), count(%lld)", 
+		i, pnc_start[i], pnc_count[i]);
+    }
+
+    switch(xtype)
+    {
+	case CFIO_BYTE :
+	    ret = ncmpi_put_vara_schar_all(nc_id, var_id, 
+		    pnc_start, pnc_count, (signed char *)data);
+	    break;
+	case CFIO_CHAR :
+	    ret = ncmpi_put_vara_text_all(nc_id, var_id, 
+		    pnc_start, pnc_count, (char *)data);
+	    break;
+	case CFIO_SHORT :
+	    ret = ncmpi_put_vara_short_all(nc_id, var_id, 
+		    pnc_start, pnc_count, (short *)data);
+	    break;
+	case CFIO_INT :
+	    ret = ncmpi_put_vara_int_all(nc_id, var_id, 
+		    pnc_start, pnc_count, (int *)data);
+	    break;
+	case CFIO_FLOAT :
+	    ret = ncmpi_put_vara_float_all(nc_id, var_id, 
+		    pnc_start, pnc_count, (float *)data);
+	    break;
+	case CFIO_DOUBLE :
+	    ret = ncmpi_put_vara_double_all(nc_id, var_id, 
+		    pnc_start, pnc_count, (double *)data);
+	    break;
+	default :
+	    free(pnc_start);
+	    free(pnc_count);
+	    error("unknown var type(%d)", xtype);
+	    return CFIO_ERROR_NC;
+    }
+
+    free(pnc_start);
+    free(pnc_count);
+
+    if(ret != NC_NOERR)
+    {
+	error("write nc(%d) var (%d) failure(%s)",
+		nc_id, var_id, ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_varn(int nc_id, int var_id, int ndims, int num,
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    int i, j, ret;
+    MPI_Offset *pnc_start, *pnc_count, **starts, **counts;
+    MPI_Offset data_len, len;
+    MPI_Datatype buftype;
+
+    switch(xtype)
+    {
+	case CFIO_BYTE :
+	    buftype = MPI_SIGNED_CHAR;
+	    break;
+	case CFIO_CHAR :
+	    buftype = MPI_CHAR;
+	    break;
+	case CFIO_SHORT :
+	    buftype = MPI_SHORT;
+	    break;
+	case CFIO_INT :
+	    buftype = MPI_INT;
+	    break;
+	case CFIO_FLOAT :
+	    buftype = MPI_FLOAT;
+	    break;
+	case CFIO_DOUBLE :
+	    buftype = MPI_DOUBLE;
+	    break;
+	default :
+	    error("unknown var type(%d)", xtype);
+	    return CFIO_ERROR_NC;
+    }
+
+    /* num may be 0, still join the collective put */
+    pnc_start = malloc(sizeof(MPI_Offset) * (ndims * num + 1));
+    pnc_count = malloc(sizeof(MPI_Offset) * (ndims * num + 1));
+    starts = malloc(sizeof(MPI_Offset *) * (num + 1));
+    counts = malloc(sizeof(MPI_Offset *) * (num + 1));
+    if(NULL == pnc_start || NULL == pnc_count || 
+	    NULL == starts || NULL == counts)
+    {
+	free(pnc_start);
+	free(pnc_count);
+	free(starts);
+	free(counts);
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    data_len = 0;
+    for(i = 0; i < num; i ++)
+    {
+	starts[i] = pnc_start + i * ndims;
+	counts[i] = pnc_count + i * ndims;
+	len = 1;
+	for(j = 0; j < ndims; j ++)
+	{
+	    starts[i][j] = start[i * ndims + j];
+	    counts[i][j] = count[i * ndims + j];
+	    len *= counts[i][j];
+	}
+	data_len += len;
+    }
+
+    ret = ncmpi_put_varn_all(nc_id, var_id, num, starts, counts, 
+	    data, data_len, buftype);
+
+    free(pnc_start);
+    free(pnc_count);
+    free(starts);
+    free(counts);
+
+    if(ret != NC_NOERR)
+    {
+	error("write nc(%d) var (%d) failure(%s)",
+		nc_id, var_id, ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _close(int nc_id)
+{
+    int ret;
+
+    ret = ncmpi_close(nc_id);
+    if(ret != NC_NOERR)
+    {
+	error("close nc(%d) file failure,%s", nc_id, ncmpi_strerror(ret));
+	return CFIO_ERROR_NC;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+cfio_backend_t cfio_backend_pnetcdf = 
+{
+    .name	= CFIO_BACKEND_PNETCDF,
+    .init	= _init,
+    .final	= NULL,
+    .create	= _create,
+    .def_dim	= _def_dim,
+    .def_var	= _def_var,
+    .put_att	= _put_att,
+    .enddef	= _enddef,
+    .put_vara	= _put_vara,
+    .put_varn	= _put_varn,
+    .close	= _close,
+};
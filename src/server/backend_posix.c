@@ -0,0 +1,216 @@
+/****************************************************************************
+ *       Filename:  backend_posix.c
+ *
+ *    Description:  posix raw-file backend, each server writes the raw data of
+ *		    every put var request into its own file, no metadata is 
+ *		    stored
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+
+#include "backend.h"
+#include "map.h"
+#include "debug.h"
+#include "define.h"
+#include "cfio_error.h"
+
+typedef struct
+{
+    int fd;		/* posix file descriptor, -1 if the slot is not used */
+    int dim_num;	/* amount of defined dim */
+    int var_num;	/* amount of defined var */
+}cfio_posix_file_t;
+
+static cfio_proc_local cfio_posix_file_t *files;
+static cfio_proc_local int server_index;
+
+static int _init(int server_id)
+{
+    int i;
+
+    server_index = cfio_map_get_server_index(server_id);
+
+    files = malloc(sizeof(cfio_posix_file_t) * CFIO_BACKEND_MAX_FILE);
+    if(NULL == files)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+    {
+	files[i].fd = -1;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _final()
+{
+    int i;
+
+    if(NULL != files)
+    {
+	for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+	{
+	    if(files[i].fd >= 0)
+	    {
+		close(files[i].fd);
+	    }
+	}
+	free(files);
+	files = NULL;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _create(char *path, int cmode, int *nc_id)
+{
+    int i;
+    char *_path;
+
+    for(i = 0; i < CFIO_BACKEND_MAX_FILE; i ++)
+    {
+	if(files[i].fd < 0)
+	{
+	    break;
+	}
+    }
+    if(CFIO_BACKEND_MAX_FILE == i)
+    {
+	error("too many opened files.");
+	return CFIO_ERROR_TOO_MANY_FILE;
+    }
+
+    /* each server writes its own file : path.server_index */
+    _path = malloc(strlen(path) + 32);
+    if(NULL == _path)
+    {
+	error("malloc fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    sprintf(_path, "%s.%d", path, server_index);
+
+    files[i].fd = open(_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(files[i].fd < 0)
+    {
+	error("open %s error(%s)", _path, strerror(errno));
+	free(_path);
+	return CFIO_ERROR_FILE;
+    }
+    files[i].dim_num = 0;
+    files[i].var_num = 0;
+    *nc_id = i;
+
+    debug(DEBUG_IO, "create posix file(%s) : %d", _path, i);
+    free(_path);
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_dim(int nc_id, char *name, size_t len, int *dim_id)
+{
+    assert(files[nc_id].fd >= 0);
+
+    *dim_id = files[nc_id].dim_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _def_var(int nc_id, char *name, cfio_type xtype,
+	int ndims, int *dim_ids, int *var_id)
+{
+    assert(files[nc_id].fd >= 0);
+
+    *var_id = files[nc_id].var_num ++;
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_att(int nc_id, int var_id, char *name, 
+	cfio_type xtype, int len, void *data)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _enddef(int nc_id)
+{
+    return CFIO_ERROR_NONE;
+}
+
+static int _put_vara(int nc_id, int var_id, int ndims, 
+	size_t *start, size_t *count, cfio_type xtype, void *data)
+{
+    int i;
+    size_t data_size, ele_size = 0;
+    ssize_t ret;
+    char *addr = data;
+
+    assert(files[nc_id].fd >= 0);
+
+    cfio_types_size(ele_size, xtype);
+    data_size = ele_size;
+    for(i = 0; i < ndims; i ++)
+    {
+	data_size *= count[i];
+    }
+
+    while(data_size > 0)
+    {
+	ret = write(files[nc_id].fd, addr, data_size);
+	if(ret < 0)
+	{
+	    if(EINTR == errno)
+	    {
+		continue;
+	    }
+	    error("write file(%d) error(%s)", nc_id, strerror(errno));
+	    return CFIO_ERROR_FILE;
+	}
+	addr += ret;
+	data_size -= ret;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static int _close(int nc_id)
+{
+    assert(files[nc_id].fd >= 0);
+
+    if(close(files[nc_id].fd) < 0)
+    {
+	error("close file(%d) error(%s)", nc_id, strerror(errno));
+	files[nc_id].fd = -1;
+	return CFIO_ERROR_FILE;
+    }
+    files[nc_id].fd = -1;
+
+    return CFIO_ERROR_NONE;
+}
+
+cfio_backend_t cfio_backend_posix = 
+{
+    .name	= CFIO_BACKEND_POSIX,
+    .init	= _init,
+    .final	= _final,
+    .create	= _create,
+    .def_dim	= _def_dim,
+    .def_var	= _def_var,
+    .put_att	= _put_att,
+    .enddef	= _enddef,
+    .put_vara	= _put_vara,
+    /* raw data is written as it's given, take big-endian so that the data 
+     * is the same as in a netCDF file */
+    .put_vara_be = _put_vara,
+    .close	= _close,
+};
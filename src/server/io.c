@@ -23,7 +23,9 @@
 #include "mpi.h"
 
 #include "io.h"
+#include "recv.h"
 #include "id.h"
+#include "backend.h"
 #include "msg.h"
 #include "buffer.h"
 #include "debug.h"
@@ -31,11 +33,17 @@
 #include "cfio_types.h"
 #include "cfio_error.h"
 #include "map.h"
+#include "bitmap.h"
+#include "merge.h"
+#include "convert.h"
 #include "define.h"
 #include "times.h"
+#include "trace.h"
+#include "stats.h"
+#include "latency.h"
 
-static struct qhash_table *io_table;
-static int server_id;
+static cfio_proc_local struct qhash_table *io_table;
+static cfio_proc_local int server_id;
 //static double start_time;
 //static int file_num = 0;
 //static double write_time = 0.0;
@@ -88,18 +96,10 @@ static void _free(cfio_io_val_t *val)
  */
 static inline void _add_bitmap(uint8_t *bitmap, int client_id)
 {
-    int i, j;
-    int client_index;
-
     assert(client_id < cfio_map_get_client_amount());
     assert(bitmap != NULL);
     
-    client_index = cfio_map_get_client_index_of_server(client_id);
-
-    i = client_index >> 3;
-    j = client_index - (i << 3);
-
-    bitmap[i] |= (1 << j);
+    cfio_bitmap_set(bitmap, cfio_map_get_client_index_of_server(client_id));
 }
 
 /**
@@ -112,29 +112,8 @@ static inline void _add_bitmap(uint8_t *bitmap, int client_id)
  */
 static inline int _bitmap_full(uint8_t *bitmap)
 {
-    int is_full;
-    int i;
-    int head, tail;
-    int client_num;
-    
-    client_num = cfio_map_get_client_num_of_server(server_id);
-    head = client_num >> 3;
-    tail = client_num - (head << 3);
-
-    for(i = 0; i < head; i ++)
-    {
-	if(bitmap[i] != 255)
-	{
-	    return 0;
-	}
-    }
-    
-    if(bitmap[head] != ((1 << tail) - 1))
-    {
-	return 0;
-    }
-
-    return 1;
+    return cfio_bitmap_full(bitmap, 
+	    cfio_map_get_client_num_of_server(server_id));
 }
 
 /**
@@ -160,7 +139,7 @@ static inline int _recv_client_io(
     cfio_io_key_t key;
     cfio_io_val_t *val;
     qlist_head_t *link;
-    int client_num;
+    int client_num, client_index;
 
     key.func_code = func_code;
     key.client_nc_id = client_nc_id;
@@ -174,14 +153,20 @@ static inline int _recv_client_io(
 	val = malloc(sizeof(cfio_io_val_t));
 
 	memcpy(val, &key, sizeof(cfio_io_key_t));
-	val->client_bitmap = malloc((client_num >> 3) + 1);
-	memset(val->client_bitmap, 0, (client_num >> 3) + 1);
+	val->client_bitmap = malloc(cfio_bitmap_size(client_num));
+	memset(val->client_bitmap, 0, cfio_bitmap_size(client_num));
+	val->recv_num = 0;
 	qhash_add(io_table, &key, &(val->hash_link));
 
     }else
     {
 	val = qlist_entry(link, cfio_io_val_t, hash_link);
     }
+    client_index = cfio_map_get_client_index_of_server(client_id);
+    if(!cfio_bitmap_get(val->client_bitmap, client_index))
+    {
+	val->recv_num ++;
+    }
     _add_bitmap(val->client_bitmap, 
 	    client_id);
     *io_info = val;
@@ -214,293 +199,112 @@ static inline int _remove_client_io(
     return CFIO_ERROR_NONE;
 }
 
-static void _inc_src_index(
-	const int ndims, const size_t ele_size, 
-	const size_t *dst_dims_len, char **dst_addr, 
-	const size_t *src_dims_len, size_t *src_index)
+static inline int _handle_def_dim(cfio_id_nc_t *nc, cfio_id_dim_t *dim)
 {
-    int dim;
-    size_t sub_size, last_sub_size;
-
-    dim = ndims - 1;
-    src_index[dim] ++;
+    int ret;
 
-    sub_size = ele_size;
-    while(src_index[dim] >= src_dims_len[dim])
+    assert(nc->nc_id != CFIO_ID_NC_INVALID);
+    dim->nc_id = nc->nc_id;
+    debug(DEBUG_IO, "dim_len = %d", dim->dim_len);
+    if((ret = cfio_backend_def_dim(nc->nc_id, dim->name, 
+		    dim->global_dim_len, &dim->dim_id)) < 0)
     {
-	*dst_addr -= (src_dims_len[dim] - 1) * sub_size;
-	src_index[dim] = 0;
-	sub_size *= dst_dims_len[dim];
-	dim --;
-	src_index[dim] ++;
+	error("def dim(%s) error.", dim->name);
+	return ret;
     }
-
-    *dst_addr += sub_size;
+    return CFIO_ERROR_NONE;
 }
 
-/**
- * @brief: put the src data array into the dst data array, src and dst both are
- *	sub-array of a total data array
- *
- * @param ndims: number of dimensions for the variable
- * @param ele_size: size of each element in the variable array
- * @param dst_start: start index of the dst data array
- * @param dst_count: count of teh dst data array
- * @param dst_data: pointer to the dst data array
- * @param src_start: start index of the src data array
- * @param src_count: count of teh src data array
- * @param src_data: pointer to the src data array
- */
-static int _put_var(
-	int ndims, size_t ele_size,
-	size_t *dst_start, size_t *dst_count, char *dst_data, 
-	size_t *src_start, size_t *src_count, char *src_data)
+static inline int _handle_def_var(cfio_id_file_t *file, cfio_id_var_t *var)
 {
-    int i;
-    size_t src_len;
-    size_t dst_offset, sub_size;
-    size_t *src_index;
-
-    //float *_data = src_data;
-    //for(i = 0; i < 4; i ++)
-    //{
-    //    printf("%f, ", _data[i]);
-    //}
-    //printf("\n");
-
-    assert(NULL != dst_start);
-    assert(NULL != dst_count);
-    assert(NULL != dst_data);
-    assert(NULL != src_start);
-    assert(NULL != src_count);
-    assert(NULL != src_data);
-
-    src_len = 1;
-    for(i = 0; i < ndims; i ++)
-    {
-	src_len *= src_count[i];
-    }
+    int ret, i;
+    cfio_id_att_t *att;
 
-    src_index = malloc(sizeof(size_t) * ndims);
-    if(NULL == src_index)
-    {
-	error("malloc for src_index fail.");
-	return CFIO_ERROR_MALLOC;
-    }
-    for(i = 0; i < ndims; i ++)
+    for(i = 0; i < var->ndims; i ++)
     {
-	src_index[i] = 0;
+	var->dim_ids[i] = file->dims[var->dim_ids[i]]->dim_id;
     }
-
-    sub_size = 1;
-    dst_offset = 0;
-    for(i = ndims - 1; i >= 0; i --)
+    var->nc_id = file->nc.nc_id;
+    debug(DEBUG_IO, "Def var : cfio_type(%d), nc_type(%d)", 
+	    var->data_type, cfio_type_to_nc(var->data_type));
+    if((ret = cfio_backend_def_var(var->nc_id, var->name, var->data_type,
+		    var->ndims, var->dim_ids, &var->var_id)) < 0)
     {
-	dst_offset += (src_start[i] - dst_start[i]) * sub_size;
-	sub_size *= dst_count[i];
+	error("def var(%s) error.", var->name);
+	return ret;
     }
-    //debug(DEBUG_ID, "dst_offset = %d", dst_offset);
-    dst_data += ele_size * dst_offset;
-
-    for(i = 0; i < src_len - 1; i ++)
+    qlist_for_each_entry(att, var->att_head, link)
     {
-	memcpy(dst_data, src_data, ele_size);
-	_inc_src_index(ndims, ele_size, dst_count, &dst_data, 
-		src_count, src_index);
-	src_data += ele_size;
+	if((ret = cfio_backend_put_att(var->nc_id, var->var_id, att->name,
+			att->xtype, att->len, att->data)) < 0)
+	{
+	    error("put var(%s) attr(%s) error.", var->name, att->name);
+	    return ret;
+	}
     }
-    memcpy(dst_data, src_data, ele_size);
 
     return CFIO_ERROR_NONE;
 }
-
-
-static inline int _handle_def(cfio_id_val_t *val)
+/**
+ * @brief: define all dims, vars and atts of a file in define mode, and end the
+ *	define mode
+ */
+static int _handle_def_file(cfio_id_file_t *file)
 {
     int ret, i;
-    cfio_id_nc_t *nc;
-    cfio_id_dim_t *dim;
-    cfio_id_var_t *var;
+    cfio_id_nc_t *nc = &file->nc;
     cfio_id_att_t *att;
-    size_t data_size, ele_size;
-    int *start;
-
-    if(NULL != val->dim)
-    {
-	dim = val->dim;
-	cfio_id_get_nc(val->client_nc_id, &nc);
-	assert(nc->nc_id != CFIO_ID_NC_INVALID);
-	dim->nc_id = nc->nc_id;
-	debug(DEBUG_IO, "dim_len = %d", dim->dim_len);
-#ifndef SVR_NO_IO
-	ret = ncmpi_def_dim(nc->nc_id, dim->name, dim->global_dim_len, &dim->dim_id);
-#else
-	ret = NC_NOERR;
-	dim->dim_id = 10;
-#endif
-	return CFIO_ERROR_NONE;
-    }
 
-    if(NULL != val->var)
+    /* client ids are assigned in define order, and all dims must be
+     * defined before vars which use them */
+    for(i = 0; i < file->dim_size; i ++)
     {
-	var = val->var;
-	for(i = 0; i < var->ndims; i ++)
-	{
-	    cfio_id_get_dim(val->client_nc_id, var->dim_ids[i], &dim);
-	    var->dim_ids[i] = dim->dim_id;
-	}
-	var->nc_id = dim->nc_id;
-	debug(DEBUG_IO, "Def var : cfio_type(%d), nc_type(%d)", 
-		var->data_type, cfio_type_to_nc(var->data_type));
-#ifndef SVR_NO_IO
-	ret = ncmpi_def_var(var->nc_id, var->name, cfio_type_to_nc(var->data_type), var->ndims,
-		var->dim_ids, &var->var_id);
-#else
-	ret = NC_NOERR;
-	var->var_id = 10;
-#endif
-	qlist_for_each_entry(att, var->att_head, link)
+	if(NULL != file->dims[i] &&
+		(ret = _handle_def_dim(nc, file->dims[i])) < 0)
 	{
-	    switch(att->xtype)
-	    {
-		case CFIO_CHAR :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_text(var->nc_id, var->var_id, att->name, att->len, att->data);
-#else
-		    ret = NC_NOERR;
-#endif
-		    break;
-		case CFIO_INT :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_int(nc->nc_id, var->var_id, att->name, 
-			    cfio_type_to_nc(att->xtype), att->len, (const int*)att->data);
-#else
-		    ret = NC_NOERR;
-#endif
-		    break;
-		case CFIO_FLOAT :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_float(nc->nc_id, var->var_id, att->name, cfio_type_to_nc(att->xtype), att->len, (const float*)att->data);
-#else
-		    ret = NC_NOERR;
-#endif
-		    break;
-		case CFIO_DOUBLE :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_double(nc->nc_id, var->var_id, att->name, cfio_type_to_nc(att->xtype), att->len, (const double*)att->data);
-#else
-		    ret = NC_NOERR;
-#endif
-		    break;
-	    }
-	    if(ret != NC_NOERR)
-	    {
-		error("put var(%s) attr(%s) error(%s)",
-			var->name, att->name, ncmpi_strerror(ret));
-		return CFIO_ERROR_NC;
-	    }
-
+	    return ret;
 	}
-	
-	return CFIO_ERROR_NONE;
-    }
-
-    error("no def can do , this is impossible.");
-    return CFIO_ERROR_NC;
-}
-/**
- * @brief: update a var's start and count, still store in cur_start and cur_count
- *
- * @param ndims: number of dim for the var
- * @param cur_start: current start of the var
- * @param cur_count: current count of the var
- * @param new_start: new start which is to be updated into cur_start 
- * @param new_count: new count which is to be updated into cur_count
- */
-void _update_start_and_count(int ndims, 
-	size_t *cur_start, size_t *cur_count,
-	size_t *new_start, size_t *new_count)
-{
-    assert(NULL != cur_start);
-    assert(NULL != cur_count);
-    assert(NULL != new_start);
-    assert(NULL != new_count);
-
-    int min_start, max_end;
-    int i;
-
-    for(i = 0; i < ndims; i ++)
-    {
-	min_start = (cur_start[i] < new_start[i]) ? cur_start[i]:new_start[i];
-	max_end = cur_start[i] + cur_count[i] > new_start[i] + new_count[i] ? 
-	    cur_start[i] + cur_count[i] : new_start[i] + new_count[i];
-	cur_start[i] = min_start;
-	cur_count[i] = max_end - min_start;
     }
-}
-/* merge var data */
-void _merge_var_data(
-	cfio_id_var_t *var, size_t *start, size_t *count, char **_data)
-{
-    int i;
-    size_t data_size, ele_size;
-    char *data;
-    
-    debug(DEBUG_IO, "_merge_var_data");
-    debug(DEBUG_IO, "ndims = %d\n", var->ndims);
-	
-    assert(var->recv_data != NULL);
-
-    for(i = 0; i < var->ndims; i ++)
+    for(i = 0; i < file->var_size; i ++)
     {
-	assert(var->recv_data[0].start != NULL);
-	assert(var->recv_data[0].count != NULL);
-	debug(DEBUG_IO, "start = %lu\n", var->recv_data[0].start[i]);
-	debug(DEBUG_IO, "count = %lu\n", var->recv_data[0].count[i]);
-	start[i] = var->recv_data[0].start[i];
-	count[i] = var->recv_data[0].count[i];
+	if(NULL != file->vars[i] &&
+		(ret = _handle_def_var(file, file->vars[i])) < 0)
+	{
+	    return ret;
+	}
     }
-    
-    for(i = 1; i < var->client_num; i ++)
+    /* global atts are only kept in the file when it is created from schema */
+    qlist_for_each_entry(att, &file->att_head, link)
     {
-	_update_start_and_count(var->ndims,start, count,
-		var->recv_data[i].start, var->recv_data[i].count);
+	if((ret = cfio_backend_put_att(nc->nc_id, NC_GLOBAL, att->name,
+			att->xtype, att->len, att->data)) < 0)
+	{
+	    error("put global attr(%s) error.", att->name);
+	    return ret;
+	}
     }
-	
-    data_size = 1;
-    for(i = 0; i < var->ndims; i ++)
+    if((ret = cfio_backend_enddef(nc->nc_id)) < 0)
     {
-	data_size *= count[i];
+	error("enddef error.");
+	return ret;
     }
-    cfio_types_size(ele_size, var->data_type);
-    data = malloc(ele_size * data_size);
 
-    debug(DEBUG_IO, "malloc for data, size = %lu * %lu", 
-	    ele_size ,  data_size);
+    nc->nc_status = DATA_MODE;
 
-    for(i = 0; i < var->client_num; i ++)
-    {
-	_put_var(var->ndims, ele_size, 
-		start, count, data,
-		var->recv_data[i].start, var->recv_data[i].count,
-		var->recv_data[i].buf);
-
-	free(var->recv_data[i].buf);	
-	var->recv_data[i].buf = NULL;	
-	free(var->recv_data[i].start);	
-	var->recv_data[i].start = NULL;	
-	free(var->recv_data[i].count);	
-	var->recv_data[i].count = NULL;	
-	
-    }
-    
-    *_data = data;	
+    return CFIO_ERROR_NONE;
 }
-
-int cfio_io_init()
+int cfio_io_init(int _server_id)
 {
+    int ret;
+
     io_table = qhash_init(_compare, _hash, IO_HASH_TABLE_SIZE);
-    MPI_Comm_rank(MPI_COMM_WORLD, &server_id);
+    server_id = _server_id;
+
+    if((ret = cfio_backend_init(server_id)) < 0)
+    {
+	error("");
+	return ret;
+    }
 
     //start_time = times_cur();
     return CFIO_ERROR_NONE;
@@ -514,6 +318,8 @@ int cfio_io_final()
 	io_table = NULL;
     }
 
+    cfio_backend_final();
+
     return CFIO_ERROR_NONE;
 }
 
@@ -587,17 +393,10 @@ int cfio_io_create(cfio_msg_t *msg)
 	cfio_id_map_nc(client_nc_id, CFIO_ID_NC_INVALID);
 	//if(_bitmap_full(io_info->client_bitmap))
 	//{
-#ifndef SVR_NO_IO
-	ret = ncmpi_create(cfio_map_get_server_comm(), path, cmode, MPI_INFO_NULL, &nc_id);
-#else
-	ret = NC_NOERR;
-	nc_id = NC_NOERR;
-#endif
-	if(ret != NC_NOERR)
+	if((ret = cfio_backend_create(path, cmode, &nc_id)) < 0)
 	{
-	    error("Error happened when open %s error(%s)", 
-		    path, ncmpi_strerror(ret));
-	    return_code = CFIO_ERROR_NC;
+	    error("Error happened when open %s", path);
+	    return_code = ret;
 
 	    goto RETURN;
 	}
@@ -634,6 +433,130 @@ RETURN:
     return return_code;
 }
 
+int cfio_io_schema_begin(cfio_msg_t *msg)
+{
+    int schema_id;
+    cfio_id_nc_t *nc;
+
+    cfio_recv_unpack_schema(msg, &schema_id);
+
+#ifdef SVR_UNPACK_ONLY
+    return CFIO_ERROR_NONE;
+#endif
+
+    /* schema has no real file, defs are kept in id map until it is freed */
+    if(CFIO_ID_HASH_GET_NULL == cfio_id_get_nc(schema_id, &nc))
+    {
+	cfio_id_map_nc(schema_id, CFIO_ID_NC_INVALID);
+	cfio_id_get_nc(schema_id, &nc);
+	nc->nc_status = SCHEMA_MODE;
+    }
+
+    debug(DEBUG_IO, "schema(%d) begin", schema_id);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_io_create_from_schema(cfio_msg_t *msg)
+{
+    int ret, cmode;
+    char *path = NULL;
+    int nc_id, client_nc_id, schema_id;
+    cfio_id_nc_t *nc, *schema;
+    cfio_id_file_t *file;
+    int return_code;
+
+    cfio_recv_unpack_create_from_schema(msg, &path, &cmode, 
+	    &schema_id, &client_nc_id);
+
+#ifdef SVR_UNPACK_ONLY
+    free(path);
+    return CFIO_ERROR_NONE;
+#endif
+
+    if(CFIO_ID_HASH_GET_NULL == cfio_id_get_nc(schema_id, &schema) ||
+	    SCHEMA_MODE != schema->nc_status)
+    {
+	error("schema(%d) is invalid.", schema_id);
+	return_code = CFIO_ERROR_INVALID_NC;
+	goto RETURN;
+    }
+    /**
+     * all defs of the schema from this client have been handled before, and
+     * each client defines the same schema, so the file can be created and
+     * defined when the first msg arrives. but the start and count of the 
+     * other clients may not be handled yet, they are copied when the msg of 
+     * each client arrives
+     **/
+    if(CFIO_ID_HASH_GET_NULL == cfio_id_get_nc(client_nc_id, &nc))
+    {
+	if((ret = cfio_backend_create(path, cmode, &nc_id)) < 0)
+	{
+	    error("Error happened when open %s", path);
+	    return_code = ret;
+	    goto RETURN;
+	}
+	if((ret = cfio_id_map_nc_from(client_nc_id, nc_id, schema_id)) < 0)
+	{
+	    error("copy schema(%d) fail.", schema_id);
+	    return_code = ret;
+	    goto RETURN;
+	}
+	cfio_id_get_file(client_nc_id, &file);
+	if((ret = _handle_def_file(file)) < 0)
+	{
+	    return_code = ret;
+	    goto RETURN;
+	}
+	debug(DEBUG_IO, "nc create(%s) from schema(%d) success", 
+		path, schema_id);
+    }
+    if((ret = cfio_id_copy_var_decomp(client_nc_id, schema_id,
+		    cfio_map_get_client_index_of_server(msg->src))) < 0)
+    {
+	error("copy decomp of client %d from schema(%d) fail.", 
+		msg->src, schema_id);
+	return_code = ret;
+	goto RETURN;
+    }
+
+    return_code = CFIO_ERROR_NONE;
+
+RETURN:
+    free(path);
+    return return_code;
+}
+
+int cfio_io_schema_free(cfio_msg_t *msg)
+{
+    int schema_id;
+    cfio_io_val_t *io_info;
+    int client_id = msg->src;
+    int func_code = FUNC_SCHEMA_FREE;
+
+    cfio_recv_unpack_schema(msg, &schema_id);
+
+#ifdef SVR_UNPACK_ONLY
+    return CFIO_ERROR_NONE;
+#endif
+
+    _recv_client_io(client_id, func_code, schema_id, 0, 0, &io_info);
+
+    /* all files which use the schema have been created when all clients free
+     * it */
+    if(_bitmap_full(io_info->client_bitmap))
+    {
+	_remove_client_io(io_info);
+	if(CFIO_ID_HASH_GET_NULL == cfio_id_unmap_nc(schema_id))
+	{
+	    debug(DEBUG_IO, "Invalid schema.");
+	    return CFIO_ERROR_INVALID_NC;
+	}
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
 int cfio_io_def_dim(cfio_msg_t *msg)
 {
     int ret = 0;
@@ -678,10 +601,8 @@ int cfio_io_def_dim(cfio_msg_t *msg)
     {
         cfio_id_map_dim(client_nc_id, client_dim_id, CFIO_ID_NC_INVALID, 
         	CFIO_ID_DIM_INVALID, name, len);
-    }else
-    {
-	free(name);
     }
+    free(name);
 
     //if(_bitmap_full(io_info->client_bitmap))
     //{
@@ -733,6 +654,25 @@ RETURN :
     return return_code;
 }
 
+/**
+ * @brief: check whether the start and count of a client is consistent with the
+ *	var, only in debug build
+ */
+static inline int _check_var_part(cfio_id_var_t *var, int ndims,
+	size_t *start, size_t *count, int is_record)
+{
+#ifdef ENABLE_DEBUG
+    if(ndims != var->ndims || is_record != var->is_record)
+    {
+	error("ndims(%d), is_record(%d) is not consistent with var's "
+		"ndims(%d), is_record(%d)", ndims, is_record, 
+		var->ndims, var->is_record);
+	return CFIO_ERROR_INVALID_VAR;
+    }
+#endif
+    return CFIO_ERROR_NONE;
+}
+
 int cfio_io_def_var(cfio_msg_t *msg)
 {
     int ret = 0, i;
@@ -813,13 +753,18 @@ int cfio_io_def_var(cfio_msg_t *msg)
 	    cfio_id_get_var(client_nc_id, client_var_id, &var))
     {
 	/**
-	 * the fisrst def var msg arrive, not need to free the name, start, count
-	 * and client_dim_ids
+	 * the fisrst def var msg arrive, name, start, count and client_dim_ids
+	 * are copied by map_var
 	 **/
 	client_num = cfio_map_get_client_num_of_server(server_id);
 	cfio_id_map_var(name, client_nc_id, client_var_id, 
 		CFIO_ID_NC_INVALID, CFIO_ID_VAR_INVALID, 
 		ndims, client_dim_ids, start, count, xtype, client_num);
+	if(ndims > 0 && cfio_id_dim_is_record(dims[0]))
+	{
+	    cfio_id_get_var(client_nc_id, client_var_id, &var);
+	    var->is_record = 1;
+	}
 	/**
 	 *set each dim's len for the var
 	 **/
@@ -832,6 +777,18 @@ int cfio_io_def_var(cfio_msg_t *msg)
 	}
     }else
     {
+	if(NULL == var->name)
+	{
+	    /* only start and count of other clients arrived before */
+	    if((ret = _check_var_part(var, ndims, start, count,
+			    ndims > 0 && cfio_id_dim_is_record(dims[0]))) < 0 ||
+		    (ret = cfio_id_set_var(client_nc_id, client_var_id, 
+			name, client_dim_ids, xtype)) < 0)
+	    {
+		return_code = ret;
+		goto RETURN;
+	    }
+	}
 	/**
 	 *update var's start, count and each dim's len
 	 **/
@@ -845,7 +802,7 @@ int cfio_io_def_var(cfio_msg_t *msg)
 	    debug(DEBUG_IO, "New var dim %d: start(%lu), count(%lu)", 
 		    i, start[i], count[i]);
 	}
-	_update_start_and_count(ndims, var->start, var->count, start, count);
+	cfio_merge_update_start_and_count(ndims, var->start, var->count, start, count);
 	for(i = 0; i < ndims; i ++)
 	{
 	    debug(DEBUG_IO, "count = %lu; dim_len = %d", 
@@ -860,18 +817,17 @@ int cfio_io_def_var(cfio_msg_t *msg)
 	    debug(DEBUG_IO, "Now var dim %d: start(%lu), count(%lu)", 
 		    i, var->start[i], var->count[i]);
 	}
-
-	/**
-	 *we need to free 4 pointer 
-	 **/
-	free(name);
-	free(start);
-	free(count);
-	free(client_dim_ids);
     }
+    /* put_vara of the client is encoded against its start and count */
+    cfio_id_put_var_decomp(client_nc_id, client_var_id,
+	    cfio_map_get_client_index_of_server(client_id), start, count);
     return_code = CFIO_ERROR_NONE;
 
 RETURN :
+    free(name);
+    free(start);
+    free(count);
+    free(client_dim_ids);
     if(dims != NULL)
     {
 	free(dims);
@@ -885,6 +841,99 @@ RETURN :
     return return_code;
 }
 
+/**
+ * only used in LEADER_META mode, a client which is not leader only sends its
+ * start and count of a var. the msg may arrive before the leader's def_var, 
+ * then the var is mapped without name and completed by the def_var
+ **/
+int cfio_io_def_var_part(cfio_msg_t *msg)
+{
+    int ret, ndims, is_record;
+    int client_nc_id, client_var_id;
+    cfio_id_nc_t *nc;
+    cfio_id_var_t *var;
+    size_t *start = NULL, *count = NULL;
+    int client_num;
+    int return_code;
+
+    cfio_recv_unpack_def_var_part(msg, &client_nc_id, &ndims, &start, &count,
+	    &is_record, &client_var_id);
+
+#ifdef SVR_UNPACK_ONLY
+    free(start);
+    free(count);
+    return CFIO_ERROR_NONE;
+#endif
+
+    if(CFIO_ID_HASH_GET_NULL == cfio_id_get_nc(client_nc_id, &nc))
+    {
+	return_code = CFIO_ERROR_INVALID_NC;
+	debug(DEBUG_IO, "Invalid NC ID.");
+	goto RETURN;
+    }
+
+    if(CFIO_ID_HASH_GET_NULL == 
+	    cfio_id_get_var(client_nc_id, client_var_id, &var))
+    {
+	client_num = cfio_map_get_client_num_of_server(server_id);
+	/* data type is set by the leader's def_var */
+	if((ret = cfio_id_map_var(NULL, client_nc_id, client_var_id, 
+		CFIO_ID_NC_INVALID, CFIO_ID_VAR_INVALID, 
+		ndims, NULL, start, count, CFIO_BYTE, client_num)) < 0)
+	{
+	    return_code = ret;
+	    goto RETURN;
+	}
+	cfio_id_get_var(client_nc_id, client_var_id, &var);
+	var->is_record = is_record;
+    }else
+    {
+	if((ret = _check_var_part(var, ndims, start, count, is_record)) < 0)
+	{
+	    return_code = ret;
+	    goto RETURN;
+	}
+	cfio_merge_update_start_and_count(ndims, var->start, var->count, start, count);
+    }
+    cfio_id_put_var_decomp(client_nc_id, client_var_id,
+	    cfio_map_get_client_index_of_server(msg->src), start, count);
+    return_code = CFIO_ERROR_NONE;
+
+RETURN :
+    free(start);
+    free(count);
+    return return_code;
+}
+
+static inline int _put_att(cfio_id_nc_t *nc,
+	int client_nc_id, int client_var_id, 
+	char *name, cfio_type xtype, int len, char *data)
+{
+    int ret;
+
+    if(client_var_id == NC_GLOBAL)
+    {
+	ret = cfio_backend_put_att(nc->nc_id, NC_GLOBAL, name, 
+		xtype, len, data);
+	if(ret < 0)
+	{
+	    error("Error happened when put attr.");
+	    return ret;
+	}
+    }
+    else
+    {
+	if(CFIO_ID_HASH_GET_NULL == cfio_id_put_att(
+		    client_nc_id, client_var_id, name, xtype, len, data))
+	{
+	    error("");
+	    return CFIO_ERROR_INVALID_NC;
+	}
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
 int cfio_io_put_att(cfio_msg_t *msg)
 {
     int client_id = msg->src;
@@ -894,7 +943,7 @@ int cfio_io_put_att(cfio_msg_t *msg)
     cfio_id_var_t *var;
     cfio_io_val_t *io_info;
     char *name;
-    nc_type xtype;
+    cfio_type xtype;
     int len;
     char *data;
 
@@ -921,9 +970,6 @@ int cfio_io_put_att(cfio_msg_t *msg)
     return CFIO_ERROR_NONE;
 #endif
     
-    _recv_client_io(
-	    client_id, func_code, client_nc_id, 0, client_var_id, &io_info);
-
     if(CFIO_ID_HASH_GET_NULL == cfio_id_get_nc(client_nc_id, &nc))
     {
 	return_code = CFIO_ERROR_INVALID_NC;
@@ -931,65 +977,47 @@ int cfio_io_put_att(cfio_msg_t *msg)
 	goto RETURN;
     }
 
-    if(_bitmap_full(io_info->client_bitmap))
+    /**
+     * att of schema is kept when the first msg arrives, so that a file can be
+     * created from the schema as soon as any client asks for it
+     **/
+    if(SCHEMA_MODE == nc->nc_status)
     {
-	if(client_var_id == NC_GLOBAL)
+	if(CFIO_ID_HASH_GET_NULL == cfio_id_put_att(
+		    client_nc_id, client_var_id, name, xtype, len, data))
 	{
-	    switch(xtype)
-	    {
-		case CFIO_CHAR :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_text(nc->nc_id, NC_GLOBAL, name, len, data);
-#else
-		    ret = NC_NOERR;
-#endif
-		    break;
-		case CFIO_INT :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_int(nc->nc_id, NC_GLOBAL, name, xtype, len, (const int*)data);
-#else
-		    ret = NC_NOERR;
-#endif
-		    break;
-		case CFIO_FLOAT :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_float(nc->nc_id, NC_GLOBAL, name, xtype, len, (const float*)data);
-#else
-		    ret = NC_NOERR;
-#endif
-		    break;
-		case CFIO_DOUBLE :
-#ifndef SVR_NO_IO
-		    ret = ncmpi_put_att_double(nc->nc_id, NC_GLOBAL, name, xtype, len, (const double*)data);
-#else
-		    ret = NC_NOERR;
+	    return_code = CFIO_ERROR_INVALID_VAR;
+	    goto RETURN;
+	}
+	return_code = CFIO_ERROR_NONE;
+	goto RETURN;
+    }
+
+#ifdef LEADER_META
+    /* only the leader sends att, no need to wait for other clients */
+    return_code = _put_att(nc, client_nc_id, client_var_id, 
+	    name, xtype, len, data);
+    goto RETURN;
 #endif
-		    break;
-	    }
-	    if(ret != NC_NOERR)
-	    {
-		error("Error happened when put attr error(%s)", 
-			ncmpi_strerror(ret));
-		return_code = CFIO_ERROR_NC;
 
-		goto RETURN;
-	    }
-	}
-	else
+    _recv_client_io(
+	    client_id, func_code, client_nc_id, 0, client_var_id, &io_info);
+
+    if(_bitmap_full(io_info->client_bitmap))
+    {
+	if((ret = _put_att(nc, client_nc_id, client_var_id, 
+			name, xtype, len, data)) < 0)
 	{
-	    if(CFIO_ID_HASH_GET_NULL == cfio_id_put_att(
-			client_nc_id, client_var_id, name, xtype, len, data))
-	    {
-		error("");
-		return_code = CFIO_ERROR_INVALID_NC;
-		goto RETURN;
-	    }
+	    return_code = ret;
+	    goto RETURN;
 	}
 	_remove_client_io(io_info);
     }
     return_code = CFIO_ERROR_NONE;
 
 RETURN:
+    free(name);
+    free(data);
 	return return_code;
     }
 
@@ -998,7 +1026,7 @@ int cfio_io_enddef(cfio_msg_t *msg)
     int client_nc_id, ret;
     cfio_id_nc_t *nc;
     cfio_io_val_t *io_info;
-    cfio_id_val_t *iter, *nc_val;
+    cfio_id_file_t *file;
     int client_id = msg->src;
 
     int func_code = FUNC_NC_ENDDEF;
@@ -1027,75 +1055,54 @@ int cfio_io_enddef(cfio_msg_t *msg)
 
 	if(DEFINE_MODE == nc->nc_status)
 	{
-	    cfio_id_get_val(client_nc_id, 0, 0, &nc_val);
-	    qlist_for_each_entry(iter, &(nc_val->link), link)
+	    cfio_id_get_file(client_nc_id, &file);
+	    if((ret = _handle_def_file(file)) < 0)
 	    {
-		if((ret = _handle_def(iter)) < 0)
-		{   
-		    return ret;
-		}
+		return ret;
 	    }
-#ifndef SVR_NO_IO
-	    ret = ncmpi_enddef(nc->nc_id);
-#else
-	    ret = NC_NOERR;
-#endif
-	    if(ret < 0)
-	    {
-		error("enddef error(%s)",ncmpi_strerror(ret));
-		return CFIO_ERROR_NC;
-	    }
-
-	    nc->nc_status = DATA_MODE;
 	}
 	_remove_client_io(io_info);
     }
     return CFIO_ERROR_NONE;
 }
 
-int cfio_io_put_vara(cfio_msg_t *msg)
+/**
+ * @brief: put the data of a client into the var, and write the var when the
+ *	data of all clients arrive
+ *
+ * @param client_id: id of the client
+ * @param client_nc_id, client_var_id: the var in client
+ * @param ndims: number of dims in start and count
+ * @param start, count, data: unpacked from the msg, owned by the var after
+ *	put
+ * @param data_type: type of data, converted into the var's type when merged
+ * @param stamp: stamps of the put_vara, for the latency
+ *
+ * @return: error code
+ */
+static int _put_vara(int client_id, int client_nc_id, int client_var_id,
+	int ndims, size_t *start, size_t *count, int data_type, char *data,
+	const cfio_latency_stamp_t *stamp)
 {
-    int i,ret = 0, ndims;
+    int i,ret = 0, be, region_num;
+    uint64_t merge_start;
     cfio_id_nc_t *nc;
     cfio_id_var_t *var;
     cfio_io_val_t *io_info;
-    int client_nc_id, client_var_id;
-    size_t *start, *count;
     size_t *total_start = NULL, *total_count = NULL;
-    size_t data_size;
-    char *data;
     char *total_data = NULL;
-    int data_len, data_type, client_index;
-    size_t *put_start;
-    int client_id = msg->src;
+    int client_index;
+    size_t rec = 0;
+    cfio_id_data_t *recv_data;
+
+    size_t ele_size = 0, ele_num;
+    int convert_ret = CFIO_ERROR_NONE;
 
     int func_code = FUNC_NC_PUT_VARA;
     int return_code;
 
-    MPI_Offset *pnc_start = NULL, *pnc_count = NULL;
-
     //double start_time, end_time;
 
-    //    ret = cfio_unpack_msg_extra_data_size(h_buf, &data_size);
-    ret = cfio_recv_unpack_put_vara(msg, 
-	    &client_nc_id, &client_var_id, &ndims, &start, &count,
-	    &data_len, &data_type, &data);	
-	
-    for(i = 0; i < ndims; i ++)
-    {
-	    debug(DEBUG_IO, "recv dim %d: start(%lu), count(%lu)", 
-		    i, start[i], count[i]);
-	    debug(DEBUG_IO, "recv data = %f", ((double *)data)[0]);
-	//    printf( "dim %d: start(%lu), count(%lu)\n", 
-	//	    i, total_start[i], total_count[i]);
-    }
-    debug(DEBUG_IO, "client_var_id = %d", client_var_id);
-    if( ret < 0 )
-    {
-	error("");
-	return CFIO_ERROR_MSG_UNPACK;
-    }
-
 #if defined(SVR_UNPACK_ONLY) || defined(SVR_META_ONLY)
     if(start != NULL)
     {
@@ -1115,14 +1122,55 @@ int cfio_io_put_vara(cfio_msg_t *msg)
     return CFIO_ERROR_NONE;
 #endif
 
+    /**
+     * each record of a record var is handled as an independent io request, so
+     * that the file can stay open and append records
+     **/
+    if(CFIO_ID_HASH_GET_NULL == 
+	    cfio_id_get_var(client_nc_id, client_var_id, &var))
+    {
+	return_code = CFIO_ERROR_INVALID_VAR;
+	debug(DEBUG_IO, "Invalid var.");
+	goto RETURN;
+    }
+    if(var->is_record && ndims > 0)
+    {
+	rec = start[0];
+    }
+
+    /**
+     * the client rejects a put of data which can't be converted, if such a part
+     * gets here, it's still counted with zeros instead of its data, or the var
+     * could never be merged and the parts of the other clients would be lost
+     **/
+    if(!cfio_convert_valid(var->data_type, data_type))
+    {
+	error("can't put data of type %d into var(%s) of type %d, zeros are "
+		"put instead.", data_type, var->name, var->data_type);
+	convert_ret = CFIO_ERROR_CONVERT;
+	cfio_types_size(ele_size, var->data_type);
+	for(i = 0, ele_num = 1; i < ndims; i ++)
+	{
+	    ele_num *= count[i];
+	}
+	free(data);
+	if(NULL == (data = calloc(ele_num > 0 ? ele_num : 1, ele_size)))
+	{
+	    error("malloc fail.");
+	    free(start);
+	    free(count);
+	    return CFIO_ERROR_MALLOC;
+	}
+	data_type = var->data_type;
+    }
+
     _recv_client_io(
-	    client_id, func_code, client_nc_id, 0, client_var_id, &io_info);
+	    client_id, func_code, client_nc_id, (int)rec, client_var_id, &io_info);
 
     client_index = cfio_map_get_client_index_of_server(client_id);
-    //TODO  check whether data_type is right
     if(CFIO_ID_HASH_GET_NULL == cfio_id_put_var(
 		client_nc_id, client_var_id, client_index, 
-		start, count, (char*)data))
+		start, count, data_type, (char*)data, stamp))
     {
 	return_code = CFIO_ERROR_INVALID_VAR;
 	debug(DEBUG_IO, "Invalid var.");
@@ -1157,88 +1205,56 @@ int cfio_io_put_vara(cfio_msg_t *msg)
             goto RETURN;
         }
 
-	total_start = malloc(sizeof(size_t) * var->ndims);
-	total_count = malloc(sizeof(size_t) * var->ndims);
-        _merge_var_data(var, total_start, total_count, &total_data);
-	
-	for(i = 0; i < var->ndims; i ++)
+	cfio_id_get_var_data(var, rec, &recv_data);
+	/* swap while merging if the backend takes data as in file */
+	be = cfio_backend_has_put_vara_be();
+	cfio_latency_begin(&recv_data->stamp, sizeof(cfio_id_data_t));
+	merge_start = cfio_trace_now();
+        ret = cfio_merge_var_data(var, recv_data, be, 
+		&region_num, &total_start, &total_count, &total_data);
+	cfio_stats_time(merge_time, merge_start);
+	cfio_trace_end("merge", merge_start, region_num);
+	cfio_latency_merged();
+	if(var->is_record)
 	{
-	    debug(DEBUG_IO, "dim %d: start(%lu), count(%lu)", 
-		    i, total_start[i], total_count[i]);
-	//    printf( "server %d: dim %d: start(%lu), count(%lu)\n", 
-	//	    server_id, i, total_start[i], total_count[i]);
+	    cfio_id_del_var_rec(var, rec);
 	}
-	debug(DEBUG_IO, "nc_id = %d, var_id = %d", nc->nc_id, var->var_id);
-	debug(DEBUG_IO, "first data = %f", ((float *)total_data)[0]);
-	
-	pnc_start = malloc(sizeof(size_t) * var->ndims);
-	pnc_count = malloc(sizeof(size_t) * var->ndims);
-	for(i = 0; i < var->ndims; i ++)
+	if(ret < 0)
 	{
-	    pnc_start[i] = total_start[i];
-	    pnc_count[i] = total_count[i];
+	    error("merge data of var(%s) fail.", var->name);
+	    return_code = ret;
+	    _remove_client_io(io_info);
+	    goto RETURN;
 	}
 	
-	for(i = 0; i < var->ndims; i ++)
+	for(i = 0; i < var->ndims * region_num; i ++)
 	{
 	    debug(DEBUG_IO, "dim %d: start(%lu), count(%lu)", 
-		    i, total_start[i], total_count[i]);
-	    debug(DEBUG_IO, "dim %d: start(%lld), count(%lld)", 
-		    i, pnc_start[i], pnc_count[i]);
-	}
-
-	switch(var->data_type)
-	{
-	    case CFIO_BYTE :
-		break;
-	    case CFIO_CHAR :
-		break;
-	    case CFIO_SHORT :
-#ifndef SVR_NO_IO
-		ret = ncmpi_put_vara_short_all(nc->nc_id, var->var_id, 
-			pnc_start, pnc_count, (short*)total_data);
-#else
-		ret = NC_NOERR;
-#endif
-		break;
-	    case CFIO_INT :
-#ifndef SVR_NO_IO
-		ret = ncmpi_put_vara_int_all(nc->nc_id, var->var_id, 
-			pnc_start, pnc_count, (int*)total_data);
-#else
-		ret = NC_NOERR;
-#endif
-		break;
-	    case CFIO_FLOAT :
-#ifndef SVR_NO_IO
-		ret = ncmpi_put_vara_float_all(nc->nc_id, var->var_id, 
-			pnc_start, pnc_count, (float*)total_data);
-#else
-		ret = NC_NOERR;
-#endif
-		break;
-	    case CFIO_DOUBLE :
-#ifndef SVR_NO_IO
-		ret = ncmpi_put_vara_double_all(nc->nc_id, var->var_id, 
-			pnc_start, pnc_count, (double*)total_data);
-#else
-		ret = NC_NOERR;
-#endif
-		break;
+		    i % var->ndims, total_start[i], total_count[i]);
 	}
+	debug(DEBUG_IO, "nc_id = %d, var_id = %d", nc->nc_id, var->var_id);
+	
+	/* the regions are put in one request, so that every server joins the
+	 * collective put once, whatever the amount of its regions */
+	ret = cfio_backend_put_varn(nc->nc_id, var->var_id, var->ndims,
+		region_num, total_start, total_count, var->data_type, 
+		be, total_data);
 	//end_time = times_cur();
 	//write_time += end_time - start_time;
 
-        if( ret != NC_NOERR )
+        if( ret < 0 )
         {
-            error("write nc(%d) var (%d) failure(%s)",
-        	    nc->nc_id,var->var_id,ncmpi_strerror(ret));
-            return_code = CFIO_ERROR_NC;
-        }
+            error("write nc(%d) var (%d) failure",
+        	    nc->nc_id,var->var_id);
+            return_code = ret;
+        }else
+	{
+	    cfio_latency_end(var->name);
+	}
         _remove_client_io(io_info);
     }
 
-    return_code = CFIO_ERROR_NONE;	
+    return_code = convert_ret;
     //printf("proc : %d, write_time : %f\n", server_id, write_time);
 
 RETURN :
@@ -1258,19 +1274,76 @@ RETURN :
 	free(total_start);
 	total_start = NULL;
     }
-    if(pnc_count != NULL)
+    return return_code;
+
+
+}
+
+int cfio_io_put_vara(cfio_msg_t *msg)
+{
+    int i, ret, ndims;
+    int client_nc_id, client_var_id;
+    size_t *start, *count;
+    char *data;
+    int data_len, data_type;
+    cfio_latency_stamp_t stamp;
+
+    //    ret = cfio_unpack_msg_extra_data_size(h_buf, &data_size);
+    ret = cfio_recv_unpack_put_vara(msg, 
+	    &client_nc_id, &client_var_id, &ndims, &start, &count,
+	    &data_len, &data_type, &data, &stamp);	
+	
+    for(i = 0; i < ndims; i ++)
     {
-	free(pnc_count);
-	pnc_count = NULL;
+	    debug(DEBUG_IO, "recv dim %d: start(%lu), count(%lu)", 
+		    i, start[i], count[i]);
+	//    printf( "dim %d: start(%lu), count(%lu)\n", 
+	//	    i, total_start[i], total_count[i]);
     }
-    if(pnc_start != NULL)
+    debug(DEBUG_IO, "client_var_id = %d", client_var_id);
+    if( ret < 0 )
     {
-	free(pnc_start);
-	pnc_start = NULL;
+	error("");
+	return CFIO_ERROR_MSG_UNPACK;
     }
-    return return_code;
 
+    return _put_vara(msg->src, client_nc_id, client_var_id, 
+	    ndims, start, count, data_type, data, &stamp);
+}
+
+int cfio_io_put_vara_multi(cfio_msg_t *msg)
+{
+    int i, n, ret, ndims;
+    int client_nc_id, client_var_id;
+    size_t *start, *count;
+    char *data;
+    int data_len, data_type;
+    int return_code = CFIO_ERROR_NONE;
+    cfio_latency_stamp_t stamp;
+
+    cfio_recv_unpack_put_vara_multi(msg, &client_nc_id, &n);
+    debug(DEBUG_IO, "client_nc_id = %d, n = %d", client_nc_id, n);
 
+    /* each var completes independently, a bad one doesn't stop the others */
+    for(i = 0; i < n; i ++)
+    {
+	ret = cfio_recv_unpack_put_vara_next(msg, 
+		&client_nc_id, &client_var_id, &ndims, &start, &count,
+		&data_len, &data_type, &data, &stamp);	
+	if(ret < 0)
+	{
+	    error("");
+	    return_code = CFIO_ERROR_MSG_UNPACK;
+	    continue;
+	}
+	if((ret = _put_vara(msg->src, client_nc_id, client_var_id, 
+			ndims, start, count, data_type, data, &stamp)) < 0)
+	{
+	    return_code = ret;
+	}
+    }
+
+    return return_code;
 }
 
 int cfio_io_close(cfio_msg_t *msg)
@@ -1279,7 +1352,6 @@ int cfio_io_close(cfio_msg_t *msg)
     cfio_id_nc_t *nc;
     cfio_io_val_t *io_info;
     int func_code = FUNC_NC_CLOSE;
-    cfio_id_val_t *iter, *next, *nc_val;
     int client_id = msg->src;
 
     ret = cfio_recv_unpack_close(msg, &client_nc_id);
@@ -1306,30 +1378,33 @@ int cfio_io_close(cfio_msg_t *msg)
 	    debug(DEBUG_IO, "Invalid NC.");
 	    return CFIO_ERROR_INVALID_NC;
 	}
-#ifndef SVR_NO_IO
-	ret = ncmpi_close(nc->nc_id);
-#else
-	ret = NC_NOERR;
-#endif
-
-	if( ret != NC_NOERR )
+	if((ret = cfio_backend_close(nc->nc_id)) < 0)
 	{
-	    error("close nc(%d) file failure,%s\n",nc->nc_id,ncmpi_strerror(ret));
-	    return CFIO_ERROR_NC;
+	    error("close nc(%d) file failure",nc->nc_id);
+	    return ret;
 	}
 	_remove_client_io(io_info);
 	
-	cfio_id_get_val(client_nc_id, 0, 0, &nc_val);
-	qlist_for_each_entry_safe(iter, next, &(nc_val->link), link)
-	{
-	    qlist_del(&(iter->link));
-	    qhash_del(&(iter->hash_link));
-	    cfio_id_val_free(iter);
-	}
-	qhash_del(&(nc_val->hash_link));
-	free(nc_val);
+	cfio_id_unmap_nc(client_nc_id);
     }
     debug(DEBUG_IO, "success return.");
     return CFIO_ERROR_NONE;
 }
 
+int cfio_io_get_recv_num(int client_nc_id, int rec, int client_var_id)
+{
+    cfio_io_key_t key;
+    qlist_head_t *link;
+
+    key.func_code = FUNC_NC_PUT_VARA;
+    key.client_nc_id = client_nc_id;
+    key.client_dim_id = rec;
+    key.client_var_id = client_var_id;
+
+    if(NULL == (link = qhash_search(io_table, &key)))
+    {
+	return 0;
+    }
+
+    return qlist_entry(link, cfio_io_val_t, hash_link)->recv_num;
+}
@@ -48,6 +48,7 @@ typedef struct
     int client_var_id;
 
     uint8_t *client_bitmap;
+    int recv_num;	    /* amount of bits set in client_bitmap */
 
     qlist_head_t hash_link;
     //qlist_head_t queue_link;
@@ -56,9 +57,11 @@ typedef struct
 /**
  * @brief: initialize
  *
+ * @param _server_id: id of the server
+ *
  * @return: error code
  */
-int cfio_io_init();
+int cfio_io_init(int _server_id);
 /**
  * @brief: finalize
  *
@@ -68,10 +71,26 @@ int cfio_io_final();
 int cfio_io_reader_done(int client_id, int *server_done);
 int cfio_io_writer_done(int client_id, int *server_done);
 int cfio_io_create(cfio_msg_t *msg);
+int cfio_io_schema_begin(cfio_msg_t *msg);
+int cfio_io_create_from_schema(cfio_msg_t *msg);
+int cfio_io_schema_free(cfio_msg_t *msg);
 int cfio_io_def_dim(cfio_msg_t *msg);
 int cfio_io_def_var(cfio_msg_t *msg);
+int cfio_io_def_var_part(cfio_msg_t *msg);
 int cfio_io_enddef(cfio_msg_t *msg);
 int cfio_io_put_vara(cfio_msg_t *msg);
+int cfio_io_put_vara_multi(cfio_msg_t *msg);
 int cfio_io_close(cfio_msg_t *msg);
+/**
+ * @brief: get the amount of clients whose part of a var is decoded, the var 
+ *	is merged and written when all clients' parts are decoded
+ *
+ * @param client_nc_id: the nc file id in client
+ * @param rec: index in the record dimension, 0 if the var is not a record var
+ * @param client_var_id: the var id in client
+ *
+ * @return: the amount, 0 if no part is decoded
+ */
+int cfio_io_get_recv_num(int client_nc_id, int rec, int client_var_id);
 
 #endif
@@ -0,0 +1,470 @@
+/****************************************************************************
+ *       Filename:  merge.c
+ *
+ *    Description:  merge the data of a var recieved from clients
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <assert.h>
+#include <string.h>
+
+#include "merge.h"
+#include "convert.h"
+#include "debug.h"
+#include "cfio_types.h"
+#include "cfio_error.h"
+
+/**
+ * @brief: put the src data array into the dst data array, src and dst both are
+ *	sub-array of a total data array, only their intersection is copied. 
+ *	data is copied a row of the last dimension at a time, and converted 
+ *	from src_type into dst_type
+ *
+ * @param ndims: number of dimensions for the variable
+ * @param dst_type: type of the dst data
+ * @param dst_start: start index of the dst data array
+ * @param dst_count: count of teh dst data array
+ * @param dst_data: pointer to the dst data array
+ * @param src_type: type of the src data
+ * @param src_start: start index of the src data array
+ * @param src_count: count of teh src data array
+ * @param src_data: pointer to the src data array
+ * @param be: 1 if dst is stored in big-endian
+ *
+ * @return: error code
+ */
+static int _put_var(
+	int ndims, cfio_type dst_type,
+	size_t *dst_start, size_t *dst_count, char *dst_data,
+	cfio_type src_type,
+	size_t *src_start, size_t *src_count, char *src_data, int be)
+{
+    int i, ret = CFIO_ERROR_NONE;
+    size_t dst_size = 0, src_size = 0;
+    size_t start, end, row_len, row_num, row;
+    size_t dst_offset, src_offset;
+    size_t *dst_stride, *src_stride, *index, *count;
+    int (*convert)(cfio_type, void *, cfio_type, const void *, size_t);
+
+    assert(NULL != dst_start);
+    assert(NULL != dst_count);
+    assert(NULL != dst_data);
+    assert(NULL != src_start);
+    assert(NULL != src_count);
+    assert(NULL != src_data);
+
+    convert = be ? cfio_convert_be : cfio_convert;
+
+    if(0 == ndims)
+    {
+	return convert(dst_type, dst_data, src_type, src_data, 1);
+    }
+
+    cfio_types_size(dst_size, dst_type);
+    cfio_types_size(src_size, src_type);
+
+    dst_stride = malloc(sizeof(size_t) * ndims * 4);
+    if(NULL == dst_stride)
+    {
+	error("malloc for dst_stride fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    src_stride = dst_stride + ndims;
+    index = src_stride + ndims;
+    count = index + ndims;
+
+    /* stride of each dim, in elements */
+    dst_stride[ndims - 1] = 1;
+    src_stride[ndims - 1] = 1;
+    for(i = ndims - 2; i >= 0; i --)
+    {
+	dst_stride[i] = dst_stride[i + 1] * dst_count[i + 1];
+	src_stride[i] = src_stride[i + 1] * src_count[i + 1];
+    }
+    dst_offset = 0;
+    src_offset = 0;
+    row_num = 1;
+    for(i = 0; i < ndims; i ++)
+    {
+	start = src_start[i] > dst_start[i] ? src_start[i] : dst_start[i];
+	end = src_start[i] + src_count[i] < dst_start[i] + dst_count[i] ?
+	    src_start[i] + src_count[i] : dst_start[i] + dst_count[i];
+	if(end <= start)
+	{
+	    goto RETURN;
+	}
+	count[i] = end - start;
+	dst_offset += (start - dst_start[i]) * dst_stride[i];
+	src_offset += (start - src_start[i]) * src_stride[i];
+	index[i] = 0;
+	if(i < ndims - 1)
+	{
+	    row_num *= count[i];
+	}
+    }
+    row_len = count[ndims - 1];
+
+    for(row = 0; row < row_num; row ++)
+    {
+	if((ret = convert(dst_type, dst_data + dst_offset * dst_size,
+			src_type, src_data + src_offset * src_size, 
+			row_len)) < 0)
+	{
+	    goto RETURN;
+	}
+
+	/* move to the next row */
+	for(i = ndims - 2; i >= 0; i --)
+	{
+	    index[i] ++;
+	    dst_offset += dst_stride[i];
+	    src_offset += src_stride[i];
+	    if(index[i] < count[i])
+	    {
+		break;
+	    }
+	    dst_offset -= index[i] * dst_stride[i];
+	    src_offset -= index[i] * src_stride[i];
+	    index[i] = 0;
+	}
+    }
+
+RETURN:
+    free(dst_stride);
+
+    return ret;
+}
+
+void cfio_merge_update_start_and_count(int ndims,
+	size_t *cur_start, size_t *cur_count,
+	size_t *new_start, size_t *new_count)
+{
+    assert(NULL != cur_start);
+    assert(NULL != cur_count);
+    assert(NULL != new_start);
+    assert(NULL != new_count);
+
+    size_t min_start, max_end;
+    int i;
+
+    for(i = 0; i < ndims; i ++)
+    {
+	min_start = (cur_start[i] < new_start[i]) ? cur_start[i]:new_start[i];
+	max_end = cur_start[i] + cur_count[i] > new_start[i] + new_count[i] ?
+	    cur_start[i] + cur_count[i] : new_start[i] + new_count[i];
+	cur_start[i] = min_start;
+	cur_count[i] = max_end - min_start;
+    }
+}
+
+/**
+ * @brief: get the amount of elements in a block
+ */
+static inline size_t _block_size(int ndims, const size_t *count)
+{
+    int i;
+    size_t size = 1;
+
+    for(i = 0; i < ndims; i ++)
+    {
+	size *= count[i];
+    }
+    return size;
+}
+
+/**
+ * @brief: whether the pieces cover their bounding box, which is known without
+ *	computing the union when the pieces tile it, or one piece is the box
+ *
+ * @return: 1 if covered, 0 if there are gaps, or it's not known with 
+ *	overlapped pieces
+ */
+static int _cover_bbox(int ndims, int n, cfio_id_data_t *recv_data,
+	size_t *start, size_t *count)
+{
+    int i, j, dim, overlap;
+    size_t bbox_size, piece_size, sum_size;
+
+    bbox_size = _block_size(ndims, count);
+    sum_size = 0;
+    for(i = 0; i < n; i ++)
+    {
+	piece_size = _block_size(ndims, recv_data[i].count);
+	/* e.g. every client puts the whole var */
+	if(piece_size == bbox_size)
+	{
+	    return 1;
+	}
+	sum_size += piece_size;
+    }
+    if(sum_size != bbox_size)
+    {
+	return 0;
+    }
+
+    for(i = 0; i < n; i ++)
+    {
+	for(j = i + 1; j < n; j ++)
+	{
+	    overlap = 1;
+	    for(dim = 0; dim < ndims && overlap; dim ++)
+	    {
+		overlap = recv_data[i].start[dim] < 
+		    recv_data[j].start[dim] + recv_data[j].count[dim] &&
+		    recv_data[j].start[dim] < 
+		    recv_data[i].start[dim] + recv_data[i].count[dim];
+	    }
+	    if(overlap)
+	    {
+		return 0;
+	    }
+	}
+    }
+
+    return 1;
+}
+
+/**
+ * @brief: whether block 1 contains block 2
+ */
+static inline int _contain(int ndims, const size_t *start1, 
+	const size_t *count1, const size_t *start2, const size_t *count2)
+{
+    int i;
+
+    for(i = 0; i < ndims; i ++)
+    {
+	if(start2[i] < start1[i] || 
+		start2[i] + count2[i] > start1[i] + count1[i])
+	{
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+/**
+ * @brief: coalesce the rectangles, two rectangles are coalesced if one 
+ *	contains the other, or they are the same in all dims but one and touch
+ *	or overlap in that dim, so their union is a rectangle
+ *
+ * @param ndims: number of dims
+ * @param n: amount of the rectangles
+ * @param start: start of the rectangles, n vectors of ndims, the rectangles
+ *	left are stored at the front
+ * @param count: count of the rectangles, as start
+ *
+ * @return: amount of rectangles left
+ */
+static int _coalesce(int ndims, int n, size_t *start, size_t *count)
+{
+    int i, j, dim, diff_dim, merged;
+    size_t *start_i, *count_i, *start_j, *count_j, end;
+
+    do
+    {
+	merged = 0;
+	for(i = 0; i < n; i ++)
+	{
+	    for(j = i + 1; j < n; j ++)
+	    {
+		start_i = start + i * ndims;
+		count_i = count + i * ndims;
+		start_j = start + j * ndims;
+		count_j = count + j * ndims;
+
+		if(_contain(ndims, start_j, count_j, start_i, count_i))
+		{
+		    memcpy(start_i, start_j, sizeof(size_t) * ndims);
+		    memcpy(count_i, count_j, sizeof(size_t) * ndims);
+		}else if(!_contain(ndims, start_i, count_i, start_j, count_j))
+		{
+		    diff_dim = -1;
+		    for(dim = 0; dim < ndims; dim ++)
+		    {
+			if(start_i[dim] != start_j[dim] || 
+				count_i[dim] != count_j[dim])
+			{
+			    if(diff_dim >= 0)
+			    {
+				break;
+			    }
+			    diff_dim = dim;
+			}
+		    }
+		    if(dim < ndims || 
+			    start_j[diff_dim] > start_i[diff_dim] + 
+			    count_i[diff_dim] ||
+			    start_i[diff_dim] > start_j[diff_dim] + 
+			    count_j[diff_dim])
+		    {
+			continue;
+		    }
+		    end = start_i[diff_dim] + count_i[diff_dim];
+		    if(start_j[diff_dim] + count_j[diff_dim] > end)
+		    {
+			end = start_j[diff_dim] + count_j[diff_dim];
+		    }
+		    if(start_j[diff_dim] < start_i[diff_dim])
+		    {
+			start_i[diff_dim] = start_j[diff_dim];
+		    }
+		    count_i[diff_dim] = end - start_i[diff_dim];
+		}
+
+		/* j is in i now, move the last one to j */
+		n --;
+		memcpy(start_j, start + n * ndims, sizeof(size_t) * ndims);
+		memcpy(count_j, count + n * ndims, sizeof(size_t) * ndims);
+		j --;
+		merged = 1;
+	    }
+	}
+    }while(merged);
+
+    return n;
+}
+
+static void _free_recv_data(int n, cfio_id_data_t *recv_data)
+{
+    int i;
+
+    for(i = 0; i < n; i ++)
+    {
+	free(recv_data[i].buf);
+	recv_data[i].buf = NULL;
+	free(recv_data[i].start);
+	recv_data[i].start = NULL;
+	free(recv_data[i].count);
+	recv_data[i].count = NULL;
+    }
+}
+
+int cfio_merge_var_data(
+	cfio_id_var_t *var, cfio_id_data_t *recv_data, int be,
+	int *_region_num, size_t **_start, size_t **_count, char **_data)
+{
+    int i, j, ndims, region_num, ret = CFIO_ERROR_NONE;
+    size_t ele_size = 0;
+    size_t *start, *count, *offset;
+    char *data;
+
+    ndims = var->ndims;
+    debug(DEBUG_IO, "ndims = %d\n", ndims);
+
+    assert(recv_data != NULL);
+
+    /* enough for the bounding box, or all the pieces */
+    start = malloc(sizeof(size_t) * (ndims * var->client_num + 1));
+    count = malloc(sizeof(size_t) * (ndims * var->client_num + 1));
+    if(NULL == start || NULL == count)
+    {
+	free(start);
+	free(count);
+	_free_recv_data(var->client_num, recv_data);
+	error("malloc for start and count fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+
+    for(i = 0; i < ndims; i ++)
+    {
+	assert(recv_data[0].start != NULL);
+	assert(recv_data[0].count != NULL);
+	debug(DEBUG_IO, "start = %lu\n", recv_data[0].start[i]);
+	debug(DEBUG_IO, "count = %lu\n", recv_data[0].count[i]);
+	start[i] = recv_data[0].start[i];
+	count[i] = recv_data[0].count[i];
+    }
+    for(i = 1; i < var->client_num; i ++)
+    {
+	cfio_merge_update_start_and_count(ndims, start, count,
+		recv_data[i].start, recv_data[i].count);
+    }
+
+    /**
+     * with an irregular decomposition, e.g. blocks over land are eliminated, 
+     * the bounding box has gaps which are not written by any client, then 
+     * the pieces are coalesced into rectangles, and only the rectangles are
+     * allocated and written
+     **/
+    if(0 == ndims || _cover_bbox(ndims, var->client_num, recv_data, 
+		start, count))
+    {
+	region_num = 1;
+    }else
+    {
+	region_num = 0;
+	for(i = 0; i < var->client_num; i ++)
+	{
+	    if(_block_size(ndims, recv_data[i].count) > 0)
+	    {
+		memcpy(start + region_num * ndims, recv_data[i].start, 
+			sizeof(size_t) * ndims);
+		memcpy(count + region_num * ndims, recv_data[i].count, 
+			sizeof(size_t) * ndims);
+		region_num ++;
+	    }
+	}
+	region_num = _coalesce(ndims, region_num, start, count);
+	debug(DEBUG_IO, "var(%s) is written in %d rectangles.", 
+		var->name, region_num);
+    }
+
+    offset = malloc(sizeof(size_t) * (region_num + 1));
+    if(NULL == offset)
+    {
+	free(start);
+	free(count);
+	_free_recv_data(var->client_num, recv_data);
+	error("malloc for offset fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+    cfio_types_size(ele_size, var->data_type);
+    offset[0] = 0;
+    for(i = 0; i < region_num; i ++)
+    {
+	offset[i + 1] = offset[i] + 
+	    ele_size * _block_size(ndims, count + i * ndims);
+    }
+
+    data = malloc(offset[region_num] + 1);
+    if(NULL == data)
+    {
+	free(offset);
+	free(start);
+	free(count);
+	_free_recv_data(var->client_num, recv_data);
+	error("malloc for data fail.");
+	return CFIO_ERROR_MALLOC;
+    }
+
+    debug(DEBUG_IO, "malloc for data, size = %lu", offset[region_num]);
+
+    for(i = 0; i < var->client_num && CFIO_ERROR_NONE == ret; i ++)
+    {
+	if(0 == _block_size(ndims, recv_data[i].count))
+	{
+	    continue;
+	}
+	/* rectangles may overlap if the pieces do, so the piece is put into
+	 * each rectangle it intersects */
+	for(j = 0; j < region_num && CFIO_ERROR_NONE == ret; j ++)
+	{
+	    ret = _put_var(ndims, var->data_type,
+		    start + j * ndims, count + j * ndims, data + offset[j],
+		    recv_data[i].type, recv_data[i].start, recv_data[i].count,
+		    recv_data[i].buf, be);
+	}
+    }
+    _free_recv_data(var->client_num, recv_data);
+    free(offset);
+
+    *_region_num = region_num;
+    *_start = start;
+    *_count = count;
+    *_data = data;
+
+    return ret;
+}
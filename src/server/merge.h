@@ -0,0 +1,54 @@
+/****************************************************************************
+ *       Filename:  merge.h
+ *
+ *    Description:  merge the data of a var recieved from clients into one
+ *		    array in the type of the var in file
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _MERGE_H
+#define _MERGE_H
+
+#include <stdlib.h>
+
+#include "id.h"
+
+/**
+ * @brief: update a var's start and count, still store in cur_start and cur_count
+ *
+ * @param ndims: number of dim for the var
+ * @param cur_start: current start of the var
+ * @param cur_count: current count of the var
+ * @param new_start: new start which is to be updated into cur_start 
+ * @param new_count: new count which is to be updated into cur_count
+ */
+void cfio_merge_update_start_and_count(int ndims, 
+	size_t *cur_start, size_t *cur_count,
+	size_t *new_start, size_t *new_count);
+/**
+ * @brief: merge var data in recv_data, which is var's data vector or the 
+ *	vector of one record, the data of each client is converted into the
+ *	type of var, and freed after merged. the data is merged into the 
+ *	bounding box of the pieces if they cover it, else the pieces are
+ *	coalesced into rectangles, so the gaps are not allocated or written
+ *
+ * @param var: the var
+ * @param recv_data: the recv data vector of the var
+ * @param be: 1 if the merged data is to be stored in big-endian as in file, 
+ *	the swap is done while merging
+ * @param region_num: return amount of regions
+ * @param start: return start of the regions, region_num vectors of 
+ *	var->ndims, should be freed by caller
+ * @param count: return count of the regions, as start
+ * @param data: return the data of the regions one by one, should be freed 
+ *	by caller
+ *
+ * @return: error code
+ */
+int cfio_merge_var_data(
+	cfio_id_var_t *var, cfio_id_data_t *recv_data, int be,
+	int *region_num, size_t **start, size_t **count, char **data);
+
+#endif
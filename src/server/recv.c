@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 #include "msg.h"
 #include "recv.h"
@@ -27,27 +28,31 @@
 #include "cfio_types.h"
 #include "cfio_error.h"
 #include "define.h"
+#include "trace.h"
+#include "stats.h"
+#include "transport.h"
+#include "latency.h"
+#include "io.h"
 
-static cfio_msg_t *msg_head;
+static cfio_proc_local cfio_msg_t *msg_head;
 //use two buffer swap, in client :writer for pack, reader for send
-static cfio_buf_t **buffer;
+static cfio_proc_local cfio_buf_t **buffer;
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t empty_cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t empty_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t full_cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t full_mutex = PTHREAD_MUTEX_INITIALIZER;
-static int rank;
-static int client_num;
-/* index used when call cfio_recv_get_first */
-static int client_get_index = 0;
-static int max_msg_size;
-size_t total_size = 0, min_size = 0, max_size = 0;
-
-int cfio_recv_init()
+static cfio_proc_local int rank;
+static cfio_proc_local int client_num;
+/* index where cfio_recv_get_first begins to look at the queues */
+static cfio_proc_local int client_get_index = 0;
+static cfio_proc_local int max_msg_size;
+
+int cfio_recv_init(int server_id)
 {
     int i, error;
 
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    rank = server_id;
 
     client_num = cfio_map_get_client_num_of_server(rank);
 
@@ -87,9 +92,6 @@ int cfio_recv_final()
     MPI_Status status;
     int i = 0;
 
-//    printf("Server %d ; recv size : %f M; max size : %f M; min size : %lu B\n",
-//	    rank, total_size/1024.0/1024.0, max_size/1024.0/1024.0, min_size);
-
     if(msg_head != NULL)
     {
 	free(msg_head);
@@ -117,12 +119,11 @@ int cfio_iprobe(
 	int *src, int src_len, MPI_Comm comm, int *flag)
 {
     int i;
-    MPI_Status status;
     int _flag;
 
     for(i = 0; i < src_len; i ++)
     {
-	MPI_Iprobe(src[i], src[i], comm, &_flag, &status);
+	cfio_transport_iprobe(src[i], src[i], comm, &_flag);
 	if(_flag == 1)
 	{
 	    *flag = 1;
@@ -133,54 +134,39 @@ int cfio_iprobe(
     return CFIO_ERROR_NONE;
 }
 
-int cfio_recv(
-	int src, int rank, MPI_Comm comm, uint32_t *func_code)
+/**
+ * @brief: queue the msg at the free_addr of the buffer of a client
+ *
+ * @return: error code
+ */
+static int _queue_msg(
+	int src, int rank, int client_index, int size, uint32_t *func_code)
 {
-    MPI_Status status;
-    int size;
     cfio_msg_t *msg;
-    int client_index;
-
-    client_index = cfio_map_get_client_index_of_server(src);
-    //times_start();
-    debug(DEBUG_RECV, "client_index = %d", client_index);
-    if(is_free_space_enough(buffer[client_index], max_msg_size)
-	    == CFIO_BUF_FREE_SPACE_NOT_ENOUGH)
-    {
-	return CFIO_RECV_BUF_FULL;
-    }
-//    ensure_free_space(buffer[client_index], max_msg_size, 
-//	    cfio_recv_server_buf_free);
+    cfio_msg_head_t *head;
 
-    MPI_Recv(buffer[client_index]->free_addr, max_msg_size, MPI_BYTE, src,  
-	    MPI_ANY_TAG, comm, &status);
-    MPI_Get_count(&status, MPI_BYTE, &size);
     debug(DEBUG_RECV, "recv: size = %d", size);
-    //total_size += size;
-    //if(min_size == 0 || min_size > size)
-    //{
-    //    min_size = size;
-    //}
-    //if(max_size == 0 || max_size < size)
-    //{
-    //    max_size = size;
-    //}
+    cfio_stats_add(recv_num, 1);
+    cfio_stats_add(recv_bytes, size);
+    cfio_stats_min(&cfio_stats.recv_min_size, size);
+    cfio_stats_max(&cfio_stats.recv_max_size, size);
 
-    //printf("proc %d , recv: size = %d, from %d\n",rank, size, src);
-    //debug(DEBUG_RECV, "code = %u", *((uint32_t *)buffer->free_addr));
-
-    if(status.MPI_SOURCE != status.MPI_TAG)
+    head = (cfio_msg_head_t *)buffer[client_index]->free_addr;
+    if(CFIO_MSG_VERSION != head->version)
     {
-	return CFIO_ERROR_MPI_RECV;
+	error("msg version(%d) from client %d, expect %d.", 
+		head->version, src, CFIO_MSG_VERSION);
+	return CFIO_ERROR_MSG_VERSION;
     }
 
     msg = cfio_msg_create();
     msg->addr = buffer[client_index]->free_addr;
     msg->size = size;
-    msg->src = status.MPI_SOURCE;
+    msg->src = src;
     msg->dst = rank;
+    msg->recv_time = cfio_latency_on ? cfio_latency_now() : 0;
     // get the func_code but not unpack it
-    msg->func_code = *((uint32_t*)(msg->addr + sizeof(size_t))); 
+    msg->func_code = head->func_code; 
     *func_code = msg->func_code;
     debug(DEBUG_RECV, "func_code = %u", *func_code);
 
@@ -202,27 +188,184 @@ int cfio_recv(
     return CFIO_ERROR_NONE;
 }
 
-cfio_msg_t *cfio_recv_get_first()
+int cfio_recv(
+	int src, int rank, MPI_Comm comm, uint32_t *func_code)
 {
-    cfio_msg_t *_msg = NULL, *msg;
-    qlist_head_t *link;
-    size_t size;
+    int size, source, tag, ret;
+    int client_index;
+    cfio_trace_begin(t);
 
-    debug(DEBUG_RECV, "client_get_index = %d", client_get_index);
-    if(qlist_empty(&(msg_head[client_get_index].link)))
+    client_index = cfio_map_get_client_index_of_server(src);
+    //times_start();
+    debug(DEBUG_RECV, "client_index = %d", client_index);
+    if(is_free_space_enough(buffer[client_index], max_msg_size)
+	    == CFIO_BUF_FREE_SPACE_NOT_ENOUGH)
     {
-	link = NULL;
-    }else
+	cfio_stats_add(recv_buf_full, 1);
+	return CFIO_RECV_BUF_FULL;
+    }
+//    ensure_free_space(buffer[client_index], max_msg_size, 
+//	    cfio_recv_server_buf_free);
+
+    ret = cfio_transport_recv(buffer[client_index]->free_addr, max_msg_size,
+	    src, comm, &size, &source, &tag);
+    if(MPI_SUCCESS != ret)
     {
-	link = msg_head[client_get_index].link.next;
+	error("recv from client %d fail(%d).", src, ret);
+	return CFIO_ERROR_MPI_RECV;
     }
+    cfio_trace_end("recv", t, size);
+
+    //printf("proc %d , recv: size = %d, from %d\n",rank, size, src);
+    //debug(DEBUG_RECV, "code = %u", *((uint32_t *)buffer->free_addr));
 
-    if(NULL == link)
+    if(source != tag)
     {
-	msg = NULL;
+	return CFIO_ERROR_MPI_RECV;
+    }
+
+    return _queue_msg(source, rank, client_index, size, func_code);
+}
+
+int cfio_recv_put(
+	int src, int rank, const char *data, size_t size, uint32_t *func_code)
+{
+    int client_index;
+
+    client_index = cfio_map_get_client_index_of_server(src);
+    if(size > max_msg_size)
+    {
+	error("msg size(%lu) from client %d exceeds %d.", 
+		size, src, max_msg_size);
+	return CFIO_ERROR_MSG_UNPACK;
+    }
+    if(is_free_space_enough(buffer[client_index], max_msg_size)
+	    == CFIO_BUF_FREE_SPACE_NOT_ENOUGH)
+    {
+	cfio_stats_add(recv_buf_full, 1);
+	return CFIO_RECV_BUF_FULL;
+    }
+
+    memcpy(buffer[client_index]->free_addr, data, size);
+
+    return _queue_msg(src, rank, client_index, (int)size, func_code);
+}
+
+/**
+ * @brief: get the var of a put_vara, and its index in the record dimension, 0
+ *	if the var is not a record var
+ *
+ * @return: 1 if got, 0 if the var is not defined yet
+ */
+static int _peek_put_vara(cfio_msg_put_vara_t *vara, int client_index,
+	int *ncid, int *varid, int *rec)
+{
+    cfio_id_var_t *var;
+    char *addr;
+
+    if(CFIO_ID_HASH_GET_NULL == cfio_id_get_var(vara->ncid, vara->varid, 
+		&var) || var->ndims != vara->ndims)
+    {
+	return 0;
+    }
+    *ncid = vara->ncid;
+    *varid = vara->varid;
+    *rec = 0;
+    if(!var->is_record || 0 == var->ndims)
+    {
+	return 1;
+    }
+
+    addr = (char *)vara + sizeof(cfio_msg_put_vara_t);
+    if(vara->head.flags & CFIO_MSG_PUT_STAMP)
+    {
+	addr += sizeof(cfio_msg_stamp_t);
+    }
+    if(vara->head.flags & CFIO_MSG_PUT_DECOMP)
+    {
+	*rec = vara->start0;
+    }else if(vara->head.flags & CFIO_MSG_PUT_DELTA)
+    {
+	*rec = var->client_start[client_index * var->ndims] + 
+	    *(int32_t *)addr;
     }else
     {
-	msg = qlist_entry(link, cfio_msg_t, link);
+	*rec = *(uint64_t *)addr;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief: priority of the first msg of a queue. the msgs without data come
+ *	first, they hold the data queued behind them. a put_vara comes next if
+ *	more parts of its var are decoded, so that the var is merged, written
+ *	and freed as early as possible
+ *
+ * @return: the priority, client_num is the highest
+ */
+static int _priority(cfio_msg_t *msg, int client_index)
+{
+    cfio_msg_put_vara_t *vara;
+    int ncid, varid, rec;
+
+    switch(((cfio_msg_head_t *)msg->addr)->func_code)
+    {
+	case FUNC_NC_PUT_VARA :
+	    vara = (cfio_msg_put_vara_t *)msg->addr;
+	    break;
+	case FUNC_NC_PUT_VARA_MULTI :
+	    /* by its first var, the others are usually of the same step */
+	    vara = (cfio_msg_put_vara_t *)
+		(msg->addr + sizeof(cfio_msg_put_vara_multi_t));
+	    break;
+	default :
+	    return client_num;
+    }
+    if(!_peek_put_vara(vara, client_index, &ncid, &varid, &rec))
+    {
+	return 0;
+    }
+
+    return cfio_io_get_recv_num(ncid, rec, varid);
+}
+
+cfio_msg_t *cfio_recv_get_first()
+{
+    cfio_msg_t *_msg = NULL, *msg = NULL, *head;
+    qlist_head_t *link = NULL;
+    size_t size;
+    int i, index, priority, best = -1;
+    int start = client_get_index, best_index = 0;
+
+    /**
+     * clients may send different amount of msgs(e.g. LEADER_META), so skip
+     * the clients whose queue is empty, NULL only if all queues are empty.
+     * the msgs of a client are decoded in order, so the first msgs of the 
+     * queues are compared, the ties are broken round robin
+     **/
+    for(i = 0; i < client_num && best < client_num; i ++)
+    {
+	index = (start + i) % client_num;
+	if(qlist_empty(&(msg_head[index].link)))
+	{
+	    continue;
+	}
+	head = qlist_entry(msg_head[index].link.next, cfio_msg_t, link);
+	priority = _priority(head, index);
+	if(priority > best)
+	{
+	    best = priority;
+	    link = &head->link;
+	    msg = head;
+	    best_index = index;
+	}
+    }
+
+    if(NULL != link)
+    {
+	debug(DEBUG_RECV, "client_index = %d, priority = %d", 
+		best_index, best);
 	cfio_recv_unpack_msg_size(msg, &size);
 	if(msg->size == size) //only contain one single msg
 	{
@@ -233,11 +376,13 @@ cfio_msg_t *cfio_recv_get_first()
 	    msg->size -= size;
 	    _msg = cfio_msg_create();
 	    _msg->addr = msg->addr;
+	    _msg->size = size;
 	    _msg->src = msg->src;
 	    _msg->dst = msg->dst;
+	    _msg->recv_time = msg->recv_time;
 	    msg->addr += size;
 	}
-	client_get_index = (client_get_index + 1) % client_num;
+	client_get_index = (best_index + 1) % client_num;
     }
 
     if(_msg != NULL)
@@ -264,7 +409,7 @@ int cfio_recv_unpack_msg_size(cfio_msg_t *msg, size_t *size)
     assert(check_used_addr(msg->addr, buffer[client_index]));
     
     buffer[client_index]->used_addr = msg->addr;
-    cfio_buf_unpack_data(size, sizeof(size_t), buffer[client_index]);
+    *size = ((cfio_msg_head_t *)msg->addr)->size;
 
     debug(DEBUG_RECV, "size : %lu", *size);
 
@@ -283,7 +428,30 @@ int cfio_recv_unpack_func_code(cfio_msg_t *msg, uint32_t *func_code)
     //    debug_mark(DEBUG_RECV);
     //}
 
-    cfio_buf_unpack_data(func_code, sizeof(uint32_t), buffer[client_index]);
+    buffer[client_index]->used_addr = msg->addr;
+    *func_code = ((cfio_msg_head_t *)msg->addr)->func_code;
+    free_buf(buffer[client_index], sizeof(cfio_msg_head_t));
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: free the space of a msg in the buffer, include its padding, called
+ *	after the msg is unpacked
+ */
+static inline void _free_msg(cfio_msg_t *msg, int client_index)
+{
+    buffer[client_index]->used_addr = msg->addr;
+    free_buf(buffer[client_index], msg->size);
+}
+
+/**
+ * @brief: unpack a msg which only contains a nc id
+ */
+static inline int _unpack_nc_msg(cfio_msg_t *msg, int *ncid)
+{
+    *ncid = ((cfio_msg_nc_t *)msg->addr)->ncid;
+    _free_msg(msg, cfio_map_get_client_index_of_server(msg->src));
 
     return CFIO_ERROR_NONE;
 }
@@ -302,6 +470,39 @@ int cfio_recv_unpack_create(
 
     debug(DEBUG_RECV, "path = %s; cmode = %d, ncid = %d", *path, *cmode, *ncid);
 
+    _free_msg(msg, client_index);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_recv_unpack_create_from_schema(
+	cfio_msg_t *msg,
+	char **path, int *cmode, int *schemaid, int *ncid)
+{
+    int client_index;
+
+    client_index = cfio_map_get_client_index_of_server(msg->src);
+    
+    cfio_buf_unpack_str(path, buffer[client_index]);
+    cfio_buf_unpack_data(cmode, sizeof(int), buffer[client_index]);
+    cfio_buf_unpack_data(schemaid, sizeof(int), buffer[client_index]);
+    cfio_buf_unpack_data(ncid, sizeof(int), buffer[client_index]);
+
+    debug(DEBUG_RECV, "path = %s; cmode = %d, schemaid = %d, ncid = %d", 
+	    *path, *cmode, *schemaid, *ncid);
+
+    _free_msg(msg, client_index);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_recv_unpack_schema(
+	cfio_msg_t *msg,
+	int *schemaid)
+{
+    _unpack_nc_msg(msg, schemaid);
+    debug(DEBUG_RECV, "schemaid = %d", *schemaid);
+
     return CFIO_ERROR_NONE;
 }
 
@@ -320,6 +521,8 @@ int cfio_recv_unpack_def_dim(
     
     debug(DEBUG_RECV, "ncid = %d, name = %s, len = %lu", *ncid, *name, *len);
 
+    _free_msg(msg, client_index);
+
     return CFIO_ERROR_NONE;
 }
 
@@ -346,6 +549,32 @@ int cfio_recv_unpack_def_var(
     
     debug(DEBUG_RECV, "ncid = %d, name = %s, ndims = %u", *ncid, *name, *ndims);
 
+    _free_msg(msg, client_index);
+
+    return CFIO_ERROR_NONE;
+}
+int cfio_recv_unpack_def_var_part(
+	cfio_msg_t *msg,
+	int *ncid, int *ndims, size_t **start, size_t **count, 
+	int *is_record, int *varid)
+{
+    int client_index;
+
+    client_index = cfio_map_get_client_index_of_server(msg->src);
+    
+    cfio_buf_unpack_data(ncid, sizeof(int), buffer[client_index]);
+    cfio_buf_unpack_data_array((void **)start, ndims, 
+	    sizeof(size_t), buffer[client_index]);
+    cfio_buf_unpack_data_array((void **)count, ndims, 
+	    sizeof(size_t), buffer[client_index]);
+    cfio_buf_unpack_data(is_record, sizeof(int), buffer[client_index]);
+    cfio_buf_unpack_data(varid, sizeof(int), buffer[client_index]);
+    
+    debug(DEBUG_RECV, "ncid = %d, varid = %d, ndims = %u", 
+	    *ncid, *varid, *ndims);
+
+    _free_msg(msg, client_index);
+
     return CFIO_ERROR_NONE;
 }
 int cfio_recv_unpack_put_att(
@@ -370,6 +599,8 @@ int cfio_recv_unpack_put_att(
     debug(DEBUG_RECV, "ncid = %d, varid = %d, name = %s, len = %d",
 	    *ncid, *varid, *name, *len);
 
+    _free_msg(msg, client_index);
+
     return CFIO_ERROR_NONE;
 }
 
@@ -377,67 +608,117 @@ int cfio_recv_unpack_enddef(
 	cfio_msg_t *msg,
 	int *ncid)
 {
-    int client_index;
-
-    client_index = cfio_map_get_client_index_of_server(msg->src);
-    
-    cfio_buf_unpack_data(ncid, sizeof(int), buffer[client_index]);
+    _unpack_nc_msg(msg, ncid);
     debug(DEBUG_RECV, "ncid = %d", *ncid);
 
     return CFIO_ERROR_NONE;
 }
 
-int cfio_recv_unpack_put_vara(
-	cfio_msg_t *msg,
+/**
+ * @brief: unpack a put_vara at vara, which is a single msg or a part of
+ *	put_vara_multi, the buffer space is not freed
+ */
+static int _unpack_put_vara(
+	cfio_msg_put_vara_t *vara, cfio_msg_t *msg, int client_index,
 	int *ncid, int *varid, int *ndims, 
 	size_t **start, size_t **count,
-	int *data_len, int *fp_type, char **fp)
+	int *data_len, int *fp_type, char **fp, cfio_latency_stamp_t *stamp)
 {
-    int i;
-    int client_index;
+    int i, n;
+    size_t len, ele_size = 0, start_size;
+    size_t *client_start = NULL, *client_count = NULL;
+    cfio_id_var_t *var;
+    char *addr;
+    int32_t *delta;
+    uint64_t *full;
+
+    *ndims = 0;
+    *start = *count = NULL;
+    *fp = NULL;
+
+    n = vara->ndims;
+    addr = (char *)vara + sizeof(cfio_msg_put_vara_t);
+
+    memset(stamp, 0, sizeof(cfio_latency_stamp_t));
+    if(vara->head.flags & CFIO_MSG_PUT_STAMP)
+    {
+	stamp->call = ((cfio_msg_stamp_t *)addr)->call;
+	stamp->send = ((cfio_msg_stamp_t *)addr)->send;
+	stamp->recv = msg->recv_time;
+	stamp->decode = cfio_latency_on ? cfio_latency_now() : 0;
+	addr += sizeof(cfio_msg_stamp_t);
+    }
 
-    client_index = cfio_map_get_client_index_of_server(msg->src);
-    
+    if(vara->head.flags & (CFIO_MSG_PUT_DECOMP | CFIO_MSG_PUT_DELTA))
+    {
+	if(CFIO_ID_HASH_GET_NULL == cfio_id_get_var(vara->ncid, vara->varid,
+		    &var) || var->ndims != n)
+	{
+	    error("var(%d, %d) is not defined by client %d.", 
+		    vara->ncid, vara->varid, msg->src);
+	    return CFIO_ERROR_MSG_UNPACK;
+	}
+	client_start = var->client_start + client_index * n;
+	client_count = var->client_count + client_index * n;
+    }
 
-    cfio_buf_unpack_data(ncid, sizeof(int), buffer[client_index]);
-    cfio_buf_unpack_data(varid, sizeof(int), buffer[client_index]);
-    
-    cfio_buf_unpack_data_array((void**)start, ndims, sizeof(size_t), 
-	    buffer[client_index]);
-    cfio_buf_unpack_data_array((void**)count, ndims, sizeof(size_t),
-	    buffer[client_index]);
-
-//    cfio_buf_unpack_data_array_ptr((void**)fp, data_len, 
-//	    sizeof(float), buffer[client_index]);
-//
-    cfio_buf_unpack_data(fp_type, sizeof(int), buffer[client_index]);
-    switch(*fp_type)
-    {
-	case CFIO_BYTE :
-	    cfio_buf_unpack_data_array((void**)fp, data_len, 1, 
-		    buffer[client_index]);
-	    break;
-	case CFIO_CHAR :
-	    cfio_buf_unpack_data_array((void**)fp, data_len, 1, 
-		    buffer[client_index]);
-	    break;
-	case CFIO_SHORT :
-	    cfio_buf_unpack_data_array((void**)fp, data_len, sizeof(short), 
-		    buffer[client_index]);
-	    break;
-	case CFIO_INT :
-	    cfio_buf_unpack_data_array((void**)fp, data_len, sizeof(int), 
-		    buffer[client_index]);
-	    break;
-	case CFIO_FLOAT :
-	    cfio_buf_unpack_data_array((void**)fp, data_len, sizeof(float), 
-		    buffer[client_index]);
-	    break;
-	case CFIO_DOUBLE :
-	    cfio_buf_unpack_data_array((void**)fp, data_len, sizeof(double), 
-		    buffer[client_index]);
-	    break;
+    /* start and count are freed with the recv data, so never NULL */
+    *start = malloc(sizeof(size_t) * (n > 0 ? n : 1));
+    *count = malloc(sizeof(size_t) * (n > 0 ? n : 1));
+    if(NULL == *start || NULL == *count)
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    if(vara->head.flags & CFIO_MSG_PUT_DECOMP)
+    {
+	memcpy(*start, client_start, sizeof(size_t) * n);
+	memcpy(*count, client_count, sizeof(size_t) * n);
+	if(n > 0)
+	{
+	    (*start)[0] = vara->start0;
+	}
+	start_size = 0;
+    }else if(vara->head.flags & CFIO_MSG_PUT_DELTA)
+    {
+	delta = (int32_t *)addr;
+	for(i = 0; i < n; i ++)
+	{
+	    (*start)[i] = client_start[i] + delta[i];
+	    (*count)[i] = client_count[i] + delta[n + i];
+	}
+	start_size = cfio_msg_align(2 * n * sizeof(int32_t));
+    }else
+    {
+	full = (uint64_t *)addr;
+	for(i = 0; i < n; i ++)
+	{
+	    (*start)[i] = full[i];
+	    (*count)[i] = full[n + i];
+	}
+	start_size = 2 * n * sizeof(uint64_t);
     }
+    addr += start_size;
+
+    len = 1;
+    for(i = 0; i < n; i ++)
+    {
+	len *= (*count)[i];
+    }
+    cfio_types_size(ele_size, vara->fp_type);
+    /* data is kept until all clients' data arrive, so it must be copied out
+     * of the recv buffer */
+    *fp = malloc(len * ele_size);
+    if(NULL == *fp && 0 != len * ele_size)
+    {
+	return CFIO_ERROR_MALLOC;
+    }
+    memcpy(*fp, addr, len * ele_size);
+
+    *ncid = vara->ncid;
+    *varid = vara->varid;
+    *ndims = n;
+    *data_len = len;
+    *fp_type = vara->fp_type;
 
     debug(DEBUG_RECV, "ncid = %d, varid = %d, ndims = %d, data_len = %u", 
 	    *ncid, *varid, *ndims, *data_len);
@@ -445,16 +726,72 @@ int cfio_recv_unpack_put_vara(
     
     return CFIO_ERROR_NONE;
 }
-	
-int cfio_recv_unpack_close(
+
+int cfio_recv_unpack_put_vara(
 	cfio_msg_t *msg,
-	int *ncid)
+	int *ncid, int *varid, int *ndims, 
+	size_t **start, size_t **count,
+	int *data_len, int *fp_type, char **fp, cfio_latency_stamp_t *stamp)
+{
+    int ret, client_index;
+
+    client_index = cfio_map_get_client_index_of_server(msg->src);
+
+    ret = _unpack_put_vara((cfio_msg_put_vara_t *)msg->addr, 
+	    msg, client_index, ncid, varid, ndims, start, count, 
+	    data_len, fp_type, fp, stamp);
+    _free_msg(msg, client_index);
+
+    return ret;
+}
+
+int cfio_recv_unpack_put_vara_multi(
+	cfio_msg_t *msg,
+	int *ncid, int *n)
 {
     int client_index;
+    cfio_msg_put_vara_multi_t *multi;
 
     client_index = cfio_map_get_client_index_of_server(msg->src);
-    
-    cfio_buf_unpack_data(ncid, sizeof(int), buffer[client_index]);
+
+    multi = (cfio_msg_put_vara_multi_t *)msg->addr;
+    *ncid = multi->ncid;
+    *n = multi->n;
+
+    /* used_addr is the cursor of cfio_recv_unpack_put_vara_next */
+    buffer[client_index]->used_addr = msg->addr;
+    free_buf(buffer[client_index], sizeof(cfio_msg_put_vara_multi_t));
+
+    debug(DEBUG_RECV, "ncid = %d, n = %d", *ncid, *n);
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_recv_unpack_put_vara_next(
+	cfio_msg_t *msg,
+	int *ncid, int *varid, int *ndims, 
+	size_t **start, size_t **count,
+	int *data_len, int *fp_type, char **fp, cfio_latency_stamp_t *stamp)
+{
+    int ret, client_index;
+    cfio_msg_put_vara_t *vara;
+
+    client_index = cfio_map_get_client_index_of_server(msg->src);
+
+    vara = (cfio_msg_put_vara_t *)buffer[client_index]->used_addr;
+    ret = _unpack_put_vara(vara, msg, client_index, ncid, varid, ndims, 
+	    start, count, data_len, fp_type, fp, stamp);
+    /* the space of the unpacked part can be reused at once */
+    free_buf(buffer[client_index], vara->head.size);
+
+    return ret;
+}
+	
+int cfio_recv_unpack_close(
+	cfio_msg_t *msg,
+	int *ncid)
+{
+    _unpack_nc_msg(msg, ncid);
     debug(DEBUG_RECV, "ncid = %d", *ncid);
 
     return CFIO_ERROR_NONE;
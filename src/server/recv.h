@@ -18,6 +18,7 @@
 
 #include "msg.h"
 #include "cfio_types.h"
+#include "latency.h"
 
 #define RECV_BUF_SIZE ((size_t)1*1024*1024*1024)
 
@@ -26,9 +27,11 @@
 /**
  * @brief: init the buffer and msg queue
  *
+ * @param server_id: id of the server
+ *
  * @return: error code
  */
-int cfio_recv_init();
+int cfio_recv_init(int server_id);
 /**
  * @brief: finalize , free the buffer and msg queue
  *
@@ -48,11 +51,26 @@ int cfio_iprobe(
  */
 int cfio_recv(
 	int src, int rank, MPI_Comm comm, uint32_t *func_code);
+/**
+ * @brief: put a msg of a client into the queue without MPI, e.g. the msg read
+ *	from a capture file in replay
+ *
+ * @param src: the client who sent the msg
+ * @param rank: the server
+ * @param data: the msg
+ * @param size: size of the msg
+ * @param func_code: function code of the msg
+ *
+ * @return: error code, CFIO_RECV_BUF_FULL if the buffer of the client is full
+ */
+int cfio_recv_put(
+	int src, int rank, const char *data, size_t size, uint32_t *func_code);
 
 /**
- * @brief: get the first msg in msg queue
+ * @brief: get the first msg in msg queue, the clients' queues are visited 
+ *	round robin, and empty queues are skipped
  *
- * @return: pointer to the first msg
+ * @return: pointer to the first msg, NULL if all queues are empty
  */
 cfio_msg_t* cfio_recv_get_first();
 int cfio_recv_unpack_msg_size(cfio_msg_t *msg, size_t *size);
@@ -80,6 +98,31 @@ int cfio_recv_unpack_func_code(
 int cfio_recv_unpack_create(
 	cfio_msg_t *msg,
 	char **path, int *cmode, int *ncid);
+/**
+ * @brief: unpack arguments for cfio_create_from_schema function
+ *
+ * @param path: poiter to where the file anme of the new netCDF dataset is to be 
+ *	stored
+ * @param cmode: pointer to where the creation mode flag is to be stored
+ * @param schemaid: pointer to where the schema id is to be stored
+ * @param ncid: pointer to where the ncid assigned by client is to be stored
+ *
+ * @return: error code
+ */
+int cfio_recv_unpack_create_from_schema(
+	cfio_msg_t *msg,
+	char **path, int *cmode, int *schemaid, int *ncid);
+/**
+ * @brief: unpack arguments for cfio_schema_begin and cfio_schema_free 
+ *	function
+ *
+ * @param schemaid: pointer to where the schema id is to be stored
+ *
+ * @return: error code
+ */
+int cfio_recv_unpack_schema(
+	cfio_msg_t *msg,
+	int *schemaid);
 /**
  * @brief: unpack arguments for ifow_def_dim function
  *
@@ -117,6 +160,27 @@ int cfio_recv_unpack_def_var(
 	int *ncid, char **name, cfio_type *xtype,
 	int *ndims, int **dimids, 
 	size_t **start, size_t **count, int *varid);
+/**
+ * @brief: unpack the start and count of the cfio_def_var function which is 
+ *	sent by the client which is not leader in LEADER_META mode
+ *
+ * @param ncid: pointer to where netCDF ID is to be stored
+ * @param ndims: pointer to where number of dimensions for the variable is to be 
+ *	stored
+ * @param start: pointer to where the start index of to be written data value 
+ *	to be stored, need to be freed by the caller
+ * @param count: pointer to where the size of to be written data dimension len
+ *	value to be stored, need to be freed by the caller
+ * @param is_record: pointer to where whether the var is record var is to be 
+ *	stored
+ * @param varid: pointer to where the varid assigned by client is to be stored
+ *
+ * @return: error code
+ */
+int cfio_recv_unpack_def_var_part(
+	cfio_msg_t *msg,
+	int *ncid, int *ndims, size_t **start, size_t **count, 
+	int *is_record, int *varid);
 /**
  * @brief: unpack arguments for cfio_put_att
  *
@@ -160,6 +224,8 @@ int cfio_recv_unpack_enddef(
  * @param fp_type: pointer to type of data, can be CFIO_BYTE, CFIO_CHAR, 
  *	CFIO_SHROT, CFIO_INT, CFIO_FLOAT, CFIO_DOUBLE
  * @param fp: where the data is stored
+ * @param stamp: pointer to where the stamps of the put_vara are to be stored,
+ *	they are 0 if the put_vara is not stamped
  *
  * @return: error code
  */
@@ -167,7 +233,30 @@ int cfio_recv_unpack_put_vara(
 	cfio_msg_t *msg,
 	int *ncid, int *varid, int *ndims, 
 	size_t **start, size_t **count,
-	int *data_len, int *fp_type, char **fp);
+	int *data_len, int *fp_type, char **fp, cfio_latency_stamp_t *stamp);
+/**
+ * @brief: unpack the head of put_vara_multi, the put_varas in it are unpacked
+ *	by calling cfio_recv_unpack_put_vara_next n times
+ *
+ * @param ncid: pointer to where netCDF ID is to be stored
+ * @param n: pointer to where the amount of put_vara is to be stored
+ *
+ * @return: error code
+ */
+int cfio_recv_unpack_put_vara_multi(
+	cfio_msg_t *msg,
+	int *ncid, int *n);
+/**
+ * @brief: unpack the next put_vara of put_vara_multi, the args are the same 
+ *	as cfio_recv_unpack_put_vara
+ *
+ * @return: error code
+ */
+int cfio_recv_unpack_put_vara_next(
+	cfio_msg_t *msg,
+	int *ncid, int *varid, int *ndims, 
+	size_t **start, size_t **count,
+	int *data_len, int *fp_type, char **fp, cfio_latency_stamp_t *stamp);
 /**
  * @brief: unpack arguments for the cfio_close function
  *
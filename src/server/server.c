@@ -19,9 +19,13 @@
 #include "recv.h"
 #include "io.h"
 #include "id.h"
+#include "map.h"
 #include "mpi.h"
 #include "debug.h"
 #include "times.h"
+#include "trace.h"
+#include "stats.h"
+#include "tune.h"
 #include "define.h"
 #include "cfio_error.h"
 
@@ -30,12 +34,16 @@ static pthread_t writer;
 /* the thread listen to the mpi message and put data into buffer */
 static pthread_t reader;
 /* my real rank in mpi_comm_world */
-static int rank;
-static int server_proc_num;	    /* server group size */
+static cfio_proc_local int rank;
+static cfio_proc_local int server_proc_num;	    /* server group size */
 
-static int reader_done, writer_done;
+static cfio_proc_local int reader_done, writer_done;
+/* error which stops the writer before all clients finish */
+static cfio_proc_local int writer_error;
+/* CFIO_SERVER_DECODE_IO_END or CFIO_SERVER_DECODE_STREAM */
+static cfio_proc_local int decode_mode;
 
-static int decode(cfio_msg_t *msg)
+static int _decode(cfio_msg_t *msg)
 {	
     int client_id = 0;
     int ret = 0;
@@ -53,6 +61,27 @@ static int decode(cfio_msg_t *msg)
 	    debug(DEBUG_SERVER, "server %d done nc_create for client %d\n",
 		    rank,client_id);
 	    return CFIO_ERROR_NONE;
+	case FUNC_SCHEMA_BEGIN: 
+	    debug(DEBUG_SERVER,"server %d recv schema_begin from client %d",
+		    rank, client_id);
+	    cfio_io_schema_begin(msg);
+	    debug(DEBUG_SERVER, "server %d done schema_begin for client %d\n",
+		    rank,client_id);
+	    return CFIO_ERROR_NONE;
+	case FUNC_NC_CREATE_SCHEMA: 
+	    debug(DEBUG_SERVER,"server %d recv create_from_schema from client %d",
+		    rank, client_id);
+	    cfio_io_create_from_schema(msg);
+	    debug(DEBUG_SERVER, "server %d done create_from_schema for client %d\n",
+		    rank,client_id);
+	    return CFIO_ERROR_NONE;
+	case FUNC_SCHEMA_FREE: 
+	    debug(DEBUG_SERVER,"server %d recv schema_free from client %d",
+		    rank, client_id);
+	    cfio_io_schema_free(msg);
+	    debug(DEBUG_SERVER, "server %d done schema_free for client %d\n",
+		    rank,client_id);
+	    return CFIO_ERROR_NONE;
 	case FUNC_NC_DEF_DIM:
 	    debug(DEBUG_SERVER,"server %d recv nc_def_dim from client %d",
 		    rank, client_id);
@@ -67,6 +96,13 @@ static int decode(cfio_msg_t *msg)
 	    debug(DEBUG_SERVER, "server %d done nc_def_var for client %d\n",
 		    rank,client_id);
 	    return CFIO_ERROR_NONE;
+	case FUNC_NC_DEF_VAR_PART:
+	    debug(DEBUG_SERVER,"server %d recv nc_def_var_part from client %d",
+		    rank, client_id);
+	    cfio_io_def_var_part(msg);
+	    debug(DEBUG_SERVER, "server %d done nc_def_var_part for client %d\n",
+		    rank,client_id);
+	    return CFIO_ERROR_NONE;
 	case FUNC_PUT_ATT:
 	    debug(DEBUG_SERVER, "server %d recv nc_put_att from client %d",
 		    rank, client_id);
@@ -89,6 +125,14 @@ static int decode(cfio_msg_t *msg)
 		    "server %d done nc_put_vara_float from client %d\n", 
 		    rank, client_id);
 	    return CFIO_ERROR_NONE;
+	case FUNC_NC_PUT_VARA_MULTI:
+	    debug(DEBUG_SERVER,"server %d recv nc_put_vara_multi from client %d",
+		    rank, client_id);
+	    cfio_io_put_vara_multi(msg);
+	    debug(DEBUG_SERVER, 
+		    "server %d done nc_put_vara_multi from client %d\n", 
+		    rank, client_id);
+	    return CFIO_ERROR_NONE;
 	case FUNC_NC_CLOSE:
 	    debug(DEBUG_SERVER,"server %d recv nc_close from client %d",
 		    rank, client_id);
@@ -110,6 +154,23 @@ static int decode(cfio_msg_t *msg)
     }	
 }
 
+/**
+ * @brief: decode and handle a msg, traced as an event
+ */
+static int decode(cfio_msg_t *msg)
+{
+    int ret;
+    cfio_stats_begin(t);
+
+    ret = _decode(msg);
+    cfio_stats_add(decode_num, 1);
+    cfio_stats_time(decode_time, t);
+    cfio_tune_add_time(t);
+    cfio_trace_end("decode", t, msg->func_code);
+
+    return ret;
+}
+
 static void * cfio_reader(void *argv)
 {
     int ret = 0;
@@ -136,11 +197,37 @@ static inline void process_one(int client_num)
     for(i = 0; i < client_num; i++)
     {
 	msg = cfio_recv_get_first();
+	if(NULL == msg)
+	{
+	    break;
+	}
 	decode(msg);
 	free(msg);
     }
 }
 
+/**
+ * @brief: decode the queued msgs until a msg of client src arrives, used in
+ *	the stream mode before waiting for the msg. the msgs of each client are
+ *	decoded in the order they are sent, but the clients may be far apart,
+ *	so a msg must only depend on the earlier msgs of its own client, e.g.
+ *	create_from_schema takes the start and count of its client from the
+ *	schema, not of all clients
+ */
+static inline void _decode_until(int src)
+{
+    int flag;
+    cfio_msg_t *msg;
+
+    cfio_iprobe(&src, 1, cfio_map_get_comm(), &flag);
+    while(!flag && NULL != (msg = cfio_recv_get_first()))
+    {
+	decode(msg);
+	free(msg);
+	cfio_iprobe(&src, 1, cfio_map_get_comm(), &flag);
+    }
+}
+
 static void* cfio_writer(void *argv)
 {
     cfio_msg_t *msg;
@@ -149,7 +236,7 @@ static void* cfio_writer(void *argv)
     int *client_id;
     double comm_time = 0.0, IO_time = 0.0;
     double start_time = times_cur();
-    int decode_num, flag;
+    int decode_num, flag, ret;
 
     server_index = cfio_map_get_server_index(rank);
     client_num = cfio_map_get_client_num_of_server(rank);
@@ -161,19 +248,31 @@ static void* cfio_writer(void *argv)
     }
     cfio_map_get_clients(rank, client_id);
 
-    while(!writer_done)
+    while(!writer_done && CFIO_ERROR_NONE == writer_error)
     {
 	/*  recv from client one by one, to make sure that data recv and output in time */
 	//times_start();
 	for(i = 0; i < client_num; i ++)
 	{
-	    while(cfio_recv(client_id[i], rank, cfio_map_get_comm(), &func_code)
-		    == CFIO_RECV_BUF_FULL)
+	    if(CFIO_SERVER_DECODE_STREAM == decode_mode)
+	    {
+		_decode_until(client_id[i]);
+	    }
+	    while((ret = cfio_recv(client_id[i], rank, cfio_map_get_comm(),
+			    &func_code)) == CFIO_RECV_BUF_FULL)
 	    {
 	//times_start();
 		process_one(client_num);
 	//IO_time += times_end();
 	    }
+	    /* the transport fails, e.g. a proc over the loopback fails, no
+	     * more msg can be got */
+	    if(CFIO_ERROR_MPI_RECV == ret)
+	    {
+		error("server %d stops for recv fail.", rank);
+		writer_error = ret;
+		break;
+	    }
 	    if(func_code == FUNC_FINAL)
 	    {
 		debug(DEBUG_SERVER,"server(writer) %d recv client_end_io from client %d",
@@ -240,17 +339,85 @@ int cfio_server_start()
     int ret = 0;
 
     cfio_writer((void*)0);
+    return writer_error;
+}
+
+int cfio_server_replay_msg(int client_id, const char *data, size_t size)
+{
+    int ret;
+    uint32_t func_code;
+    cfio_msg_t *msg;
+
+    /* handle the msg as cfio_writer, except there is no msg to probe */
+    while((ret = cfio_recv_put(client_id, rank, data, size, &func_code))
+	    == CFIO_RECV_BUF_FULL)
+    {
+	process_one(cfio_map_get_client_num_of_server(rank));
+    }
+    if(ret < 0)
+    {
+	error("");
+	return ret;
+    }
+
+    if(func_code == FUNC_FINAL)
+    {
+	cfio_io_writer_done(client_id, &writer_done);
+    }else if(func_code == FUNC_IO_END || 
+	    CFIO_SERVER_DECODE_STREAM == decode_mode)
+    {
+	while(NULL != (msg = cfio_recv_get_first()))
+	{
+	    decode(msg);
+	    free(msg);
+	}
+    }
+
     return CFIO_ERROR_NONE;
 }
 
-int cfio_server_init()
+int cfio_server_replay_end()
+{
+    cfio_msg_t *msg;
+
+    while(NULL != (msg = cfio_recv_get_first()))
+    {
+	decode(msg);
+	free(msg);
+    }
+    if(!writer_done)
+    {
+	error("server %d doesn't get FINAL from all clients, the capture may "
+		"be truncated.", rank);
+	return CFIO_ERROR_UNEXPECTED_MSG;
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+int cfio_server_init(int server_id)
 {
     int ret = 0;
     int x_proc_num, y_proc_num;
+    char *mode;
 
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    rank = server_id;
+
+    decode_mode = CFIO_SERVER_DECODE_IO_END;
+    if(NULL != (mode = getenv(CFIO_SERVER_DECODE_ENV)))
+    {
+	if(0 == strcmp(mode, "stream"))
+	{
+	    decode_mode = CFIO_SERVER_DECODE_STREAM;
+	}else if(0 != strcmp(mode, "io_end"))
+	{
+	    error("invalid %s : %s, should be io_end or stream.",
+		    CFIO_SERVER_DECODE_ENV, mode);
+	    return CFIO_ERROR_INVALID_INIT_ARG;
+	}
+    }
 
-    if((ret = cfio_recv_init()) < 0)
+    if((ret = cfio_recv_init(rank)) < 0)
     {
 	error("");
 	return ret;
@@ -258,6 +425,7 @@ int cfio_server_init()
     
     reader_done = 0;
     writer_done = 0;
+    writer_error = CFIO_ERROR_NONE;
     
     if((ret = cfio_id_init(CFIO_ID_INIT_SERVER)) < 0)
     {
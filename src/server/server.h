@@ -15,12 +15,28 @@
 #ifndef _SERVER_H
 #define _SERVER_H
 
+#include <stdlib.h>
+
+/* env variable of when the server decodes the msgs it received :
+ * io_end : default, the msgs are decoded after IO_END of a step is received, 
+ *	or when the recv buffer of a client is full
+ * stream : the msgs are also decoded while the server waits for the next msg
+ *	of a client, so a var is merged and written as soon as all its parts 
+ *	arrive, and the recv buffers are freed earlier */
+#define CFIO_SERVER_DECODE_ENV	"CFIO_SERVER_DECODE"
+
+#define CFIO_SERVER_DECODE_IO_END	0
+#define CFIO_SERVER_DECODE_STREAM	1
+
 /**
  * @brief: init
  *
+ * @param server_id: id of the server, its rank in MPI_COMM_WORLD, or the 
+ *	captured one in replay
+ *
  * @return: error code
  */
-int cfio_server_init();
+int cfio_server_init(int server_id);
 /**
  * @brief: final 
  *
@@ -33,5 +49,23 @@ int cfio_server_final();
  * @return: error code
  */
 int cfio_server_start();
+/**
+ * @brief: handle a msg of a client read from a capture file instead of 
+ *	cfio_server_start, the queued msgs are decoded in the same way as a 
+ *	running server
+ *
+ * @param client_id: the client who produced the msg
+ * @param data: the msg
+ * @param size: size of the msg
+ *
+ * @return: error code
+ */
+int cfio_server_replay_msg(int client_id, const char *data, size_t size);
+/**
+ * @brief: decode the rest msgs after all captured msgs are replayed
+ *
+ * @return: error code
+ */
+int cfio_server_replay_end();
 
 #endif
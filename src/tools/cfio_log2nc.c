@@ -0,0 +1,407 @@
+/****************************************************************************
+ *       Filename:  cfio_log2nc.c
+ *
+ *    Description:  convert the logs written by the log backend into the
+ *		    netCDF file, run in parallel :
+ *		    mpirun -np N cfio_log2nc path [output]
+ *
+ *		    every proc reads the metadata from the index of server 0
+ *		    and defines the file collectively, then each proc writes
+ *		    the data blocks of the logs assigned to it (log i is
+ *		    handled by proc i % N) in independent mode
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpi.h"
+#include "pnetcdf.h"
+
+#include "backend_log.h"
+#include "cfio_types.h"
+#include "cfio_error.h"
+#include "debug.h"
+
+typedef struct
+{
+    int index_fd;
+    int data_fd;
+    size_t index_size;
+    size_t data_size;
+    cfio_log_head_t *head;	/* mmaped index file */
+    cfio_log_rec_t *recs;	/* records in the index file */
+    int rec_num;
+    char *data;			/* mmaped log file */
+}cfio_log_t;
+
+static int rank, size;
+
+/**
+ * @brief: mmap the index and the log file of a server
+ *
+ * @param path: path passed to cfio_create
+ * @param server_index: index of the server
+ * @param log: return the mmaped log
+ *
+ * @return: error code
+ */
+static int _open_log(const char *path, int server_index, cfio_log_t *log)
+{
+    char _path[PATH_MAX];
+    struct stat st;
+
+    memset(log, 0, sizeof(cfio_log_t));
+    log->index_fd = log->data_fd = -1;
+
+    snprintf(_path, PATH_MAX, "%s.%s.%d",
+	    path, CFIO_LOG_INDEX_SUFFIX, server_index);
+    if((log->index_fd = open(_path, O_RDONLY)) < 0 ||
+	    fstat(log->index_fd, &st) < 0)
+    {
+	error("open %s error(%s)", _path, strerror(errno));
+	return CFIO_ERROR_FILE;
+    }
+    log->index_size = st.st_size;
+    if(log->index_size < sizeof(cfio_log_head_t))
+    {
+	error("%s is truncated.", _path);
+	return CFIO_ERROR_FILE;
+    }
+    log->head = mmap(NULL, log->index_size, PROT_READ, MAP_SHARED,
+	    log->index_fd, 0);
+    if(MAP_FAILED == log->head)
+    {
+	log->head = NULL;
+	error("mmap %s error(%s)", _path, strerror(errno));
+	return CFIO_ERROR_FILE;
+    }
+    if(CFIO_LOG_MAGIC != log->head->magic ||
+	    CFIO_LOG_VERSION != log->head->version ||
+	    sizeof(cfio_log_rec_t) != log->head->rec_size)
+    {
+	error("%s is not a cfio log index.", _path);
+	return CFIO_ERROR_FILE;
+    }
+    log->recs = (cfio_log_rec_t *)(log->head + 1);
+    log->rec_num = (log->index_size - sizeof(cfio_log_head_t)) /
+	sizeof(cfio_log_rec_t);
+
+    snprintf(_path, PATH_MAX, "%s.%s.%d",
+	    path, CFIO_LOG_DATA_SUFFIX, server_index);
+    if((log->data_fd = open(_path, O_RDONLY)) < 0 ||
+	    fstat(log->data_fd, &st) < 0)
+    {
+	error("open %s error(%s)", _path, strerror(errno));
+	return CFIO_ERROR_FILE;
+    }
+    log->data_size = st.st_size;
+    if(log->data_size > 0)
+    {
+	log->data = mmap(NULL, log->data_size, PROT_READ, MAP_SHARED,
+		log->data_fd, 0);
+	if(MAP_FAILED == log->data)
+	{
+	    log->data = NULL;
+	    error("mmap %s error(%s)", _path, strerror(errno));
+	    return CFIO_ERROR_FILE;
+	}
+	madvise(log->data, log->data_size, MADV_SEQUENTIAL);
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+static void _close_log(cfio_log_t *log)
+{
+    if(NULL != log->data)
+    {
+	munmap(log->data, log->data_size);
+    }
+    if(NULL != log->head)
+    {
+	munmap(log->head, log->index_size);
+    }
+    if(log->data_fd >= 0)
+    {
+	close(log->data_fd);
+    }
+    if(log->index_fd >= 0)
+    {
+	close(log->index_fd);
+    }
+    memset(log, 0, sizeof(cfio_log_t));
+    log->index_fd = log->data_fd = -1;
+}
+
+static int _put_att(int nc_id, int var_id, char *name,
+	cfio_type xtype, int len, void *data)
+{
+    nc_type type = cfio_type_to_nc(xtype);
+
+    switch(xtype)
+    {
+	case CFIO_BYTE :
+	    return ncmpi_put_att_schar(nc_id, var_id, name, type, len,
+		    (const signed char *)data);
+	case CFIO_CHAR :
+	    return ncmpi_put_att_text(nc_id, var_id, name, len,
+		    (const char *)data);
+	case CFIO_SHORT :
+	    return ncmpi_put_att_short(nc_id, var_id, name, type, len,
+		    (const short *)data);
+	case CFIO_INT :
+	    return ncmpi_put_att_int(nc_id, var_id, name, type, len,
+		    (const int *)data);
+	case CFIO_FLOAT :
+	    return ncmpi_put_att_float(nc_id, var_id, name, type, len,
+		    (const float *)data);
+	case CFIO_DOUBLE :
+	    return ncmpi_put_att_double(nc_id, var_id, name, type, len,
+		    (const double *)data);
+	default :
+	    return NC_EBADTYPE;
+    }
+}
+
+static int _put_vara(int nc_id, int var_id, cfio_type xtype,
+	MPI_Offset *start, MPI_Offset *count, void *data)
+{
+    switch(xtype)
+    {
+	case CFIO_BYTE :
+	    return ncmpi_put_vara_schar(nc_id, var_id, start, count,
+		    (const signed char *)data);
+	case CFIO_CHAR :
+	    return ncmpi_put_vara_text(nc_id, var_id, start, count,
+		    (const char *)data);
+	case CFIO_SHORT :
+	    return ncmpi_put_vara_short(nc_id, var_id, start, count,
+		    (const short *)data);
+	case CFIO_INT :
+	    return ncmpi_put_vara_int(nc_id, var_id, start, count,
+		    (const int *)data);
+	case CFIO_FLOAT :
+	    return ncmpi_put_vara_float(nc_id, var_id, start, count,
+		    (const float *)data);
+	case CFIO_DOUBLE :
+	    return ncmpi_put_vara_double(nc_id, var_id, start, count,
+		    (const double *)data);
+	default :
+	    return NC_EBADTYPE;
+    }
+}
+
+/**
+ * @brief: define dims, vars and atts recorded in the log, the dim and var
+ *	ids assigned by pnetcdf are recorded in dim_ids and var_ids
+ */
+static int _define(int nc_id, cfio_log_t *log, int *dim_ids, int *var_ids)
+{
+    int i, j, ret = NC_NOERR;
+    int ndims;
+    int nc_dim_ids[CFIO_LOG_MAX_DIMS];
+    cfio_log_rec_t *rec;
+    char *name;
+
+    for(i = 0; i < log->rec_num; i ++)
+    {
+	rec = &log->recs[i];
+	name = log->data + rec->offset;
+	switch(rec->type)
+	{
+	    case CFIO_LOG_REC_DIM :
+		ret = ncmpi_def_dim(nc_id, name, rec->start[0],
+			&dim_ids[rec->id]);
+		break;
+	    case CFIO_LOG_REC_VAR :
+		ndims = rec->ndims;
+		for(j = 0; j < ndims; j ++)
+		{
+		    nc_dim_ids[j] = dim_ids[rec->start[j]];
+		}
+		ret = ncmpi_def_var(nc_id, name, cfio_type_to_nc(rec->xtype),
+			ndims, nc_dim_ids, &var_ids[rec->id]);
+		break;
+	    case CFIO_LOG_REC_ATT :
+		ret = _put_att(nc_id,
+			NC_GLOBAL == rec->id ? NC_GLOBAL : var_ids[rec->id],
+			name, rec->xtype, rec->ndims, name + strlen(name) + 1);
+		break;
+	    default :
+		break;
+	}
+	if(NC_NOERR != ret)
+	{
+	    error("define error(%s)", ncmpi_strerror(ret));
+	    return CFIO_ERROR_NC;
+	}
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: write all data blocks of the log
+ */
+static int _write(int nc_id, cfio_log_t *log, int *var_ids)
+{
+    int i, j, ret;
+    MPI_Offset start[CFIO_LOG_MAX_DIMS], count[CFIO_LOG_MAX_DIMS];
+    cfio_log_rec_t *rec;
+
+    for(i = 0; i < log->rec_num; i ++)
+    {
+	rec = &log->recs[i];
+	if(CFIO_LOG_REC_DATA != rec->type)
+	{
+	    continue;
+	}
+	if(rec->offset + rec->size > log->data_size)
+	{
+	    error("data block %d is out of the log.", i);
+	    return CFIO_ERROR_FILE;
+	}
+	for(j = 0; j < rec->ndims; j ++)
+	{
+	    start[j] = rec->start[j];
+	    count[j] = rec->count[j];
+	}
+	ret = _put_vara(nc_id, var_ids[rec->id], rec->xtype,
+		start, count, log->data + rec->offset);
+	if(NC_NOERR != ret)
+	{
+	    error("write var(%d) error(%s)", rec->id, ncmpi_strerror(ret));
+	    return CFIO_ERROR_NC;
+	}
+    }
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: count the logs path.idx.0, path.idx.1 ... which exist
+ */
+static int _get_server_num(const char *path)
+{
+    char _path[PATH_MAX];
+    struct stat st;
+    int num = 0;
+
+    while(1)
+    {
+	snprintf(_path, PATH_MAX, "%s.%s.%d",
+		path, CFIO_LOG_INDEX_SUFFIX, num);
+	if(stat(_path, &st) < 0)
+	{
+	    break;
+	}
+	num ++;
+    }
+
+    return num;
+}
+
+int main(int argc, char** argv)
+{
+    int i, ret, nc_id;
+    int server_num;
+    int *dim_ids = NULL, *var_ids = NULL;
+    char *path, *output;
+    cfio_log_t log;
+    int return_code = 0;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if(argc < 2)
+    {
+	if(0 == rank)
+	{
+	    printf("Usage : %s path [output]\n", argv[0]);
+	}
+	MPI_Finalize();
+	return 1;
+    }
+    path = argv[1];
+    output = argc > 2 ? argv[2] : argv[1];
+
+    if(0 == rank)
+    {
+	server_num = _get_server_num(path);
+    }
+    MPI_Bcast(&server_num, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if(0 == server_num)
+    {
+	if(0 == rank)
+	{
+	    error("no log of %s is found.", path);
+	}
+	MPI_Finalize();
+	return 1;
+    }
+
+    /* all servers record the same metadata, use the one of server 0 */
+    if(_open_log(path, 0, &log) < 0)
+    {
+	MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    dim_ids = malloc(sizeof(int) * log.rec_num);
+    var_ids = malloc(sizeof(int) * log.rec_num);
+    if(NULL == dim_ids || NULL == var_ids)
+    {
+	error("malloc fail.");
+	MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    ret = ncmpi_create(MPI_COMM_WORLD, output, log.head->cmode | NC_CLOBBER,
+	    MPI_INFO_NULL, &nc_id);
+    if(NC_NOERR != ret)
+    {
+	error("create %s error(%s)", output, ncmpi_strerror(ret));
+	MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if(_define(nc_id, &log, dim_ids, var_ids) < 0 ||
+	    NC_NOERR != ncmpi_enddef(nc_id))
+    {
+	MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    _close_log(&log);
+
+    ncmpi_begin_indep_data(nc_id);
+    for(i = rank; i < server_num; i += size)
+    {
+	if(_open_log(path, i, &log) < 0 ||
+		_write(nc_id, &log, var_ids) < 0)
+	{
+	    error("convert log %d fail.", i);
+	    return_code = 1;
+	}
+	_close_log(&log);
+    }
+    ncmpi_end_indep_data(nc_id);
+
+    ret = ncmpi_close(nc_id);
+    if(NC_NOERR != ret)
+    {
+	error("close %s error(%s)", output, ncmpi_strerror(ret));
+	return_code = 1;
+    }
+
+    free(dim_ids);
+    free(var_ids);
+
+    MPI_Finalize();
+    return return_code;
+}
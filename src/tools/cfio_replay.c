@@ -0,0 +1,361 @@
+/****************************************************************************
+ *       Filename:  cfio_replay.c
+ *
+ *    Description:  replay the msgs captured from the clients (CFIO_CAPTURE)
+ *		    through the server path, without the clients :
+ *		    mpirun -np N cfio_replay [-f] prefix
+ *
+ *		    the map of the captured run is rebuilt from the heads of
+ *		    the capture files, proc i acts as server i and handles the
+ *		    msgs of its clients in the order of their time, at the
+ *		    recorded speed, or as fast as possible with -f. the
+ *		    files are written to the paths of the captured run by the
+ *		    backend chosen by CFIO_BACKEND, and CFIO_TRACE, CFIO_STATS
+ *		    and CFIO_DEBUG work as in the server
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "mpi.h"
+
+#include "capture.h"
+#include "server.h"
+#include "map.h"
+#include "trace.h"
+#include "stats.h"
+#include "cfio_error.h"
+#include "debug.h"
+
+/**
+ * @brief: the msgs of a client, the next msg is read ahead
+ **/
+typedef struct
+{
+    int client_id;
+    FILE *fp;
+    int has_next;
+    cfio_capture_rec_t rec;	/* head of the next msg */
+    char *data;			/* the next msg */
+    size_t buf_size;
+}cfio_replay_stream_t;
+
+static int rank, size;
+
+static void _usage(const char *name)
+{
+    fprintf(stderr, "usage: mpirun -np N %s [-f] prefix\n"
+	    "  -f      replay as fast as possible, not at the recorded speed\n"
+	    "  prefix  CFIO_CAPTURE of the captured run\n", name);
+}
+
+/**
+ * @brief: read the heads of all capture files and rebuild the map, it's 
+ *	collective
+ *
+ * @param prefix: prefix of the capture files
+ * @param server_amount: return the server amount of the captured run
+ * @param server_comm: return the comm of the procs which act as servers
+ *
+ * @return: error code
+ */
+static int _init_map(const char *prefix, int *server_amount,
+	MPI_Comm *server_comm)
+{
+    char path[256];
+    FILE *fp;
+    cfio_capture_head_t head;
+    int i, client_amount, ret;
+    int *client_server, *client_index, *client_num, *expect_num;
+
+    snprintf(path, sizeof(path), "%s.0.cap", prefix);
+    if(NULL == (fp = cfio_capture_open(path, &head)))
+    {
+	return CFIO_ERROR_FILE;
+    }
+    fclose(fp);
+    client_amount = head.client_amount;
+    *server_amount = head.server_amount;
+
+    client_server = malloc(sizeof(int) * client_amount);
+    client_index = malloc(sizeof(int) * client_amount);
+    client_num = calloc(*server_amount, sizeof(int));
+    expect_num = calloc(*server_amount, sizeof(int));
+    if(NULL == client_server || NULL == client_index || 
+	    NULL == client_num || NULL == expect_num)
+    {
+	error("malloc fail for map.");
+	ret = CFIO_ERROR_MALLOC;
+	goto RETURN;
+    }
+
+    for(i = 0; i < client_amount; i ++)
+    {
+	snprintf(path, sizeof(path), "%s.%d.cap", prefix, i);
+	if(NULL == (fp = cfio_capture_open(path, &head)))
+	{
+	    ret = CFIO_ERROR_FILE;
+	    goto RETURN;
+	}
+	fclose(fp);
+	if(head.client_id != i || head.client_amount != client_amount ||
+		head.server_amount != *server_amount ||
+		head.server_index < 0 || head.server_index >= *server_amount)
+	{
+	    error("head of %s doesn't match the other capture files.", path);
+	    ret = CFIO_ERROR_INVALID_INIT_ARG;
+	    goto RETURN;
+	}
+	client_server[i] = head.server_index;
+	client_index[i] = head.client_index;
+	client_num[head.server_index] ++;
+	expect_num[head.server_index] = head.client_num;
+	if(head.client_index >= head.client_num)
+	{
+	    error("invalid client index in %s.", path);
+	    ret = CFIO_ERROR_INVALID_INIT_ARG;
+	    goto RETURN;
+	}
+    }
+    for(i = 0; i < *server_amount; i ++)
+    {
+	if(client_num[i] != expect_num[i])
+	{
+	    error("server %d has %d clients, but %d are captured.", 
+		    i, expect_num[i], client_num[i]);
+	    ret = CFIO_ERROR_INVALID_INIT_ARG;
+	    goto RETURN;
+	}
+    }
+
+    /* the procs more than the servers do nothing */
+    MPI_Comm_split(MPI_COMM_WORLD, rank < *server_amount ? 0 : 1, rank, 
+	    server_comm);
+    ret = cfio_map_init_table(client_amount, *server_amount,
+	    client_server, client_index, MPI_COMM_WORLD, *server_comm);
+
+RETURN:
+    free(client_server);
+    free(client_index);
+    free(client_num);
+    free(expect_num);
+    return ret;
+}
+
+/**
+ * @brief: read the next msg of a stream
+ *
+ * @return: error code
+ */
+static int _stream_next(cfio_replay_stream_t *stream)
+{
+    int ret;
+
+    ret = cfio_capture_next(stream->fp, &stream->rec,
+	    &stream->data, &stream->buf_size);
+    if(ret < 0)
+    {
+	error("read capture of client %d fail.", stream->client_id);
+	return ret;
+    }
+    stream->has_next = ret;
+
+    return CFIO_ERROR_NONE;
+}
+
+/**
+ * @brief: replay the msgs of the clients of the server
+ *
+ * @param prefix: prefix of the capture files
+ * @param fast: whether replay as fast as possible
+ * @param msg_num: return the amount of replayed msgs
+ * @param msg_bytes: return the size of replayed msgs
+ *
+ * @return: error code
+ */
+static int _replay(const char *prefix, int fast,
+	uint64_t *msg_num, uint64_t *msg_bytes)
+{
+    char path[256];
+    cfio_capture_head_t head;
+    cfio_replay_stream_t *streams, *next;
+    int i, client_num, server_id, ret = CFIO_ERROR_NONE;
+    int *client_id = NULL;
+    uint64_t start, now;
+    struct timespec ts;
+
+    server_id = cfio_map_get_client_amount() + rank;
+    client_num = cfio_map_get_client_num_of_server(server_id);
+    client_id = malloc(sizeof(int) * client_num);
+    streams = calloc(client_num, sizeof(cfio_replay_stream_t));
+    if(NULL == client_id || NULL == streams)
+    {
+	error("malloc fail for streams.");
+	free(client_id);
+	return CFIO_ERROR_MALLOC;
+    }
+    cfio_map_get_clients(server_id, client_id);
+
+    for(i = 0; i < client_num; i ++)
+    {
+	streams[i].client_id = client_id[i];
+	snprintf(path, sizeof(path), "%s.%d.cap", prefix, client_id[i]);
+	if(NULL == (streams[i].fp = cfio_capture_open(path, &head)))
+	{
+	    ret = CFIO_ERROR_FILE;
+	    goto RETURN;
+	}
+	if((ret = _stream_next(&streams[i])) < 0)
+	{
+	    goto RETURN;
+	}
+    }
+
+    if((ret = cfio_server_init(server_id)) < 0)
+    {
+	error("");
+	goto RETURN;
+    }
+
+    start = cfio_trace_now();
+    while(1)
+    {
+	next = NULL;
+	for(i = 0; i < client_num; i ++)
+	{
+	    if(streams[i].has_next &&
+		    (NULL == next || streams[i].rec.time < next->rec.time))
+	    {
+		next = streams + i;
+	    }
+	}
+	if(NULL == next)
+	{
+	    break;
+	}
+
+	now = cfio_trace_now() - start;
+	if(!fast && next->rec.time > now)
+	{
+	    ts.tv_sec = (next->rec.time - now) / 1000000000;
+	    ts.tv_nsec = (next->rec.time - now) % 1000000000;
+	    nanosleep(&ts, NULL);
+	}
+
+	if((ret = cfio_server_replay_msg(next->client_id,
+			next->data, next->rec.size)) < 0)
+	{
+	    break;
+	}
+	(*msg_num) ++;
+	(*msg_bytes) += next->rec.size;
+
+	if((ret = _stream_next(next)) < 0)
+	{
+	    break;
+	}
+    }
+    if(ret >= 0)
+    {
+	ret = cfio_server_replay_end();
+    }
+    cfio_server_final();
+
+RETURN:
+    for(i = 0; i < client_num; i ++)
+    {
+	if(NULL != streams[i].fp)
+	{
+	    fclose(streams[i].fp);
+	}
+	free(streams[i].data);
+    }
+    free(streams);
+    free(client_id);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    int opt, fast = 0, server_amount, ret = CFIO_ERROR_NONE;
+    char *prefix;
+    MPI_Comm server_comm;
+    uint64_t msg_num = 0, msg_bytes = 0;
+    double start, time;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    while(-1 != (opt = getopt(argc, argv, "f")))
+    {
+	switch(opt)
+	{
+	    case 'f':
+		fast = 1;
+		break;
+	    default:
+		if(0 == rank)
+		{
+		    _usage(argv[0]);
+		}
+		MPI_Finalize();
+		return 1;
+	}
+    }
+    if(optind >= argc)
+    {
+	if(0 == rank)
+	{
+	    _usage(argv[0]);
+	}
+	MPI_Finalize();
+	return 1;
+    }
+    prefix = argv[optind];
+
+    cfio_log_init(rank);
+    cfio_trace_init(rank);
+    cfio_stats_init(rank);
+
+    if((ret = _init_map(prefix, &server_amount, &server_comm)) < 0)
+    {
+	error("rebuild map from %s fail.", prefix);
+	MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if(0 == rank && size != server_amount)
+    {
+	fprintf(stderr, "%d servers are captured but %d procs are started, "
+		"only servers 0 ~ %d are replayed.\n", server_amount, size,
+		(size < server_amount ? size : server_amount) - 1);
+    }
+
+    start = MPI_Wtime();
+    if(rank < server_amount)
+    {
+	ret = _replay(prefix, fast, &msg_num, &msg_bytes);
+    }
+    time = MPI_Wtime() - start;
+    if(rank < server_amount)
+    {
+	printf("server %d replay %llu msgs, %llu bytes in %f s, %f MB/s%s\n",
+		rank, (unsigned long long)msg_num,
+		(unsigned long long)msg_bytes, time,
+		msg_bytes / time / 1024 / 1024, ret < 0 ? ", fail" : "");
+    }
+
+    cfio_map_final();
+    cfio_stats_final();
+    cfio_trace_final();
+    cfio_log_final();
+    MPI_Comm_free(&server_comm);
+    MPI_Finalize();
+
+    return ret < 0 ? 1 : 0;
+}
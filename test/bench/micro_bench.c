@@ -0,0 +1,575 @@
+/****************************************************************************
+ *       Filename:  micro_bench.c
+ *
+ *    Description:  microbenchmarks of the building blocks on the data path,
+ *		    run without MPI, each case prints ns/op and GB/s
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+
+#include "buffer.h"
+#include "bitmap.h"
+#include "convert.h"
+#include "id.h"
+#include "merge.h"
+#include "cfio_types.h"
+#include "cfio_error.h"
+
+/* a case is run with doubled amount of ops until it takes min_time */
+#define MIN_TIME_NS	200000000ULL
+#define MAX_OPS		((uint64_t)1 << 32)
+#define RING_SIZE	((size_t)16 << 20)
+#define RING_MSG_MAX	(RING_SIZE / 64)
+
+/**
+ * @brief: run n ops of a case
+ *
+ * @return: time of the ops, in ns, some cases need setup for each op, which is
+ *	not counted
+ */
+typedef uint64_t (*bench_op_t)(void *arg, uint64_t n);
+
+static uint64_t min_time = MIN_TIME_NS;
+static const char *filter = NULL;
+
+static uint64_t now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief: run a case and print its result
+ *
+ * @param name: name of the case
+ * @param bytes: bytes handled by an op, 0 if it's not a data op
+ * @param op: the op
+ * @param arg: arg of op
+ */
+static void run(const char *name, size_t bytes, bench_op_t op, void *arg)
+{
+    uint64_t n, t;
+    double ns;
+
+    if(NULL != filter && NULL == strstr(name, filter))
+    {
+	return;
+    }
+
+    op(arg, 1);
+    for(n = 1; ; n <<= 1)
+    {
+	t = op(arg, n);
+	if(t >= min_time || n >= MAX_OPS)
+	{
+	    break;
+	}
+    }
+
+    ns = (double)t / n;
+    if(bytes > 0)
+    {
+	printf("%-44s %14.1f ns/op %10.3f GB/s\n", name, ns, bytes / ns);
+    }else
+    {
+	printf("%-44s %14.1f ns/op %10s\n", name, ns, "-");
+    }
+    fflush(stdout);
+}
+
+/****************************************************************************
+ * buffer
+ ***************************************************************************/
+typedef struct
+{
+    cfio_buf_t *buf;
+    char *data;
+    size_t size;
+}buf_arg_t;
+
+static uint64_t pack_data(void *arg, uint64_t n)
+{
+    buf_arg_t *a = arg;
+    uint64_t i, t = now();
+
+    for(i = 0; i < n; i ++)
+    {
+	a->buf->free_addr = a->buf->used_addr = a->buf->start_addr;
+	cfio_buf_pack_data(a->data, a->size, a->buf);
+    }
+    return now() - t;
+}
+
+static uint64_t unpack_data(void *arg, uint64_t n)
+{
+    buf_arg_t *a = arg;
+    uint64_t i, t = now();
+
+    for(i = 0; i < n; i ++)
+    {
+	a->buf->used_addr = a->buf->start_addr;
+	a->buf->free_addr = a->buf->start_addr + a->size;
+	cfio_buf_unpack_data(a->data, a->size, a->buf);
+    }
+    return now() - t;
+}
+
+static uint64_t pack_data_array(void *arg, uint64_t n)
+{
+    buf_arg_t *a = arg;
+    uint64_t i, t = now();
+
+    for(i = 0; i < n; i ++)
+    {
+	a->buf->free_addr = a->buf->used_addr = a->buf->start_addr;
+	cfio_buf_pack_data_array(a->data, a->size / sizeof(int),
+		sizeof(int), a->buf);
+    }
+    return now() - t;
+}
+
+/* the unpacked array is malloced by unpack, so free is counted */
+static uint64_t unpack_data_array(void *arg, uint64_t n)
+{
+    buf_arg_t *a = arg;
+    uint64_t i, t = now();
+    void *data;
+    int len;
+
+    for(i = 0; i < n; i ++)
+    {
+	a->buf->used_addr = a->buf->start_addr;
+	a->buf->free_addr = a->buf->start_addr + a->size + sizeof(int);
+	cfio_buf_unpack_data_array(&data, &len, sizeof(int), a->buf);
+	free(data);
+    }
+    return now() - t;
+}
+
+static void bench_buf()
+{
+    size_t sizes[] = {64, 4096, 1 << 20};
+    char name[64];
+    int i, error;
+    buf_arg_t a;
+
+    a.buf = cfio_buf_open((1 << 20) + 64, &error);
+    a.data = malloc(1 << 20);
+    memset(a.data, 1, 1 << 20);
+    /* the array is unpacked from a packed one */
+    cfio_buf_pack_data_array(a.data, (1 << 20) / sizeof(int), sizeof(int),
+	    a.buf);
+
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i ++)
+    {
+	a.size = sizes[i];
+	sprintf(name, "buf_pack_data/%lu", sizes[i]);
+	run(name, a.size, pack_data, &a);
+	sprintf(name, "buf_unpack_data/%lu", sizes[i]);
+	run(name, a.size, unpack_data, &a);
+	sprintf(name, "buf_pack_data_array/%lu", sizes[i]);
+	run(name, a.size, pack_data_array, &a);
+	cfio_buf_clear(a.buf);
+	cfio_buf_pack_data_array(a.data, a.size / sizeof(int), sizeof(int),
+		a.buf);
+	sprintf(name, "buf_unpack_data_array/%lu", sizes[i]);
+	run(name, a.size, unpack_data_array, &a);
+    }
+
+    free(a.data);
+    cfio_buf_close(a.buf);
+}
+
+/****************************************************************************
+ * ring, a producer reserves msgs as _msg_begin, and the oldest msg is freed
+ * when the ring is full, as the sender does
+ ***************************************************************************/
+typedef struct
+{
+    cfio_buf_t *buf;
+    size_t size;
+    char *addr[RING_MSG_MAX];	/* msgs in the ring, FIFO */
+    int head, tail;
+}ring_arg_t;
+
+static ring_arg_t ring;
+
+static void ring_free()
+{
+    ring.buf->used_addr = ring.addr[ring.head];
+    free_buf(ring.buf, ring.size);
+    ring.head = (ring.head + 1) % RING_MSG_MAX;
+}
+
+static uint64_t ring_op(void *arg, uint64_t n)
+{
+    ring_arg_t *a = arg;
+    uint64_t i, t = now();
+
+    for(i = 0; i < n; i ++)
+    {
+	if((a->tail + 1) % RING_MSG_MAX == a->head)
+	{
+	    ring_free();
+	}
+	ensure_free_space(a->buf, a->size, ring_free);
+	a->addr[a->tail] = a->buf->free_addr;
+	a->tail = (a->tail + 1) % RING_MSG_MAX;
+	use_buf(a->buf, a->size);
+    }
+    return now() - t;
+}
+
+static void bench_ring()
+{
+    size_t sizes[] = {64, 4096, 1 << 20};
+    char name[64];
+    int i, error;
+
+    ring.buf = cfio_buf_open(RING_SIZE, &error);
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i ++)
+    {
+	cfio_buf_clear(ring.buf);
+	ring.head = ring.tail = 0;
+	ring.size = sizes[i];
+	sprintf(name, "ring_reserve_free/%lu", sizes[i]);
+	run(name, 0, ring_op, &ring);
+    }
+    cfio_buf_close(ring.buf);
+}
+
+/****************************************************************************
+ * convert
+ ***************************************************************************/
+typedef struct
+{
+    cfio_type dst_type, src_type;
+    void *dst, *src;
+    size_t n;
+    int be;
+}convert_arg_t;
+
+static uint64_t convert_op(void *arg, uint64_t n)
+{
+    convert_arg_t *a = arg;
+    uint64_t i, t = now();
+
+    for(i = 0; i < n; i ++)
+    {
+	if(a->be)
+	{
+	    cfio_convert_be(a->dst_type, a->dst, a->src_type, a->src, a->n);
+	}else
+	{
+	    cfio_convert(a->dst_type, a->dst, a->src_type, a->src, a->n);
+	}
+    }
+    return now() - t;
+}
+
+static void bench_convert()
+{
+    convert_arg_t a;
+    size_t src_size = 0;
+    char name[64];
+    int i;
+    struct
+    {
+	const char *name;
+	cfio_type dst_type, src_type;
+	int be;
+    }cases[] =
+    {
+	{"double_double", CFIO_DOUBLE, CFIO_DOUBLE, 0},
+	{"double_float", CFIO_FLOAT, CFIO_DOUBLE, 0},
+	{"float_double", CFIO_DOUBLE, CFIO_FLOAT, 0},
+	{"int_short", CFIO_SHORT, CFIO_INT, 0},
+	{"double_double_be", CFIO_DOUBLE, CFIO_DOUBLE, 1},
+	{"double_float_be", CFIO_FLOAT, CFIO_DOUBLE, 1},
+    };
+
+    a.n = 1 << 18;
+    a.src = calloc(a.n, sizeof(double));
+    a.dst = calloc(a.n, sizeof(double));
+    for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i ++)
+    {
+	a.dst_type = cases[i].dst_type;
+	a.src_type = cases[i].src_type;
+	a.be = cases[i].be;
+	cfio_types_size(src_size, a.src_type);
+	sprintf(name, "convert_%s/%lu", cases[i].name, a.n);
+	run(name, src_size * a.n, convert_op, &a);
+    }
+    free(a.src);
+    free(a.dst);
+}
+
+/****************************************************************************
+ * merge, the var is split into pieces of clients, which are merged as
+ * cfio_io_put_vara does
+ ***************************************************************************/
+typedef struct
+{
+    cfio_id_var_t var;
+    cfio_id_data_t *recv_data;
+    size_t *piece_start, *piece_count;	/* client_num * ndims */
+    cfio_type src_type;
+    char *src;
+    int be;
+}merge_arg_t;
+
+static uint64_t merge_op(void *arg, uint64_t n)
+{
+    merge_arg_t *a = arg;
+    int ndims = a->var.ndims, region_num, c, j;
+    size_t size = 0, piece_size;
+    size_t *start, *count;
+    char *data;
+    uint64_t i, t = 0, begin;
+
+    cfio_types_size(size, a->src_type);
+    for(i = 0; i < n; i ++)
+    {
+	/* the pieces are freed by merge, so they are made for each op */
+	for(c = 0; c < a->var.client_num; c ++)
+	{
+	    a->recv_data[c].start = malloc(sizeof(size_t) * ndims);
+	    a->recv_data[c].count = malloc(sizeof(size_t) * ndims);
+	    piece_size = size;
+	    for(j = 0; j < ndims; j ++)
+	    {
+		a->recv_data[c].start[j] = a->piece_start[c * ndims + j];
+		a->recv_data[c].count[j] = a->piece_count[c * ndims + j];
+		piece_size *= a->piece_count[c * ndims + j];
+	    }
+	    a->recv_data[c].buf = malloc(piece_size);
+	    memcpy(a->recv_data[c].buf, a->src, piece_size);
+	    a->recv_data[c].type = a->src_type;
+	}
+
+	begin = now();
+	cfio_merge_var_data(&a->var, a->recv_data, a->be,
+		&region_num, &start, &count, &data);
+	t += now() - begin;
+
+	free(start);
+	free(count);
+	free(data);
+    }
+    return t;
+}
+
+/**
+ * @brief: bench merge of a var of ndims dims, each dim is split into split[i]
+ *	pieces, the pieces with index % skip == skip - 1 are gaps if skip > 0
+ */
+static void bench_merge_case(int ndims, size_t *dims, int *split, int skip,
+	cfio_type src_type, cfio_type dst_type, int be)
+{
+    merge_arg_t a;
+    int i, j, c, idx, total = 1;
+    size_t size = 0, bytes = 0, piece_size;
+    char name[128], *p;
+
+    for(i = 0; i < ndims; i ++)
+    {
+	total *= split[i];
+    }
+
+    memset(&a, 0, sizeof(merge_arg_t));
+    a.var.name = "v";
+    a.var.ndims = ndims;
+    a.var.data_type = dst_type;
+    a.src_type = src_type;
+    a.be = be;
+    a.piece_start = malloc(sizeof(size_t) * ndims * total);
+    a.piece_count = malloc(sizeof(size_t) * ndims * total);
+    a.recv_data = calloc(total, sizeof(cfio_id_data_t));
+
+    cfio_types_size(size, src_type);
+    c = 0;
+    for(i = 0; i < total; i ++)
+    {
+	if(skip > 0 && i % skip == skip - 1)
+	{
+	    continue;
+	}
+	idx = i;
+	piece_size = size;
+	for(j = ndims - 1; j >= 0; j --)
+	{
+	    a.piece_count[c * ndims + j] = dims[j] / split[j];
+	    a.piece_start[c * ndims + j] =
+		(idx % split[j]) * a.piece_count[c * ndims + j];
+	    idx /= split[j];
+	    piece_size *= a.piece_count[c * ndims + j];
+	}
+	bytes += piece_size;
+	c ++;
+    }
+    a.var.client_num = c;
+    a.src = calloc(1, bytes / c);
+
+    p = name + sprintf(name, "merge_%dd", ndims);
+    for(i = 0; i < ndims; i ++)
+    {
+	p += sprintf(p, "%c%lu", 0 == i ? '/' : 'x', dims[i]);
+    }
+    sprintf(p, "/%d_pieces%s/%s", c, skip > 0 ? "_gaps" : "",
+	    src_type == dst_type ? (be ? "be" : "same_type") :
+	    (be ? "convert_be" : "convert"));
+    run(name, bytes, merge_op, &a);
+
+    free(a.src);
+    free(a.recv_data);
+    free(a.piece_start);
+    free(a.piece_count);
+}
+
+static void bench_merge()
+{
+    size_t dims2[] = {1024, 1024}, dims3[] = {32, 256, 256};
+    int split2[] = {2, 2}, split2_many[] = {8, 8}, split3[] = {1, 4, 4};
+
+    bench_merge_case(2, dims2, split2, 0, CFIO_DOUBLE, CFIO_DOUBLE, 0);
+    bench_merge_case(2, dims2, split2, 0, CFIO_DOUBLE, CFIO_FLOAT, 0);
+    bench_merge_case(2, dims2, split2, 0, CFIO_DOUBLE, CFIO_DOUBLE, 1);
+    bench_merge_case(2, dims2, split2_many, 0, CFIO_DOUBLE, CFIO_DOUBLE, 0);
+    bench_merge_case(2, dims2, split2_many, 3, CFIO_DOUBLE, CFIO_DOUBLE, 0);
+    bench_merge_case(3, dims3, split3, 0, CFIO_DOUBLE, CFIO_DOUBLE, 0);
+    bench_merge_case(3, dims3, split3, 0, CFIO_FLOAT, CFIO_FLOAT, 1);
+}
+
+/****************************************************************************
+ * id, lookup of vars by (client nc id, client var id) in server
+ ***************************************************************************/
+#define ID_NC_NUM	16
+#define ID_VAR_NUM	64
+
+static uint64_t id_op(void *arg, uint64_t n)
+{
+    uint64_t i, t = now();
+    cfio_id_var_t *var;
+    unsigned int r = 1;
+
+    for(i = 0; i < n; i ++)
+    {
+	r = r * 1103515245 + 12345;
+	cfio_id_get_var((r >> 8) % ID_NC_NUM + 1, (r >> 16) % ID_VAR_NUM, &var);
+    }
+    return now() - t;
+}
+
+static void bench_id()
+{
+    int i, j, dim_ids[2] = {0, 1};
+    size_t start[2] = {0, 0}, count[2] = {16, 16};
+    char name[16];
+
+    cfio_id_init(CFIO_ID_INIT_SERVER);
+    for(i = 1; i <= ID_NC_NUM; i ++)
+    {
+	cfio_id_map_nc(i, i);
+	for(j = 0; j < ID_VAR_NUM; j ++)
+	{
+	    sprintf(name, "v%d", j);
+	    cfio_id_map_var(name, i, j, i, j, 2, dim_ids, start, count,
+		    CFIO_DOUBLE, 4);
+	}
+    }
+    run("id_get_var/16_files_64_vars", 0, id_op, NULL);
+    cfio_id_final();
+}
+
+/****************************************************************************
+ * bitmap
+ ***************************************************************************/
+typedef struct
+{
+    uint8_t *bitmap;
+    int num;
+}bitmap_arg_t;
+
+static uint64_t bitmap_op(void *arg, uint64_t n)
+{
+    bitmap_arg_t *a = arg;
+    uint64_t i, t = now();
+    volatile int full;
+
+    for(i = 0; i < n; i ++)
+    {
+	full = cfio_bitmap_full(a->bitmap, a->num);
+    }
+    (void)full;
+    return now() - t;
+}
+
+static void bench_bitmap()
+{
+    int nums[] = {8, 64, 1024};
+    bitmap_arg_t a;
+    char name[64];
+    int i, j;
+
+    for(i = 0; i < sizeof(nums) / sizeof(nums[0]); i ++)
+    {
+	a.num = nums[i];
+	a.bitmap = calloc(cfio_bitmap_size(a.num), 1);
+	for(j = 0; j < a.num; j ++)
+	{
+	    cfio_bitmap_set(a.bitmap, j);
+	}
+	sprintf(name, "bitmap_full/%d", a.num);
+	run(name, 0, bitmap_op, &a);
+	free(a.bitmap);
+    }
+}
+
+static void usage()
+{
+    printf("Usage : micro_bench [-t ms] [filter]\n");
+    printf("\t-t ms : min time of each case, default %llu\n",
+	    MIN_TIME_NS / 1000000);
+    printf("\tfilter : only run the cases whose name contains it\n");
+}
+
+int main(int argc, char** argv)
+{
+    int opt;
+
+    while(-1 != (opt = getopt(argc, argv, "t:h")))
+    {
+	switch(opt)
+	{
+	    case 't' :
+		min_time = strtoull(optarg, NULL, 10) * 1000000;
+		break;
+	    default :
+		usage();
+		return -1;
+	}
+    }
+    if(optind < argc)
+    {
+	filter = argv[optind];
+    }
+
+    bench_buf();
+    bench_ring();
+    bench_convert();
+    bench_merge();
+    bench_id();
+    bench_bitmap();
+
+    return 0;
+}
@@ -0,0 +1,372 @@
+/****************************************************************************
+ *       Filename:  bench.c
+ *
+ *    Description:  benchmark driver, the shape of the output is set by
+ *		    options, and the result of all procs is written by rank 0
+ *		    as a line of JSON
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "mpi.h"
+#include "cfio.h"
+#include "times.h"
+
+/* result of a proc, reduced into rank 0 */
+typedef struct
+{
+    double client_io_time;	/* time in cfio calls of all steps */
+    double compute_time;	/* time of compute of all steps */
+    double client_time;		/* time of the steps */
+    double server_time;		/* time of server, from init to final */
+    double decode_time;		/* time in decode of server */
+    double data_bytes;		/* bytes put by client */
+    double write_bytes;		/* bytes written by server backend */
+    double max_rss;		/* max resident set size, in KB */
+    double is_server;
+}bench_result_t;
+
+#define _RESULT_NUM (sizeof(bench_result_t) / sizeof(double))
+
+static const char *type_names[] =
+{
+    NULL, "byte", "char", "short", "int", "float", "double"
+};
+
+static void usage()
+{
+    printf("Usage : bench [options]\n");
+    printf("\t-p XxY : client proc grid, default 2x2\n");
+    printf("\t-g LATxLON : size of each var, default 1024x1024\n");
+    printf("\t-v n : amount of vars, default 1\n");
+    printf("\t-t type : byte|short|int|float|double, default double\n");
+    printf("\t-r n : client : server ratio, default 4\n");
+    printf("\t-s n : amount of steps, a file is written each step, "
+	    "default 4\n");
+    printf("\t-c ms : compute time of each step, default 0\n");
+    printf("\t-b name : server backend, pnetcdf|posix|mem|null|log, "
+	    "default $CFIO_BACKEND or pnetcdf\n");
+    printf("\t-m : put all vars by one cfio_put_vara_multi\n");
+    printf("\t-d dir : output dir, default .\n");
+    printf("\t-o file : append the JSON result into file, default stdout\n");
+    printf("the procs must be X * Y + X * Y / ratio at least, the result is "
+	    "a line of JSON, so runs can be appended into a file\n");
+}
+
+static int parse_type(const char *name)
+{
+    int i;
+
+    for(i = 1; i < sizeof(type_names) / sizeof(type_names[0]); i ++)
+    {
+	if(CFIO_CHAR != i && 0 == strcmp(name, type_names[i]))
+	{
+	    return i;
+	}
+    }
+    return -1;
+}
+
+/**
+ * @brief: simulate compute by sleeping, so that the server procs can run
+ *	even if the procs are oversubscribed
+ */
+static void compute(int ms)
+{
+    struct timespec ts;
+
+    if(ms <= 0)
+    {
+	return;
+    }
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    nanosleep(&ts, NULL);
+}
+
+static void fill_data(char *buf, cfio_type type, size_t n, int rank)
+{
+    size_t i;
+
+    for(i = 0; i < n; i ++)
+    {
+	switch(type)
+	{
+	    case CFIO_BYTE :
+		((signed char *)buf)[i] = (signed char)(i + rank);
+		break;
+	    case CFIO_SHORT :
+		((short *)buf)[i] = (short)(i + rank);
+		break;
+	    case CFIO_INT :
+		((int *)buf)[i] = (int)(i + rank);
+		break;
+	    case CFIO_FLOAT :
+		((float *)buf)[i] = (float)(i + rank);
+		break;
+	    default :
+		((double *)buf)[i] = (double)(i + rank);
+		break;
+	}
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int rank, size, opt, type_id;
+    int x_proc = 2, y_proc = 2, var_num = 1, ratio = 4, steps = 4;
+    int compute_ms = 0, multi = 0;
+    size_t lat = 1024, lon = 1024;
+    cfio_type type = CFIO_DOUBLE;
+    char *dir = ".", *out = NULL, *backend;
+    char file_name[256], var_name[32];
+    int i, j, ncid, dimids[2], proc_type, client_num, server_num;
+    int *vars = NULL;
+    size_t start[2], count[2], n, elem_size = 0;
+    size_t **starts = NULL, **counts = NULL;
+    cfio_type *types = NULL;
+    void **bufs = NULL;
+    char *data = NULL;
+    double t, init_time;
+    cfio_stats_t stats;
+    struct rusage usage_info;
+    bench_result_t result, sum, max;
+    double overlap;
+    FILE *fp;
+
+    while(-1 != (opt = getopt(argc, argv, "p:g:v:t:r:s:c:b:md:o:h")))
+    {
+	switch(opt)
+	{
+	    case 'p' :
+		if(2 != sscanf(optarg, "%dx%d", &x_proc, &y_proc))
+		{
+		    usage();
+		    return -1;
+		}
+		break;
+	    case 'g' :
+		if(2 != sscanf(optarg, "%zux%zu", &lat, &lon))
+		{
+		    usage();
+		    return -1;
+		}
+		break;
+	    case 'v' :
+		var_num = atoi(optarg);
+		break;
+	    case 't' :
+		if((type_id = parse_type(optarg)) < 0)
+		{
+		    usage();
+		    return -1;
+		}
+		type = type_id;
+		break;
+	    case 'r' :
+		ratio = atoi(optarg);
+		break;
+	    case 's' :
+		steps = atoi(optarg);
+		break;
+	    case 'c' :
+		compute_ms = atoi(optarg);
+		break;
+	    case 'b' :
+		setenv("CFIO_BACKEND", optarg, 1);
+		break;
+	    case 'm' :
+		multi = 1;
+		break;
+	    case 'd' :
+		dir = optarg;
+		break;
+	    case 'o' :
+		out = optarg;
+		break;
+	    default :
+		usage();
+		return -1;
+	}
+    }
+    if(x_proc <= 0 || y_proc <= 0 || var_num <= 0 || ratio <= 0 ||
+	    steps <= 0 || lat % x_proc != 0 || lon % y_proc != 0)
+    {
+	printf("invalid options, LAT and LON must be divided by X and Y.\n");
+	usage();
+	return -1;
+    }
+    backend = getenv("CFIO_BACKEND");
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    memset(&result, 0, sizeof(bench_result_t));
+    cfio_types_size(elem_size, type);
+    start[0] = (rank % x_proc) * (lat / x_proc);
+    start[1] = (rank / x_proc) * (lon / y_proc);
+    count[0] = lat / x_proc;
+    count[1] = lon / y_proc;
+    n = count[0] * count[1];
+
+    /* server procs run in cfio_init until all clients finalize */
+    init_time = times_cur();
+    if(cfio_init(x_proc, y_proc, ratio) < 0)
+    {
+	printf("proc %d : cfio_init fail.\n", rank);
+	MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    proc_type = cfio_proc_type();
+
+    CFIO_START();
+    vars = malloc(sizeof(int) * var_num);
+    starts = malloc(sizeof(size_t *) * var_num);
+    counts = malloc(sizeof(size_t *) * var_num);
+    types = malloc(sizeof(cfio_type) * var_num);
+    bufs = malloc(sizeof(void *) * var_num);
+    data = malloc(elem_size * n);
+    if(NULL == vars || NULL == starts || NULL == counts || NULL == types ||
+	    NULL == bufs || NULL == data)
+    {
+	printf("proc %d : malloc fail.\n", rank);
+	MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    fill_data(data, type, n, rank);
+    for(j = 0; j < var_num; j ++)
+    {
+	starts[j] = start;
+	counts[j] = count;
+	types[j] = type;
+	bufs[j] = data;
+    }
+
+    result.client_time = times_cur();
+    for(i = 0; i < steps; i ++)
+    {
+	t = times_cur();
+	compute(compute_ms);
+	result.compute_time += times_cur() - t;
+
+	t = times_cur();
+	sprintf(file_name, "%s/bench-%d.nc", dir, i);
+	cfio_create(file_name, NC_64BIT_OFFSET, &ncid);
+	cfio_def_dim(ncid, "lat", lat, &dimids[0]);
+	cfio_def_dim(ncid, "lon", lon, &dimids[1]);
+	for(j = 0; j < var_num; j ++)
+	{
+	    sprintf(var_name, "v%d", j);
+	    cfio_def_var(ncid, var_name, type, 2, dimids, start, count,
+		    &vars[j]);
+	}
+	cfio_enddef(ncid);
+	if(multi)
+	{
+	    cfio_put_vara_multi(ncid, var_num, vars, starts, counts,
+		    types, bufs);
+	}else
+	{
+	    for(j = 0; j < var_num; j ++)
+	    {
+		if(CFIO_FLOAT == type)
+		{
+		    cfio_put_vara_float(ncid, vars[j], 2, start, count,
+			    (float *)data);
+		}else if(CFIO_DOUBLE == type)
+		{
+		    cfio_put_vara_double(ncid, vars[j], 2, start, count,
+			    (double *)data);
+		}else
+		{
+		    cfio_put_vara_multi(ncid, 1, vars + j, starts + j,
+			    counts + j, types + j, bufs + j);
+		}
+	    }
+	}
+	cfio_close(ncid);
+	cfio_io_end();
+	result.client_io_time += times_cur() - t;
+	result.data_bytes += (double)elem_size * n * var_num;
+    }
+    result.client_time = times_cur() - result.client_time;
+
+    free(vars);
+    free(starts);
+    free(counts);
+    free(types);
+    free(bufs);
+    free(data);
+    CFIO_END();
+    cfio_finalize();
+
+    if(CFIO_PROC_SERVER == proc_type)
+    {
+	result.is_server = 1;
+	result.server_time = times_cur() - init_time;
+	cfio_get_stats(&stats);
+	result.decode_time = stats.decode_time / 1e6;
+	result.write_bytes = stats.write_bytes;
+    }
+    getrusage(RUSAGE_SELF, &usage_info);
+    result.max_rss = usage_info.ru_maxrss;
+
+    MPI_Reduce(&result, &sum, _RESULT_NUM, MPI_DOUBLE, MPI_SUM, 0,
+	    MPI_COMM_WORLD);
+    MPI_Reduce(&result, &max, _RESULT_NUM, MPI_DOUBLE, MPI_MAX, 0,
+	    MPI_COMM_WORLD);
+    if(0 == rank)
+    {
+	client_num = x_proc * y_proc;
+	server_num = (int)sum.is_server;
+	/* fraction of the server decode time hidden from the clients, 1 if the
+	 * clients only pay for packing and sending */
+	overlap = sum.decode_time > 0 ?
+	    1.0 - (sum.client_io_time / client_num) /
+	    (sum.decode_time / server_num) : 0.0;
+	overlap = overlap < 0.0 ? 0.0 : overlap;
+	fp = NULL == out ? stdout : fopen(out, "a");
+	if(NULL == fp)
+	{
+	    printf("open %s fail.\n", out);
+	    fp = stdout;
+	}
+	fprintf(fp, "{\"procs\":%d,\"clients\":%d,\"servers\":%d,"
+		"\"lat\":%zu,\"lon\":%zu,\"vars\":%d,\"type\":\"%s\","
+		"\"ratio\":%d,\"steps\":%d,\"compute_ms\":%d,\"multi\":%d,"
+		"\"backend\":\"%s\",", size, client_num, server_num,
+		lat, lon, var_num, type_names[type], ratio, steps, compute_ms,
+		multi, NULL == backend ? "pnetcdf" : backend);
+	/* time in s, size in bytes, throughput of all servers in MB/s while 
+	 * they are decoding */
+	fprintf(fp, "\"data_bytes\":%.0f,\"client_io_time\":%.6f,"
+		"\"client_io_time_max\":%.6f,\"compute_time\":%.6f,"
+		"\"client_time_max\":%.6f,\"server_time_max\":%.6f,"
+		"\"server_decode_time\":%.6f,\"write_bytes\":%.0f,"
+		"\"server_throughput\":%.3f,\"overlap_efficiency\":%.4f,"
+		"\"max_rss_kb\":%.0f}\n",
+		sum.data_bytes, sum.client_io_time / client_num / 1000.0,
+		max.client_io_time / 1000.0,
+		sum.compute_time / client_num / 1000.0,
+		max.client_time / 1000.0, max.server_time / 1000.0,
+		server_num > 0 ? sum.decode_time / server_num / 1000.0 : 0.0,
+		sum.write_bytes, sum.decode_time > 0 ?
+		sum.write_bytes / 1e6 / (sum.decode_time / server_num / 1000.0) :
+		0.0,
+		overlap, max.max_rss);
+	if(stdout != fp)
+	{
+	    fclose(fp);
+	}
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,77 @@
+#!/bin/bash
+#############################################################################
+#       Filename:  bench_sweep.sh
+#
+#    Description:  run bench for each combination of the values of its
+#		   options, the JSON results are appended into a file
+#
+#	  Usage :  bench_sweep.sh out.json [bench options]
+#		   the values of -p -g -v -t -r -s -c -b can be comma
+#		   separated lists, e.g. bench_sweep.sh out.json -p 4x4
+#		   -r 4,8 -v 1,8 -b null,pnetcdf. MPIRUN is the mpirun
+#		   command, default "mpirun --oversubscribe", and BENCH is
+#		   the bench binary, default ./bench
+#		   BENCH can also be loadgen or compare_pnetcdf, their
+#		   spec file is passed as a bench option, e.g.
+#		   BENCH=./compare_pnetcdf bench_sweep.sh out.json -p 4x4
+#		   -r 2,4,8 climate.spec
+#############################################################################
+
+MPIRUN=${MPIRUN:-"mpirun --oversubscribe"}
+BENCH=${BENCH:-./bench}
+
+if [ $# -lt 1 ]; then
+    echo "Usage : bench_sweep.sh out.json [bench options]"
+    exit 1
+fi
+out=$1
+shift
+
+keys=()
+lists=()
+fixed=()
+while [ $# -gt 0 ]; do
+    case $1 in
+	-[pgvtrscb])
+	    keys+=(${1#-})
+	    lists+=("$2")
+	    shift 2
+	    ;;
+	*)
+	    fixed+=("$1")
+	    shift
+	    ;;
+    esac
+done
+
+# run the combinations of lists[$1..], the values chosen are in cur
+sweep()
+{
+    local i=$1 v procs ratio clients np
+    if [ $i -eq ${#keys[@]} ]; then
+	procs=2x2
+	ratio=4
+	for ((j = 0; j < ${#keys[@]}; j ++)); do
+	    [ ${keys[$j]} = p ] && procs=${cur[$j]}
+	    [ ${keys[$j]} = r ] && ratio=${cur[$j]}
+	done
+	clients=$(( ${procs%x*} * ${procs#*x} ))
+	np=$(( clients + clients / ratio ))
+	[ $(( clients / ratio )) -eq 0 ] && np=$(( clients + 1 ))
+	args=()
+	for ((j = 0; j < ${#keys[@]}; j ++)); do
+	    args+=(-${keys[$j]} ${cur[$j]})
+	done
+	echo "$MPIRUN -np $np $BENCH ${args[*]} ${fixed[*]} -o $out"
+	$MPIRUN -np $np $BENCH "${args[@]}" "${fixed[@]}" -o "$out" || exit 1
+	return
+    fi
+    IFS=, read -ra vals <<< "${lists[$i]}"
+    for v in "${vals[@]}"; do
+	cur[$i]=$v
+	sweep $(( i + 1 ))
+    done
+}
+
+cur=()
+sweep 0
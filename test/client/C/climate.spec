@@ -0,0 +1,39 @@
+# a synthetic climate model run, see workload.h for the directives
+grid 256 512 26
+steps 12
+compute 20
+
+# history file of every step, records appended
+file h0 every 1 record
+att title "synthetic atmosphere history"
+att source "cfio loadgen"
+att version int 1
+var T 3d float
+att units "K"
+att valid_range float 150 350
+var U 3d float
+att units "m/s"
+var PS 2d double
+att units "Pa"
+var PRECT 2d float
+var LANDMASK 2d int
+diag gmean 32 double 1
+diag zonal 16 float 8
+
+# 3-hourly surface fields
+file h1 every 3 offset 1
+att title "synthetic surface"
+var TS 2d float
+var SNOWH 2d float
+var ICEFRAC 2d short
+diag flux 8 double 4
+
+# restart, irregular steps
+file rst at 5,11
+att title "synthetic restart"
+var T 3d double
+var U 3d double
+var V 3d double
+var Q 3d double
+var PS 2d double
+var NSTEP 2d int
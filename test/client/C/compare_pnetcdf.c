@@ -0,0 +1,374 @@
+/****************************************************************************
+ *       Filename:  compare_pnetcdf.c
+ *
+ *    Description:  the workload of a spec file is written by the clients
+ *		    through collective PnetCDF directly, and then through
+ *		    cfio, the result of both is written by rank 0 as a line
+ *		    of JSON
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "mpi.h"
+#include "pnetcdf.h"
+#include "cfio.h"
+#include "times.h"
+#include "workload.h"
+
+/* result of a proc, reduced into rank 0 */
+typedef struct
+{
+    double pnetcdf_io_time;	/* time in PnetCDF calls of all steps */
+    double pnetcdf_client_time;	/* time of the steps */
+    double cfio_io_time;	/* time in cfio calls of all steps */
+    double cfio_client_time;
+    double data_bytes;		/* bytes put by client in each run */
+    double is_server;
+}compare_result_t;
+
+#define _RESULT_NUM (sizeof(compare_result_t) / sizeof(double))
+#define _MAX_DIMS 4
+
+/* the comm of the clients, which PnetCDF files are created in */
+static MPI_Comm pnetcdf_comm;
+
+static void usage()
+{
+    printf("Usage : compare_pnetcdf [options] spec_file\n");
+    printf("\t-p XxY : client proc grid, default 2x2\n");
+    printf("\t-r n : client : server ratio of cfio, default 4\n");
+    printf("\t-b name : server backend of cfio, pnetcdf|posix|mem|null|log, "
+	    "default $CFIO_BACKEND or pnetcdf\n");
+    printf("\t-d dir : output dir, the files are in dir/pnetcdf and "
+	    "dir/cfio, default .\n");
+    printf("\t-o file : append the JSON result into file, default stdout\n");
+    printf("the procs must be X * Y + X * Y / ratio at least, the X * Y "
+	    "clients write through PnetCDF first and then through cfio. "
+	    "speedup is the wall time of PnetCDF / the one of cfio, it's "
+	    "swept over ratios by BENCH=./compare_pnetcdf bench_sweep.sh\n");
+}
+
+static int _pnetcdf_create(char *path, int *ncid)
+{
+    return ncmpi_create(pnetcdf_comm, path, NC_64BIT_OFFSET, MPI_INFO_NULL,
+	    ncid);
+}
+
+static int _pnetcdf_def_dim(int ncid, char *name, size_t len, int *dimid)
+{
+    return ncmpi_def_dim(ncid, name, len, dimid);
+}
+
+/* start and count are only needed by cfio */
+static int _pnetcdf_def_var(int ncid, char *name, cfio_type type,
+	int ndims, int *dimids, size_t *start, size_t *count, int *varid)
+{
+    return ncmpi_def_var(ncid, name, (nc_type)type, ndims, dimids, varid);
+}
+
+static int _pnetcdf_put_att(int ncid, int varid, char *name, cfio_type type,
+	size_t len, void *data)
+{
+    nc_type xtype = (nc_type)type;
+
+    switch(type)
+    {
+	case CFIO_BYTE :
+	    return ncmpi_put_att_schar(ncid, varid, name, xtype, len, data);
+	case CFIO_CHAR :
+	    return ncmpi_put_att_text(ncid, varid, name, len, data);
+	case CFIO_SHORT :
+	    return ncmpi_put_att_short(ncid, varid, name, xtype, len, data);
+	case CFIO_INT :
+	    return ncmpi_put_att_int(ncid, varid, name, xtype, len, data);
+	case CFIO_FLOAT :
+	    return ncmpi_put_att_float(ncid, varid, name, xtype, len, data);
+	case CFIO_DOUBLE :
+	    return ncmpi_put_att_double(ncid, varid, name, xtype, len, data);
+    }
+    return NC_EBADTYPE;
+}
+
+static int _pnetcdf_put_vara(int ncid, int varid, int ndims, size_t *start,
+	size_t *count, cfio_type type, void *data)
+{
+    MPI_Offset _start[_MAX_DIMS], _count[_MAX_DIMS];
+    int i;
+
+    for(i = 0; i < ndims; i ++)
+    {
+	_start[i] = start[i];
+	_count[i] = count[i];
+    }
+    switch(type)
+    {
+	case CFIO_BYTE :
+	    return ncmpi_put_vara_schar_all(ncid, varid, _start, _count, data);
+	case CFIO_SHORT :
+	    return ncmpi_put_vara_short_all(ncid, varid, _start, _count, data);
+	case CFIO_INT :
+	    return ncmpi_put_vara_int_all(ncid, varid, _start, _count, data);
+	case CFIO_FLOAT :
+	    return ncmpi_put_vara_float_all(ncid, varid, _start, _count, data);
+	case CFIO_DOUBLE :
+	    return ncmpi_put_vara_double_all(ncid, varid, _start, _count, data);
+	default :
+	    return NC_EBADTYPE;
+    }
+}
+
+/* the data is written when a PnetCDF call returns */
+static int _pnetcdf_io_end()
+{
+    return 0;
+}
+
+static wl_writer_t pnetcdf_writer =
+{
+    .name	= "pnetcdf",
+    .create	= _pnetcdf_create,
+    .def_dim	= _pnetcdf_def_dim,
+    .def_var	= _pnetcdf_def_var,
+    .put_att	= _pnetcdf_put_att,
+    .enddef	= ncmpi_enddef,
+    .put_vara	= _pnetcdf_put_vara,
+    .close	= ncmpi_close,
+    .io_end	= _pnetcdf_io_end,
+};
+
+static int _cfio_create(char *path, int *ncid)
+{
+    return cfio_create(path, NC_64BIT_OFFSET, ncid);
+}
+
+static int _cfio_put_vara(int ncid, int varid, int ndims, size_t *start,
+	size_t *count, cfio_type type, void *data)
+{
+    return cfio_put_vara_multi(ncid, 1, &varid, &start, &count, &type, &data);
+}
+
+static wl_writer_t cfio_writer =
+{
+    .name	= "cfio",
+    .create	= _cfio_create,
+    .def_dim	= cfio_def_dim,
+    .def_var	= cfio_def_var,
+    .put_att	= cfio_put_att,
+    .enddef	= cfio_enddef,
+    .put_vara	= _cfio_put_vara,
+    .close	= cfio_close,
+    .io_end	= cfio_io_end,
+};
+
+/**
+ * @brief: make dir/sub by rank 0
+ *
+ * @return: the path, which is to be freed
+ */
+static char *_sub_dir(const char *dir, const char *sub, int rank)
+{
+    char *path = malloc(strlen(dir) + strlen(sub) + 2);
+
+    if(NULL == path)
+    {
+	return NULL;
+    }
+    sprintf(path, "%s/%s", dir, sub);
+    if(0 == rank && 0 != mkdir(path, 0755) && EEXIST != errno)
+    {
+	printf("mkdir %s fail.\n", path);
+	free(path);
+	return NULL;
+    }
+    return path;
+}
+
+int main(int argc, char** argv)
+{
+    int rank, size, opt, client_num, server_num;
+    int x_proc = 2, y_proc = 2, ratio = 4;
+    char *dir = ".", *out = NULL, *backend, *spec_path;
+    char *pnetcdf_dir, *cfio_dir;
+    wl_spec_t spec;
+    wl_decomp_t decomp;
+    wl_result_t wl_result;
+    compare_result_t result, sum, max;
+    double pnetcdf_wall, cfio_wall, t;
+    FILE *fp;
+
+    while(-1 != (opt = getopt(argc, argv, "p:r:b:d:o:h")))
+    {
+	switch(opt)
+	{
+	    case 'p' :
+		if(2 != sscanf(optarg, "%dx%d", &x_proc, &y_proc))
+		{
+		    usage();
+		    return -1;
+		}
+		break;
+	    case 'r' :
+		ratio = atoi(optarg);
+		break;
+	    case 'b' :
+		setenv("CFIO_BACKEND", optarg, 1);
+		break;
+	    case 'd' :
+		dir = optarg;
+		break;
+	    case 'o' :
+		out = optarg;
+		break;
+	    default :
+		usage();
+		return -1;
+	}
+    }
+    if(optind + 1 != argc || ratio <= 0)
+    {
+	usage();
+	return -1;
+    }
+    spec_path = argv[optind];
+    if(wl_spec_read(spec_path, &spec))
+    {
+	return -1;
+    }
+    if(wl_decomp_grid(&spec, x_proc, y_proc, 0, &decomp))
+    {
+	printf("invalid options, LAT and LON must be divided by X and Y.\n");
+	usage();
+	return -1;
+    }
+    backend = getenv("CFIO_BACKEND");
+    client_num = x_proc * y_proc;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if(size <= client_num)
+    {
+	if(0 == rank)
+	{
+	    usage();
+	}
+	MPI_Finalize();
+	return -1;
+    }
+
+    memset(&result, 0, sizeof(compare_result_t));
+    wl_decomp_grid(&spec, x_proc, y_proc, rank, &decomp);
+    pnetcdf_dir = _sub_dir(dir, "pnetcdf", rank);
+    cfio_dir = _sub_dir(dir, "cfio", rank);
+    if(NULL == pnetcdf_dir || NULL == cfio_dir)
+    {
+	MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    /* the ranks of the cfio clients write through PnetCDF, the others
+     * wait, as the cfio servers are procs added to the model */
+    MPI_Comm_split(MPI_COMM_WORLD, rank < client_num ? 0 : MPI_UNDEFINED,
+	    rank, &pnetcdf_comm);
+    MPI_Barrier(MPI_COMM_WORLD);
+    t = times_cur();
+    if(rank < client_num)
+    {
+	result.pnetcdf_client_time = times_cur();
+	if(wl_run(&spec, &pnetcdf_writer, &decomp, pnetcdf_dir, &wl_result))
+	{
+	    printf("proc %d : run %s through PnetCDF fail.\n", rank,
+		    spec_path);
+	    MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+	result.pnetcdf_client_time = times_cur() -
+	    result.pnetcdf_client_time;
+	result.pnetcdf_io_time = wl_result.io_time;
+	result.data_bytes = wl_result.data_bytes;
+	MPI_Comm_free(&pnetcdf_comm);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    pnetcdf_wall = times_cur() - t;
+
+    /* the data of cfio is not written until cfio_finalize returns */
+    t = times_cur();
+    if(cfio_init(x_proc, y_proc, ratio) < 0)
+    {
+	printf("proc %d : cfio_init fail.\n", rank);
+	MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    if(CFIO_PROC_CLIENT == cfio_proc_type())
+    {
+	result.cfio_client_time = times_cur();
+	if(wl_run(&spec, &cfio_writer, &decomp, cfio_dir, &wl_result))
+	{
+	    printf("proc %d : run %s through cfio fail.\n", rank, spec_path);
+	    MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+	result.cfio_client_time = times_cur() - result.cfio_client_time;
+	result.cfio_io_time = wl_result.io_time;
+    }else if(CFIO_PROC_SERVER == cfio_proc_type())
+    {
+	result.is_server = 1;
+    }
+    cfio_finalize();
+    MPI_Barrier(MPI_COMM_WORLD);
+    cfio_wall = times_cur() - t;
+
+    MPI_Reduce(&result, &sum, _RESULT_NUM, MPI_DOUBLE, MPI_SUM, 0,
+	    MPI_COMM_WORLD);
+    MPI_Reduce(&result, &max, _RESULT_NUM, MPI_DOUBLE, MPI_MAX, 0,
+	    MPI_COMM_WORLD);
+    if(0 == rank)
+    {
+	server_num = (int)sum.is_server;
+	fp = NULL == out ? stdout : fopen(out, "a");
+	if(NULL == fp)
+	{
+	    printf("open %s fail.\n", out);
+	    fp = stdout;
+	}
+	fprintf(fp, "{\"spec\":\"%s\",\"procs\":%d,\"clients\":%d,"
+		"\"servers\":%d,\"lat\":%zu,\"lon\":%zu,\"lev\":%zu,"
+		"\"steps\":%d,\"compute_ms\":%d,\"ratio\":%d,"
+		"\"backend\":\"%s\",\"data_bytes\":%.0f,", spec_path, size,
+		client_num, server_num, spec.lat, spec.lon, spec.lev,
+		spec.steps, spec.compute_ms, ratio,
+		NULL == backend ? "pnetcdf" : backend, sum.data_bytes);
+	/* time in s, the blocking time is the one a client is in the I/O
+	 * calls, the wall time is from the start of the steps till the data
+	 * is written by all procs */
+	fprintf(fp, "\"pnetcdf_blocking_time\":%.6f,"
+		"\"pnetcdf_blocking_time_max\":%.6f,"
+		"\"pnetcdf_client_time_max\":%.6f,\"pnetcdf_wall_time\":%.6f,"
+		"\"cfio_blocking_time\":%.6f,\"cfio_blocking_time_max\":%.6f,"
+		"\"cfio_client_time_max\":%.6f,\"cfio_wall_time\":%.6f,"
+		"\"speedup\":%.4f,\"blocking_speedup\":%.4f}\n",
+		sum.pnetcdf_io_time / client_num / 1000.0,
+		max.pnetcdf_io_time / 1000.0,
+		max.pnetcdf_client_time / 1000.0, pnetcdf_wall / 1000.0,
+		sum.cfio_io_time / client_num / 1000.0,
+		max.cfio_io_time / 1000.0,
+		max.cfio_client_time / 1000.0, cfio_wall / 1000.0,
+		cfio_wall > 0 ? pnetcdf_wall / cfio_wall : 0.0,
+		max.cfio_io_time > 0 ?
+		max.pnetcdf_io_time / max.cfio_io_time : 0.0);
+	if(stdout != fp)
+	{
+	    fclose(fp);
+	}
+    }
+
+    free(pnetcdf_dir);
+    free(cfio_dir);
+    wl_spec_free(&spec);
+    MPI_Finalize();
+    return 0;
+}
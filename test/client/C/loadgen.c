@@ -0,0 +1,224 @@
+/****************************************************************************
+ *       Filename:  loadgen.c
+ *
+ *    Description:  synthetic climate model load generator, the workload of a
+ *		    spec file is written through cfio, and the result of all
+ *		    procs is written by rank 0 as a line of JSON
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mpi.h"
+#include "cfio.h"
+#include "times.h"
+#include "workload.h"
+
+/* result of a proc, reduced into rank 0 */
+typedef struct
+{
+    double client_io_time;	/* time in cfio calls of all steps */
+    double compute_time;	/* time of compute of all steps */
+    double client_time;		/* time of the steps */
+    double server_time;		/* time of server, from init to final */
+    double decode_time;		/* time in decode of server */
+    double data_bytes;		/* bytes put by client */
+    double write_bytes;		/* bytes written by server backend */
+    double file_count;		/* files created by client */
+    double is_server;
+}loadgen_result_t;
+
+#define _RESULT_NUM (sizeof(loadgen_result_t) / sizeof(double))
+
+static void usage()
+{
+    printf("Usage : loadgen [options] spec_file\n");
+    printf("\t-p XxY : client proc grid, default 2x2\n");
+    printf("\t-r n : client : server ratio, default 4\n");
+    printf("\t-b name : server backend, pnetcdf|posix|mem|null|log, "
+	    "default $CFIO_BACKEND or pnetcdf\n");
+    printf("\t-d dir : output dir, default .\n");
+    printf("\t-o file : append the JSON result into file, default stdout\n");
+    printf("the procs must be X * Y + X * Y / ratio at least, see "
+	    "workload.h for the spec file\n");
+}
+
+static int _create(char *path, int *ncid)
+{
+    return cfio_create(path, NC_64BIT_OFFSET, ncid);
+}
+
+static int _put_vara(int ncid, int varid, int ndims, size_t *start,
+	size_t *count, cfio_type type, void *data)
+{
+    if(CFIO_FLOAT == type)
+    {
+	return cfio_put_vara_float(ncid, varid, ndims, start, count, data);
+    }else if(CFIO_DOUBLE == type)
+    {
+	return cfio_put_vara_double(ncid, varid, ndims, start, count, data);
+    }
+    return cfio_put_vara_multi(ncid, 1, &varid, &start, &count, &type, &data);
+}
+
+static wl_writer_t cfio_writer =
+{
+    .name	= "cfio",
+    .create	= _create,
+    .def_dim	= cfio_def_dim,
+    .def_var	= cfio_def_var,
+    .put_att	= cfio_put_att,
+    .enddef	= cfio_enddef,
+    .put_vara	= _put_vara,
+    .close	= cfio_close,
+    .io_end	= cfio_io_end,
+};
+
+int main(int argc, char** argv)
+{
+    int rank, size, opt, proc_type, client_num, server_num;
+    int x_proc = 2, y_proc = 2, ratio = 4;
+    char *dir = ".", *out = NULL, *backend, *spec_path;
+    wl_spec_t spec;
+    wl_decomp_t decomp;
+    wl_result_t wl_result;
+    loadgen_result_t result, sum, max;
+    cfio_stats_t stats;
+    double init_time;
+    FILE *fp;
+
+    while(-1 != (opt = getopt(argc, argv, "p:r:b:d:o:h")))
+    {
+	switch(opt)
+	{
+	    case 'p' :
+		if(2 != sscanf(optarg, "%dx%d", &x_proc, &y_proc))
+		{
+		    usage();
+		    return -1;
+		}
+		break;
+	    case 'r' :
+		ratio = atoi(optarg);
+		break;
+	    case 'b' :
+		setenv("CFIO_BACKEND", optarg, 1);
+		break;
+	    case 'd' :
+		dir = optarg;
+		break;
+	    case 'o' :
+		out = optarg;
+		break;
+	    default :
+		usage();
+		return -1;
+	}
+    }
+    if(optind + 1 != argc || ratio <= 0)
+    {
+	usage();
+	return -1;
+    }
+    spec_path = argv[optind];
+    if(wl_spec_read(spec_path, &spec))
+    {
+	return -1;
+    }
+    if(wl_decomp_grid(&spec, x_proc, y_proc, 0, &decomp))
+    {
+	printf("invalid options, LAT and LON must be divided by X and Y.\n");
+	usage();
+	return -1;
+    }
+    backend = getenv("CFIO_BACKEND");
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    memset(&result, 0, sizeof(loadgen_result_t));
+    wl_decomp_grid(&spec, x_proc, y_proc, rank, &decomp);
+
+    /* server procs run in cfio_init until all clients finalize */
+    init_time = times_cur();
+    if(cfio_init(x_proc, y_proc, ratio) < 0)
+    {
+	printf("proc %d : cfio_init fail.\n", rank);
+	MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    proc_type = cfio_proc_type();
+
+    if(CFIO_PROC_CLIENT == proc_type)
+    {
+	result.client_time = times_cur();
+	if(wl_run(&spec, &cfio_writer, &decomp, dir, &wl_result))
+	{
+	    printf("proc %d : run %s fail.\n", rank, spec_path);
+	    MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+	result.client_time = times_cur() - result.client_time;
+	result.client_io_time = wl_result.io_time;
+	result.compute_time = wl_result.compute_time;
+	result.data_bytes = wl_result.data_bytes;
+	result.file_count = wl_result.file_count;
+    }
+    cfio_finalize();
+
+    if(CFIO_PROC_SERVER == proc_type)
+    {
+	result.is_server = 1;
+	result.server_time = times_cur() - init_time;
+	cfio_get_stats(&stats);
+	result.decode_time = stats.decode_time / 1e6;
+	result.write_bytes = stats.write_bytes;
+    }
+
+    MPI_Reduce(&result, &sum, _RESULT_NUM, MPI_DOUBLE, MPI_SUM, 0,
+	    MPI_COMM_WORLD);
+    MPI_Reduce(&result, &max, _RESULT_NUM, MPI_DOUBLE, MPI_MAX, 0,
+	    MPI_COMM_WORLD);
+    if(0 == rank)
+    {
+	client_num = x_proc * y_proc;
+	server_num = (int)sum.is_server;
+	fp = NULL == out ? stdout : fopen(out, "a");
+	if(NULL == fp)
+	{
+	    printf("open %s fail.\n", out);
+	    fp = stdout;
+	}
+	fprintf(fp, "{\"spec\":\"%s\",\"procs\":%d,\"clients\":%d,"
+		"\"servers\":%d,\"lat\":%zu,\"lon\":%zu,\"lev\":%zu,"
+		"\"files\":%d,\"steps\":%d,\"compute_ms\":%d,\"ratio\":%d,"
+		"\"backend\":\"%s\",", spec_path, size, client_num, server_num,
+		spec.lat, spec.lon, spec.lev, spec.file_num, spec.steps,
+		spec.compute_ms, ratio, NULL == backend ? "pnetcdf" : backend);
+	/* time in s, size in bytes */
+	fprintf(fp, "\"files_created\":%.0f,\"data_bytes\":%.0f,"
+		"\"client_io_time\":%.6f,\"client_io_time_max\":%.6f,"
+		"\"compute_time\":%.6f,\"client_time_max\":%.6f,"
+		"\"server_time_max\":%.6f,\"server_decode_time\":%.6f,"
+		"\"write_bytes\":%.0f}\n",
+		max.file_count, sum.data_bytes,
+		sum.client_io_time / client_num / 1000.0,
+		max.client_io_time / 1000.0,
+		sum.compute_time / client_num / 1000.0,
+		max.client_time / 1000.0, max.server_time / 1000.0,
+		server_num > 0 ? sum.decode_time / server_num / 1000.0 : 0.0,
+		sum.write_bytes);
+	if(stdout != fp)
+	{
+	    fclose(fp);
+	}
+    }
+
+    wl_spec_free(&spec);
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,117 @@
+/****************************************************************************
+ *       Filename:  loopback_test.c
+ *
+ *    Description:  the workload of perform_test, with the clients and
+ *		    servers as threads of one process over the loopback :
+ *		    loopback_test LAT_PROC LON_PROC output_dir
+ *		    the servers use the null backend unless CFIO_BACKEND is
+ *		    set, pnetcdf can't be used over the loopback, set e.g.
+ *		    CFIO_BACKEND=posix to write into output_dir
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpi.h"
+#include "cfio.h"
+#include "test_def.h"
+
+typedef struct
+{
+    int lat_proc;
+    int lon_proc;
+    char *dir;
+}test_arg_t;
+
+static void proc_main(int rank, int size, void *_arg)
+{
+    test_arg_t *arg = _arg;
+    int i, j, ncidp, dimids[2], var[VALN];
+    size_t start[2], count[2], n;
+    char name[256];
+    double *fp;
+
+    start[0] = (rank % arg->lat_proc) * (LAT / arg->lat_proc);
+    start[1] = (rank / arg->lat_proc) * (LON / arg->lon_proc);
+    count[0] = LAT / arg->lat_proc;
+    count[1] = LON / arg->lon_proc;
+    n = count[0] * count[1];
+
+    if(cfio_init(arg->lat_proc, arg->lon_proc, CFIO_RATIO) < 0)
+    {
+	printf("proc %d : cfio_init fail.\n", rank);
+	return;
+    }
+    /* the servers return from cfio_init when all clients finalize */
+    if(cfio_proc_type() != CFIO_PROC_CLIENT)
+    {
+	cfio_finalize();
+	return;
+    }
+
+    fp = malloc(n * sizeof(double));
+    for(i = 0; i < n; i ++)
+    {
+	fp[i] = i + rank * n;
+    }
+
+    for(i = 0; i < LOOP; i ++)
+    {
+	sprintf(name, "%s/cfio-%d.nc", arg->dir, i);
+	cfio_create(name, NC_64BIT_OFFSET, &ncidp);
+	cfio_def_dim(ncidp, "lat", LAT, &dimids[0]);
+	cfio_def_dim(ncidp, "lon", LON, &dimids[1]);
+	for(j = 0; j < VALN; j ++)
+	{
+	    sprintf(name, "time_v%d", j);
+	    cfio_def_var(ncidp, name, CFIO_DOUBLE, 2, dimids,
+		    start, count, &var[j]);
+	}
+	cfio_enddef(ncidp);
+	for(j = 0; j < VALN; j ++)
+	{
+	    cfio_put_vara_double(ncidp, var[j], 2, start, count, fp);
+	}
+	cfio_close(ncidp);
+	cfio_io_end();
+    }
+
+    free(fp);
+    cfio_finalize();
+}
+
+int main(int argc, char** argv)
+{
+    test_arg_t arg;
+    int client_num, server_num, ret;
+    double start;
+
+    if(4 != argc)
+    {
+	printf("Usage : loopback_test LAT_PROC LON_PROC output_dir\n");
+	return -1;
+    }
+    arg.lat_proc = atoi(argv[1]);
+    arg.lon_proc = atoi(argv[2]);
+    arg.dir = argv[3];
+
+    client_num = arg.lat_proc * arg.lon_proc;
+    server_num = client_num / CFIO_RATIO;
+    if(server_num <= 0)
+    {
+	server_num = 1;
+    }
+
+    MPI_Init(&argc, &argv);
+    start = MPI_Wtime();
+    ret = cfio_loopback_run(client_num + server_num, proc_main, &arg);
+    printf("%d clients, %d servers, ret %d, total time : %f\n",
+	    client_num, server_num, ret, MPI_Wtime() - start);
+    MPI_Finalize();
+
+    return ret < 0 ? -1 : 0;
+}
@@ -13,6 +13,7 @@
  *        Company:  HPC Tsinghua
  ***************************************************************************/
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #include "mpi.h"
@@ -21,6 +22,34 @@
 #include "times.h"
 #include "test_def.h"
 
+/* define dims and vars of the test file, ncid can be a schema */
+static void def_file(int ncid, int record, size_t *start, size_t *count, 
+	int *var)
+{
+    int j;
+    int dimids[3];
+    char var_name[16];
+    int ndims = record ? 3 : 2;
+
+    if(record)
+    {
+	cfio_def_dim(ncid, "time", CFIO_UNLIMITED, &dimids[0]);
+    }
+    cfio_def_dim(ncid, "lat", LAT,&dimids[1]);
+    cfio_def_dim(ncid, "lon", LON,&dimids[2]);
+    ////cfio_put_att(ncid, NC_GLOBAL, "global", NC_CHAR, 6, "global");
+
+    for(j = 0; j < VALN; j++)
+    {
+	sprintf(var_name, "time_v%d", j);
+	cfio_def_var(ncid,var_name, CFIO_DOUBLE, ndims,
+		record ? dimids : dimids + 1, 
+		start, count, &var[j]);
+    //    cfio_put_att(ncid, var[j], "global", NC_CHAR, 
+    //	    strlen(var_name), var_name );
+    }
+}
+
 int main(int argc, char** argv)
 {
     int rank, size;
@@ -28,9 +57,15 @@ int main(int argc, char** argv)
     int dim1,var1,i, j, l;
 
     int LAT_PROC, LON_PROC;
-    size_t start[2],count[2];
+    size_t start[3],count[3];
+    size_t *_start, *_count;
+    int record, schema, multi, land, ndims;
+    int block, client_num;
+    size_t *starts[VALN], *counts[VALN];
+    cfio_type types[VALN];
+    void *bufs[VALN];
+    int schemaid;
     char fileName[100];
-    char var_name[16];
     int var[VALN];
     double compute_time = 0.0, IO_time = 0.0;
 
@@ -38,14 +73,24 @@ int main(int argc, char** argv)
     MPI_Comm comm = MPI_COMM_WORLD;
     volatile double a;
 
-    if(4 != argc)
+    if(4 != argc && 5 != argc)
     {
-	printf("Usage : perform_test LAT_PROC LON_PROC output_dir\n");
+	printf("Usage : perform_test LAT_PROC LON_PROC output_dir "
+		"[record|schema|multi|land]\n");
+	printf("\trecord : keep one file open and append a record each loop\n");
+	printf("\tschema : define a schema once and create each file from it\n");
+	printf("\tmulti : put all vars by one cfio_put_vara_multi\n");
+	printf("\tland : every third block is eliminated as land, "
+		"init by cfio_init_nd\n");
 	return -1;
     }
     
     LAT_PROC = atoi(argv[1]);
     LON_PROC = atoi(argv[2]);
+    record = (5 == argc && 0 == strcmp(argv[4], "record"));
+    schema = (5 == argc && 0 == strcmp(argv[4], "schema"));
+    multi = (5 == argc && 0 == strcmp(argv[4], "multi"));
+    land = (5 == argc && 0 == strcmp(argv[4], "land"));
     
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(comm, &rank);
@@ -63,28 +108,59 @@ int main(int argc, char** argv)
     //    set_debug_mask(DEBUG_MSG | DEBUG_CFIO);
     //}
     //set_debug_mask(DEBUG_SERVER | DEBUG_SENDER);
-    start[0] = (rank % LAT_PROC) * (LAT / LAT_PROC);
-    start[1] = (rank / LAT_PROC) * (LON / LON_PROC);
-    count[0] = LAT / LAT_PROC;
-    count[1] = LON / LON_PROC;
+    /* in land mode, rank i owns the i-th block left */
+    block = rank;
+    client_num = LAT_PROC * LON_PROC;
+    if(land)
+    {
+	client_num = 0;
+	for(j = 0; j < LAT_PROC * LON_PROC; j ++)
+	{
+	    if(j % 3 != 2 && client_num ++ == rank)
+	    {
+		block = j;
+	    }
+	}
+    }
+    /* start[0] and count[0] is the record dim, only used in record mode */
+    start[0] = 0;
+    start[1] = (block % LAT_PROC) * (LAT / LAT_PROC);
+    start[2] = (block / LAT_PROC) * (LON / LON_PROC);
+    count[0] = 1;
+    count[1] = LAT / LAT_PROC;
+    count[2] = LON / LON_PROC;
+    _start = record ? start : start + 1;
+    _count = record ? count : count + 1;
+    ndims = record ? 3 : 2;
     //start[0] = 0;
     //start[1] = rank * (LON / size);
     //count[0] = LAT ;
     //count[1] = LON / size;
-    double *fp = malloc(count[0] * count[1] *sizeof(double));
+    double *fp = malloc(count[1] * count[2] *sizeof(double));
 
 //    printf("Proc %d : start(%lu, %lu) ; count(%lu, %lu)\n", 
 //	    rank, start[0], start[1], count[0], count[1]);
 
-    for( i = 0; i< count[0] * count[1]; i++)
+    for( i = 0; i< count[1] * count[2]; i++)
     {
-	fp[i] = i + rank * count[0] * count[1];
+	fp[i] = i + rank * count[1] * count[2];
     }
 
     times_start();
-    cfio_init( LAT_PROC, LON_PROC, CFIO_RATIO);
+    if(land)
+    {
+	cfio_init_nd(client_num, 2, start + 1, count + 1, CFIO_RATIO);
+    }else
+    {
+	cfio_init( LAT_PROC, LON_PROC, CFIO_RATIO);
+    }
     CFIO_START();
     double start_time = times_cur();
+    if(schema)
+    {
+	cfio_schema_begin(&schemaid);
+	def_file(schemaid, record, _start, _count, var);
+    }
     //printf("Loop : %d\n", LOOP);
     for(i = 0; i < LOOP; i ++)
     {
@@ -102,38 +178,58 @@ int main(int argc, char** argv)
 	compute_time += times_end();
 	//printf("proc %d, loop %d compute time : %f\n", rank, i, times_end());
 	times_start();
-	sprintf(fileName,"%s/cfio-%d.nc", argv[3], i);
-	int dimids[2];
-	cfio_create(fileName, NC_64BIT_OFFSET, &ncidp);
-	int lat = LAT;
-	cfio_def_dim(ncidp, "lat", LAT,&dimids[0]);
-	cfio_def_dim(ncidp, "lon", LON,&dimids[1]);
-	////cfio_put_att(ncidp, NC_GLOBAL, "global", NC_CHAR, 6, "global");
-
-	for(j = 0; j < VALN; j++)
+	/* in record mode, only the first loop create the file */
+	if(!record || 0 == i)
 	{
-	    sprintf(var_name, "time_v%d", j);
-	    cfio_def_var(ncidp,var_name, CFIO_DOUBLE, 2,dimids, 
-		    start, count, &var[j]);
-	//    cfio_put_att(ncidp, var[j], "global", NC_CHAR, 
-	//	    strlen(var_name), var_name );
+	    sprintf(fileName,"%s/cfio-%d.nc", argv[3], i);
+	    if(schema)
+	    {
+		/* the file is in data mode, var ids are the same as schema */
+		cfio_create_from_schema(fileName, NC_64BIT_OFFSET, schemaid, 
+			&ncidp);
+	    }else
+	    {
+		cfio_create(fileName, NC_64BIT_OFFSET, &ncidp);
+		def_file(ncidp, record, _start, _count, var);
+		cfio_enddef(ncidp);
+	    }
 	}
-	cfio_enddef(ncidp);
 
-	for(j = 0; j < VALN; j++)
+	start[0] = i;
+	if(multi)
 	{
-	    cfio_put_vara_double(ncidp,var[j], 2,start, count,fp);
+	    for(j = 0; j < VALN; j++)
+	    {
+		starts[j] = _start;
+		counts[j] = _count;
+		types[j] = CFIO_DOUBLE;
+		bufs[j] = fp;
+	    }
+	    cfio_put_vara_multi(ncidp, VALN, var, starts, counts, types, bufs);
+	}else
+	{
+	    for(j = 0; j < VALN; j++)
+	    {
+		cfio_put_vara_double(ncidp,var[j], ndims, _start, _count,fp);
+	    }
 	}
 	//cfio_put_vara_float(rank,ncidp,var1, 2,start, count,fp); 
 	//cfio_put_vara_float(rank,ncidp,var1, 2,start, count,fp); 
 
-	cfio_close(ncidp);
+	if(!record || LOOP - 1 == i)
+	{
+	    cfio_close(ncidp);
+	}
 	//printf("send point : %f\n", times_cur() - start_time);
 	cfio_io_end();
 	//printf("proc %d send point : %f\n", rank, times_cur() - start_time);
 	IO_time += times_end();
 	//printf("proc %d, loop %d time : %f\n", rank, i, times_end());
     }
+    if(schema)
+    {
+	cfio_schema_free(schemaid);
+    }
     free(fp);
 
     //printf("proc %d before cfio final time : %f\n", rank, times_cur() - start_time);
@@ -0,0 +1,906 @@
+/****************************************************************************
+ *       Filename:  workload.c
+ *
+ *    Description:  synthetic climate model workload read from a spec file
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "workload.h"
+#include "times.h"
+
+#define _LINE_LEN 1024
+#define _MAX_DIMS 4
+
+static const char *type_names[] =
+{
+    NULL, "byte", "char", "short", "int", "float", "double"
+};
+
+/* the state of a file while the spec is run */
+typedef struct
+{
+    int ncid;
+    int open;
+    int *varids;
+    size_t record;		/* index of the next record */
+}_file_state_t;
+
+static int _parse_type(const char *name)
+{
+    int i;
+
+    if(NULL == name)
+    {
+	return -1;
+    }
+    for(i = 1; i < sizeof(type_names) / sizeof(type_names[0]); i ++)
+    {
+	if(CFIO_CHAR != i && 0 == strcmp(name, type_names[i]))
+	{
+	    return i;
+	}
+    }
+    return -1;
+}
+
+/**
+ * @brief: add an element to the end of an array
+ *
+ * @return: the new element, which is zeroed, NULL if malloc fail
+ */
+static void *_append(void **array, int *num, size_t size)
+{
+    char *p;
+
+    if(NULL == (p = realloc(*array, (*num + 1) * size)))
+    {
+	return NULL;
+    }
+    *array = p;
+    p += (*num) * size;
+    memset(p, 0, size);
+    (*num) ++;
+
+    return p;
+}
+
+static int _copy_name(char *dst, const char *src)
+{
+    if(NULL == src || strlen(src) >= WL_NAME_LEN)
+    {
+	return -1;
+    }
+    strcpy(dst, src);
+    return 0;
+}
+
+/**
+ * @brief: parse the rest of an att line, after the att name
+ */
+static int _parse_att(char *rest, wl_att_t *att)
+{
+    char *end, *tok;
+    int type;
+    size_t size = 0, i;
+
+    while(' ' == *rest || '\t' == *rest)
+    {
+	rest ++;
+    }
+    if('"' == *rest)
+    {
+	rest ++;
+	if(NULL == (end = strchr(rest, '"')))
+	{
+	    return -1;
+	}
+	att->type = CFIO_CHAR;
+	att->len = end - rest;
+	if(NULL == (att->data = malloc(att->len + 1)))
+	{
+	    return -1;
+	}
+	memcpy(att->data, rest, att->len);
+	((char *)att->data)[att->len] = 0;
+	return 0;
+    }
+
+    if((type = _parse_type(strtok(rest, " \t"))) < 0)
+    {
+	return -1;
+    }
+    att->type = type;
+    cfio_types_size(size, att->type);
+    while(NULL != (tok = strtok(NULL, " \t")))
+    {
+	i = att->len;
+	if(NULL == (att->data = realloc(att->data, (i + 1) * size)))
+	{
+	    return -1;
+	}
+	att->len ++;
+	switch(att->type)
+	{
+	    case CFIO_BYTE :
+		((signed char *)att->data)[i] = (signed char)atoi(tok);
+		break;
+	    case CFIO_SHORT :
+		((short *)att->data)[i] = (short)atoi(tok);
+		break;
+	    case CFIO_INT :
+		((int *)att->data)[i] = atoi(tok);
+		break;
+	    case CFIO_FLOAT :
+		((float *)att->data)[i] = (float)atof(tok);
+		break;
+	    default :
+		((double *)att->data)[i] = atof(tok);
+		break;
+	}
+    }
+
+    return att->len > 0 ? 0 : -1;
+}
+
+/**
+ * @brief: parse the step list of a file, like 1,2,5
+ */
+static int _parse_steps(char *list, wl_file_t *file)
+{
+    char *tok, *save;
+    int *step;
+
+    for(tok = strtok_r(list, ",", &save); NULL != tok;
+	    tok = strtok_r(NULL, ",", &save))
+    {
+	if(NULL == (step = _append((void **)&file->steps, &file->step_num,
+			sizeof(int))))
+	{
+	    return -1;
+	}
+	*step = atoi(tok);
+    }
+
+    return file->step_num > 0 ? 0 : -1;
+}
+
+static int _parse_file(wl_file_t *file)
+{
+    char *tok;
+
+    if(_copy_name(file->name, strtok(NULL, " \t")))
+    {
+	return -1;
+    }
+    while(NULL != (tok = strtok(NULL, " \t")))
+    {
+	if(0 == strcmp(tok, "every"))
+	{
+	    if(NULL == (tok = strtok(NULL, " \t")) ||
+		    (file->every = atoi(tok)) <= 0)
+	    {
+		return -1;
+	    }
+	}else if(0 == strcmp(tok, "offset"))
+	{
+	    if(NULL == (tok = strtok(NULL, " \t")))
+	    {
+		return -1;
+	    }
+	    file->offset = atoi(tok);
+	}else if(0 == strcmp(tok, "at"))
+	{
+	    if(NULL == (tok = strtok(NULL, " \t")) ||
+		    _parse_steps(tok, file))
+	    {
+		return -1;
+	    }
+	}else if(0 == strcmp(tok, "record"))
+	{
+	    file->record = 1;
+	}else
+	{
+	    return -1;
+	}
+    }
+    /* either every or at */
+    if((0 == file->every) == (0 == file->step_num))
+    {
+	return -1;
+    }
+
+    return 0;
+}
+
+static int _parse_var(wl_file_t *file)
+{
+    wl_var_t *var;
+    char *tok;
+    int type;
+
+    if(NULL == (var = _append((void **)&file->vars, &file->var_num,
+		    sizeof(wl_var_t))))
+    {
+	return -1;
+    }
+    if(_copy_name(var->name, strtok(NULL, " \t")) ||
+	    NULL == (tok = strtok(NULL, " \t")))
+    {
+	return -1;
+    }
+    if(0 == strcmp(tok, "2d"))
+    {
+	var->kind = WL_VAR_2D;
+    }else if(0 == strcmp(tok, "3d"))
+    {
+	var->kind = WL_VAR_3D;
+    }else
+    {
+	return -1;
+    }
+    if((type = _parse_type(strtok(NULL, " \t"))) < 0)
+    {
+	return -1;
+    }
+    var->type = type;
+
+    return 0;
+}
+
+static int _parse_diag(wl_file_t *file)
+{
+    wl_diag_t *diag;
+    wl_var_t *var;
+    char *tok, *name;
+    int i, n, type;
+
+    name = strtok(NULL, " \t");
+    if(NULL == (tok = strtok(NULL, " \t")) || (n = atoi(tok)) <= 0 ||
+	    (type = _parse_type(strtok(NULL, " \t"))) < 0 ||
+	    NULL == (tok = strtok(NULL, " \t")) || atoi(tok) <= 0)
+    {
+	return -1;
+    }
+    if(NULL == (diag = _append((void **)&file->diags, &file->diag_num,
+		    sizeof(wl_diag_t))) || _copy_name(diag->name, name))
+    {
+	return -1;
+    }
+    diag->len = atoi(tok);
+
+    for(i = 0; i < n; i ++)
+    {
+	if(NULL == (var = _append((void **)&file->vars, &file->var_num,
+			sizeof(wl_var_t))))
+	{
+	    return -1;
+	}
+	if(snprintf(var->name, WL_NAME_LEN, "%s_%d", name, i) >= WL_NAME_LEN)
+	{
+	    return -1;
+	}
+	var->kind = WL_VAR_DIAG;
+	var->type = type;
+	var->diag = file->diag_num - 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief: parse a line of spec, the line is changed
+ *
+ * @param last_var: whether the last directive is var, which atts belong to
+ */
+static int _parse_line(char *line, wl_spec_t *spec, int *last_var)
+{
+    wl_file_t *file = spec->file_num > 0 ?
+	spec->files + spec->file_num - 1 : NULL;
+    wl_att_t *att;
+    char *tok, *name, *p, *end;
+    int *num;
+    wl_att_t **atts;
+    int in_quote = 0;
+
+    /* cut the comment, which is not in a string */
+    for(p = line; 0 != *p; p ++)
+    {
+	if('"' == *p)
+	{
+	    in_quote = !in_quote;
+	}else if('#' == *p && !in_quote)
+	{
+	    *p = 0;
+	    break;
+	}
+    }
+    line[strcspn(line, "\r\n")] = 0;
+    end = line + strlen(line);
+
+    if(NULL == (tok = strtok(line, " \t")))
+    {
+	return 0;
+    }
+    if(0 == strcmp(tok, "grid"))
+    {
+	if(NULL == (tok = strtok(NULL, " \t")) ||
+		0 == (spec->lat = atol(tok)) ||
+		NULL == (tok = strtok(NULL, " \t")) ||
+		0 == (spec->lon = atol(tok)) ||
+		NULL == (tok = strtok(NULL, " \t")))
+	{
+	    return -1;
+	}
+	spec->lev = atol(tok);
+	return 0;
+    }else if(0 == strcmp(tok, "steps"))
+    {
+	return NULL != (tok = strtok(NULL, " \t")) &&
+	    (spec->steps = atoi(tok)) > 0 ? 0 : -1;
+    }else if(0 == strcmp(tok, "compute"))
+    {
+	return NULL != (tok = strtok(NULL, " \t")) &&
+	    (spec->compute_ms = atoi(tok)) >= 0 ? 0 : -1;
+    }else if(0 == strcmp(tok, "file"))
+    {
+	*last_var = 0;
+	if(NULL == (file = _append((void **)&spec->files, &spec->file_num,
+			sizeof(wl_file_t))))
+	{
+	    return -1;
+	}
+	return _parse_file(file);
+    }
+
+    /* the others belong to a file */
+    if(NULL == file)
+    {
+	return -1;
+    }
+    if(0 == strcmp(tok, "var"))
+    {
+	*last_var = 1;
+	return _parse_var(file);
+    }else if(0 == strcmp(tok, "diag"))
+    {
+	*last_var = 0;
+	return _parse_diag(file);
+    }else if(0 == strcmp(tok, "att"))
+    {
+	if(*last_var)
+	{
+	    num = &file->vars[file->var_num - 1].att_num;
+	    atts = &file->vars[file->var_num - 1].atts;
+	}else
+	{
+	    num = &file->att_num;
+	    atts = &file->atts;
+	}
+	name = strtok(NULL, " \t");
+	/* the values follow the name */
+	if(NULL == name || name + strlen(name) >= end ||
+		NULL == (att = _append((void **)atts, num, sizeof(wl_att_t))))
+	{
+	    return -1;
+	}
+	if(_copy_name(att->name, name))
+	{
+	    return -1;
+	}
+	return _parse_att(name + strlen(name) + 1, att);
+    }
+
+    return -1;
+}
+
+int wl_spec_read(const char *path, wl_spec_t *spec)
+{
+    FILE *fp;
+    char line[_LINE_LEN];
+    int line_no = 0, last_var = 0, i, j;
+
+    memset(spec, 0, sizeof(wl_spec_t));
+    spec->steps = 1;
+    if(NULL == (fp = fopen(path, "r")))
+    {
+	printf("open spec file %s fail.\n", path);
+	return -1;
+    }
+    while(NULL != fgets(line, _LINE_LEN, fp))
+    {
+	line_no ++;
+	if(_parse_line(line, spec, &last_var))
+	{
+	    printf("%s:%d : invalid directive.\n", path, line_no);
+	    fclose(fp);
+	    wl_spec_free(spec);
+	    return -1;
+	}
+    }
+    fclose(fp);
+
+    if(0 == spec->lat || 0 == spec->lon || 0 == spec->file_num)
+    {
+	printf("%s : grid and at least one file are needed.\n", path);
+	wl_spec_free(spec);
+	return -1;
+    }
+    for(i = 0; i < spec->file_num; i ++)
+    {
+	if(0 == spec->files[i].var_num)
+	{
+	    printf("%s : file %s has no var.\n", path, spec->files[i].name);
+	    wl_spec_free(spec);
+	    return -1;
+	}
+	for(j = 0; j < spec->files[i].var_num; j ++)
+	{
+	    if(WL_VAR_3D == spec->files[i].vars[j].kind && 0 == spec->lev)
+	    {
+		printf("%s : 3d var %s needs LEV of grid.\n", path,
+			spec->files[i].vars[j].name);
+		wl_spec_free(spec);
+		return -1;
+	    }
+	}
+    }
+
+    return 0;
+}
+
+static void _free_atts(wl_att_t *atts, int att_num)
+{
+    int i;
+
+    for(i = 0; i < att_num; i ++)
+    {
+	free(atts[i].data);
+    }
+    free(atts);
+}
+
+void wl_spec_free(wl_spec_t *spec)
+{
+    int i, j;
+    wl_file_t *file;
+
+    for(i = 0; i < spec->file_num; i ++)
+    {
+	file = spec->files + i;
+	for(j = 0; j < file->var_num; j ++)
+	{
+	    _free_atts(file->vars[j].atts, file->vars[j].att_num);
+	}
+	_free_atts(file->atts, file->att_num);
+	free(file->vars);
+	free(file->diags);
+	free(file->steps);
+    }
+    free(spec->files);
+    memset(spec, 0, sizeof(wl_spec_t));
+}
+
+int wl_file_due(wl_file_t *file, int step)
+{
+    int i;
+
+    if(file->every > 0)
+    {
+	return step >= file->offset &&
+	    (step - file->offset) % file->every == 0;
+    }
+    for(i = 0; i < file->step_num; i ++)
+    {
+	if(file->steps[i] == step)
+	{
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+int wl_decomp_grid(wl_spec_t *spec, int x_proc, int y_proc, int client_id,
+	wl_decomp_t *decomp)
+{
+    if(x_proc <= 0 || y_proc <= 0 ||
+	    spec->lat % x_proc != 0 || spec->lon % y_proc != 0)
+    {
+	return -1;
+    }
+    decomp->client_id = client_id;
+    decomp->client_num = x_proc * y_proc;
+    decomp->count[0] = spec->lat / x_proc;
+    decomp->count[1] = spec->lon / y_proc;
+    decomp->start[0] = (client_id % x_proc) * decomp->count[0];
+    decomp->start[1] = (client_id / x_proc) * decomp->count[1];
+
+    return 0;
+}
+
+/**
+ * @brief: get the dims, start and count of a var put by a client
+ *
+ * @param file_dims: dim ids of the file, as defined in _def_file, NULL if
+ *	the dims of the var are not needed
+ *
+ * @return: ndims of the var
+ */
+static int _var_shape(wl_spec_t *spec, wl_file_t *file, wl_var_t *var,
+	wl_decomp_t *decomp, int *file_dims, size_t record,
+	int *dimids, size_t *start, size_t *count)
+{
+    int i, ndims = 0, dims[_MAX_DIMS];
+
+    if(file->record)
+    {
+	dims[ndims] = 0;
+	start[ndims] = record;
+	count[ndims] = 1;
+	ndims ++;
+    }
+    switch(var->kind)
+    {
+	case WL_VAR_3D :
+	    dims[ndims] = 3;
+	    start[ndims] = 0;
+	    count[ndims] = spec->lev;
+	    ndims ++;
+	    /* fall through */
+	case WL_VAR_2D :
+	    dims[ndims] = 1;
+	    start[ndims] = decomp->start[0];
+	    count[ndims] = decomp->count[0];
+	    ndims ++;
+	    dims[ndims] = 2;
+	    start[ndims] = decomp->start[1];
+	    count[ndims] = decomp->count[1];
+	    ndims ++;
+	    break;
+	default :
+	    dims[ndims] = 4 + var->diag;
+	    start[ndims] = decomp->client_id * file->diags[var->diag].len;
+	    count[ndims] = file->diags[var->diag].len;
+	    ndims ++;
+	    break;
+    }
+    if(NULL != file_dims)
+    {
+	for(i = 0; i < ndims; i ++)
+	{
+	    dimids[i] = file_dims[dims[i]];
+	}
+    }
+
+    return ndims;
+}
+
+static size_t _var_size(wl_spec_t *spec, wl_file_t *file, wl_var_t *var,
+	wl_decomp_t *decomp)
+{
+    size_t n, size = 0;
+
+    cfio_types_size(size, var->type);
+    switch(var->kind)
+    {
+	case WL_VAR_3D :
+	    n = spec->lev * decomp->count[0] * decomp->count[1];
+	    break;
+	case WL_VAR_2D :
+	    n = decomp->count[0] * decomp->count[1];
+	    break;
+	default :
+	    n = file->diags[var->diag].len;
+	    break;
+    }
+
+    return n * size;
+}
+
+size_t wl_step_bytes(wl_spec_t *spec, wl_decomp_t *decomp, int step)
+{
+    int i, j;
+    size_t bytes = 0;
+
+    for(i = 0; i < spec->file_num; i ++)
+    {
+	if(!wl_file_due(spec->files + i, step))
+	{
+	    continue;
+	}
+	for(j = 0; j < spec->files[i].var_num; j ++)
+	{
+	    bytes += _var_size(spec, spec->files + i, spec->files[i].vars + j,
+		    decomp);
+	}
+    }
+
+    return bytes;
+}
+
+/**
+ * @brief: create a file and define its dims, vars and atts
+ */
+static int _def_file(wl_spec_t *spec, wl_file_t *file, _file_state_t *state,
+	wl_writer_t *writer, wl_decomp_t *decomp, const char *dir, int step)
+{
+    char path[256];
+    int i, j, ndims, has_3d = 0;
+    /* time, lat, lon, lev, and the diag dims */
+    int *file_dims, dimids[_MAX_DIMS];
+    size_t start[_MAX_DIMS], count[_MAX_DIMS];
+    wl_var_t *var;
+    wl_att_t *att;
+
+    if(file->record)
+    {
+	snprintf(path, sizeof(path), "%s/%s.nc", dir, file->name);
+    }else
+    {
+	snprintf(path, sizeof(path), "%s/%s-%d.nc", dir, file->name, step);
+    }
+    if(NULL == (file_dims = malloc(sizeof(int) * (4 + file->diag_num))))
+    {
+	return -1;
+    }
+    if(writer->create(path, &state->ncid))
+    {
+	printf("create %s fail.\n", path);
+	free(file_dims);
+	return -1;
+    }
+    state->open = 1;
+    state->record = 0;
+
+    for(i = 0; i < file->var_num; i ++)
+    {
+	has_3d |= (WL_VAR_3D == file->vars[i].kind);
+    }
+    if(file->record)
+    {
+	writer->def_dim(state->ncid, "time", CFIO_UNLIMITED, &file_dims[0]);
+    }
+    writer->def_dim(state->ncid, "lat", spec->lat, &file_dims[1]);
+    writer->def_dim(state->ncid, "lon", spec->lon, &file_dims[2]);
+    if(has_3d)
+    {
+	writer->def_dim(state->ncid, "lev", spec->lev, &file_dims[3]);
+    }
+    for(i = 0; i < file->diag_num; i ++)
+    {
+	writer->def_dim(state->ncid, file->diags[i].name,
+		file->diags[i].len * decomp->client_num, &file_dims[4 + i]);
+    }
+    for(i = 0; i < file->att_num; i ++)
+    {
+	att = file->atts + i;
+	writer->put_att(state->ncid, NC_GLOBAL, att->name, att->type,
+		att->len, att->data);
+    }
+
+    for(i = 0; i < file->var_num; i ++)
+    {
+	var = file->vars + i;
+	ndims = _var_shape(spec, file, var, decomp, file_dims, 0,
+		dimids, start, count);
+	writer->def_var(state->ncid, var->name, var->type, ndims, dimids,
+		start, count, &state->varids[i]);
+	for(j = 0; j < var->att_num; j ++)
+	{
+	    att = var->atts + j;
+	    writer->put_att(state->ncid, state->varids[i], att->name,
+		    att->type, att->len, att->data);
+	}
+    }
+    writer->enddef(state->ncid);
+    free(file_dims);
+
+    return 0;
+}
+
+static int _put_file(wl_spec_t *spec, wl_file_t *file, _file_state_t *state,
+	wl_writer_t *writer, wl_decomp_t *decomp, void **bufs)
+{
+    int i, ndims, ret = 0;
+    size_t start[_MAX_DIMS], count[_MAX_DIMS];
+    wl_var_t *var;
+
+    for(i = 0; i < file->var_num; i ++)
+    {
+	var = file->vars + i;
+	ndims = _var_shape(spec, file, var, decomp, NULL, state->record,
+		NULL, start, count);
+	ret |= writer->put_vara(state->ncid, state->varids[i], ndims,
+		start, count, var->type, bufs[var->type]);
+    }
+    state->record ++;
+
+    return ret;
+}
+
+static void _compute(int ms)
+{
+    struct timespec ts;
+
+    if(ms <= 0)
+    {
+	return;
+    }
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    nanosleep(&ts, NULL);
+}
+
+static void _fill_data(void *buf, cfio_type type, size_t n, int rank)
+{
+    size_t i;
+
+    for(i = 0; i < n; i ++)
+    {
+	switch(type)
+	{
+	    case CFIO_BYTE :
+		((signed char *)buf)[i] = (signed char)(i + rank);
+		break;
+	    case CFIO_SHORT :
+		((short *)buf)[i] = (short)(i + rank);
+		break;
+	    case CFIO_INT :
+		((int *)buf)[i] = (int)(i + rank);
+		break;
+	    case CFIO_FLOAT :
+		((float *)buf)[i] = (float)(i + rank);
+		break;
+	    default :
+		((double *)buf)[i] = (double)(i + rank);
+		break;
+	}
+    }
+}
+
+int wl_run(wl_spec_t *spec, wl_writer_t *writer, wl_decomp_t *decomp,
+	const char *dir, wl_result_t *result)
+{
+    _file_state_t *states;
+    void *bufs[CFIO_DOUBLE + 1] = {NULL};
+    size_t n, max_n = 1, size;
+    int i, j, step, written, ret = -1;
+    double t;
+    wl_file_t *file;
+
+    memset(result, 0, sizeof(wl_result_t));
+
+    /* a buffer of each type, large enough for any var */
+    n = decomp->count[0] * decomp->count[1] * (spec->lev > 0 ? spec->lev : 1);
+    max_n = n > max_n ? n : max_n;
+    for(i = 0; i < spec->file_num; i ++)
+    {
+	for(j = 0; j < spec->files[i].diag_num; j ++)
+	{
+	    n = spec->files[i].diags[j].len;
+	    max_n = n > max_n ? n : max_n;
+	}
+    }
+    for(i = CFIO_BYTE; i <= CFIO_DOUBLE; i ++)
+    {
+	if(CFIO_CHAR == i)
+	{
+	    continue;
+	}
+	size = 0;
+	cfio_types_size(size, i);
+	if(NULL == (bufs[i] = malloc(size * max_n)))
+	{
+	    printf("client %d : malloc fail.\n", decomp->client_id);
+	    goto RETURN;
+	}
+	_fill_data(bufs[i], i, max_n, decomp->client_id);
+    }
+
+    if(NULL == (states = calloc(spec->file_num, sizeof(_file_state_t))))
+    {
+	printf("client %d : malloc fail.\n", decomp->client_id);
+	goto RETURN;
+    }
+    for(i = 0; i < spec->file_num; i ++)
+    {
+	if(NULL == (states[i].varids =
+		    malloc(sizeof(int) * spec->files[i].var_num)))
+	{
+	    printf("client %d : malloc fail.\n", decomp->client_id);
+	    goto FREE_STATES;
+	}
+    }
+
+    for(step = 0; step < spec->steps; step ++)
+    {
+	t = times_cur();
+	_compute(spec->compute_ms);
+	result->compute_time += times_cur() - t;
+
+	t = times_cur();
+	written = 0;
+	/* the due files are all open at the same time, as a model writes its
+	 * history and restart files in the same step */
+	for(i = 0; i < spec->file_num; i ++)
+	{
+	    file = spec->files + i;
+	    if(wl_file_due(file, step) && !states[i].open)
+	    {
+		if(_def_file(spec, file, states + i, writer, decomp, dir, step))
+		{
+		    goto FREE_STATES;
+		}
+		result->file_count ++;
+	    }
+	}
+	for(i = 0; i < spec->file_num; i ++)
+	{
+	    file = spec->files + i;
+	    if(wl_file_due(file, step))
+	    {
+		if(_put_file(spec, file, states + i, writer, decomp, bufs))
+		{
+		    printf("client %d : put %s fail.\n",
+			    decomp->client_id, file->name);
+		}
+		written = 1;
+	    }
+	}
+	for(i = 0; i < spec->file_num; i ++)
+	{
+	    file = spec->files + i;
+	    /* a record file is closed after its last record */
+	    if(wl_file_due(file, step) && (!file->record ||
+			spec->steps - 1 == step))
+	    {
+		writer->close(states[i].ncid);
+		states[i].open = 0;
+	    }
+	}
+	if(written)
+	{
+	    writer->io_end();
+	}
+	result->io_time += times_cur() - t;
+	result->data_bytes += wl_step_bytes(spec, decomp, step);
+    }
+
+    /* record files not due in the last step */
+    t = times_cur();
+    written = 0;
+    for(i = 0; i < spec->file_num; i ++)
+    {
+	if(states[i].open)
+	{
+	    writer->close(states[i].ncid);
+	    states[i].open = 0;
+	    written = 1;
+	}
+    }
+    if(written)
+    {
+	writer->io_end();
+    }
+    result->io_time += times_cur() - t;
+    ret = 0;
+
+FREE_STATES:
+    for(i = 0; i < spec->file_num; i ++)
+    {
+	free(states[i].varids);
+    }
+    free(states);
+RETURN:
+    for(i = CFIO_BYTE; i <= CFIO_DOUBLE; i ++)
+    {
+	free(bufs[i]);
+    }
+    return ret;
+}
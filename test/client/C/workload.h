@@ -0,0 +1,182 @@
+/****************************************************************************
+ *       Filename:  workload.h
+ *
+ *    Description:  synthetic climate model workload, the files, vars, atts
+ *		    and output frequencies are read from a spec file, and the
+ *		    steps are run through a writer, so that the same workload
+ *		    can be written by cfio or by other libs
+ *
+ *		    a spec file has one directive a line, # starts a comment :
+ *
+ *		    grid LAT LON LEV	size of the 2-D vars and levels of 3-D
+ *		    steps N		amount of model steps
+ *		    compute MS		compute time of each step
+ *		    file NAME every N [offset M] [record]
+ *		    file NAME at S1,S2,... [record]
+ *					a file written in step i if
+ *					i % N == M, or i is in the list. a
+ *					record file is created once and a
+ *					record is appended each time, or else
+ *					a new file NAME-i.nc is written
+ *		    var NAME 2d|3d TYPE	a var of the last file, 3d is
+ *					LEV x LAT x LON
+ *		    diag NAME N TYPE LEN
+ *					N 1-D vars NAME_0 ... NAME_N-1 of the
+ *					last file, each client puts LEN values
+ *					of them, LEN 1 for scalar diagnostics
+ *		    att NAME "text"
+ *		    att NAME TYPE V1 V2 ...
+ *					an att of the last var, or a global
+ *					att if it follows the file directly
+ *
+ *		    TYPE is one of byte, short, int, float, double
+ *
+ *        Version:  1.0
+ *       Revision:  none
+ *       Compiler:  gcc
+ ***************************************************************************/
+#ifndef _WORKLOAD_H
+#define _WORKLOAD_H
+
+#include <stddef.h>
+
+#include "cfio_types.h"
+
+#define WL_NAME_LEN	64
+#define WL_VAR_2D	0
+#define WL_VAR_3D	1
+#define WL_VAR_DIAG	2
+
+typedef struct
+{
+    char name[WL_NAME_LEN];
+    cfio_type type;
+    size_t len;			/* amount of values */
+    void *data;
+}wl_att_t;
+
+typedef struct
+{
+    char name[WL_NAME_LEN];
+    int kind;			/* WL_VAR_2D, WL_VAR_3D or WL_VAR_DIAG */
+    cfio_type type;
+    int diag;			/* index of the diag dim, only WL_VAR_DIAG */
+    int att_num;
+    wl_att_t *atts;
+}wl_var_t;
+
+typedef struct
+{
+    char name[WL_NAME_LEN];
+    size_t len;			/* values put by each client */
+}wl_diag_t;
+
+typedef struct
+{
+    char name[WL_NAME_LEN];
+    int every, offset;		/* every 0 if the steps are listed */
+    int step_num;
+    int *steps;
+    int record;
+    int att_num;
+    wl_att_t *atts;
+    int var_num;
+    wl_var_t *vars;
+    int diag_num;
+    wl_diag_t *diags;
+}wl_file_t;
+
+typedef struct
+{
+    size_t lat, lon, lev;
+    int steps;
+    int compute_ms;
+    int file_num;
+    wl_file_t *files;
+}wl_spec_t;
+
+/**
+ * @brief: the decomposition of a client, 3-D vars are not decomposed in LEV
+ **/
+typedef struct
+{
+    int client_id;
+    int client_num;
+    size_t start[2], count[2];	/* block of the client in LAT x LON */
+}wl_decomp_t;
+
+/**
+ * @brief: the lib the workload is written by, each function returns 0 if
+ *	success, varid is NC_GLOBAL for a global att
+ **/
+typedef struct
+{
+    const char *name;
+    int (*create)(char *path, int *ncid);
+    int (*def_dim)(int ncid, char *name, size_t len, int *dimid);
+    int (*def_var)(int ncid, char *name, cfio_type type, int ndims,
+	    int *dimids, size_t *start, size_t *count, int *varid);
+    int (*put_att)(int ncid, int varid, char *name, cfio_type type,
+	    size_t len, void *data);
+    int (*enddef)(int ncid);
+    int (*put_vara)(int ncid, int varid, int ndims, size_t *start,
+	    size_t *count, cfio_type type, void *data);
+    int (*close)(int ncid);
+    /* called at the end of each step in which some file is written */
+    int (*io_end)();
+}wl_writer_t;
+
+/**
+ * @brief: time of a client, in ms
+ **/
+typedef struct
+{
+    double io_time;		/* time in the writer of all steps */
+    double compute_time;
+    double data_bytes;		/* bytes put */
+    int file_count;		/* files created */
+}wl_result_t;
+
+/**
+ * @brief: read a spec file
+ *
+ * @param path: path of the spec file
+ * @param spec: where the spec is to be stored
+ *
+ * @return: 0 if success, or else an error is printed and -1 is returned
+ */
+int wl_spec_read(const char *path, wl_spec_t *spec);
+/**
+ * @brief: free the space of a spec
+ */
+void wl_spec_free(wl_spec_t *spec);
+/**
+ * @brief: whether a file of spec is written in a step
+ */
+int wl_file_due(wl_file_t *file, int step);
+/**
+ * @brief: bytes put by a client in a step
+ */
+size_t wl_step_bytes(wl_spec_t *spec, wl_decomp_t *decomp, int step);
+/**
+ * @brief: block decomposition of a client in a x_proc x y_proc grid
+ *
+ * @return: 0 if LAT and LON can be divided by x_proc and y_proc, or else -1
+ */
+int wl_decomp_grid(wl_spec_t *spec, int x_proc, int y_proc, int client_id,
+	wl_decomp_t *decomp);
+/**
+ * @brief: run all steps of a spec by a client
+ *
+ * @param spec: the spec
+ * @param writer: the lib the files are written by
+ * @param decomp: decomposition of the client
+ * @param dir: dir of the output files
+ * @param result: where the time of the client is to be stored
+ *
+ * @return: 0 if success, or else -1
+ */
+int wl_run(wl_spec_t *spec, wl_writer_t *writer, wl_decomp_t *decomp,
+	const char *dir, wl_result_t *result);
+
+#endif